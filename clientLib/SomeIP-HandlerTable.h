@@ -0,0 +1,218 @@
+#pragma once
+
+#include "SomeIP-clientLib.h"
+#include <unordered_map>
+
+namespace SomeIPClient {
+
+/**
+ * A ClientConnectionListener which routes the incoming messages to handlers registered per method or event, instead of
+ * having the application test the service, instance and member IDs of every message. The handlers of a service are stored
+ * in arrays indexed by member ID, so that a message is routed with a hash lookup and an array access. A request which
+ * has no handler is answered with an ERROR message.
+ * The handlers should be registered before the connection dispatches any message.
+ */
+class MessageHandlerTable : public ClientConnectionListener {
+
+	LOG_SET_CLASS_CONTEXT(clientLibContext);
+
+public:
+	typedef std::function<void (const InputMessage&)> MessageHandler;
+
+	/**
+	 * Receives a part of the payload of a message. The given message only contains the header when its payload is streamed.
+	 */
+	typedef std::function<void (const InputMessage& msg, const void* data, size_t length, bool isLast)> ChunkHandler;
+
+	MessageHandlerTable(MessageSource& connection) : m_connection(connection) {
+	}
+
+	/**
+	 * Registers the handler of the requests sent to the given method
+	 */
+	void onMethod(SomeIP::ServiceIDs serviceIDs, SomeIP::MemberID memberID, MessageHandler handler) {
+		getServiceHandlers(serviceIDs).m_methods.set(memberID, handler);
+	}
+
+	/**
+	 * Registers the handler of the notifications of the given event
+	 */
+	void onEvent(SomeIP::ServiceIDs serviceIDs, SomeIP::MemberID memberID, MessageHandler handler) {
+		getServiceHandlers(serviceIDs).m_events.set(memberID, handler);
+	}
+
+	/**
+	 * Registers the handler of the requests sent to the given method, which receives their payload by chunks as it arrives
+	 * when it reaches the streaming threshold of the connection, so that it never needs to be buffered entirely. A smaller
+	 * payload is passed as a single chunk. The handler is used only if no handler is registered with onMethod().
+	 */
+	void onStreamingMethod(SomeIP::ServiceIDs serviceIDs, SomeIP::MemberID memberID, ChunkHandler handler) {
+		getServiceHandlers(serviceIDs).m_streamingMethods.set(memberID, handler);
+	}
+
+	/**
+	 * Registers the handler of the notifications of the given event, which receives their payload by chunks as it arrives
+	 */
+	void onStreamingEvent(SomeIP::ServiceIDs serviceIDs, SomeIP::MemberID memberID, ChunkHandler handler) {
+		getServiceHandlers(serviceIDs).m_streamingEvents.set(memberID, handler);
+	}
+
+	/**
+	 * Sets the sink which receives the messages without handler, such as the answers to the requests sent with
+	 * ClientConnection::sendMessage(). A request which the sink does not process is answered with an ERROR message.
+	 */
+	void setDefaultSink(MessageSink* sink) {
+		m_defaultSink = sink;
+	}
+
+	void setDisconnectionHandler(std::function<void()> handler) {
+		m_disconnectionHandler = handler;
+	}
+
+	MessageProcessingResult processMessage(const InputMessage& msg) override {
+
+		const ServiceHandlers* service = findService( SomeIP::ServiceIDs( msg.getServiceID(), msg.getInstanceID() ) );
+
+		if (service != nullptr) {
+			auto handler = findHandler(*service, msg);
+			if (handler != nullptr) {
+				(*handler)(msg);
+				return MessageProcessingResult::Processed_OK;
+			}
+
+			auto chunkHandler = findChunkHandler(*service, msg);
+			if (chunkHandler != nullptr) {
+				(*chunkHandler)(msg, msg.getPayload(), msg.getPayloadLength(), true);
+				return MessageProcessingResult::Processed_OK;
+			}
+		}
+
+		if (m_defaultSink != nullptr) {
+			auto result = m_defaultSink->processMessage(msg);
+			if (result != MessageProcessingResult::NotProcessed_OK)
+				return result;
+		}
+
+		if ( msg.getHeader().isRequestWithReturn() ) {
+			sendError(msg, (service != nullptr) ? SomeIP::E_UNKNOWN_METHOD : SomeIP::E_UNKNOWN_SERVICE);
+			return MessageProcessingResult::Processed_Error;
+		}
+
+		return MessageProcessingResult::NotProcessed_OK;
+	}
+
+	void onDisconnected() override {
+		if (m_disconnectionHandler)
+			m_disconnectionHandler();
+	}
+
+	bool isStreamedMessage(const InputMessage& msg, size_t payloadLength) override {
+		// the handlers registered with onMethod() and onEvent() take precedence, and receive the whole payload
+		const ServiceHandlers* service = findService( SomeIP::ServiceIDs( msg.getServiceID(), msg.getInstanceID() ) );
+		return (service != nullptr) && (findHandler(*service, msg) == nullptr) && (findChunkHandler(*service, msg) != nullptr);
+	}
+
+	void processPayloadChunk(const InputMessage& msg, const void* data, size_t length, bool isLast) override {
+		const ServiceHandlers* service = findService( SomeIP::ServiceIDs( msg.getServiceID(), msg.getInstanceID() ) );
+		auto chunkHandler = (service != nullptr) ? findChunkHandler(*service, msg) : nullptr;
+		if (chunkHandler != nullptr)
+			(*chunkHandler)(msg, data, length, isLast);
+	}
+
+private:
+	/**
+	 * The handlers of the members of a service, indexed by member ID. Only the range between the smallest and the largest
+	 * member IDs is allocated, which keeps the array small, since the member IDs of a service are usually consecutive.
+	 */
+	template<typename Handler>
+	class HandlerArray {
+
+	public:
+		const Handler* find(SomeIP::MemberID memberID) const {
+			// the index wraps around if the member ID is lower than the first one
+			size_t index = static_cast<size_t>(memberID) - m_firstMemberID;
+			if ( (index < m_handlers.size()) && m_handlers[index] )
+				return &m_handlers[index];
+			return nullptr;
+		}
+
+		void set(SomeIP::MemberID memberID, Handler handler) {
+			if ( m_handlers.empty() )
+				m_firstMemberID = memberID;
+			else if (memberID < m_firstMemberID) {
+				m_handlers.insert(m_handlers.begin(), m_firstMemberID - memberID, Handler());
+				m_firstMemberID = memberID;
+			}
+
+			size_t index = memberID - m_firstMemberID;
+			if ( index >= m_handlers.size() )
+				m_handlers.resize(index + 1);
+			m_handlers[index] = handler;
+		}
+
+	private:
+		SomeIP::MemberID m_firstMemberID = 0;
+		std::vector<Handler> m_handlers;
+	};
+
+	struct ServiceHandlers {
+		HandlerArray<MessageHandler> m_methods;
+		HandlerArray<MessageHandler> m_events;
+		HandlerArray<ChunkHandler> m_streamingMethods;
+		HandlerArray<ChunkHandler> m_streamingEvents;
+	};
+
+	static const MessageHandler* findHandler(const ServiceHandlers& service, const InputMessage& msg) {
+		switch ( msg.getMessageType() ) {
+		case SomeIP::MessageType::REQUEST :
+		case SomeIP::MessageType::REQUEST_NO_RETURN : return service.m_methods.find( msg.getHeader().getMemberID() );
+		case SomeIP::MessageType::NOTIFICATION : return service.m_events.find( msg.getHeader().getMemberID() );
+		default : return nullptr;
+		}
+	}
+
+	static const ChunkHandler* findChunkHandler(const ServiceHandlers& service, const InputMessage& msg) {
+		switch ( msg.getMessageType() ) {
+		case SomeIP::MessageType::REQUEST :
+		case SomeIP::MessageType::REQUEST_NO_RETURN : return service.m_streamingMethods.find( msg.getHeader().getMemberID() );
+		case SomeIP::MessageType::NOTIFICATION : return service.m_streamingEvents.find( msg.getHeader().getMemberID() );
+		default : return nullptr;
+		}
+	}
+
+	ServiceHandlers& getServiceHandlers(SomeIP::ServiceIDs serviceIDs) {
+		return m_services[serviceIDs];
+	}
+
+	const ServiceHandlers* findService(SomeIP::ServiceIDs serviceIDs) {
+		// consecutive messages are often addressed to the same service
+		if ( (m_lastService != nullptr) && (m_lastServiceIDs == serviceIDs) )
+			return m_lastService;
+
+		auto it = m_services.find(serviceIDs);
+		if ( it == m_services.end() )
+			return nullptr;
+
+		m_lastServiceIDs = serviceIDs;
+		m_lastService = &(it->second);
+		return m_lastService;
+	}
+
+	void sendError(const InputMessage& request, SomeIP::ReturnCode returnCode) {
+		log_warning() << "No handler for message " << request.toString();
+		OutputMessage errorMessage = createMethodReturn(request);
+		errorMessage.getHeader().setMessageType(SomeIP::MessageType::ERROR);
+		errorMessage.getHeader().setReturnCode(returnCode);
+		m_connection.sendMessage(errorMessage);
+	}
+
+	MessageSource& m_connection;
+	std::unordered_map<SomeIP::ServiceIDs, ServiceHandlers> m_services;
+	SomeIP::ServiceIDs m_lastServiceIDs;
+	const ServiceHandlers* m_lastService = nullptr;
+	MessageSink* m_defaultSink = nullptr;
+	std::function<void()> m_disconnectionHandler;
+
+};
+
+}
@@ -7,6 +7,7 @@
 #include "SomeIP-clientLib.h"
 #include <unistd.h>
 #include <fcntl.h>
+#include <chrono>
 
 namespace SomeIPClient {
 
@@ -28,6 +29,7 @@ SomeIPReturnCode ClientDaemonConnection::getDaemonStateDump(std::string& dump) {
 }
 
 bool ClientDaemonConnection::dispatchIncomingMessages() {
+	deleteClosedPeerChannels();
 	dispatchQueuedMessages();
 	return readIncomingMessages([&] (IPCInputMessage & msg) {
 					    onIPCInputMessage(msg);
@@ -48,7 +50,7 @@ SomeIPReturnCode ClientDaemonConnection::connect(ClientConnectionListener& clien
 
 	newInputMessage();
 
-	auto c = connectToServer(DEFAULT_SERVER_SOCKET_PATH);
+	auto c = connectToServer(DEFAULT_SERVER_SOCKET_PATH, m_socketType);
 
 	if ( !isError(c) ) {
 		log_info() << "Connected to the dispatcher";
@@ -83,11 +85,30 @@ SomeIPReturnCode ClientDaemonConnection::connect(ClientConnectionListener& clien
 							    }, fd);
 		m_disconnectionWatch->enable();
 
+		// the negotiation also tells the dispatcher that we can receive BATCH messages
+		// the packets of a SOCK_SEQPACKET connection already carry their length
+		negotiateFraming( (m_compactFramingEnabled && !isPacketMode() ) ? IPCFraming::COMPACT : IPCFraming::NATIVE );
+
 	}
 
 	return c;
 }
 
+void ClientDaemonConnection::negotiateFraming(IPCFraming framing) {
+	IPCOutputMessage msg(IPCMessageType::SET_FRAMING);
+	msg << static_cast<uint8_t>(framing);
+
+	// the dispatcher switches right after its answer, so we do the same once we have read that answer
+	std::lock_guard<std::recursive_mutex> emissionLock(dataEmissionMutex);
+	std::lock_guard<std::recursive_mutex> receptionLock(dataReceptionMutex);
+	IPCInputMessage returnMessage = writeRequest(msg);
+
+	if (returnMessage.getReturnCode() == IPCReturnCode::OK)
+		setFraming(framing);
+	else
+		log_warning() << "The dispatcher does not support the requested framing. Using the native framing";
+}
+
 SomeIPReturnCode ClientDaemonConnection::registerService(SomeIP::ServiceIDs serviceID) {
 	IPCOutputMessage msg(IPCMessageType::REGISTER_SERVICE);
 	msg << serviceID.serviceID << serviceID.instanceID;
@@ -121,13 +142,298 @@ SomeIPReturnCode ClientDaemonConnection::subscribeToNotifications(SomeIP::Member
 	return writeMessage(msg);
 }
 
+SomeIPReturnCode ClientDaemonConnection::registerServices(const std::vector<SomeIP::ServiceIDs>& serviceIDs) {
+	IPCOutputMessage msg(IPCMessageType::REGISTER_SERVICES);
+	for (auto& serviceID : serviceIDs)
+		msg << serviceID.serviceID << serviceID.instanceID;
+	IPCInputMessage returnMessage = writeRequest(msg);
+
+	if ( returnMessage.isError() )
+		return SomeIPReturnCode::ERROR;
+	else {
+		log_info() << "Successfully registered " << serviceIDs.size() << " services";
+		return SomeIPReturnCode::OK;
+	}
+}
+
+SomeIPReturnCode ClientDaemonConnection::unregisterServices(const std::vector<SomeIP::ServiceIDs>& serviceIDs) {
+	IPCOutputMessage msg(IPCMessageType::UNREGISTER_SERVICES);
+	for (auto& serviceID : serviceIDs)
+		msg << serviceID.serviceID << serviceID.instanceID;
+	IPCInputMessage returnMessage = writeRequest(msg);
+
+	if ( returnMessage.isError() )
+		return SomeIPReturnCode::ERROR;
+	else {
+		log_info() << "Successfully unregistered " << serviceIDs.size() << " services";
+		return SomeIPReturnCode::OK;
+	}
+}
+
+SomeIPReturnCode ClientDaemonConnection::subscribeToNotifications(const std::vector<SomeIP::MemberIDs>& members) {
+	log_debug() << "Subscribing to " << members.size() << " notifications";
+	IPCOutputMessage msg(IPCMessageType::SUBSCRIBE_NOTIFICATIONS);
+	for (auto& member : members)
+		msg << member.m_serviceIDs.serviceID  << member.m_serviceIDs.instanceID << member.m_memberID;
+	IPCInputMessage returnMessage = writeRequest(msg);
+
+	return returnMessage.isError() ? SomeIPReturnCode::ERROR : SomeIPReturnCode::OK;
+}
+
 SomeIPReturnCode ClientDaemonConnection::sendMessage(const OutputMessage& msg) {
-	const IPCMessage& ipcMessage = msg.getIPCMessage();
-	auto ret = writeMessage(ipcMessage);
+	auto sharedPayloadMessage = SharedPayloadIPCMessage::create(msg, m_sharedPayloadThreshold);
+	const IPCMessage& ipcMessage = sharedPayloadMessage ? *sharedPayloadMessage : msg.getIPCMessage();
+	SomeIPReturnCode ret = SomeIPReturnCode::ERROR;
+
+	{
+		std::lock_guard<std::recursive_mutex> lock(m_peerChannelsMutex);
+		PeerChannel* channel = getPeerChannel(msg);
+		if (channel != nullptr)
+			ret = channel->writeMessage(ipcMessage);
+	}
+
+	// if the peer channel is broken, the dispatcher is still able to route the message
+	if ( isError(ret) )
+		ret = writeMessage(ipcMessage);
+
 	log_traffic() << "Message sent : " << msg;
 	return ret;
 }
 
+SomeIPReturnCode ClientDaemonConnection::sendMessages(const OutputMessage* const* messages, size_t messageCount) {
+
+	std::vector<const IPCMessage*> daemonMessages;
+	daemonMessages.reserve(messageCount);
+	std::vector<std::unique_ptr<SharedPayloadIPCMessage> > sharedPayloadMessages;
+
+	{
+		std::lock_guard<std::recursive_mutex> lock(m_peerChannelsMutex);
+		for (size_t i = 0; i < messageCount; i++) {
+			const OutputMessage& msg = *messages[i];
+			const IPCMessage* ipcMessage = &msg.getIPCMessage();
+			auto sharedPayloadMessage = SharedPayloadIPCMessage::create(msg, m_sharedPayloadThreshold);
+			if (sharedPayloadMessage) {
+				ipcMessage = sharedPayloadMessage.get();
+				sharedPayloadMessages.push_back( std::move(sharedPayloadMessage) );
+			}
+
+			PeerChannel* channel = getPeerChannel(msg);
+			if ( (channel == nullptr) || isError( channel->writeMessage(*ipcMessage) ) )
+				daemonMessages.push_back(ipcMessage);
+			log_traffic() << "Message sent : " << msg;
+		}
+	}
+
+	std::lock_guard<std::recursive_mutex> lock(dataEmissionMutex);
+	auto code = writeBlocking( daemonMessages.data(), daemonMessages.size() );
+	return ( (code == IPCOperationReport::OK) ? SomeIPReturnCode::OK : SomeIPReturnCode::ERROR );
+}
+
+PeerChannel* ClientDaemonConnection::getPeerChannel(const OutputMessage& msg) {
+
+	if ( m_peerChannels.empty() )
+		return nullptr;
+
+	auto& header = msg.getHeader();
+
+	if ( header.isReply() ) {
+		for (auto i = m_peerChannelRequests.begin(); i != m_peerChannelRequests.end(); i++) {
+			if ( (i->m_clientIdentifier == msg.getClientIdentifier()) && (i->m_requestID == header.getRequestID()) ) {
+				PeerChannel* channel = i->m_channel;
+				m_peerChannelRequests.erase(i);
+				return channel;
+			}
+		}
+	} else if ( !header.isNotification() ) {
+		SomeIP::ServiceIDs serviceID( header.getServiceID(), msg.getInstanceID() );
+		for (auto& channel : m_peerChannels) {
+			if ( !channel->isProvider() && (channel->getServiceID() == serviceID) )
+				return channel.get();
+		}
+	}
+
+	return nullptr;
+}
+
+void ClientDaemonConnection::openPeerChannel(SomeIP::ServiceIDs serviceID, ClientIdentifier peer, bool isProvider,
+					     int fd) {
+	std::lock_guard<std::recursive_mutex> lock(m_peerChannelsMutex);
+
+	// a new channel replaces any existing one for the same service and peer
+	for (size_t i = 0; i < m_peerChannels.size(); ) {
+		auto& channel = m_peerChannels[i];
+		if ( (channel->getServiceID() == serviceID) && (channel->getPeer() == peer) && (channel->isProvider() == isProvider) )
+			channel->disconnect();            // removes the channel from m_peerChannels
+		else
+			i++;
+	}
+
+	PeerChannel* channel = new PeerChannel(*this, serviceID, peer, isProvider, fd);
+	m_peerChannels.emplace_back(channel);
+	channel->init(*m_mainLoop);
+
+	log_info() << "Direct channel opened : " << channel->toString();
+}
+
+void ClientDaemonConnection::closePeerChannels(SomeIP::ServiceIDs serviceID) {
+	std::lock_guard<std::recursive_mutex> lock(m_peerChannelsMutex);
+	for (size_t i = 0; i < m_peerChannels.size(); ) {
+		auto& channel = m_peerChannels[i];
+		if ( channel->getServiceID() == serviceID )
+			channel->disconnect();            // removes the channel from m_peerChannels
+		else
+			i++;
+	}
+}
+
+void ClientDaemonConnection::onPeerChannelDisconnected(PeerChannel& channel) {
+	std::lock_guard<std::recursive_mutex> lock(m_peerChannelsMutex);
+
+	log_info() << "Direct channel closed : " << channel.toString();
+
+	// the answers to pending requests will go via the dispatcher
+	for (size_t i = 0; i < m_peerChannelRequests.size(); ) {
+		if (m_peerChannelRequests[i].m_channel == &channel)
+			m_peerChannelRequests.erase(m_peerChannelRequests.begin() + i);
+		else
+			i++;
+	}
+
+	// we might be called from a callback of the channel, so we delete it later
+	for (auto i = m_peerChannels.begin(); i != m_peerChannels.end(); i++) {
+		if (i->get() == &channel) {
+			m_closedPeerChannels.push_back( std::move(*i) );
+			m_peerChannels.erase(i);
+			break;
+		}
+	}
+}
+
+void ClientDaemonConnection::deleteClosedPeerChannels() {
+	std::lock_guard<std::recursive_mutex> lock(m_peerChannelsMutex);
+	m_closedPeerChannels.clear();
+}
+
+void ClientDaemonConnection::onPeerChannelMessage(PeerChannel& channel, const IPCInputMessage& inputMessage) {
+	if ( channel.isProvider() && (inputMessage.getMessageType() == IPCMessageType::SEND_MESSAGE) ) {
+		// identify the requester the same way the dispatcher does, so that the answer can be routed back to it
+		InputMessage msg = readMessageFromIPCMessage(inputMessage);
+		msg.setClientIdentifier( channel.getPeer() );
+
+		if ( msg.getHeader().isRequestWithReturn() ) {
+			std::lock_guard<std::recursive_mutex> lock(m_peerChannelsMutex);
+			PeerChannelRequest request;
+			request.m_channel = &channel;
+			request.m_clientIdentifier = channel.getPeer();
+			request.m_requestID = msg.getHeader().getRequestID();
+			m_peerChannelRequests.push_back(request);
+		}
+	}
+}
+
+void PeerChannel::init(MainLoopInterface& mainLoop) {
+	setStreamingThreshold(m_connection.m_streamingThreshold);
+
+	struct pollfd fd;
+	fd.fd = getFileDescriptor();
+	fd.revents = 0;
+	fd.events = POLLIN;
+	m_inputDataWatch = mainLoop.addFileDescriptorWatch([&] () {
+								   return onIncomingDataAvailable();
+							   }, fd);
+	m_inputDataWatch->enable();
+
+	fd.events = POLLHUP;
+	m_disconnectionWatch = mainLoop.addFileDescriptorWatch([&] () {
+								       disconnect();
+							       }, fd);
+	m_disconnectionWatch->enable();
+}
+
+WatchStatus PeerChannel::onIncomingDataAvailable() {
+
+	std::vector<IPCInputMessage*> bufferedMessages;
+
+	{
+		std::lock_guard<std::recursive_mutex> receptionLock(m_dataReceptionMutex);
+		bufferedMessages.swap(m_bufferedMessages);
+	}
+
+	for (auto msg : bufferedMessages) {
+		m_connection.handleConstIncomingIPCMessage(*msg);
+		delete msg;
+	}
+
+	bool bKeepProcessing = true;
+
+	do {
+		IPCInputMessage* msg = nullptr;
+
+		{
+			std::lock_guard<std::recursive_mutex> receptionLock(m_dataReceptionMutex);
+			readNonBlocking(m_inputMessage);
+			if ( m_inputMessage.isComplete() ) {
+				msg = new IPCInputMessage( std::move(m_inputMessage) );
+				setInputMessage(m_inputMessage);
+			}
+		}
+
+		if (msg != nullptr) {
+			handleIncomingIPCMessage(*msg);
+			delete msg;
+		} else
+			bKeepProcessing = false;
+
+	} while ( bKeepProcessing && isConnected() );
+
+	return WatchStatus::KEEP_WATCHING;
+}
+
+void PeerChannel::handleIncomingIPCMessage(IPCInputMessage& inputMessage) {
+	m_connection.onPeerChannelMessage(*this, inputMessage);
+	m_connection.handleConstIncomingIPCMessage(inputMessage);
+}
+
+bool PeerChannel::beginStreamedMessage(const IPCInputMessage& header, size_t payloadLength) {
+	if ( !m_connection.acceptStreamedMessage(header, payloadLength) )
+		return false;
+	m_connection.onPeerChannelMessage(*this, header);
+	return true;
+}
+
+void PeerChannel::onStreamedChunk(const IPCInputMessage& header, const void* data, size_t length, bool isLast) {
+	m_connection.onStreamedChunk(header, data, length, isLast);
+}
+
+void PeerChannel::onDisconnected() {
+	m_inputDataWatch->disable();
+	m_disconnectionWatch->disable();
+	m_connection.onPeerChannelDisconnected(*this);
+}
+
+void PeerChannel::onCongestionDetected() {
+
+	{
+		// read what the peer has sent us, since it might be blocked writing to us
+		std::lock_guard<std::recursive_mutex> receptionLock(m_dataReceptionMutex);
+		bool bKeepReading = true;
+		while (bKeepReading) {
+			readNonBlocking(m_inputMessage);
+			if ( m_inputMessage.isComplete() ) {
+				m_connection.onPeerChannelMessage(*this, m_inputMessage);
+				m_bufferedMessages.push_back( new IPCInputMessage( std::move(m_inputMessage) ) );
+				setInputMessage(m_inputMessage);
+			} else
+				bKeepReading = false;
+		}
+	}
+
+	struct pollfd fd;
+	fd.fd = getFileDescriptor();
+	fd.events = POLLOUT | POLLHUP;
+	poll(&fd, 1, 1000);
+}
+
 
 SomeIPReturnCode ClientDaemonConnection::sendPing() {
 	IPCOutputMessage ipcMessage(IPCMessageType::PONG);
@@ -140,7 +446,8 @@ InputMessage ClientDaemonConnection::sendMessageBlocking(const OutputMessage& ms
 
 	log_traffic() << "Send blocking message : " << msg.toString();
 
-	const IPCMessage& ipcMessage = msg.getIPCMessage();
+	auto sharedPayloadMessage = SharedPayloadIPCMessage::create(msg, m_sharedPayloadThreshold);
+	const IPCMessage& ipcMessage = sharedPayloadMessage ? *sharedPayloadMessage : msg.getIPCMessage();
 
 	std::lock_guard<std::recursive_mutex> receptionLock(dataReceptionMutex); // we prevent other threads from stealing the response of our request
 	writeMessage(ipcMessage);
@@ -148,7 +455,137 @@ InputMessage ClientDaemonConnection::sendMessageBlocking(const OutputMessage& ms
 	return waitForAnswer(msg);
 }
 
+void ClientConnection::waitForServicesAsync(const std::vector<ServiceIDs>& services, ServicesAvailabilityCallback callback,
+					    int timeoutInMilliseconds) {
+
+	if (!m_isDispatchingServiceWaitTimeout)
+		m_expiredServiceWaitTimeouts.clear();
+
+	if ( areServicesRegistered(services) ) {
+		callback(true);
+		return;
+	}
+
+	auto wait = new ServiceWait();
+	wait->m_services = services;
+	wait->m_callback = callback;
+
+	if (timeoutInMilliseconds != NO_TIMEOUT) {
+		if (m_mainLoop != nullptr)
+			wait->m_timeout = m_mainLoop->addTimeout([this, wait]() {
+									 onServiceWaitTimeout(wait);
+								 }, timeoutInMilliseconds);
+		else
+			log_warning() << "No main loop set. Timeout ignored";
+	}
+
+	m_serviceWaits.emplace_back(wait);
+}
+
+void ClientConnection::onServiceWaitTimeout(ServiceWait* wait) {
+	for (size_t i = 0; i < m_serviceWaits.size(); i++) {
+		if (m_serviceWaits[i].get() == wait) {
+			std::unique_ptr<ServiceWait> expiredWait = std::move(m_serviceWaits[i]);
+			m_serviceWaits.erase(m_serviceWaits.begin() + i);
+
+			// we are called from that timer, so it has to be kept alive until we return
+			m_expiredServiceWaitTimeouts.push_back( std::move(expiredWait->m_timeout) );
+
+			m_isDispatchingServiceWaitTimeout = true;
+			expiredWait->m_callback(false);
+			m_isDispatchingServiceWaitTimeout = false;
+			return;
+		}
+	}
+}
+
+void ClientConnection::resolveServiceWaits() {
+
+	if (!m_isDispatchingServiceWaitTimeout)
+		m_expiredServiceWaitTimeouts.clear();
+
+	std::vector<std::unique_ptr<ServiceWait> > completedWaits;
+
+	for (size_t i = 0; i < m_serviceWaits.size(); ) {
+		if ( areServicesRegistered(m_serviceWaits[i]->m_services) ) {
+			completedWaits.push_back( std::move(m_serviceWaits[i]) );
+			m_serviceWaits.erase(m_serviceWaits.begin() + i);
+		} else
+			i++;
+	}
+
+	// the callbacks are called once the list is consistent, since they might start new waits
+	for (auto& wait : completedWaits)
+		wait->m_callback(true);
+}
+
+bool ClientDaemonConnection::isServiceRegistered(ServiceIDs service) {
+	{
+		std::lock_guard<std::mutex> lock(m_registrySegmentMutex);
+		if (m_registrySegment.lookup(service) == ServiceRegistrySegment::LookupResult::FOUND)
+			return true;
+	}
+
+	return ClientConnection::isServiceRegistered(service);
+}
+
+bool ClientDaemonConnection::waitForServices(const std::vector<ServiceIDs>& services, int timeoutInMilliseconds) {
+
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutInMilliseconds);
+
+	std::lock_guard<std::recursive_mutex> receptionLock(dataReceptionMutex);
+
+	while ( !areServicesRegistered(services) ) {
+
+		if ( !isConnected() )
+			return false;
+
+		int remainingTime = -1;
+		if (timeoutInMilliseconds != NO_TIMEOUT) {
+			remainingTime = std::chrono::duration_cast<std::chrono::milliseconds>( deadline - std::chrono::steady_clock::now() ).count();
+			if (remainingTime <= 0)
+				return false;
+		}
+
+		// wait for the next registration notification from the dispatcher
+		pollfd fd;
+		fd.fd = getFileDescriptor();
+		fd.events = POLLIN;
+		if (poll(&fd, 1, remainingTime) <= 0)
+			continue;
+
+		if ( fd.revents & (POLLHUP | POLLERR) )
+			return false;
+
+		readIncomingMessages([&] (IPCInputMessage & incomingMsg) {
+					     switch ( incomingMsg.getMessageType() ) {
+					     case IPCMessageType::SERVICES_REGISTERED :
+					     case IPCMessageType::SERVICES_UNREGISTERED :
+					     case IPCMessageType::REGISTRY_SEGMENT :
+						     handleConstIncomingIPCMessage(incomingMsg);
+						     break;
+					     default :
+						     pushToQueue(incomingMsg);
+						     break;
+					     }
+					     return true;
+				     });
+	}
+
+	return true;
+}
+
 bool ClientDaemonConnection::isServiceAvailableBlocking(ServiceIDs service) {
+
+	{
+		std::lock_guard<std::mutex> lock(m_registrySegmentMutex);
+		switch ( m_registrySegment.lookup(service) ) {
+		case ServiceRegistrySegment::LookupResult::FOUND : return true;
+		case ServiceRegistrySegment::LookupResult::NOT_FOUND : return false;
+		default : break;                 // segment not available => ask the dispatcher
+		}
+	}
+
 	IPCOutputMessage msg(IPCMessageType::GET_SERVICE_LIST);
 	auto inputMessage = writeRequest(msg);
 	IPCInputMessageReader reader(inputMessage);
@@ -172,6 +609,23 @@ InputMessage ClientDaemonConnection::waitForAnswer(const OutputMessage& requestM
 
 	readIncomingMessagesBlocking([&] (IPCInputMessage & incomingIPCMsg) {
 
+					     if (incomingIPCMsg.getMessageType() == IPCMessageType::BATCH) {
+						     // the answer can be packed with other messages, which are queued individually
+						     bool isAnswerReceived = false;
+						     IPCBatchReader batchReader(incomingIPCMsg);
+						     while ( batchReader.next() ) {
+							     IPCInputMessage subMessage;
+							     batchReader.copyTo(subMessage);
+							     if ( !isAnswerReceived && (subMessage.getMessageType() == IPCMessageType::SEND_MESSAGE) &&
+								  readMessageFromIPCMessage(subMessage).isAnswerTo(requestMsg) ) {
+								     answerMessage.copyFrom(subMessage);
+								     isAnswerReceived = true;
+							     } else
+								     pushToQueue(subMessage);
+						     }
+						     return !isAnswerReceived;
+					     }
+
 					     if (incomingIPCMsg.getMessageType() == IPCMessageType::SEND_MESSAGE) {
 						     InputMessage inputMsg = readMessageFromIPCMessage(incomingIPCMsg);
 						     if ( inputMsg.isAnswerTo(requestMsg) ) {
@@ -246,6 +700,26 @@ void ClientDaemonConnection::dispatchQueuedMessages() {
 	} while (msg != nullptr);
 }
 
+bool ClientDaemonConnection::beginStreamedMessage(const IPCInputMessage& header, size_t payloadLength) {
+	// the messages queued by a blocking call have been received before this one
+	dispatchQueuedMessages();
+	return acceptStreamedMessage(header, payloadLength);
+}
+
+bool ClientDaemonConnection::acceptStreamedMessage(const IPCInputMessage& header, size_t payloadLength) {
+	const InputMessage msg = readMessageFromIPCMessage(header);
+	if ( (messageReceivedCallback == nullptr) || !messageReceivedCallback->isStreamedMessage(msg, payloadLength) )
+		return false;
+	log_traffic() << "Streaming message " << msg.toString() << " payload length:" << payloadLength;
+	return true;
+}
+
+void ClientDaemonConnection::onStreamedChunk(const IPCInputMessage& header, const void* data, size_t length, bool isLast) {
+	const InputMessage msg = readMessageFromIPCMessage(header);
+	if (messageReceivedCallback != nullptr)
+		messageReceivedCallback->processPayloadChunk(msg, data, length, isLast);
+}
+
 void ClientDaemonConnection::handleConstIncomingIPCMessage(const IPCInputMessage& inputMessage) {
 
 	IPCInputMessageReader reader(inputMessage);
@@ -262,6 +736,24 @@ void ClientDaemonConnection::handleConstIncomingIPCMessage(const IPCInputMessage
 	}
 	break;
 
+	case IPCMessageType::BATCH : {
+		// the messages are dispatched directly from the batch, without being copied
+		IPCBatchReader batchReader(inputMessage);
+		while ( batchReader.next() ) {
+			if (batchReader.getMessageType() == IPCMessageType::SEND_MESSAGE) {
+				const InputMessage msg( batchReader.getUserData(), batchReader.getUserDataLength() );
+				log_traffic() << "Dispatching message " << msg.toString();
+				if (m_endPoint.processMessage(msg) == MessageProcessingResult::NotProcessed_OK)
+					messageReceivedCallback->processMessage(msg);
+			} else if (batchReader.getMessageType() != IPCMessageType::BATCH) {
+				IPCInputMessage subMessage;
+				batchReader.copyTo(subMessage);
+				handleConstIncomingIPCMessage(subMessage);
+			}
+		}
+	}
+	break;
+
 	case IPCMessageType::PING : {
 		for (size_t i = 0; i < inputMessage.getUserDataLength(); i++) {
 			uint8_t v;
@@ -288,11 +780,50 @@ void ClientDaemonConnection::handleConstIncomingIPCMessage(const IPCInputMessage
 		while ( reader.remainingBytesCount() >= sizeof(SomeIP::ServiceID) ) {
 			SomeIP::ServiceIDs serviceID;
 			reader >> serviceID.serviceID >> serviceID.instanceID ;
+			closePeerChannels(serviceID);
 			onServiceUnregistered(serviceID);
 		}
 	}
 	break;
 
+	case IPCMessageType::PEER_CHANNEL : {
+		SomeIP::ServiceIDs serviceID;
+		ClientIdentifier peer;
+		uint8_t isProvider;
+		reader >> serviceID.serviceID >> serviceID.instanceID >> peer >> isProvider;
+
+		if (inputMessage.getFileDescriptor() == -1)
+			log_error() << "No file descriptor received for direct channel to " << serviceID.toString();
+		else
+			openPeerChannel( serviceID, peer, isProvider != 0, dup( inputMessage.getFileDescriptor() ) );
+	}
+	break;
+
+	case IPCMessageType::REGISTRY_SEGMENT : {
+		std::vector<SomeIP::ServiceIDs> services;
+		bool isSegmentReadable = false;
+
+		if (inputMessage.getFileDescriptor() == -1)
+			log_error() << "No file descriptor received for the registry segment";
+		else {
+			std::lock_guard<std::mutex> lock(m_registrySegmentMutex);
+			if (m_registrySegment.map( dup( inputMessage.getFileDescriptor() ) ) != SomeIPReturnCode::OK)
+				log_warning() << "Can't map the registry segment. Using IPC instead";
+			else
+				isSegmentReadable = m_registrySegment.getServices(services);
+		}
+
+		if (isSegmentReadable) {
+			// the initial registry is read from the segment instead of being sent by the dispatcher
+			for (auto& serviceID : services)
+				onServiceRegistered(serviceID);
+		} else {
+			IPCOutputMessage msg(IPCMessageType::REGISTRY_SEGMENT_UNAVAILABLE);
+			writeMessage(msg);
+		}
+	}
+	break;
+
 	default : {
 		log_error() << "Unknown message type : " << static_cast<int>(messageType);
 	}
@@ -366,6 +897,19 @@ void ClientDaemonConnection::onCongestionDetected() {
 
 void ClientDaemonConnection::onDisconnected() {
 	log_warning() << "Disconnected from server";
+
+	{
+		std::lock_guard<std::recursive_mutex> lock(m_peerChannelsMutex);
+		while ( !m_peerChannels.empty() )
+			m_peerChannels.front()->disconnect();
+	}
+
+	{
+		// the content of the segment is not maintained anymore
+		std::lock_guard<std::mutex> lock(m_registrySegmentMutex);
+		m_registrySegment.unmap();
+	}
+
 	if (messageReceivedCallback)
 		messageReceivedCallback->onDisconnected();
 }
@@ -19,6 +19,7 @@
 #include "Message.h"
 
 #include "ipc/UDSConnection.h"
+#include "ServiceRegistrySegment.h"
 #include <algorithm>
 
 namespace SomeIPClient {
@@ -37,6 +38,22 @@ public:
 	 * Called when the connection to the dispatcher has been lost
 	 */
 	virtual void onDisconnected() = 0;
+
+	/**
+	 * Called when the header of a message whose payload reaches the streaming threshold has been received. If true is
+	 * returned, the payload is passed to processPayloadChunk() as it arrives, instead of being buffered, and processMessage()
+	 * is not called for that message.
+	 */
+	virtual bool isStreamedMessage(const InputMessage& msg, size_t payloadLength) {
+		return false;
+	}
+
+	/**
+	 * Receives the next part of the payload of a message accepted by isStreamedMessage(), whose header is given. The parts
+	 * are passed in order, and isLast is true for the last one.
+	 */
+	virtual void processPayloadChunk(const InputMessage& msg, const void* data, size_t length, bool isLast) {
+	}
 };
 
 
@@ -108,7 +125,13 @@ public:
 	}
 
 protected:
+	/**
+	 * The notifications received right after the connection may overlap the registry read from the shared segment, so the
+	 * registration of a known service and the unregistration of an unknown one are ignored
+	 */
 	void onServiceRegistered(SomeIP::ServiceIDs serviceID) {
+		if ( isServiceRegistered(serviceID) )
+			return;
 		m_availableServices.push_back(serviceID);
 		for (auto& listener : m_serviceAvailabilityListeners) {
 			listener->onServiceRegistered(serviceID);
@@ -116,7 +139,10 @@ protected:
 	}
 
 	void onServiceUnregistered(SomeIP::ServiceIDs serviceID) {
-		m_availableServices.erase(std::find(m_availableServices.begin(), m_availableServices.end(), serviceID));
+		auto it = std::find(m_availableServices.begin(), m_availableServices.end(), serviceID);
+		if ( it == m_availableServices.end() )
+			return;
+		m_availableServices.erase(it);
 		for (auto& listener : m_serviceAvailabilityListeners) {
 			listener->onServiceUnregistered(serviceID);
 		}
@@ -142,7 +168,9 @@ public:
 /**
  * Interface to be used by client application to connect to the dispatcher. The dispatcher can either be local
  */
-class ClientConnection {
+class ClientConnection : public MessageSource {
+
+	LOG_SET_CLASS_CONTEXT(clientLibContext);
 
 public:
 
@@ -175,11 +203,35 @@ public:
 	 */
 	virtual SomeIPReturnCode subscribeToNotifications(SomeIP::MemberIDs memberID) = 0;
 
+	/**
+	 * Registers several services at once. Either all the services get registered, or none of them.
+	 */
+	virtual SomeIPReturnCode registerServices(const std::vector<SomeIP::ServiceIDs>& serviceIDs) = 0;
+
+	/**
+	 * Unregisters several services at once. Either all the services get unregistered, or none of them.
+	 */
+	virtual SomeIPReturnCode unregisterServices(const std::vector<SomeIP::ServiceIDs>& serviceIDs) = 0;
+
+	/**
+	 * Subscribes to notifications for all the given members
+	 */
+	virtual SomeIPReturnCode subscribeToNotifications(const std::vector<SomeIP::MemberIDs>& memberIDs) = 0;
+
 	/**
 	 * Sends the given message to the dispatcher.
 	 */
 	virtual SomeIPReturnCode sendMessage(const OutputMessage& msg) = 0;
 
+	/**
+	 * Sends several messages at once, which is much cheaper than sending them one by one.
+	 */
+	virtual SomeIPReturnCode sendMessages(const OutputMessage* const* messages, size_t messageCount) = 0;
+
+	SomeIPReturnCode sendMessages(const std::vector<const OutputMessage*>& messages) {
+		return sendMessages( messages.data(), messages.size() );
+	}
+
 	/**
 	 * Sends a ping message to the dispatcher
 	 */
@@ -218,10 +270,52 @@ public:
 
 	virtual bool isServiceAvailableBlocking(ServiceIDs service) = 0;
 
+	static const int NO_TIMEOUT = -1;
+
+	typedef std::function<void (bool)> ServicesAvailabilityCallback;
+
+	/**
+	 * Blocks until all the given services are registered, or until the timeout expires. Instead of polling the
+	 * dispatcher, this method relies on the service registration notifications.
+	 * @return true if all the services are available
+	 */
+	virtual bool waitForServices(const std::vector<ServiceIDs>& services, int timeoutInMilliseconds) = 0;
+
+	bool waitForService(ServiceIDs service, int timeoutInMilliseconds) {
+		return waitForServices(std::vector<ServiceIDs>(1, service), timeoutInMilliseconds);
+	}
+
+	/**
+	 * Calls the given function from the main loop as soon as all the given services are registered, with "true" as argument,
+	 * or with "false" if the timeout expires first. The function is called immediately if the services are already known.
+	 */
+	void waitForServicesAsync(const std::vector<ServiceIDs>& services, ServicesAvailabilityCallback callback,
+				  int timeoutInMilliseconds = NO_TIMEOUT);
+
+	void waitForServiceAsync(ServiceIDs service, ServicesAvailabilityCallback callback,
+				 int timeoutInMilliseconds = NO_TIMEOUT) {
+		waitForServicesAsync(std::vector<ServiceIDs>(1, service), callback, timeoutInMilliseconds);
+	}
+
 protected:
 
+	/**
+	 * Returns true if the service is known to be registered, without any blocking call
+	 */
+	virtual bool isServiceRegistered(ServiceIDs service) {
+		return m_registry.isServiceRegistered(service);
+	}
+
+	bool areServicesRegistered(const std::vector<ServiceIDs>& services) {
+		for (auto& service : services)
+			if ( !isServiceRegistered(service) )
+				return false;
+		return true;
+	}
+
 	void onServiceRegistered(SomeIP::ServiceIDs serviceID) {
 		m_registry.onServiceRegistered(serviceID);
+		resolveServiceWaits();
 	}
 
 	void onServiceUnregistered(SomeIP::ServiceIDs serviceID) {
@@ -232,13 +326,168 @@ protected:
 	ClientConnectionListener* messageReceivedCallback = nullptr;
 	ServiceRegistry m_registry;
 
+private:
+	struct ServiceWait {
+		std::vector<ServiceIDs> m_services;
+		ServicesAvailabilityCallback m_callback;
+		std::unique_ptr<TimeOutMainLoopHook> m_timeout;
+	};
+
+	/**
+	 * Calls the callbacks of the pending waits whose services are now all registered
+	 */
+	void resolveServiceWaits();
+
+	void onServiceWaitTimeout(ServiceWait* wait);
+
+	std::vector<std::unique_ptr<ServiceWait> > m_serviceWaits;
+
+	/// Timers which have expired. They can't be destroyed from their own callback
+	std::vector<std::unique_ptr<TimeOutMainLoopHook> > m_expiredServiceWaitTimeouts;
+	bool m_isDispatchingServiceWaitTimeout = false;
+
 };
 
 
+/**
+ * IPC message sent instead of a message whose payload has been moved into a SharedPayload. It only contains the header of
+ * the message, and owns the file descriptor of the payload.
+ */
+class SharedPayloadIPCMessage : public IPCOutputMessage {
+
+public:
+	SharedPayloadIPCMessage() : IPCOutputMessage(IPCMessageType::SEND_MESSAGE) {
+	}
+
+	~SharedPayloadIPCMessage() {
+		if (getFileDescriptor() != -1)
+			close( getFileDescriptor() );
+	}
+
+	/**
+	 * Returns a message containing the header of the given one, or nullptr if its payload is smaller than the threshold, or
+	 * if the shared payload could not be created
+	 */
+	static std::unique_ptr<SharedPayloadIPCMessage> create(const OutputMessage& msg, size_t threshold) {
+		if ( (threshold == 0) || (msg.getPayloadLength() < threshold) )
+			return nullptr;
+
+		int fd = SharedPayload::createFile( msg.getPayload(), msg.getPayloadLength() );
+		if (fd == -1)
+			return nullptr;
+
+		std::unique_ptr<SharedPayloadIPCMessage> sharedPayloadMessage(new SharedPayloadIPCMessage());
+		sharedPayloadMessage->getHeader() = msg.getIPCMessage().getHeader();
+		sharedPayloadMessage->getWritablePayload().append( &msg.getHeader(), sizeof( msg.getHeader() ) );
+		sharedPayloadMessage->setFileDescriptor(fd);
+		return sharedPayloadMessage;
+	}
+
+};
+
+class ClientDaemonConnection;
+
+/**
+ * A direct connection to another local client, which is opened by the dispatcher when a client sends a lot of requests to
+ * a service provided by another local client. The requests and their answers are then exchanged via that channel instead
+ * of going through the dispatcher. Notifications and blocking requests still go through the dispatcher.
+ */
+class PeerChannel : private UDSConnection {
+
+	LOG_SET_CLASS_CONTEXT(clientLibContext);
+
+public:
+	PeerChannel(ClientDaemonConnection& connection, SomeIP::ServiceIDs serviceID, ClientIdentifier peer, bool isProvider,
+		    int fd) : m_connection(connection), m_serviceID(serviceID), m_peer(peer), m_isProvider(isProvider) {
+		setFileDescriptor(fd);
+		setInputMessage(m_inputMessage);
+	}
+
+	~PeerChannel() {
+		for (auto msg : m_bufferedMessages)
+			delete msg;
+
+		// close without notifying the connection, which is the one deleting us
+		if ( isConnected() ) {
+			close( getFileDescriptor() );
+			setFileDescriptor(UNINITIALIZED_FILE_DESCRIPTOR);
+		}
+	}
+
+	void init(MainLoopInterface& mainLoop);
+
+	using SocketStreamConnection::isConnected;
+
+	void disconnect() {
+		SocketStreamConnection::disconnect();
+	}
+
+	/**
+	 * Returns the service to which the requests are sent via this channel
+	 */
+	SomeIP::ServiceIDs getServiceID() const {
+		return m_serviceID;
+	}
+
+	/**
+	 * Returns the identifier of the client at the other end of the channel
+	 */
+	ClientIdentifier getPeer() const {
+		return m_peer;
+	}
+
+	/**
+	 * Returns true if we are the provider of the service, in which case we receive the requests from the channel
+	 */
+	bool isProvider() const {
+		return m_isProvider;
+	}
+
+	SomeIPReturnCode writeMessage(const IPCMessage& ipcMessage) {
+		std::lock_guard<std::recursive_mutex> lock(m_dataEmissionMutex);
+		auto code = writeBlocking(ipcMessage);
+		return ( (code == IPCOperationReport::OK) ? SomeIPReturnCode::OK : SomeIPReturnCode::ERROR );
+	}
+
+	std::string toString() const {
+		return StringBuilder() << "PeerChannel service:" << m_serviceID.toString() << " peer:" << m_peer;
+	}
+
+private:
+	WatchStatus onIncomingDataAvailable();
+
+	void handleIncomingIPCMessage(IPCInputMessage& inputMessage) override;
+
+	bool beginStreamedMessage(const IPCInputMessage& header, size_t payloadLength) override;
+
+	void onStreamedChunk(const IPCInputMessage& header, const void* data, size_t length, bool isLast) override;
+
+	void onDisconnected() override;
+
+	void onCongestionDetected() override;
+
+	ClientDaemonConnection& m_connection;
+	SomeIP::ServiceIDs m_serviceID;
+	ClientIdentifier m_peer;
+	bool m_isProvider;
+
+	IPCInputMessage m_inputMessage;
+
+	/// Messages which have been read while we were waiting for the peer to read our data
+	std::vector<IPCInputMessage*> m_bufferedMessages;
+
+	std::recursive_mutex m_dataReceptionMutex;
+	std::recursive_mutex m_dataEmissionMutex;
+
+	std::unique_ptr<WatchMainLoopHook> m_inputDataWatch;
+	std::unique_ptr<WatchMainLoopHook> m_disconnectionWatch;
+
+};
+
 /**
  * This is the main class to be used to connect to the daemon dispatcher
  */
-class ClientDaemonConnection : public ClientConnection, private MessageSource, private UDSConnection {
+class ClientDaemonConnection : public ClientConnection, private UDSConnection {
 
 	LOG_SET_CLASS_CONTEXT(clientLibContext);
 
@@ -246,19 +495,58 @@ public:
 	static constexpr const char* DEFAULT_SERVER_SOCKET_PATH = "/tmp/someIPSocket";
 	static constexpr const char* ALTERNATIVE_SERVER_SOCKET_PATH = "/tmp/someIPSocket2";
 
+	/// Payload size from which the listener is asked whether a message is streamed
+	static const size_t DEFAULT_STREAMING_THRESHOLD = 256 * 1024;
+
 	ClientDaemonConnection() : m_endPoint(*this) {
+		UDSConnection::setStreamingThreshold(m_streamingThreshold);
 	}
 
 	~ClientDaemonConnection() {
 		messageReceivedCallback = nullptr;
 		disconnect();
+		m_peerChannels.clear();
+		m_closedPeerChannels.clear();
 	}
 
 	/**
 	 * Returns true if some data has been received
 	 */
 	bool hasIncomingMessages() {
-		return ( ( !m_queue.isEmpty() ) || hasAvailableBytes() );
+		return ( ( !m_queue.isEmpty() ) || hasBufferedData() || hasAvailableBytes() );
+	}
+
+	/**
+	 * Enables or disables the compact framing of the messages exchanged with the dispatcher, which is negotiated when
+	 * connecting. Enabled by default.
+	 */
+	void setCompactFramingEnabled(bool enabled) {
+		m_compactFramingEnabled = enabled;
+	}
+
+	/**
+	 * Sets the preferred type of the socket used to connect to the dispatcher. The other type is used if the socket of
+	 * the dispatcher does not have that type.
+	 */
+	void setSocketType(IPCSocketType socketType) {
+		m_socketType = socketType;
+	}
+
+	/**
+	 * Sets the payload size from which the payload of the messages is passed in a shared memory file instead of being copied
+	 * through the dispatcher. 0 disables shared payloads.
+	 */
+	void setSharedPayloadThreshold(size_t threshold) {
+		m_sharedPayloadThreshold = threshold;
+	}
+
+	/**
+	 * Sets the payload size from which ClientConnectionListener::isStreamedMessage() is called for the messages received
+	 * while dispatching. 0 disables the streaming, in which case every message is buffered before being dispatched.
+	 */
+	void setStreamingThreshold(size_t threshold) {
+		m_streamingThreshold = threshold;
+		UDSConnection::setStreamingThreshold(threshold);
 	}
 
 	void disconnect() {
@@ -298,11 +586,33 @@ public:
 	 */
 	SomeIPReturnCode subscribeToNotifications(SomeIP::MemberIDs memberID) override;
 
+	/**
+	 * Registers several services with a single request to the dispatcher
+	 */
+	SomeIPReturnCode registerServices(const std::vector<SomeIP::ServiceIDs>& serviceIDs) override;
+
+	/**
+	 * Unregisters several services with a single request to the dispatcher
+	 */
+	SomeIPReturnCode unregisterServices(const std::vector<SomeIP::ServiceIDs>& serviceIDs) override;
+
+	/**
+	 * Subscribes to notifications for all the given members, with a single request to the dispatcher
+	 */
+	SomeIPReturnCode subscribeToNotifications(const std::vector<SomeIP::MemberIDs>& memberIDs) override;
+
 	/**
 	 * Sends the given message to the dispatcher.
 	 */
 	SomeIPReturnCode sendMessage(const OutputMessage& msg);
 
+	/**
+	 * Sends the given messages. The messages which go to the dispatcher are written with a single system call.
+	 */
+	SomeIPReturnCode sendMessages(const OutputMessage* const* messages, size_t messageCount) override;
+
+	using ClientConnection::sendMessages;
+
 	/**
 	 * Sends a ping message to the dispatcher
 	 */
@@ -320,6 +630,11 @@ public:
 
 	bool isServiceAvailableBlocking(ServiceIDs service) override;
 
+	bool waitForServices(const std::vector<ServiceIDs>& services, int timeoutInMilliseconds) override;
+
+protected:
+	bool isServiceRegistered(ServiceIDs service) override;
+
 private:
 	class SafeMessageQueue {
 
@@ -361,12 +676,41 @@ private:
 		return "ClientConnection";
 	}
 
+	/**
+	 * A request received via a peer channel, whose answer needs to be sent back via that channel
+	 */
+	struct PeerChannelRequest {
+		PeerChannel* m_channel;
+		ClientIdentifier m_clientIdentifier;
+		SomeIP::RequestID m_requestID;
+	};
+
+	void openPeerChannel(SomeIP::ServiceIDs serviceID, ClientIdentifier peer, bool isProvider, int fd);
+
+	void closePeerChannels(SomeIP::ServiceIDs serviceID);
+
+	void deleteClosedPeerChannels();
+
+	/**
+	 * Returns the channel via which the given message should be sent, or nullptr if it should be sent to the dispatcher
+	 */
+	PeerChannel* getPeerChannel(const OutputMessage& msg);
+
+	/**
+	 * Called when a message has been received via a peer channel, before it gets dispatched
+	 */
+	void onPeerChannelMessage(PeerChannel& channel, const IPCInputMessage& inputMessage);
+
+	void onPeerChannelDisconnected(PeerChannel& channel);
+
 	InputMessage waitForAnswer(const OutputMessage& requestMsg);
 
 	void pushToQueue(const IPCInputMessage& msg);
 
 	IPCInputMessage writeRequest(IPCOutputMessage& ipcMessage);
 
+	void negotiateFraming(IPCFraming framing);
+
 	SomeIPReturnCode writeMessage(const IPCMessage& ipcMessage) {
 		std::lock_guard<std::recursive_mutex> lock(dataEmissionMutex);
 		auto code = writeBlocking(ipcMessage);
@@ -393,6 +737,15 @@ private:
 
 	void handleConstIncomingIPCMessage(const IPCInputMessage& inputMessage);
 
+	bool beginStreamedMessage(const IPCInputMessage& header, size_t payloadLength) override;
+
+	void onStreamedChunk(const IPCInputMessage& header, const void* data, size_t length, bool isLast) override;
+
+	/**
+	 * Asks the listener whether the message with the given header is streamed
+	 */
+	bool acceptStreamedMessage(const IPCInputMessage& header, size_t payloadLength);
+
 	void onCongestionDetected() override;
 
 	void onDisconnected() override;
@@ -426,6 +779,22 @@ private:
 	int m_queuedMessageIndicatorPipe[2];
 	char m_dummy = 0;
 
+	bool m_compactFramingEnabled = true;
+	IPCSocketType m_socketType = IPCSocketType::STREAM;
+	size_t m_sharedPayloadThreshold = SharedPayload::DEFAULT_THRESHOLD;
+	size_t m_streamingThreshold = DEFAULT_STREAMING_THRESHOLD;
+
+	std::vector<std::unique_ptr<PeerChannel> > m_peerChannels;
+	std::vector<std::unique_ptr<PeerChannel> > m_closedPeerChannels;
+	std::vector<PeerChannelRequest> m_peerChannelRequests;
+	std::recursive_mutex m_peerChannelsMutex;
+
+	/// Registry published by the dispatcher in shared memory, used to check the availability of a service without IPC
+	ServiceRegistrySegment m_registrySegment;
+	std::mutex m_registrySegmentMutex;
+
+	friend class PeerChannel;
+
 };
 
 }
@@ -4,6 +4,7 @@
 #include <string.h>
 #include <poll.h>
 #include <cstdint>
+#include <condition_variable>
 
 #include "SomeIP-common.h"
 #include "SomeIP.h"
@@ -110,10 +111,15 @@ public:
 	}
 
 	void onServiceRegistered(const Service& service) override {
-		ClientConnection::onServiceRegistered(service.getServiceIDs());
+		{
+			std::lock_guard<std::recursive_mutex> lock(m_registryMutex);
+			ClientConnection::onServiceRegistered(service.getServiceIDs());
+		}
+		m_serviceRegisteredCondition.notify_all();
 	}
 
 	virtual void onServiceUnregistered(const Service& service) override {
+		std::lock_guard<std::recursive_mutex> lock(m_registryMutex);
 		ClientConnection::onServiceUnregistered(service.getServiceIDs());
 	}
 
@@ -154,6 +160,44 @@ public:
 		return SomeIPReturnCode::OK;
 	}
 
+	SomeIPReturnCode registerServices(const std::vector<SomeIP::ServiceIDs>& serviceIDs) override {
+		auto services = m_dispatcher.tryRegisterServices(serviceIDs, m_daemonInterface, true);
+
+		if ( services.size() != serviceIDs.size() )
+			return SomeIPReturnCode::ERROR;
+
+		for (auto service : services)
+			m_registeredServices[service->getServiceIDs()] = service;
+
+		return SomeIPReturnCode::OK;
+	}
+
+	SomeIPReturnCode unregisterServices(const std::vector<SomeIP::ServiceIDs>& serviceIDs) override {
+		std::vector<Service*> services;
+
+		for (auto& serviceID : serviceIDs) {
+			if ( (m_registeredServices.count(serviceID) == 0) || (m_registeredServices[serviceID] == nullptr) )
+				return SomeIPReturnCode::ERROR;
+			auto service = m_registeredServices[serviceID];
+			if ( std::find(services.begin(), services.end(), service) != services.end() )
+				return SomeIPReturnCode::ERROR;
+			services.push_back(service);
+		}
+
+		m_dispatcher.unregisterServices(services);
+
+		for (auto& serviceID : serviceIDs)
+			m_registeredServices[serviceID] = nullptr;
+
+		return SomeIPReturnCode::OK;
+	}
+
+	SomeIPReturnCode subscribeToNotifications(const std::vector<SomeIP::MemberIDs>& memberIDs) override {
+		for (auto& memberID : memberIDs)
+			m_dispatcher.subscribeClientForNotifications(m_daemonInterface, memberID);
+		return SomeIPReturnCode::OK;
+	}
+
 	/**
 	 * Sends the given message to the dispatcher.
 	 */
@@ -163,6 +207,14 @@ public:
 		return SomeIPReturnCode::OK;
 	}
 
+	SomeIPReturnCode sendMessages(const OutputMessage* const* messages, size_t messageCount) override {
+		for (size_t i = 0; i < messageCount; i++)
+			sendMessage(*messages[i]);
+		return SomeIPReturnCode::OK;
+	}
+
+	using ClientConnection::sendMessages;
+
 	/**
 	 * Sends a ping message to the connected peers
 	 */
@@ -228,6 +280,23 @@ public:
 		return getServiceRegistry().isServiceRegistered(service);
 	}
 
+	/**
+	 * The services are registered by the main loop, so this method must not be called from the main loop thread.
+	 */
+	bool waitForServices(const std::vector<ServiceIDs>& services, int timeoutInMilliseconds) override {
+		std::unique_lock<std::recursive_mutex> lock(m_registryMutex);
+		auto predicate = [&] () {
+			return areServicesRegistered(services);
+		};
+
+		if (timeoutInMilliseconds == NO_TIMEOUT) {
+			m_serviceRegisteredCondition.wait(lock, predicate);
+			return true;
+		}
+
+		return m_serviceRegisteredCondition.wait_for(lock, std::chrono::milliseconds(timeoutInMilliseconds), predicate);
+	}
+
 private:
 	int m_tcpPortNumber = 6666;
 	int tcpPortTriesCount = 10;
@@ -242,6 +311,9 @@ private:
 
 	bool m_connected = false;
 
+	std::recursive_mutex m_registryMutex;
+	std::condition_variable_any m_serviceRegisteredCondition;
+
 };
 
 }
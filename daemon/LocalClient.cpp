@@ -1,3 +1,5 @@
+#include <sys/socket.h>
+
 #include "LocalClient.h"
 
 namespace SomeIP_Dispatcher {
@@ -10,6 +12,7 @@ void LocalClient::handleIncomingIPCMessage(IPCInputMessage& inputMessage) {
 	case IPCMessageType::SEND_MESSAGE : {
 		DispatcherMessage msg = readMessageFromIPCMessage(inputMessage);
 		processIncomingMessage(msg);
+		updatePeerTrafficCounter(msg);
 	}
 	break;
 
@@ -55,6 +58,57 @@ void LocalClient::handleIncomingIPCMessage(IPCInputMessage& inputMessage) {
 	}
 	break;
 
+	case IPCMessageType::REGISTER_SERVICES : {
+
+		std::vector<SomeIP::ServiceIDs> serviceIDs;
+		while ( reader.hasMoreData() ) {
+			SomeIP::ServiceIDs serviceID;
+			reader >> serviceID.serviceID >> serviceID.instanceID;
+			serviceIDs.push_back(serviceID);
+		}
+
+		log_debug() << "REGISTER_SERVICES Message received from client " << toString() << ". Service count:" <<
+		serviceIDs.size();
+
+		IPCReturnCode returnCode = registerServices(serviceIDs, true) ? IPCReturnCode::OK : IPCReturnCode::ERROR;
+
+		IPCOutputMessage answer(inputMessage, returnCode);
+		writeNonBlocking(answer);
+	}
+	break;
+
+	case IPCMessageType::UNREGISTER_SERVICES : {
+
+		std::vector<SomeIP::ServiceIDs> serviceIDs;
+		while ( reader.hasMoreData() ) {
+			SomeIP::ServiceIDs serviceID;
+			reader >> serviceID.serviceID >> serviceID.instanceID;
+			serviceIDs.push_back(serviceID);
+		}
+
+		log_debug() << "UNREGISTER_SERVICES Message received from client " << toString() << ". Service count:" <<
+		serviceIDs.size();
+
+		IPCReturnCode returnCode = unregisterServices(serviceIDs) ? IPCReturnCode::OK : IPCReturnCode::ERROR;
+
+		IPCOutputMessage answer(inputMessage, returnCode);
+		writeNonBlocking(answer);
+	}
+	break;
+
+	case IPCMessageType::SUBSCRIBE_NOTIFICATIONS : {
+
+		while ( reader.hasMoreData() ) {
+			SomeIP::MemberIDs memberIDs;
+			reader >> memberIDs.m_serviceIDs.serviceID >> memberIDs.m_serviceIDs.instanceID >> memberIDs.m_memberID;
+			subscribeToNotification(memberIDs);
+		}
+
+		IPCOutputMessage answer(inputMessage, IPCReturnCode::OK);
+		writeNonBlocking(answer);
+	}
+	break;
+
 	case IPCMessageType::PONG : {
 		log_debug() << "PONG Message received from client " << toString();
 		//			sendTestMessage();
@@ -71,6 +125,12 @@ void LocalClient::handleIncomingIPCMessage(IPCInputMessage& inputMessage) {
 	}
 	break;
 
+	case IPCMessageType::REGISTRY_SEGMENT_UNAVAILABLE : {
+		log_debug() << "Registry segment not readable by client " << toString();
+		sendRegistry();
+	}
+	break;
+
 	case IPCMessageType::SUBSCRIBE_NOTIFICATION : {
 		SomeIP::MemberIDs memberIDs;
 		reader >> memberIDs.m_serviceIDs.serviceID >> memberIDs.m_serviceIDs.instanceID >> memberIDs.m_memberID;
@@ -90,6 +150,41 @@ void LocalClient::handleIncomingIPCMessage(IPCInputMessage& inputMessage) {
 	}
 	break;
 
+	case IPCMessageType::SET_FRAMING : {
+		uint8_t framing = 0;
+		reader >> framing;
+
+		// the packets of a SOCK_SEQPACKET connection already carry their length
+		bool isSupported = ( framing == static_cast<uint8_t>(IPCFraming::NATIVE) ) ||
+				   ( ( framing == static_cast<uint8_t>(IPCFraming::COMPACT) ) && !isPacketMode() );
+
+		// the answer is still sent with the previous framing, which the client switches from once it has received it
+		IPCOutputMessage answer(inputMessage, isSupported ? IPCReturnCode::OK : IPCReturnCode::ERROR);
+		writeNonBlocking(answer);
+
+		if (isSupported) {
+			setFraming( static_cast<IPCFraming>(framing) );
+			m_supportsBatches = true;
+			log_debug() << "Client " << toString() << " uses the " <<
+				( (framing == static_cast<uint8_t>(IPCFraming::COMPACT) ) ? "compact" : "native" ) << " framing";
+		}
+	}
+	break;
+
+	case IPCMessageType::BATCH : {
+		IPCBatchReader batchReader(inputMessage);
+		IPCInputMessage subMessage;
+		while ( batchReader.next() ) {
+			if (batchReader.getMessageType() == IPCMessageType::BATCH) {
+				log_error() << "Nested batch received from client " << toString();
+				continue;
+			}
+			batchReader.copyTo(subMessage);
+			handleIncomingIPCMessage(subMessage);
+		}
+	}
+	break;
+
 	default : {
 		log_error() << "Unknown message type : " << SomeIP_Lib::toString( inputMessage.getMessageType() );
 	}
@@ -104,6 +199,9 @@ WatchStatus LocalClient::onIncomingDataAvailable() {
 		return WatchStatus::STOP_WATCHING;
 	}
 
+	// the messages sent to the other clients while processing the received data are packed together
+	DispatchCycle dispatchCycle( getDispatcher() );
+
 	bool bKeepProcessing = true;
 
 	do {
@@ -123,6 +221,130 @@ WatchStatus LocalClient::onIncomingDataAvailable() {
 
 }
 
+bool LocalClient::deferMessage(const IPCMessage& msg) {
+
+	auto& dispatcher = getDispatcher();
+
+	if ( !m_supportsBatches || !dispatcher.isInDispatchCycle() || (msg.getMessageType() != IPCMessageType::SEND_MESSAGE) ||
+	     (msg.getFileDescriptor() != -1) )
+		return false;
+
+	// the first message of a cycle is sent immediately if nothing is pending, so that batching never adds any latency
+	if ( (m_deferredMessages.getMessageCount() == 0) && !SocketStreamConnection::isCongested() &&
+	     (m_lastDirectWriteCycleID != dispatcher.getDispatchCycleID() ) ) {
+		m_lastDirectWriteCycleID = dispatcher.getDispatchCycleID();
+		return false;
+	}
+
+	if (m_deferredMessages.getMessageCount() == 0)
+		dispatcher.addClientToFlush(*this);
+
+	m_deferredMessages.append(msg);
+	return true;
+}
+
+bool LocalClient::beginRelay(const DispatcherMessage& msg, size_t payloadLength, SpliceRelay& relay) {
+
+	// the payload of a packet can not be written separately
+	if ( !isConnected() || isPacketMode() )
+		return false;
+
+	// the messages deferred during the current dispatch cycle have to be sent before
+	flushDeferredMessages();
+
+	ByteArray frameHeader;
+	encodeFrameHeader(msg.getIPCMessage(), payloadLength, frameHeader);
+	return relay.start( *this, frameHeader.getData(), frameHeader.size(), payloadLength );
+}
+
+void LocalClient::flushDeferredMessages() {
+
+	if (m_deferredMessages.getMessageCount() == 0)
+		return;
+
+	log_verbose() << "Sending a batch of " << m_deferredMessages.getMessageCount() << " messages to " << toString();
+
+	if ( isConnected() )
+		UDSConnection::writeNonBlocking( m_deferredMessages.getMessage() );
+
+	m_deferredMessages.clear();
+}
+
+void LocalClient::updatePeerTrafficCounter(const DispatcherMessage& msg) {
+
+	if ( (m_peerChannelThreshold == 0) || msg.getHeader().isReply() || msg.getHeader().isNotification() )
+		return;
+
+	SomeIP::ServiceIDs serviceID( msg.getServiceID(), msg.getInstanceID() );
+
+	PeerTrafficCounter* counter = nullptr;
+	for (auto& existingCounter : m_peerTrafficCounters) {
+		if (existingCounter.m_serviceID == serviceID) {
+			counter = &existingCounter;
+			break;
+		}
+	}
+
+	if (counter == nullptr) {
+		PeerTrafficCounter newCounter;
+		newCounter.m_serviceID = serviceID;
+		newCounter.m_requestCount = 0;
+		m_peerTrafficCounters.push_back(newCounter);
+		counter = &m_peerTrafficCounters.back();
+	}
+
+	// the channel is only opened once per service
+	if (++counter->m_requestCount != m_peerChannelThreshold)
+		return;
+
+	Service* service = getDispatcher().getService(serviceID);
+	if ( (service == nullptr) || !service->isLocal() )
+		return;
+
+	LocalClient* provider = dynamic_cast<LocalClient*>( service->getClient() );
+	if ( (provider != nullptr) && (provider != this) && provider->isConnected() )
+		openPeerChannel(*service, *provider);
+}
+
+void LocalClient::resetPeerTrafficCounter(SomeIP::ServiceIDs serviceID) {
+	for (auto i = m_peerTrafficCounters.begin(); i != m_peerTrafficCounters.end(); i++) {
+		if (i->m_serviceID == serviceID) {
+			m_peerTrafficCounters.erase(i);
+			break;
+		}
+	}
+}
+
+void LocalClient::openPeerChannel(const Service& service, LocalClient& provider) {
+
+	int fds[2];
+	if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0) {
+		log_error() << "Can't create socket pair for direct channel with " << provider.toString();
+		return;
+	}
+
+	log_info() << "Opening direct channel between " << toString() << " and " << provider.toString() << " for " <<
+	service.getServiceIDs().toString();
+
+	// the provider gets its end first, so that it can handle the requests which will be sent via the channel
+	if ( isError( provider.sendPeerChannel(service.getServiceIDs(), getIdentifier(), true, fds[1]) ) )
+		log_warning() << "Could not send direct channel to " << provider.toString();
+	else
+		sendPeerChannel(service.getServiceIDs(), provider.getIdentifier(), false, fds[0]);
+
+	// the descriptors have been duplicated by the kernel or by our output queue
+	close(fds[0]);
+	close(fds[1]);
+}
+
+SomeIPReturnCode LocalClient::sendPeerChannel(SomeIP::ServiceIDs serviceID, ClientIdentifier peer, bool isProvider,
+					      int fd) {
+	IPCOutputMessage msg(IPCMessageType::PEER_CHANNEL);
+	msg << serviceID.serviceID << serviceID.instanceID << peer << static_cast<uint8_t>(isProvider ? 1 : 0);
+	msg.setFileDescriptor(fd);
+	return isError( writeNonBlocking(msg) ) ? SomeIPReturnCode::ERROR : SomeIPReturnCode::OK;
+}
+
 void LocalClient::sendPingMessage() {
 #ifdef ENABLE_PING
 	log_verbose() << "Sending PING message to " << toString();
@@ -155,7 +377,8 @@ void LocalClient::initConnection() {
 		fd.fd = getFileDescriptor();
 		fd.events = POLLOUT;
 		m_outputDataWatcher = m_mainLoopContext.addFileDescriptorWatch([&] () {
-									 return onWritingPossible();
+									 if (onWritingPossible() == WatchStatus::STOP_WATCHING)
+										 m_outputDataWatcher->disable();
 								 }, fd);
 	}
 
@@ -170,7 +393,12 @@ void LocalClient::initConnection() {
 	}
 
 	sendPingMessage();
-	sendRegistry();
+
+	// the client fills its registry from the segment, and only asks for the full registry if it can't read it
+	if (m_registrySegment != nullptr)
+		sendRegistrySegment();
+	else
+		sendRegistry();
 }
 
 }
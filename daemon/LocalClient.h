@@ -7,6 +7,7 @@
 #include "GlibIO.h"
 
 #include "ipc/UDSConnection.h"
+#include "ServiceRegistrySegment.h"
 
 namespace SomeIP_Dispatcher {
 
@@ -28,11 +29,19 @@ protected:
 
 public:
 	using SocketStreamConnection::isConnected;
+	using UDSConnection::setMaximumMessageSize;
 
-	LocalClient(Dispatcher& dispatcher, int fd, MainLoopContext& context) :
-		Client(dispatcher), m_mainLoopContext(context) {
+	/// Number of requests sent to a service provided by another local client, after which a direct channel is opened between the two clients
+	static const unsigned int DEFAULT_PEER_CHANNEL_THRESHOLD = 1000;
+
+	LocalClient(Dispatcher& dispatcher, int fd, MainLoopContext& context,
+		    unsigned int peerChannelThreshold = DEFAULT_PEER_CHANNEL_THRESHOLD,
+		    const ServiceRegistrySegment* registrySegment = nullptr) :
+		Client(dispatcher), m_mainLoopContext(context), m_peerChannelThreshold(peerChannelThreshold),
+		m_registrySegment(registrySegment) {
 		setInputMessage(m_inputMessage);
 		setFileDescriptor(fd);
+		detectSocketType();
 	}
 
 	~LocalClient() {
@@ -64,6 +73,17 @@ public:
 		writeNonBlocking(msg);
 	}
 
+	/**
+	 * Send the file descriptor of the shared registry segment, if any, from which the client gets the initial registry
+	 */
+	void sendRegistrySegment() {
+		if (m_registrySegment != nullptr) {
+			IPCOutputMessage msg(IPCMessageType::REGISTRY_SEGMENT);
+			msg.setFileDescriptor( m_registrySegment->getFileDescriptor() );
+			writeNonBlocking(msg);
+		}
+	}
+
 	void onNotificationSubscribed(Service& serviceID, SomeIP::MemberID memberID) override {
 		// TODO : send message to inform the client that we are interested in the notification
 	}
@@ -78,16 +98,21 @@ public:
 		return sendIPCMessage( msg.getIPCMessage() );
 	}
 
+	bool beginRelay(const DispatcherMessage& msg, size_t payloadLength, SpliceRelay& relay) override;
+
 	InputMessage sendMessageBlocking(const OutputMessage& msg) override {
 		sendMessage(msg);
 		assert(false);
 	}
 
 	SomeIPReturnCode sendIPCMessage(const IPCMessage& msg) {
-		writeNonBlocking(msg);
+		if ( !deferMessage(msg) )
+			writeNonBlocking(msg);
 		return SomeIPReturnCode::OK;
 	}
 
+	void flushDeferredMessages() override;
+
 	void onServiceRegistered(const Service& service) override {
 		if ( isConnected() ) {
 			IPCOutputMessage msg(IPCMessageType::SERVICES_REGISTERED);
@@ -97,6 +122,7 @@ public:
 	}
 
 	void onServiceUnregistered(const Service& service) override {
+		resetPeerTrafficCounter( service.getServiceIDs() );
 		if ( isConnected() ) {
 			IPCOutputMessage msg(IPCMessageType::SERVICES_UNREGISTERED);
 			msg << service.getServiceIDs().serviceID << service.getServiceIDs().instanceID;
@@ -104,6 +130,27 @@ public:
 		}
 	}
 
+	void onServicesRegistered(const std::vector<const Service*>& services) override {
+		if ( isConnected() ) {
+			IPCOutputMessage msg(IPCMessageType::SERVICES_REGISTERED);
+			for (auto service : services)
+				msg << service->getServiceIDs().serviceID << service->getServiceIDs().instanceID;
+			writeNonBlocking(msg);
+		}
+	}
+
+	void onServicesUnregistered(const std::vector<const Service*>& services) override {
+		for (auto service : services)
+			resetPeerTrafficCounter( service->getServiceIDs() );
+
+		if ( isConnected() ) {
+			IPCOutputMessage msg(IPCMessageType::SERVICES_UNREGISTERED);
+			for (auto service : services)
+				msg << service->getServiceIDs().serviceID << service->getServiceIDs().instanceID;
+			writeNonBlocking(msg);
+		}
+	}
+
 	void handleIncomingIPCMessage(IPCInputMessage& inputMessage) override;
 
 	void sendPingMessage();
@@ -115,6 +162,7 @@ public:
 	}
 
 	void onDisconnected() override {
+		m_deferredMessages.clear();
 		getDispatcher().removeServiceRegistrationListener(*this);
 		unregisterClient();
 
@@ -139,6 +187,41 @@ public:
 	}
 
 private:
+	/**
+	 * Writes the given message after the deferred ones, so that the order of the messages is kept
+	 */
+	IPCOperationReport writeNonBlocking(const IPCMessage& msg) {
+		flushDeferredMessages();
+		return UDSConnection::writeNonBlocking(msg);
+	}
+
+	/**
+	 * Adds the given message to the batch sent at the end of the current dispatch cycle, if the message is not the first one
+	 * sent to the client during that cycle
+	 * @return false if the message should be sent immediately
+	 */
+	bool deferMessage(const IPCMessage& msg);
+
+	/**
+	 * Counts the requests sent to services provided by other local clients, and asks both clients to open a direct channel
+	 * once the threshold is reached.
+	 */
+	void updatePeerTrafficCounter(const DispatcherMessage& msg);
+
+	void resetPeerTrafficCounter(SomeIP::ServiceIDs serviceID);
+
+	/**
+	 * Creates a socket pair and sends one end to this client and the other end to the provider of the given service
+	 */
+	void openPeerChannel(const Service& service, LocalClient& provider);
+
+	SomeIPReturnCode sendPeerChannel(SomeIP::ServiceIDs serviceID, ClientIdentifier peer, bool isProvider, int fd);
+
+	struct PeerTrafficCounter {
+		SomeIP::ServiceIDs m_serviceID;
+		unsigned int m_requestCount;
+	};
+
 	IPCInputMessage m_inputMessage;
 
 	std::unique_ptr<WatchMainLoopHook> m_inputDataWatcher;
@@ -153,6 +236,22 @@ private:
 	/// A textual representation of the process, used for logging
 	std::string processName;
 
+	/// 0 if direct channels should not be used
+	unsigned int m_peerChannelThreshold;
+
+	/// The shared registry segment, whose file descriptor is sent to the client, or nullptr
+	const ServiceRegistrySegment* m_registrySegment;
+
+	std::vector<PeerTrafficCounter> m_peerTrafficCounters;
+
+	/// True if the client has negotiated its framing, which implies that it can receive BATCH messages
+	bool m_supportsBatches = false;
+
+	/// Messages sent during the current dispatch cycle, after the first one
+	IPCBatchWriter m_deferredMessages;
+
+	unsigned int m_lastDirectWriteCycleID = 0;
+
 };
 
 }
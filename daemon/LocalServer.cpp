@@ -22,9 +22,9 @@ void LocalServer::init(const char* socketPath) {
 		setFileDescriptor(SD_LISTEN_FDS_START);
 		log_info() << "Got a file descriptor from systemd";
 	} else
-		initServerSocket(socketPath);
+		initServerSocket(socketPath, 0, m_socketType);
 #else
-	initServerSocket(socketPath);
+	initServerSocket(socketPath, 0, m_socketType);
 #endif
 
 	// when running as root, allow the applications which are not running as root to connect
@@ -36,6 +36,15 @@ void LocalServer::init(const char* socketPath) {
 
 	log_info() << "UNIX domain server socket listening on path " << getSocketPath();
 
+	// publish the service registry in a shared memory segment, so that the clients can read it without any IPC
+	if ( m_registrySegment.create() == SomeIPReturnCode::OK ) {
+		for ( auto service : m_dispatcher.getServices() )
+			m_registrySegment.addService( service->getServiceIDs() );
+		// updated before any client gets notified, so that the segment is up to date when the clients react
+		m_dispatcher.setServiceRegistryMirror(this);
+	} else
+		log_warning() << "Service registry segment not available";
+
 }
 
 }
@@ -7,6 +7,7 @@
 #include "ipc.h"
 #include "Dispatcher.h"
 #include "LocalClient.h"
+#include "ServiceRegistrySegment.h"
 #include "ipc/UDSConnection.h"
 
 #ifdef ENABLE_SYSTEMD
@@ -18,7 +19,7 @@ namespace SomeIP_Dispatcher {
 /**
  * Handles the local connections.
  */
-class LocalServer : private UDSServer {
+class LocalServer : private UDSServer, private ServiceRegistrationListener {
 
 	LOG_DECLARE_CLASS_CONTEXT("LoSe", "LocalServer");
 
@@ -28,6 +29,9 @@ public:
 	}
 
 	~LocalServer() {
+		if ( m_registrySegment.isMapped() )
+			m_dispatcher.setServiceRegistryMirror(nullptr);
+
 		g_io_channel_unref(m_serverSocketChannel);
 
 		// delete server socket. TODO : check whether the socket should actually be removed with SystemD
@@ -41,7 +45,9 @@ public:
 	}
 
 	void createNewClientConnection(int fileDescriptor) override {
-		LocalClient* newClient = new LocalClient(m_dispatcher, fileDescriptor, m_mainLoopContext);
+		LocalClient* newClient = new LocalClient(m_dispatcher, fileDescriptor, m_mainLoopContext, m_peerChannelThreshold,
+							     m_registrySegment.isMapped() ? &m_registrySegment : nullptr);
+		newClient->setMaximumMessageSize(m_maximumMessageSize);
 		newClient->registerClient();
 		log_debug() << "New client : " << newClient->toString();
 	}
@@ -52,8 +58,54 @@ public:
 
 	void init(const char* socketPath);
 
+	/**
+	 * Sets the number of requests after which two local clients get a direct channel. 0 disables direct channels.
+	 */
+	void setPeerChannelThreshold(unsigned int threshold) {
+		m_peerChannelThreshold = threshold;
+	}
+
+	/**
+	 * Sets the maximum length of the messages received from the local clients. A client sending a larger message is
+	 * disconnected. 0 means no limit.
+	 */
+	void setMaximumMessageSize(size_t maximumSize) {
+		m_maximumMessageSize = maximumSize;
+	}
+
+	/**
+	 * Sets the type of the server socket. Must be called before init().
+	 */
+	void setSocketType(IPCSocketType socketType) {
+		m_socketType = socketType;
+	}
+
 private:
+	void onServiceRegistered(const Service& service) override {
+		m_registrySegment.addService( service.getServiceIDs() );
+	}
+
+	void onServiceUnregistered(const Service& service) override {
+		m_registrySegment.removeService( service.getServiceIDs() );
+
+		// the services refused while the segment was full are published as soon as all the services fit again
+		if ( !m_registrySegment.isOverflowed() )
+			return;
+
+		auto services = m_dispatcher.getServices();
+		if ( services.size() <= m_registrySegment.getMaximumServiceCount() ) {
+			std::vector<ServiceIDs> serviceIDs;
+			for (auto registeredService : services)
+				serviceIDs.push_back( registeredService->getServiceIDs() );
+			m_registrySegment.rebuild(serviceIDs);
+		}
+	}
+
 	Dispatcher& m_dispatcher;
+	ServiceRegistrySegment m_registrySegment;
+	unsigned int m_peerChannelThreshold = LocalClient::DEFAULT_PEER_CHANNEL_THRESHOLD;
+	IPCSocketType m_socketType = IPCSocketType::STREAM;
+	size_t m_maximumMessageSize = SocketStreamConnection::DEFAULT_MAXIMUM_MESSAGE_SIZE;
 	GIOChannel* m_serverSocketChannel = nullptr;
 	MainLoopContext& m_mainLoopContext;
 };
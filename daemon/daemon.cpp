@@ -10,6 +10,7 @@ LOG_DEFINE_APP_IDS("Some", "SomeIP daemon");
 #include "LocalServer.h"
 #include "TCPServer.h"
 #include "TCPManager.h"
+#include "UDPManager.h"
 
 #include "RemoteServiceListener.h"
 #include "ServiceAnnouncer.h"
@@ -51,6 +52,37 @@ int run(int argc, const char** argv) {
 	const char* localSocketPath = SomeIPClient::ClientDaemonConnection::DEFAULT_SERVER_SOCKET_PATH;
 	commandLineParser.addOption(localSocketPath, "localPath", 's', "Local IPC socket path");
 
+	unsigned int peerChannelThreshold = LocalClient::DEFAULT_PEER_CHANNEL_THRESHOLD;
+	commandLineParser.addOption(peerChannelThreshold, "peerThreshold", 't',
+				    "Number of requests after which two local clients communicate directly (0 to disable)");
+
+	bool useSeqPacketSocket = false;
+	commandLineParser.addOption(useSeqPacketSocket, "seqpacket", 'q', "Use a SOCK_SEQPACKET local IPC socket");
+
+	unsigned int zeroCopyThreshold = 0;
+	commandLineParser.addOption(zeroCopyThreshold, "zerocopy", 'z',
+				    "Payload size from which the shared payloads are sent with MSG_ZEROCOPY over TCP (0 to disable)");
+
+	unsigned int relayThreshold = 0;
+	commandLineParser.addOption(relayThreshold, "relay", 'y',
+				    "Payload size from which the messages received over TCP are relayed with splice() (0 to disable)");
+
+	unsigned int maximumMessageSize = SocketStreamConnection::DEFAULT_MAXIMUM_MESSAGE_SIZE;
+	commandLineParser.addOption(maximumMessageSize, "maxMessageSize", 'm',
+				    "Maximum size of a message buffered by the dispatcher (0 for no limit)");
+
+	unsigned int acceptorCount = 1;
+	commandLineParser.addOption(acceptorCount, "acceptors", 'a',
+				    "Number of threads accepting the TCP connections, through sockets sharing the port with SO_REUSEPORT");
+
+	int udpPortNumber = 0;
+	commandLineParser.addOption(udpPortNumber, "udpPort", 'd',
+				    "First UDP port through which the services are also offered (0 to offer them over TCP only)");
+
+	const char* multicastEventGroups = "";
+	commandLineParser.addOption(multicastEventGroups, "multicast", 'g',
+				    "Eventgroups delivered via UDP multicast : serviceID:instanceID:eventGroupID=address:port,...");
+
 	if ( commandLineParser.parse(argc, argv) )
 		exit(1);
 
@@ -67,21 +99,35 @@ int run(int argc, const char** argv) {
 	log_info() << "Daemon started. version: " << SOMEIP_PACKAGE_VERSION << ". Logging to : " << logFilePath;
 
 	TCPManager tcpManager(dispatcher, mainLoopContext, tcpPortNumber);
+	tcpManager.setZeroCopyThreshold(zeroCopyThreshold);
+	tcpManager.setRelayThreshold(relayThreshold);
+	tcpManager.setMaximumMessageSize(maximumMessageSize);
+	tcpManager.setAcceptorCount(acceptorCount);
 	if(isError(tcpManager.init(tcpPortTriesCount))) {
 		return -1;
 	}
 
+	UDPManager udpManager(dispatcher, mainLoopContext, udpPortNumber);
+	udpManager.init(tcpPortTriesCount);
+	if ( isError( udpManager.addMulticastEventGroups(multicastEventGroups) ) )
+		return -1;
+
 	for ( auto& localIpAddress : tcpManager.getIPAddresses() )
 		log_debug() << "Local IP address : " << localIpAddress.toString();
 
 	LocalServer localServer(dispatcher, mainLoopContext);
+	localServer.setPeerChannelThreshold(peerChannelThreshold);
+	localServer.setMaximumMessageSize(maximumMessageSize);
+	localServer.setSocketType(useSeqPacketSocket ? IPCSocketType::SEQPACKET : IPCSocketType::STREAM);
 	if (!disableLocalIPC)
 		localServer.init(localSocketPath);
 
 	ServiceAnnouncer serviceAnnouncer(dispatcher, tcpManager, mainLoopContext);
+	serviceAnnouncer.setUDPManager(udpManager);
 	serviceAnnouncer.init();
 
 	RemoteServiceListener remoteServiceListener(dispatcher, tcpManager, serviceAnnouncer, mainLoopContext);
+	remoteServiceListener.setUDPManager(udpManager);
 	if (!disableRemoteServices)
 		remoteServiceListener.init();
 
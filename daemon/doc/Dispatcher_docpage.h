@@ -6,7 +6,7 @@ Dispatcher daemon
 \section Dispatcher
 The dispatcher is a process, which is in charge of handling the requests coming from clients. 2 types of clients exist:
         \li Applications running locally. The communication between the client processes and the dispatcher is using a local IPC channel (Unix Domain Socket).
-        \li Devices connected via TCP or UDP (UDP not yet implemented).
+        \li Devices connected via TCP or UDP.
 
 \subsection Requirements
 Here are the main requirements fulfilled by the dispatcher:
@@ -19,7 +19,8 @@ Here are the main requirements fulfilled by the dispatcher:
 Here are the main components:
         \li Dispatcher core. This component handle the core features such as the registration/unregistration of services and the message dispatching from one client to another.
         \li Local Server. This component handles the connection of the local client applications. Unix domain sockets are currently used as low-level IPC channel.
-        \li TCP Server. This component handles the connection of client applications via TCP.
+        \li TCP Server. This component handles the connection of client applications via TCP. Several threads can accept the incoming connections in parallel, through listening sockets sharing the same port, the accepted connections being then handled by the main loop.
+        \li UDP endpoints. When a UDP port is configured, the services are also offered via UDP. Several small messages sent to the same device are packed into a single datagram, and the datagrams are sent and received in batches. The messages larger than a datagram are split into SOME/IP-TP segments, which are reassembled in any order by the receiving endpoint. The notifications of the eventgroups configured for multicast are sent once to a multicast group, which is advertised to the subscribers when their subscription is acknowledged.
         \li Service announcer. This component is in charge of sending notifications on the network (via UDP broadcasts) as soon as a service has been registered or unregistered.
         \li Remote service listener. This component listens to notifications sent by other devices on the network and registers those service locally, so that they can be used by local clients.
 
@@ -0,0 +1,167 @@
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+#include "AcceptorGroup.h"
+
+namespace SomeIP_Lib {
+
+/// Delay during which an acceptor stops accepting after a resource error such as EMFILE, instead of spinning on poll()
+static const int RESOURCE_ERROR_DELAY = 100;  // ms
+
+AcceptorGroup::~AcceptorGroup() {
+	stop();
+}
+
+SomeIPReturnCode AcceptorGroup::start(const std::vector<int>& listeningSockets) {
+
+	assert( m_threads.empty() );
+	m_listeningSockets = listeningSockets;
+
+	m_wakeUpEvent = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	m_stopEvent = eventfd(0, EFD_CLOEXEC);
+	if ( (m_wakeUpEvent == -1) || (m_stopEvent == -1) ) {
+		log_error() << "Failed to create eventfd. Error : " << strerror(errno);
+		stop();
+		return SomeIPReturnCode::ERROR;
+	}
+
+	// each acceptor drains the queue of its socket until EAGAIN
+	for (auto listeningSocket : m_listeningSockets) {
+		if (fcntl( listeningSocket, F_SETFL, fcntl(listeningSocket, F_GETFL) | O_NONBLOCK ) == -1) {
+			log_error() << "Failed to make the listening socket non-blocking. Error : " << strerror(errno);
+			stop();
+			return SomeIPReturnCode::ERROR;
+		}
+	}
+
+	pollfd fd;
+	fd.fd = m_wakeUpEvent;
+	fd.events = POLLIN;
+	m_wakeUpWatch = m_mainLoop.addFileDescriptorWatch([this] () {
+								  handleAcceptedConnections();
+							  }, fd);
+	m_wakeUpWatch->enable();
+
+	for (auto listeningSocket : m_listeningSockets)
+		m_threads.push_back( std::thread(&AcceptorGroup::runAcceptor, this, listeningSocket) );
+
+	return SomeIPReturnCode::OK;
+}
+
+void AcceptorGroup::stop() {
+
+	if ( !m_threads.empty() ) {
+		uint64_t value = 1;
+		if (::write( m_stopEvent, &value, sizeof(value) ) != sizeof(value))
+			log_error() << "Failed to stop the acceptors. Error : " << strerror(errno);
+		for (auto& thread : m_threads)
+			thread.join();
+		m_threads.clear();
+	}
+
+	m_wakeUpWatch.reset();
+
+	for (auto listeningSocket : m_listeningSockets)
+		::close(listeningSocket);
+	m_listeningSockets.clear();
+
+	closeAcceptedConnections();
+
+	for (auto event : {&m_wakeUpEvent, &m_stopEvent}) {
+		if (*event != -1) {
+			::close(*event);
+			*event = -1;
+		}
+	}
+}
+
+void AcceptorGroup::runAcceptor(int listeningSocket) {
+
+	std::vector<int> acceptedConnections;
+
+	while (true) {
+		pollfd fds[2];
+		fds[0].fd = listeningSocket;
+		fds[0].events = POLLIN;
+		fds[1].fd = m_stopEvent;
+		fds[1].events = POLLIN;
+
+		if (::poll(fds, 2, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			log_error() << "Acceptor stopped. Error : " << strerror(errno);
+			return;
+		}
+
+		if (fds[1].revents != 0)
+			return;
+
+		bool isResourceError = false;
+		while (true) {
+			int fileDescriptor = ::accept4(listeningSocket, nullptr, nullptr, SOCK_CLOEXEC);
+			if (fileDescriptor != -1) {
+				acceptedConnections.push_back(fileDescriptor);
+				continue;
+			}
+
+			// the peer may have reset its connection while it was waiting in the queue
+			if ( (errno == EINTR) || (errno == ECONNABORTED) || (errno == EPROTO) )
+				continue;
+
+			if ( (errno != EAGAIN) && (errno != EWOULDBLOCK) ) {
+				log_error() << "Failed to accept client connection. Error : " << strerror(errno);
+				isResourceError = true;
+			}
+			break;
+		}
+
+		if ( !acceptedConnections.empty() ) {
+			m_acceptedConnectionCount += acceptedConnections.size();
+			{
+				std::lock_guard<std::mutex> lock(m_acceptedConnectionsMutex);
+				m_acceptedConnections.insert( m_acceptedConnections.end(), acceptedConnections.begin(),
+							      acceptedConnections.end() );
+			}
+			acceptedConnections.clear();
+
+			uint64_t value = 1;
+			if (::write( m_wakeUpEvent, &value, sizeof(value) ) != sizeof(value))
+				log_error() << "Failed to wake up the main loop. Error : " << strerror(errno);
+		}
+
+		if (isResourceError)
+			std::this_thread::sleep_for( std::chrono::milliseconds(RESOURCE_ERROR_DELAY) );
+	}
+}
+
+void AcceptorGroup::handleAcceptedConnections() {
+
+	uint64_t value;
+	if (::read( m_wakeUpEvent, &value, sizeof(value) ) != sizeof(value))
+		return;
+
+	std::vector<int> acceptedConnections;
+	{
+		std::lock_guard<std::mutex> lock(m_acceptedConnectionsMutex);
+		acceptedConnections.swap(m_acceptedConnections);
+	}
+
+	log_debug() << "Accepting " << acceptedConnections.size() << " new connection(s)";
+
+	for (auto fileDescriptor : acceptedConnections)
+		m_connectionHandler(fileDescriptor);
+}
+
+void AcceptorGroup::closeAcceptedConnections() {
+	std::lock_guard<std::mutex> lock(m_acceptedConnectionsMutex);
+	for (auto fileDescriptor : m_acceptedConnections)
+		::close(fileDescriptor);
+	m_acceptedConnections.clear();
+}
+
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "SomeIP-common.h"
+
+namespace SomeIP_Lib {
+
+/**
+ * Accepts the connections of a group of listening sockets bound to the same port with SO_REUSEPORT, each socket being served by
+ * its own thread. The kernel distributes the incoming connections between the sockets, so that a burst of connections is
+ * accepted in parallel instead of one connection per main loop iteration. Since the dispatcher is single-threaded, the accepted
+ * sockets are handed over to the main loop in batches, where the connection handler is called.
+ */
+class AcceptorGroup {
+
+	LOG_DECLARE_CLASS_CONTEXT("AccG", "AcceptorGroup");
+
+public:
+	typedef std::function<void (int fileDescriptor)> ConnectionHandler;
+
+	AcceptorGroup(MainLoopInterface& mainLoop, ConnectionHandler connectionHandler) :
+		m_mainLoop(mainLoop), m_connectionHandler(connectionHandler) {
+	}
+
+	~AcceptorGroup();
+
+	AcceptorGroup(const AcceptorGroup&) = delete;
+	AcceptorGroup& operator=(const AcceptorGroup&) = delete;
+
+	/**
+	 * Starts one acceptor thread per listening socket. The sockets are owned by the group from now on, even if an error occurs.
+	 */
+	SomeIPReturnCode start(const std::vector<int>& listeningSockets);
+
+	/**
+	 * Stops and joins the acceptor threads. The connections which have been accepted but not handed over yet are closed.
+	 */
+	void stop();
+
+	size_t getAcceptorCount() const {
+		return m_threads.size();
+	}
+
+	/**
+	 * Returns the number of connections accepted by the acceptor threads since the group has been started
+	 */
+	size_t getAcceptedConnectionCount() const {
+		return m_acceptedConnectionCount;
+	}
+
+private:
+	/**
+	 * Body of an acceptor thread
+	 */
+	void runAcceptor(int listeningSocket);
+
+	/**
+	 * Called from the main loop when the acceptors have queued new connections
+	 */
+	void handleAcceptedConnections();
+
+	void closeAcceptedConnections();
+
+	MainLoopInterface& m_mainLoop;
+	ConnectionHandler m_connectionHandler;
+
+	std::vector<int> m_listeningSockets;
+	std::vector<std::thread> m_threads;
+
+	/// Connections accepted by the acceptor threads, not handed over to the main loop yet
+	std::vector<int> m_acceptedConnections;
+	std::mutex m_acceptedConnectionsMutex;
+	std::atomic<size_t> m_acceptedConnectionCount{0};
+
+	/// Event signaled by the acceptors when they have queued new connections
+	int m_wakeUpEvent = -1;
+	/// Event signaled to stop the acceptors
+	int m_stopEvent = -1;
+	std::unique_ptr<WatchMainLoopHook> m_wakeUpWatch;
+
+};
+
+}
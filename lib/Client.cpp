@@ -36,6 +36,40 @@ Service* Client::registerService(SomeIP::ServiceIDs serviceID, bool isLocal) {
 	return service;
 }
 
+bool Client::registerServices(const std::vector<SomeIP::ServiceIDs>& serviceIDs, bool isLocal) {
+	auto services = m_dispatcher.tryRegisterServices(serviceIDs, *this, isLocal);
+
+	for (auto service : services)
+		m_registeredServices.push_back(service);
+
+	return ( services.size() == serviceIDs.size() );
+}
+
+bool Client::unregisterServices(const std::vector<SomeIP::ServiceIDs>& serviceIDs) {
+
+	std::vector<Service*> services;
+
+	for (auto& serviceID : serviceIDs) {
+		auto i = std::find_if(m_registeredServices.begin(), m_registeredServices.end(), [&] (const Service * service) {
+					      return (service->getServiceIDs() == serviceID);
+				      });
+
+		if ( ( i == m_registeredServices.end() ) || ( std::find(services.begin(), services.end(), *i) != services.end() ) ) {
+			log_warning() << "Service " << serviceID.toString() << " is not registered by " << toString();
+			return false;
+		}
+
+		services.push_back(*i);
+	}
+
+	for (auto service : services)
+		removeFromVector(m_registeredServices, service);
+
+	m_dispatcher.unregisterServices(services);
+
+	return true;
+}
+
 void Client::unregisterService(SomeIP::ServiceIDs serviceID) {
 
 	for (auto i = m_registeredServices.begin(); i != m_registeredServices.end(); ++i) {
@@ -58,10 +92,34 @@ void Client::processIncomingMessage(InputMessage& msg) {
 			getDispatcher().dispatchMessage(msg, *this);
 }
 
+bool Client::relayIncomingMessage(DispatcherMessage& msg, size_t payloadLength, SpliceRelay& relay) {
+
+	// the messages processed by the client itself need their payload
+	if (msg.getHeader().getMemberID() == SomeIP::PING_MEMBER_ID)
+		return false;
+
+	Client* destination = getDispatcher().getSingleDestination(msg, *this);
+	if ( (destination == nullptr) || (destination == this) || !destination->beginRelay(msg, payloadLength, relay) )
+		return false;
+
+	log_traffic() << "Relaying message from client " << toString() << " to " << destination->toString() << " : " << msg;
+	return true;
+}
+
 void Client::subscribeToNotification(SomeIP::MemberIDs messageID) {
 	log_debug() << "SUBSCRIBE_NOTIFICATION Message received from client " << toString() << ". MessageID:0x" << messageID.toString();
 	auto& subscription = m_dispatcher.subscribeClientForNotifications(*this, messageID);
 	m_subscribedNotifications.push_back(&subscription);
 }
 
+void Client::unsubscribeFromNotification(SomeIP::MemberIDs messageID) {
+	for (auto i = m_subscribedNotifications.begin(); i != m_subscribedNotifications.end(); ++i) {
+		if ( (*i)->getMessageID() == messageID ) {
+			(*i)->unsubscribe(*this);
+			m_subscribedNotifications.erase(i);
+			break;
+		}
+	}
+}
+
 }
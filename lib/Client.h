@@ -9,6 +9,7 @@
 #include <vector>
 
 #include "SomeIP-common.h"
+#include "SpliceRelay.h"
 
 namespace SomeIP_Dispatcher {
 
@@ -25,6 +26,68 @@ public:
 	}
 	virtual void onServiceRegistered(const Service& service) = 0;
 	virtual void onServiceUnregistered(const Service& service) = 0;
+
+	/**
+	 * Called when several services have been registered at once. By default, the listener is notified for each service
+	 */
+	virtual void onServicesRegistered(const std::vector<const Service*>& services) {
+		for (auto service : services)
+			onServiceRegistered(*service);
+	}
+
+	/**
+	 * Called when several services have been unregistered at once
+	 */
+	virtual void onServicesUnregistered(const std::vector<const Service*>& services) {
+		for (auto service : services)
+			onServiceUnregistered(*service);
+	}
+};
+
+/**
+ * Message received from a remote client, whose SOME/IP header and payload are written by the transport
+ */
+class NetworkInputMessage : public DispatcherMessage {
+
+public:
+	NetworkInputMessage() :
+		InputMessage(m_ipcMessage) {
+		m_ipcMessage.getHeader().m_messageType = IPCMessageType::SEND_MESSAGE;
+	}
+
+	SomeIP::SomeIPHeader& getHeaderPrivate() {
+		return InputMessage::getHeaderPrivate();
+	}
+
+	void setPayloadSize(size_t size) {
+		auto s = size + m_ipcMessage.getHeaderSize() + getHeaderSize();
+		m_ipcMessage.getPayload().resize(s);
+	}
+
+	void* getWritablePayload() {
+		return const_cast<void*>( getPayload() );
+	}
+
+	/**
+	 * Returns the number of bytes preceding the payload in the buffer of the message
+	 */
+	static size_t getPayloadOffset() {
+		return IPCMessage::getHeaderSize() + getHeaderSize();
+	}
+
+	/**
+	 * Takes over a buffer in which the payload has already been written, after getPayloadOffset() bytes. The header of the
+	 * message has to be set afterwards.
+	 */
+	void setBuffer(ByteArray&& buffer) {
+		assert( buffer.size() >= getPayloadOffset() );
+		m_ipcMessage.getPayload() = std::move(buffer);
+		m_ipcMessage.getHeader().m_messageType = IPCMessageType::SEND_MESSAGE;
+	}
+
+private:
+	IPCInputMessage m_ipcMessage;
+
 };
 
 /**
@@ -65,8 +128,29 @@ public:
 
 	void processIncomingMessage(InputMessage& msg);
 
+	/**
+	 * Tries to relay an incoming message, whose payload has not been read yet, to its destination. The payload is then moved
+	 * by the given relay.
+	 * @return false if the message has to be read entirely and processed with processIncomingMessage()
+	 */
+	bool relayIncomingMessage(DispatcherMessage& msg, size_t payloadLength, SpliceRelay& relay);
+
+	/**
+	 * Starts sending a message whose payload is written to the socket of the client by the given relay
+	 * @return false if the message can not be relayed to this client, in which case it is sent with sendMessage()
+	 */
+	virtual bool beginRelay(const DispatcherMessage& msg, size_t payloadLength, SpliceRelay& relay) {
+		return false;
+	}
+
 	virtual bool isConnected() const = 0;
 
+	/**
+	 * Sends the messages which have been deferred during the current dispatch cycle
+	 */
+	virtual void flushDeferredMessages() {
+	}
+
 	/**
 	 * Called when a client has subscribed for notifications on the given property
 	 */
@@ -86,13 +170,44 @@ public:
 					     });
 	}
 
+	/**
+	 * Stores the identifier of the client sending a request in the upper bits of its requestID, so that the answer
+	 * received from a remote client can be dispatched to it
+	 */
+	void tagClientIdentifier(SomeIP::SomeIPHeader& header, ClientIdentifier clientIdentifier) const {
+		SomeIP::RequestID requestID = clientIdentifier;
+		requestID <<= 16;
+		requestID += (header.getRequestID() & 0xFFFF);
+		header.setRequestID(requestID);
+	}
+
+	ClientIdentifier extractClientIdentifier(const SomeIP::SomeIPHeader& header) const {
+		return header.getRequestID() >> 16;
+	}
+
 	Service* registerService(SomeIP::ServiceIDs serviceID, bool isLocal);
 
+	/**
+	 * Registers all the given services, or none of them if one of them can't be registered
+	 */
+	bool registerServices(const std::vector<SomeIP::ServiceIDs>& serviceIDs, bool isLocal);
+
 	void unregisterService(SomeIP::ServiceIDs serviceID);
 
+	/**
+	 * Unregisters all the given services, or none of them if one of them is not registered by this client
+	 */
+	bool unregisterServices(const std::vector<SomeIP::ServiceIDs>& serviceIDs);
+
 protected:
 	void subscribeToNotification(SomeIP::MemberIDs messageID);
 
+	void unsubscribeFromNotification(SomeIP::MemberIDs messageID);
+
+	bool hasSubscriptions() const {
+		return !m_subscribedNotifications.empty();
+	}
+
 	bool isInputBlocked() {
 		return inputBlocked;
 	}
@@ -0,0 +1,287 @@
+#include <sys/socket.h>
+#include <unistd.h>
+#include <errno.h>
+#include <algorithm>
+
+#include "DatagramSocket.h"
+
+namespace SomeIP_Lib {
+
+/// Size of the buffer receiving a datagram, which is large enough for any UDP datagram
+static const size_t RECEPTION_SLOT_SIZE = 64 * 1024;
+
+/// Size requested for the reception buffer of the socket, which the kernel caps to net.core.rmem_max
+static const int RECEIVE_BUFFER_SIZE = 1024 * 1024;
+
+SomeIPReturnCode SomeIPDatagramSocket::createSocket() {
+
+	close();
+
+	m_fileDescriptor = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+	if (m_fileDescriptor < 0) {
+		log_error() << "Failed to create UDP socket. Error : " << strerror(errno);
+		return SomeIPReturnCode::ERROR;
+	}
+
+	// a segmented message arrives as a burst of datagrams, which must not overflow the default buffer
+	int receiveBufferSize = RECEIVE_BUFFER_SIZE;
+	if (setsockopt( m_fileDescriptor, SOL_SOCKET, SO_RCVBUF, &receiveBufferSize, sizeof(receiveBufferSize) ) != 0)
+		log_warning() << "Can't set the size of the reception buffer. Error : " << strerror(errno);
+
+	return SomeIPReturnCode::OK;
+}
+
+SomeIPReturnCode SomeIPDatagramSocket::bind(TCPPort port) {
+
+	if ( isError( createSocket() ) )
+		return SomeIPReturnCode::ERROR;
+
+	struct sockaddr_in sin;
+	memset( &sin, 0, sizeof(sin) );
+	sin.sin_family = AF_INET;
+	sin.sin_port = htons(port);
+	sin.sin_addr.s_addr = INADDR_ANY;
+
+	if (::bind( m_fileDescriptor, (struct sockaddr*) &sin, sizeof(sin) ) != 0) {
+		log_warn() << "Failed to bind UDP socket " << port << ". Error : " << strerror(errno);
+		close();
+		return SomeIPReturnCode::ERROR;
+	}
+
+	return SomeIPReturnCode::OK;
+}
+
+SomeIPReturnCode SomeIPDatagramSocket::bindMulticast(const IPv4TCPEndPoint& group) {
+
+	if ( isError( createSocket() ) )
+		return SomeIPReturnCode::ERROR;
+
+	// several sockets of the host can receive the same group
+	int reuseAddress = 1;
+	if (setsockopt( m_fileDescriptor, SOL_SOCKET, SO_REUSEADDR, &reuseAddress, sizeof(reuseAddress) ) != 0)
+		log_warning() << "Can't set SO_REUSEADDR. Error : " << strerror(errno);
+
+	// binding to the group address filters out the datagrams sent to other groups using the same port
+	struct sockaddr_in sin;
+	memset( &sin, 0, sizeof(sin) );
+	sin.sin_family = AF_INET;
+	sin.sin_port = htons(group.m_port);
+	sin.sin_addr = group.m_address.getInAddr();
+
+	if (::bind( m_fileDescriptor, (struct sockaddr*) &sin, sizeof(sin) ) != 0) {
+		log_error() << "Failed to bind UDP socket to multicast group " << group.toString() << ". Error : " << strerror(errno);
+		close();
+		return SomeIPReturnCode::ERROR;
+	}
+
+	struct ip_mreq membership;
+	membership.imr_multiaddr = group.m_address.getInAddr();
+	membership.imr_interface.s_addr = htonl(INADDR_ANY);
+	if (setsockopt( m_fileDescriptor, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership) ) != 0) {
+		log_error() << "Failed to join multicast group " << group.toString() << ". Error : " << strerror(errno);
+		close();
+		return SomeIPReturnCode::ERROR;
+	}
+
+	return SomeIPReturnCode::OK;
+}
+
+void SomeIPDatagramSocket::close() {
+	if (m_fileDescriptor != -1) {
+		::close(m_fileDescriptor);
+		m_fileDescriptor = -1;
+	}
+	m_pendingDatagramCount = 0;
+}
+
+TCPPort SomeIPDatagramSocket::getLocalPort() const {
+	struct sockaddr_in sin;
+	socklen_t length = sizeof(sin);
+	if (getsockname( m_fileDescriptor, (struct sockaddr*) &sin, &length ) != 0)
+		return 0;
+	return ntohs(sin.sin_port);
+}
+
+unsigned char* SomeIPDatagramSocket::appendMessage(const IPv4TCPEndPoint& destination, size_t messageLength) {
+
+	PendingDatagram* datagram = nullptr;
+	for (size_t i = m_pendingDatagramCount; i-- > 0; ) {
+		if (m_pendingDatagrams[i].m_destination == destination) {
+			datagram = &m_pendingDatagrams[i];
+			break;
+		}
+	}
+
+	if ( (datagram == nullptr) || (datagram->m_bytes.size() + messageLength > m_maximumDatagramSize) ) {
+		if ( m_pendingDatagramCount == m_pendingDatagrams.size() )
+			m_pendingDatagrams.resize(m_pendingDatagramCount + 1);
+		datagram = &m_pendingDatagrams[m_pendingDatagramCount++];
+		datagram->m_destination = destination;
+		datagram->m_bytes.resize(0);
+	}
+
+	auto& bytes = datagram->m_bytes;
+	size_t offset = bytes.size();
+	bytes.resize(offset + messageLength);
+	return bytes.getData() + offset;
+}
+
+SomeIPReturnCode SomeIPDatagramSocket::queueMessage(const IPv4TCPEndPoint& destination, const SomeIP::SomeIPHeader& header,
+						    const void* payload, size_t payloadLength) {
+
+	size_t messageLength = SomeIP::SOMEIP_HEADER_LENGTH_ON_NETWORK + payloadLength;
+	if (messageLength > m_maximumDatagramSize)
+		return queueSegments(destination, header, payload, payloadLength);
+
+	auto data = appendMessage(destination, messageLength);
+	SomeIPHeaderCodec::encode(header, payloadLength, data);
+	memcpy(data + SomeIP::SOMEIP_HEADER_LENGTH_ON_NETWORK, payload, payloadLength);
+
+	return SomeIPReturnCode::OK;
+}
+
+size_t SomeIPDatagramSocket::getMaximumSegmentLength() const {
+	size_t length = m_maximumDatagramSize - SomeIP::SOMEIP_HEADER_LENGTH_ON_NETWORK - SomeIPTPHeaderCodec::SIZE;
+	length -= length % SomeIPTPHeaderCodec::OFFSET_UNIT;
+	return (length != 0) ? length : SomeIPTPHeaderCodec::OFFSET_UNIT;
+}
+
+SomeIPReturnCode SomeIPDatagramSocket::queueSegments(const IPv4TCPEndPoint& destination, const SomeIP::SomeIPHeader& header,
+						     const void* payload, size_t payloadLength) {
+
+	if (payloadLength > UINT32_MAX - SomeIPHeaderCodec::LENGTH_COVERED_HEADER_SIZE) {
+		log_error() << "Message ID:" << header.getMessageID() << " is too large to be sent. Payload length : " << payloadLength;
+		return SomeIPReturnCode::ERROR;
+	}
+
+	SomeIP::SomeIPHeader segmentHeader(header);
+	SomeIPTPHeaderCodec::setSegmentFlag(segmentHeader, true);
+
+	auto maximumSegmentLength = getMaximumSegmentLength();
+	auto payloadBytes = static_cast<const unsigned char*>(payload);
+
+	for (size_t offset = 0; offset < payloadLength; offset += maximumSegmentLength) {
+		size_t segmentLength = payloadLength - offset;
+		bool hasMoreSegments = (segmentLength > maximumSegmentLength);
+		if (hasMoreSegments)
+			segmentLength = maximumSegmentLength;
+
+		auto data = appendMessage(destination, SomeIP::SOMEIP_HEADER_LENGTH_ON_NETWORK + SomeIPTPHeaderCodec::SIZE + segmentLength);
+		SomeIPHeaderCodec::encode(segmentHeader, SomeIPTPHeaderCodec::SIZE + segmentLength, data);
+		data += SomeIP::SOMEIP_HEADER_LENGTH_ON_NETWORK;
+		SomeIPTPHeaderCodec::encode(offset, hasMoreSegments, data);
+		memcpy(data + SomeIPTPHeaderCodec::SIZE, payloadBytes + offset, segmentLength);
+	}
+
+	return SomeIPReturnCode::OK;
+}
+
+IPCOperationReport SomeIPDatagramSocket::flush() {
+
+	size_t sentCount = 0;
+	IPCOperationReport report = IPCOperationReport::OK;
+
+	while (sentCount < m_pendingDatagramCount) {
+
+		struct mmsghdr messages[BATCH_SIZE];
+		struct iovec vectors[BATCH_SIZE];
+		struct sockaddr_in addresses[BATCH_SIZE];
+
+		size_t count = m_pendingDatagramCount - sentCount;
+		if (count > BATCH_SIZE)
+			count = BATCH_SIZE;
+		memset( messages, 0, sizeof(messages) );
+		memset( addresses, 0, sizeof(addresses) );
+
+		for (size_t i = 0; i < count; i++) {
+			auto& datagram = m_pendingDatagrams[sentCount + i];
+			addresses[i].sin_family = AF_INET;
+			addresses[i].sin_port = htons(datagram.m_destination.m_port);
+			addresses[i].sin_addr = datagram.m_destination.m_address.getInAddr();
+			vectors[i].iov_base = datagram.m_bytes.getData();
+			vectors[i].iov_len = datagram.m_bytes.size();
+			messages[i].msg_hdr.msg_name = &addresses[i];
+			messages[i].msg_hdr.msg_namelen = sizeof(addresses[i]);
+			messages[i].msg_hdr.msg_iov = &vectors[i];
+			messages[i].msg_hdr.msg_iovlen = 1;
+		}
+
+		int n = sendmmsg(m_fileDescriptor, messages, count, MSG_DONTWAIT | MSG_NOSIGNAL);
+		if (n < 0) {
+			if ( (errno == EAGAIN) || (errno == ENOBUFS) ) {
+				report = IPCOperationReport::BUFFER_FULL;
+				break;
+			}
+			// the datagram which can not be sent is dropped, as if it had been lost on the network
+			log_warning() << "Can't send datagram to " << m_pendingDatagrams[sentCount].m_destination.toString() << ". Error : " <<
+				strerror(errno);
+			n = 1;
+		}
+
+		sentCount += n;
+	}
+
+	// the datagrams which have not been sent are moved to the front, keeping their order
+	std::rotate(m_pendingDatagrams.begin(), m_pendingDatagrams.begin() + sentCount, m_pendingDatagrams.end());
+	m_pendingDatagramCount -= sentCount;
+
+	return report;
+}
+
+size_t SomeIPDatagramSocket::receive(MessageHandler handler) {
+
+	if (m_receptionBuffer.size() == 0)
+		m_receptionBuffer.resize(BATCH_SIZE * RECEPTION_SLOT_SIZE);
+
+	struct mmsghdr messages[BATCH_SIZE];
+	struct iovec vectors[BATCH_SIZE];
+	struct sockaddr_in addresses[BATCH_SIZE];
+
+	memset( messages, 0, sizeof(messages) );
+	for (size_t i = 0; i < BATCH_SIZE; i++) {
+		vectors[i].iov_base = m_receptionBuffer.getData() + i * RECEPTION_SLOT_SIZE;
+		vectors[i].iov_len = RECEPTION_SLOT_SIZE;
+		messages[i].msg_hdr.msg_name = &addresses[i];
+		messages[i].msg_hdr.msg_namelen = sizeof(addresses[i]);
+		messages[i].msg_hdr.msg_iov = &vectors[i];
+		messages[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	int count = recvmmsg(m_fileDescriptor, messages, BATCH_SIZE, MSG_DONTWAIT, nullptr);
+	if (count < 0) {
+		if (errno != EAGAIN)
+			log_warning() << "Can't receive datagrams. Error : " << strerror(errno);
+		return 0;
+	}
+
+	for (int i = 0; i < count; i++) {
+		IPv4TCPEndPoint source( IPV4Address(addresses[i].sin_addr), ntohs(addresses[i].sin_port) );
+		decodeDatagram(source, static_cast<const unsigned char*>(vectors[i].iov_base), messages[i].msg_len, handler);
+	}
+
+	return count;
+}
+
+void SomeIPDatagramSocket::decodeDatagram(const IPv4TCPEndPoint& source, const unsigned char* data, size_t length,
+					  MessageHandler& handler) {
+
+	while (length != 0) {
+
+		SomeIP::SomeIPHeader header;
+		size_t payloadLength;
+		if ( (length < SomeIP::SOMEIP_HEADER_LENGTH_ON_NETWORK) || !SomeIPHeaderCodec::decode(data, header, payloadLength) ||
+		     (payloadLength > length - SomeIP::SOMEIP_HEADER_LENGTH_ON_NETWORK) ) {
+			log_warning() << "Invalid datagram received from " << source.toString() << ", " << length << " bytes ignored";
+			return;
+		}
+
+		handler(source, header, data + SomeIP::SOMEIP_HEADER_LENGTH_ON_NETWORK, payloadLength);
+
+		size_t messageLength = SomeIP::SOMEIP_HEADER_LENGTH_ON_NETWORK + payloadLength;
+		data += messageLength;
+		length -= messageLength;
+	}
+
+}
+
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <netinet/in.h>
+#include <functional>
+#include <vector>
+
+#include "SomeIP-common.h"
+#include "Networking.h"
+#include "ipc.h"
+
+namespace SomeIP_Lib {
+
+/**
+ * UDP socket exchanging SOME/IP messages. The messages sent to the same destination are packed into a single datagram, up to
+ * the maximum datagram size, and the datagrams are sent and received in batches with sendmmsg() and recvmmsg(). A larger message
+ * is split into SOME/IP-TP segments, which are passed to the handler as they are received, to be reassembled by the caller.
+ */
+class SomeIPDatagramSocket {
+
+	LOG_DECLARE_CLASS_CONTEXT("SDgS", "SomeIPDatagramSocket");
+
+public:
+	typedef std::function<void (const IPv4TCPEndPoint& source, const SomeIP::SomeIPHeader& header, const void* payload,
+				    size_t payloadLength)> MessageHandler;
+
+	/// Default maximum size of a datagram containing several messages, so that it fits into an Ethernet frame
+	static const size_t DEFAULT_MAXIMUM_DATAGRAM_SIZE = 1400;
+
+	/// Largest payload of a UDP datagram over IPv4
+	static const size_t MAXIMUM_UDP_PAYLOAD_SIZE = 65507;
+
+	/// Smallest datagram size, which can still carry a segment
+	static const size_t MINIMUM_DATAGRAM_SIZE = 64;
+
+	/// Maximum number of datagrams sent or received with a single system call
+	static const size_t BATCH_SIZE = 8;
+
+	SomeIPDatagramSocket() {
+	}
+
+	~SomeIPDatagramSocket() {
+		close();
+	}
+
+	SomeIPDatagramSocket(const SomeIPDatagramSocket&) = delete;
+	SomeIPDatagramSocket& operator=(const SomeIPDatagramSocket&) = delete;
+
+	/**
+	 * Creates the socket and binds it to the given port on all the interfaces. If the port is 0, a port is chosen by the kernel.
+	 */
+	SomeIPReturnCode bind(TCPPort port);
+
+	/**
+	 * Creates the socket and binds it to the given multicast group, which it joins on all the interfaces
+	 */
+	SomeIPReturnCode bindMulticast(const IPv4TCPEndPoint& group);
+
+	void close();
+
+	int getFileDescriptor() const {
+		return m_fileDescriptor;
+	}
+
+	/**
+	 * Returns the port to which the socket is bound
+	 */
+	TCPPort getLocalPort() const;
+
+	/**
+	 * Sets the size up to which messages are packed into a datagram. A larger message is split into segments.
+	 */
+	void setMaximumDatagramSize(size_t size) {
+		assert( (size >= MINIMUM_DATAGRAM_SIZE) && (size <= MAXIMUM_UDP_PAYLOAD_SIZE) );
+		m_maximumDatagramSize = size;
+	}
+
+	/**
+	 * Returns the length of the payload carried by each segment but the last one, when a message is split
+	 */
+	size_t getMaximumSegmentLength() const;
+
+	/**
+	 * Adds a message to the datagrams to be sent by flush(). The message is appended to the last datagram queued for the same
+	 * destination if it fits into it, so that the order of the messages is kept. A message which does not fit into a datagram
+	 * is split into segments of getMaximumSegmentLength() bytes.
+	 */
+	SomeIPReturnCode queueMessage(const IPv4TCPEndPoint& destination, const SomeIP::SomeIPHeader& header, const void* payload,
+				      size_t payloadLength);
+
+	size_t getPendingDatagramCount() const {
+		return m_pendingDatagramCount;
+	}
+
+	/**
+	 * Sends the queued datagrams
+	 * @return BUFFER_FULL if the socket does not accept more data, in which case the rest of the datagrams stays queued
+	 */
+	IPCOperationReport flush();
+
+	/**
+	 * Reads the datagrams which are available, without blocking, and calls the handler for each message they contain
+	 * @return the number of datagrams read
+	 */
+	size_t receive(MessageHandler handler);
+
+private:
+	SomeIPReturnCode createSocket();
+
+	/**
+	 * Reserves the given number of bytes in a datagram queued for the destination, and returns a pointer to them
+	 */
+	unsigned char* appendMessage(const IPv4TCPEndPoint& destination, size_t messageLength);
+
+	SomeIPReturnCode queueSegments(const IPv4TCPEndPoint& destination, const SomeIP::SomeIPHeader& header, const void* payload,
+				       size_t payloadLength);
+
+	void decodeDatagram(const IPv4TCPEndPoint& source, const unsigned char* data, size_t length, MessageHandler& handler);
+
+	struct PendingDatagram {
+		IPv4TCPEndPoint m_destination;
+		ByteArray m_bytes;
+	};
+
+	int m_fileDescriptor = -1;
+
+	size_t m_maximumDatagramSize = DEFAULT_MAXIMUM_DATAGRAM_SIZE;
+
+	/// Datagrams waiting to be sent. The elements after the first m_pendingDatagramCount ones are kept to reuse their buffers.
+	std::vector<PendingDatagram> m_pendingDatagrams;
+	size_t m_pendingDatagramCount = 0;
+
+	ByteArray m_receptionBuffer;
+
+};
+
+}
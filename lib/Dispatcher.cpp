@@ -70,6 +70,38 @@ void Dispatcher::dispatchMessage(DispatcherMessage& msg, Client& client) {
 	}
 }
 
+Client* Dispatcher::getSingleDestination(DispatcherMessage& msg, Client& client) {
+
+	auto& header = msg.getHeader();
+
+	if ( header.isNotification() ) {
+		if (header.getMessageID() == SomeIPServiceDiscoveryMessage::SERVICE_DISCOVERY_MEMBER_ID)
+			return nullptr;
+		auto& subscribers =
+			getOrCreateNotification( MemberIDs(header.getServiceID(), header.getInstanceID(), header.getMemberID() ) ).getSubscribedClients();
+		return (subscribers.size() == 1) ? subscribers[0] : nullptr;
+	}
+
+	if ( header.isReply() )
+		return getClientFromId( msg.getClientIdentifier() );
+
+	if ( header.isRequestWithReturn() )
+		msg.setClientIdentifier( client.getIdentifier() );
+
+	Client* destination = nullptr;
+	for (auto& service : m_services) {
+		if ( service->matchesRequest(msg) ) {
+			if (destination != nullptr)
+				return nullptr;
+			destination = service->getClient();
+			if (destination == nullptr)         // the service is not started yet
+				return nullptr;
+		}
+	}
+
+	return destination;
+}
+
 std::string Dispatcher::dumpState() {
 
 	std::string s = "Notifications:\n";
@@ -153,8 +185,14 @@ ReturnCode Dispatcher::registerService(Service& service) {
 	log_info() << "Service registered : " << service.toString();
 
 	// Notify clients
-	for (auto client : m_serviceRegistrationListeners) {
-		client->onServiceRegistered(service);
+	if (m_batchRegisteredServices != nullptr)
+		m_batchRegisteredServices->push_back(&service);
+	else {
+		if (m_serviceRegistryMirror != nullptr)
+			m_serviceRegistryMirror->onServiceRegistered(service);
+		for (auto client : m_serviceRegistrationListeners) {
+			client->onServiceRegistered(service);
+		}
 	}
 
 	for (auto notification : m_notifications) {
@@ -165,9 +203,85 @@ ReturnCode Dispatcher::registerService(Service& service) {
 	return ReturnCode::OK;
 }
 
+bool Dispatcher::canRegisterService(SomeIP::ServiceIDs serviceID, const Client& client, bool isLocal) {
+	Service* service = getService(serviceID);
+
+	if (service == nullptr)
+		return true;
+
+	// an existing service can only be taken by a local client, if not already provided by someone else
+	return ( isLocal && ( (service->getClient() == nullptr) || (service->getClient() == &client) ) );
+}
+
+std::vector<Service*> Dispatcher::tryRegisterServices(const std::vector<SomeIP::ServiceIDs>& serviceIDs,
+						      Client& client, bool isLocal) {
+	std::vector<Service*> services;
+
+	// check everything first, so that we don't need to roll back
+	for (auto i = serviceIDs.begin(); i != serviceIDs.end(); i++) {
+		if ( !canRegisterService(*i, client, isLocal) || ( std::find(serviceIDs.begin(), i, *i) != i ) ) {
+			log_warn() << "registration refused : " << i->toString();
+			return services;
+		}
+	}
+
+	std::vector<const Service*> registeredServices;
+	m_batchRegisteredServices = &registeredServices;
+
+	for (auto& serviceID : serviceIDs) {
+		Service* service = tryRegisterService(serviceID, client, isLocal);
+		assert(service != nullptr);
+		services.push_back(service);
+	}
+
+	m_batchRegisteredServices = nullptr;
+
+	notifyServicesRegistered(registeredServices);
+
+	return services;
+}
+
+void Dispatcher::notifyServicesRegistered(const std::vector<const Service*>& services) {
+	if ( services.empty() )
+		return;
+
+	if (m_serviceRegistryMirror != nullptr)
+		m_serviceRegistryMirror->onServicesRegistered(services);
+
+	for (auto listener : m_serviceRegistrationListeners)
+		listener->onServicesRegistered(services);
+}
+
+void Dispatcher::unregisterServices(const std::vector<Service*>& services) {
+	std::vector<const Service*> unregisteredServices;
+
+	for (auto service : services) {
+		removeFromVector(m_services, service);
+		unregisteredServices.push_back(service);
+	}
+
+	if (m_serviceRegistryMirror != nullptr)
+		m_serviceRegistryMirror->onServicesUnregistered(unregisteredServices);
+
+	// Same order as in unregisterService()
+	for (auto i = m_serviceRegistrationListeners.rbegin(); i != m_serviceRegistrationListeners.rend(); ++i)
+		(*i)->onServicesUnregistered(unregisteredServices);
+
+	for (auto service : services) {
+		for (auto& notification : m_notifications) {
+			if (notification->getProviderService() == service)
+				notification->setProviderService(nullptr);
+		}
+		log_info() << "Service unregistered : " << service->toString();
+	}
+}
+
 void Dispatcher::unregisterService(Service& service) {
 	removeFromVector(m_services, &service);
 
+	if (m_serviceRegistryMirror != nullptr)
+		m_serviceRegistryMirror->onServiceUnregistered(service);
+
 	// Notify listeners in reverse order since the service announcer needs to be notified before having the service unregistered from TCP and UDP endpoints
 	for (auto i = m_serviceRegistrationListeners.rbegin(); i != m_serviceRegistrationListeners.rend(); ++i) {
 		auto listener = *i;
@@ -197,8 +311,22 @@ void Dispatcher::onNewClient(Client& client) {
 	client.init();
 }
 
+void Dispatcher::endDispatchCycle() {
+	assert(m_dispatchCycleDepth != 0);
+
+	if (--m_dispatchCycleDepth != 0)
+		return;
+
+	// a client can be disconnected while being flushed, which removes it from the list
+	vector<Client*> clientsToFlush;
+	clientsToFlush.swap(m_clientsToFlush);
+	for (auto client : clientsToFlush)
+		client->flushDeferredMessages();
+}
+
 void Dispatcher::onClientDisconnected(Client& client) {
 	assert(m_clients[client.getIdentifier()] != nullptr);
+	removeFromVector(m_clientsToFlush, &client);
 	m_clients[client.getIdentifier()] = nullptr;
 	m_disconnectedClients.push_back(&client);
 	m_idleCallback->activate();
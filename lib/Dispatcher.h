@@ -48,6 +48,10 @@ public:
 
 	void sendMessageToSubscribedClients(const DispatcherMessage& msg);
 
+	const vector<Client*>& getSubscribedClients() const {
+		return m_subscribedClients;
+	}
+
 	const SomeIP::MemberIDs& getMessageID() const {
 		return m_messageID;
 	}
@@ -151,6 +155,12 @@ public:
 
 	void dispatchMessage(DispatcherMessage& msg, Client& client);
 
+	/**
+	 * Returns the client to which dispatchMessage() would send the given message, or nullptr if it would be sent to several
+	 * clients or to none. Used to relay the payload of a large message directly from the socket of its sender.
+	 */
+	Client* getSingleDestination(DispatcherMessage& msg, Client& client);
+
 	Notification& subscribeClientForNotifications(Client& client, SomeIP::MemberIDs messageID) {
 		Notification& notification = getOrCreateNotification(messageID);
 		notification.subscribe(client);
@@ -198,13 +208,35 @@ public:
 		removeFromVector(m_serviceRegistrationListeners, &listener);
 	}
 
+	/**
+	 * Sets the listener maintaining a copy of the registry which the clients can read, such as the shared registry segment.
+	 * It is notified of the registrations and unregistrations before any other listener, so that the copy is up to date when
+	 * the clients get notified.
+	 */
+	void setServiceRegistryMirror(ServiceRegistrationListener* mirror) {
+		m_serviceRegistryMirror = mirror;
+	}
+
 	void onClientDisconnected(Client& client);
 
 	Service* tryRegisterService(SomeIP::ServiceIDs serviceID, Client& client, bool isLocal = true);
 	ReturnCode registerService(Service& service);
 
+	/**
+	 * Registers the given services atomically : if one of them can't be registered, none of them is registered.
+	 * The listeners are notified once for the whole set of services.
+	 * @return the registered services, or an empty list in case of failure
+	 */
+	std::vector<Service*> tryRegisterServices(const std::vector<SomeIP::ServiceIDs>& serviceIDs, Client& client,
+						  bool isLocal = true);
+
 	void unregisterService(Service& service);
 
+	/**
+	 * Unregisters the given services, notifying the listeners once for the whole set
+	 */
+	void unregisterServices(const std::vector<Service*>& services);
+
 	Service* getService(SomeIP::ServiceIDs serviceID) {
 		for (auto& service : m_services) {
 			if (service->getServiceIDs() == serviceID)
@@ -223,12 +255,49 @@ public:
 		return m_blackList;
 	}
 
+	/**
+	 * Starts a dispatch cycle, during which the clients can defer the messages they have to send, and pack them together.
+	 * Cycles can be nested : the deferred messages are sent when the outermost cycle ends.
+	 */
+	void beginDispatchCycle() {
+		if (m_dispatchCycleDepth++ == 0)
+			m_dispatchCycleID++;
+	}
+
+	void endDispatchCycle();
+
+	bool isInDispatchCycle() const {
+		return (m_dispatchCycleDepth != 0);
+	}
+
+	/**
+	 * Returns an identifier of the current dispatch cycle
+	 */
+	unsigned int getDispatchCycleID() const {
+		return m_dispatchCycleID;
+	}
+
+	/**
+	 * Called by a client which has deferred some messages, so that they are sent at the end of the current dispatch cycle
+	 */
+	void addClientToFlush(Client& client) {
+		m_clientsToFlush.push_back(&client);
+	}
+
 private:
+	/**
+	 * Returns true if tryRegisterService() would succeed for the given service
+	 */
+	bool canRegisterService(SomeIP::ServiceIDs serviceID, const Client& client, bool isLocal);
+
+	void notifyServicesRegistered(const std::vector<const Service*>& services);
+
 	vector<Notification*> m_notifications;
 	vector<Service*> m_services;
 	vector<Client*> m_clients;
 	vector<Client*> m_disconnectedClients;
 	vector<ServiceRegistrationListener*> m_serviceRegistrationListeners;
+	ServiceRegistrationListener* m_serviceRegistryMirror = nullptr;
 	vector<const BlackListHostFilter*> m_blackList;
 
 	int m_messageCounter;
@@ -238,6 +307,34 @@ private:
 
 	ClientIdentifier m_nextAvailableClientID = 0;
 
+	/// If not null, the services registered are added to that list instead of being notified one by one to the listeners
+	std::vector<const Service*>* m_batchRegisteredServices = nullptr;
+
+	unsigned int m_dispatchCycleDepth = 0;
+	unsigned int m_dispatchCycleID = 0;
+
+	/// Clients which have deferred some messages during the current dispatch cycle
+	vector<Client*> m_clientsToFlush;
+
+};
+
+/**
+ * Delimits a dispatch cycle during its lifetime
+ */
+class DispatchCycle {
+
+public:
+	DispatchCycle(Dispatcher& dispatcher) :
+		m_dispatcher(dispatcher) {
+		m_dispatcher.beginDispatchCycle();
+	}
+
+	~DispatchCycle() {
+		m_dispatcher.endDispatchCycle();
+	}
+
+private:
+	Dispatcher& m_dispatcher;
 };
 
 //void trace_message(const DispatcherMessage& msg);
@@ -5,8 +5,10 @@
 #include "SomeIP-common.h"
 #include "SomeIP-Serialization.h"
 #include <mutex>
+#include <memory>
 
 #include "ipc.h"
+#include "SharedPayload.h"
 
 namespace SomeIP_Lib {
 
@@ -41,16 +43,63 @@ public:
 
 	InputMessage(const OutputMessage& outputMessage);
 
+	/**
+	 * Creates a message which references the given user data (header and payload), such as a message packed into a BATCH
+	 * message. The data is not copied, and must outlive the message.
+	 */
+	InputMessage(const void* userData, size_t userDataLength) :
+		m_ipcMessage(nullptr), m_userData( static_cast<const unsigned char*>(userData) ), m_userDataLength(userDataLength) {
+	}
+
+	/**
+	 * A copy of a message which owns its IPC message gets its own IPC message, so that each instance releases only what it owns
+	 */
+	InputMessage(const InputMessage& msg) :
+		m_ipcMessage(msg.m_ipcMessage), m_userData(msg.m_userData), m_userDataLength(msg.m_userDataLength),
+		m_sharedPayload(msg.m_sharedPayload) {
+		if (msg.m_ownedIPCMessage)
+			takeOwnership( new IPCInputMessage(*msg.m_ownedIPCMessage) );
+	}
+
+	InputMessage(InputMessage&& msg) noexcept :
+		m_ipcMessage(msg.m_ipcMessage), m_userData(msg.m_userData), m_userDataLength(msg.m_userDataLength),
+		m_sharedPayload( std::move(msg.m_sharedPayload) ), m_ownedIPCMessage( std::move(msg.m_ownedIPCMessage) ) {
+	}
+
+	InputMessage& operator=(const InputMessage& msg) {
+		if (this != &msg) {
+			if (msg.m_ownedIPCMessage)
+				takeOwnership( new IPCInputMessage(*msg.m_ownedIPCMessage) );
+			else {
+				m_ownedIPCMessage.reset();
+				m_ipcMessage = msg.m_ipcMessage;
+			}
+			m_userData = msg.m_userData;
+			m_userDataLength = msg.m_userDataLength;
+			m_sharedPayload = msg.m_sharedPayload;
+		}
+		return *this;
+	}
+
+	InputMessage& operator=(InputMessage&& msg) noexcept {
+		if (this != &msg) {
+			m_ownedIPCMessage = std::move(msg.m_ownedIPCMessage);
+			m_ipcMessage = msg.m_ipcMessage;
+			m_userData = msg.m_userData;
+			m_userDataLength = msg.m_userDataLength;
+			m_sharedPayload = std::move(msg.m_sharedPayload);
+		}
+		return *this;
+	}
+
 	bool operator==(const OutputMessage& right) const;
 
 	virtual ~InputMessage() {
-		if (m_bDeleteNeeded)
-			delete m_ipcMessage;
 	}
 
 	void copyFrom(IPCInputMessage& msg) {
-		m_ipcMessage = new IPCInputMessage(msg);
-		m_bDeleteNeeded = true;
+		takeOwnership( new IPCInputMessage(msg) );
+		m_sharedPayload.reset();
 	}
 
 	/**
@@ -90,7 +139,7 @@ public:
 	}
 
 	const InputMessageHeader& getHeader() const {
-		return *reinterpret_cast<const InputMessageHeader*>( m_ipcMessage->getUserData() );
+		return *reinterpret_cast<const InputMessageHeader*>( getUserData() );
 	}
 
 	static size_t getHeaderSize() {
@@ -103,14 +152,41 @@ public:
 	}
 
 	const void* getPayload() const {
-		return m_ipcMessage->getUserData() + sizeof(InputMessageHeader);
+		if ( hasSharedPayload() )
+			return getSharedPayload().getData();
+		return getUserData() + sizeof(InputMessageHeader);
 	}
 
 	size_t getPayloadLength() const {
-		return m_ipcMessage->getUserDataLength() - sizeof(InputMessageHeader);
+		if ( hasSharedPayload() )
+			return getSharedPayload().getSize();
+		return getUserDataLength() - sizeof(InputMessageHeader);
+	}
+
+	/**
+	 * Returns true if the payload is not contained in the message, but in a memory file attached to it
+	 */
+	bool hasSharedPayload() const {
+		return (m_ipcMessage != nullptr) && (m_ipcMessage->getMessageType() == IPCMessageType::SEND_MESSAGE) &&
+		       (m_ipcMessage->getFileDescriptor() != -1);
+	}
+
+	/**
+	 * Returns the mapping of the shared payload, which stays valid as long as a reference to it is kept, even after the
+	 * message has been destroyed. Returns null if the message has no shared payload.
+	 */
+	std::shared_ptr<const SharedPayload> getSharedPayloadMapping() const {
+		if ( !hasSharedPayload() )
+			return nullptr;
+		getSharedPayload();
+		return m_sharedPayload;
 	}
 
+	/**
+	 * Returns the IPC message containing the message. Not available for a message created from a user data buffer.
+	 */
 	const IPCMessage& getIPCMessage() const {
+		assert(m_ipcMessage != nullptr);
 		return *m_ipcMessage;
 	}
 
@@ -128,11 +204,43 @@ public:
 
 protected:
 	InputMessageHeader& getHeaderPrivate() {
-		return *const_cast<InputMessageHeader*>( reinterpret_cast<const InputMessageHeader*>( m_ipcMessage->getUserData() ) );
+		return *const_cast<InputMessageHeader*>( reinterpret_cast<const InputMessageHeader*>( getUserData() ) );
+	}
+
+	const unsigned char* getUserData() const {
+		return (m_ipcMessage != nullptr) ? m_ipcMessage->getUserData() : m_userData;
+	}
+
+	size_t getUserDataLength() const {
+		return (m_ipcMessage != nullptr) ? m_ipcMessage->getUserDataLength() : m_userDataLength;
 	}
 
 	const IPCMessage* m_ipcMessage;
-	bool m_bDeleteNeeded = false;
+
+	/// Used instead of the IPC message, if the message has been created from a user data buffer
+	const unsigned char* m_userData = nullptr;
+	size_t m_userDataLength = 0;
+
+	/// Mapping of the shared payload, created when the payload is accessed for the first time, since the dispatcher usually
+	/// only needs the header
+	mutable std::shared_ptr<SharedPayload> m_sharedPayload;
+
+private:
+	const SharedPayload& getSharedPayload() const {
+		if (!m_sharedPayload) {
+			m_sharedPayload = std::make_shared<SharedPayload>();
+			m_sharedPayload->map( m_ipcMessage->getFileDescriptor() );
+		}
+		return *m_sharedPayload;
+	}
+
+	void takeOwnership(IPCInputMessage* msg) {
+		// IPCMessage has no virtual destructor, so the owned message is kept with its actual type
+		m_ownedIPCMessage.reset(msg);
+		m_ipcMessage = msg;
+	}
+
+	std::unique_ptr<IPCInputMessage> m_ownedIPCMessage;
 
 };
 
@@ -374,8 +482,8 @@ public:
 	void sendPingMessage(MessageSinkFunction sinkFunction, SomeIP::ServiceID serviceID = SomeIP::DISPATCHER_SERVICE_ID) {
 #ifdef ENABLE_PING
 		if (!m_pongPending) {
-			m_serviceID = serviceID;
-			OutputMessage msg( SomeIP::getMessageID(serviceID, SomeIP::PING_MEMBER_ID) );
+			m_pingMessageID = SomeIP::getMessageID(serviceID, SomeIP::PING_MEMBER_ID);
+			OutputMessage msg(m_pingMessageID);
 			msg.getHeader().setMessageType(SomeIP::MessageType::REQUEST);
 			gettimeofday(&m_lastPingDate, &tz);
 			msg.getPayloadOutputStream();
@@ -405,8 +513,8 @@ public:
 
 	MessageProcessingResult processMessage(const InputMessage& msg) {
 
-		if ( (msg.getHeader().getMemberID() == SomeIP::PING_MEMBER_ID) &&
-		     (msg.getHeader().getServiceID() == m_serviceID) ) {
+		// this check is done for every incoming message, so we only compare the message ID
+		if (msg.getHeader().getMessageID() == m_pingMessageID) {
 			if ( !msg.getHeader().isRequestWithReturn() ) {
 				handlePingReply(msg);
 				return MessageProcessingResult::Processed_OK;
@@ -419,7 +527,7 @@ public:
 	int maxRTTDelay = 0;
 	struct timeval m_lastPingDate;
 	struct timezone tz;
-	SomeIP::ServiceID m_serviceID;
+	SomeIP::MessageID m_pingMessageID = SomeIP::getMessageID(SomeIP::DISPATCHER_SERVICE_ID, SomeIP::PING_MEMBER_ID);
 	bool m_pongPending = false;
 
 };
@@ -433,13 +541,13 @@ class SomeIPEndPoint : public MessageSink {
 
 public:
 	SomeIPEndPoint(MessageSource& source, SomeIP::ServiceID serviceID = SomeIP::DISPATCHER_SERVICE_ID) : m_source(source) {
-		m_serviceID = serviceID;
+		m_pingMessageID = SomeIP::getMessageID(serviceID, SomeIP::PING_MEMBER_ID);
 	}
 
 	MessageProcessingResult processMessage(const InputMessage& msg) {
 
-		if ( (msg.getHeader().getMemberID() == SomeIP::PING_MEMBER_ID) &&
-		     (msg.getHeader().getServiceID() == m_serviceID) ) {
+		// this check is done for every incoming message, so we only compare the message ID
+		if (msg.getHeader().getMessageID() == m_pingMessageID) {
 			if ( msg.getHeader().isRequestWithReturn() ) {
 				sendPongMessage(msg);
 				return MessageProcessingResult::Processed_OK;
@@ -462,7 +570,7 @@ protected:
 
 private:
 	MessageSource& m_source;
-	SomeIP::ServiceID m_serviceID;
+	SomeIP::MessageID m_pingMessageID;
 
 };
 
@@ -3,6 +3,7 @@
 #include "string"
 #include "SomeIP-common.h"
 #include <array>
+#include <functional>
 
 #include <netdb.h>
 
@@ -118,6 +119,16 @@ struct IPv4TCPEndPoint {
 	TCPPort m_port;
 };
 
+/**
+ * Hash function of the endpoints, so that they can be used as keys of the unordered containers
+ */
+struct IPv4TCPEndPointHash {
+	size_t operator()(const IPv4TCPEndPoint& endPoint) const {
+		uint64_t key = endPoint.m_address.numbers.s_addr;
+		return std::hash<uint64_t>()( (key << 16) | endPoint.m_port );
+	}
+};
+
 struct BlackListHostFilter {
 
 	virtual ~BlackListHostFilter() {
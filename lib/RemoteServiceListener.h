@@ -7,6 +7,7 @@
 #include "ServiceDiscovery.h"
 #include "TCPClient.h"
 #include "TCPManager.h"
+#include "UDPManager.h"
 
 #include "ServiceAnnouncer.h"
 
@@ -31,6 +32,13 @@ public:
 
 	SomeIPReturnCode init();
 
+	/**
+	 * Sets the manager to which the services offered over UDP are reported
+	 */
+	void setUDPManager(UDPManager& udpManager) {
+		m_udpManager = &udpManager;
+	}
+
 	void onFindServiceRequested(const SomeIPServiceDiscoveryServiceEntry& serviceEntry,
 				    const SomeIPServiceDiscoveryMessage& message) {
 		m_serviceAnnouncer.announceServices();
@@ -51,16 +59,25 @@ public:
 		assert(false);
 	}
 
+	void onRemoteSubscriptionAcknowledged(const SomeIPServiceDiscoveryEventGroupEntry& serviceEntry,
+					      const IPv4ConfigurationOption* multicastAddress) override {
+		// the subscriptions are acknowledged to the endpoint they have been sent from
+	}
+
 	void onRemoteServiceAvailable(const SomeIPServiceDiscoveryServiceEntry& serviceEntry,
 				      const IPv4ConfigurationOption* address,
 				      const SomeIPServiceDiscoveryMessage& message) override {
 		m_tcpManager.onRemoteServiceAvailable(serviceEntry, address, message);
+		if (m_udpManager != nullptr)
+			m_udpManager->onRemoteServiceAvailable(serviceEntry, address, message);
 	}
 
 	void onRemoteServiceUnavailable(const SomeIPServiceDiscoveryServiceEntry& serviceEntry,
 					const IPv4ConfigurationOption* address,
 					const SomeIPServiceDiscoveryMessage& message) override {
 		m_tcpManager.onRemoteServiceUnavailable(serviceEntry, address, message);
+		if (m_udpManager != nullptr)
+			m_udpManager->onRemoteServiceUnavailable(serviceEntry, address, message);
 	}
 
 private:
@@ -71,6 +88,7 @@ private:
 	int m_broadcastFileDescriptor = -1;
 
 	TCPManager& m_tcpManager;
+	UDPManager* m_udpManager = nullptr;
 	ServiceAnnouncer& m_serviceAnnouncer;
 	MainLoopInterface& m_mainLoopContext;
 
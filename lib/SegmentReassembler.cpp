@@ -0,0 +1,198 @@
+#include <algorithm>
+
+#include "SegmentReassembler.h"
+
+namespace SomeIP_Lib {
+
+/**
+ * Returns true if the given headers identify the same message, the segments of a message having the same header apart from
+ * their length
+ */
+static bool isSameMessage(const SomeIP::SomeIPHeader& messageHeader, const SomeIP::SomeIPHeader& segmentHeader) {
+	return (messageHeader.getMessageID() == segmentHeader.getMessageID()) &&
+	       (messageHeader.getRequestID() == segmentHeader.getRequestID()) &&
+	       (messageHeader.m_protocolVersion == segmentHeader.m_protocolVersion) &&
+	       (messageHeader.m_interfaceVersion == segmentHeader.m_interfaceVersion) &&
+	       (messageHeader.getMessageType() == segmentHeader.getMessageType());
+}
+
+bool SegmentReassembler::addSegment(const SomeIP::SomeIPHeader& header, const void* payload, size_t payloadLength,
+				    SomeIP::SomeIPHeader& messageHeader, ByteArray& messageBuffer, Clock::time_point now) {
+
+	if (payloadLength < SomeIPTPHeaderCodec::SIZE) {
+		log_warning() << "Segment of message ID:" << header.getMessageID() << " ignored : no TP header";
+		return false;
+	}
+
+	size_t offset;
+	bool hasMoreSegments;
+	SomeIPTPHeaderCodec::decode(payload, offset, hasMoreSegments);
+	auto segmentData = static_cast<const unsigned char*>(payload) + SomeIPTPHeaderCodec::SIZE;
+	size_t segmentLength = payloadLength - SomeIPTPHeaderCodec::SIZE;
+	size_t end = offset + segmentLength;
+
+	// only the last segment can have a length which is not a multiple of the offset unit
+	if ( hasMoreSegments && ( (segmentLength == 0) || (segmentLength % SomeIPTPHeaderCodec::OFFSET_UNIT != 0) ) ) {
+		log_warning() << "Segment of message ID:" << header.getMessageID() << " ignored : invalid length " << segmentLength;
+		return false;
+	}
+
+	SomeIP::SomeIPHeader segmentHeader(header);
+	SomeIPTPHeaderCodec::setSegmentFlag(segmentHeader, false);
+	auto& message = getOrCreatePendingMessage(segmentHeader, now);
+
+	message.m_lastSegmentTime = now;
+
+	bool isLengthKnown = (message.m_payloadLength != UNKNOWN_LENGTH);
+	if ( isLengthKnown && (end > message.m_payloadLength) ) {
+		dropMessage(message, "segment beyond the end of the message");
+		return false;
+	}
+
+	if (!hasMoreSegments) {
+		if ( ( isLengthKnown && (end != message.m_payloadLength) ) ||
+		     ( !message.m_receivedRanges.empty() && (message.m_receivedRanges.back().second > end) ) ) {
+			dropMessage(message, "inconsistent last segment");
+			return false;
+		}
+		message.m_payloadLength = end;
+	}
+
+	// the buffer grows up to the end of the furthest segment, and gets its final size with the last segment
+	size_t bufferedLength = message.m_buffer.size() - m_headroom;
+	if (end > bufferedLength) {
+		if ( !reserveBufferedBytes(end - bufferedLength, message) ) {
+			dropMessage(message, "maximum buffer size exceeded");
+			return false;
+		}
+		message.m_buffer.resize(m_headroom + end);
+	}
+
+	memcpy(message.m_buffer.getData() + m_headroom + offset, segmentData, segmentLength);
+	addReceivedRange(message, offset, end);
+
+	if (message.m_payloadLength == UNKNOWN_LENGTH)
+		return false;
+
+	auto& ranges = message.m_receivedRanges;
+	size_t receivedLength = ranges.empty() ? 0 : ranges[0].second;
+	if ( (ranges.size() > 1) || ( !ranges.empty() && (ranges[0].first != 0) ) || (receivedLength != message.m_payloadLength) )
+		return false;
+
+	// the message is complete
+	messageHeader = message.m_header;
+	messageBuffer = std::move(message.m_buffer);
+	releaseBufferedBytes(message.m_payloadLength);
+	removeMessage(message);
+
+	return true;
+}
+
+size_t SegmentReassembler::evictExpiredMessages(Clock::time_point now) {
+	auto timeout = std::chrono::milliseconds(m_timeout);
+	size_t count = 0;
+	for (size_t i = m_pendingMessages.size(); i-- > 0; ) {
+		if (now - m_pendingMessages[i]->m_lastSegmentTime >= timeout) {
+			dropMessage(*m_pendingMessages[i], "timeout");
+			count++;
+		}
+	}
+	return count;
+}
+
+SegmentReassembler::PendingMessage& SegmentReassembler::getOrCreatePendingMessage(const SomeIP::SomeIPHeader& header,
+										  Clock::time_point now) {
+
+	for (auto& message : m_pendingMessages) {
+		if ( isSameMessage(message->m_header, header) )
+			return *message;
+	}
+
+	if (m_pendingMessages.size() >= m_maximumPendingMessageCount) {
+		auto oldest = std::min_element( m_pendingMessages.begin(), m_pendingMessages.end(),
+						[] (const std::unique_ptr<PendingMessage>& a, const std::unique_ptr<PendingMessage>& b) {
+							return a->m_lastSegmentTime < b->m_lastSegmentTime;
+						} );
+		dropMessage(**oldest, "too many incomplete messages");
+	}
+
+	std::unique_ptr<PendingMessage> message(new PendingMessage);
+	message->m_header = header;
+	message->m_buffer.resize(m_headroom);
+	message->m_lastSegmentTime = now;
+	m_pendingMessages.push_back( std::move(message) );
+
+	return *m_pendingMessages.back();
+}
+
+bool SegmentReassembler::reserveBufferedBytes(size_t size, const PendingMessage& message) {
+
+	size_t messageLength = message.m_buffer.size() - m_headroom;
+	if (messageLength + size > m_maximumBufferedBytes)
+		return false;
+
+	// when the shared budget is exhausted by the other peers, only our own messages can be dropped to make room
+	while ( (m_bufferedBytes + size > m_maximumBufferedBytes) ||
+		( m_sharedBudget && (m_sharedBudget->getAvailableBytes() < size) ) ) {
+		size_t oldest = m_pendingMessages.size();
+		for (size_t i = 0; i < m_pendingMessages.size(); i++) {
+			if ( (m_pendingMessages[i].get() != &message) &&
+			     ( (oldest == m_pendingMessages.size()) ||
+			       (m_pendingMessages[i]->m_lastSegmentTime < m_pendingMessages[oldest]->m_lastSegmentTime) ) )
+				oldest = i;
+		}
+		if ( oldest == m_pendingMessages.size() )
+			return false;
+		dropMessage(*m_pendingMessages[oldest], "maximum buffer size reached");
+	}
+
+	m_bufferedBytes += size;
+	if (m_sharedBudget)
+		m_sharedBudget->reserve(size);
+
+	return true;
+}
+
+void SegmentReassembler::releaseBufferedBytes(size_t size) {
+	m_bufferedBytes -= size;
+	if (m_sharedBudget)
+		m_sharedBudget->release(size);
+}
+
+void SegmentReassembler::dropMessage(const PendingMessage& message, const char* reason) {
+	log_warning() << "Incomplete message ID:" << message.m_header.getMessageID() << " dropped : " << reason;
+	releaseBufferedBytes(message.m_buffer.size() - m_headroom);
+	removeMessage(message);
+}
+
+void SegmentReassembler::removeMessage(const PendingMessage& message) {
+	for (auto it = m_pendingMessages.begin(); it != m_pendingMessages.end(); ++it) {
+		if (it->get() == &message) {
+			m_pendingMessages.erase(it);
+			return;
+		}
+	}
+}
+
+void SegmentReassembler::addReceivedRange(PendingMessage& message, size_t begin, size_t end) {
+
+	if (begin == end)
+		return;
+
+	auto& ranges = message.m_receivedRanges;
+	auto it = ranges.insert( std::lower_bound( ranges.begin(), ranges.end(), std::make_pair(begin, end) ),
+				 std::make_pair(begin, end) );
+
+	if ( (it != ranges.begin() ) && ( (it - 1)->second >= it->first ) ) {
+		--it;
+		it->second = std::max( it->second, (it + 1)->second );
+		ranges.erase(it + 1);
+	}
+
+	while ( (it + 1 != ranges.end() ) && ( (it + 1)->first <= it->second ) ) {
+		it->second = std::max( it->second, (it + 1)->second );
+		ranges.erase(it + 1);
+	}
+}
+
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "SomeIP-common.h"
+
+namespace SomeIP_Lib {
+
+/**
+ * Number of bytes which can be buffered in total by the reassemblers sharing the budget, so that the memory used for the
+ * incomplete messages stays bounded whatever the number of peers
+ */
+class SegmentReassemblyBudget {
+
+public:
+	/// Default maximum number of payload bytes buffered by all the reassemblers sharing the budget
+	static const size_t DEFAULT_MAXIMUM_BYTES = 16 * 1024 * 1024;
+
+	SegmentReassemblyBudget(size_t maximumBytes = DEFAULT_MAXIMUM_BYTES) :
+		m_maximumBytes(maximumBytes) {
+	}
+
+	size_t getAvailableBytes() const {
+		return (m_usedBytes < m_maximumBytes) ? m_maximumBytes - m_usedBytes : 0;
+	}
+
+	size_t getUsedBytes() const {
+		return m_usedBytes;
+	}
+
+	void reserve(size_t size) {
+		m_usedBytes += size;
+	}
+
+	void release(size_t size) {
+		assert(size <= m_usedBytes);
+		m_usedBytes -= size;
+	}
+
+	void setMaximumBytes(size_t size) {
+		m_maximumBytes = size;
+	}
+
+private:
+	size_t m_maximumBytes;
+	size_t m_usedBytes = 0;
+
+};
+
+/**
+ * Reassembles the messages received from a peer as SOME/IP-TP segments. The segments can be received in any order, and are
+ * written directly at their place in the buffer of their message, which is handed over to the caller once complete. The
+ * memory used by the incomplete messages is bounded, optionally by a budget shared with the reassemblers of other peers as
+ * well, and the messages whose segments stop arriving are dropped after a timeout.
+ */
+class SegmentReassembler {
+
+	LOG_DECLARE_CLASS_CONTEXT("SeRe", "SegmentReassembler");
+
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	/// Default maximum number of payload bytes buffered for the incomplete messages
+	static const size_t DEFAULT_MAXIMUM_BUFFERED_BYTES = 4 * 1024 * 1024;
+
+	/// Default maximum number of messages reassembled at the same time
+	static const size_t DEFAULT_MAXIMUM_PENDING_MESSAGE_COUNT = 16;
+
+	/// Default delay after which a message which has not received any new segment is dropped
+	static const int DEFAULT_TIMEOUT = 2000;  // ms
+
+	/**
+	 * @param headroom Number of bytes reserved at the beginning of the buffer of each message, before its payload, which the
+	 * caller can use for its own headers
+	 */
+	SegmentReassembler(size_t headroom = 0) :
+		m_headroom(headroom) {
+	}
+
+	~SegmentReassembler() {
+		releaseBufferedBytes(m_bufferedBytes);
+	}
+
+	SegmentReassembler(const SegmentReassembler&) = delete;
+	SegmentReassembler& operator=(const SegmentReassembler&) = delete;
+
+	/**
+	 * Adds a segment, whose payload starts with the TP header
+	 * @param messageHeader set to the header of the message when it is complete, without the TP flag
+	 * @param messageBuffer receives the buffer of the message when it is complete, in which the payload follows the headroom
+	 * @return true if the segment completes its message
+	 */
+	bool addSegment(const SomeIP::SomeIPHeader& header, const void* payload, size_t payloadLength,
+			SomeIP::SomeIPHeader& messageHeader, ByteArray& messageBuffer, Clock::time_point now = Clock::now());
+
+	/**
+	 * Drops the messages which have not received any segment during the timeout
+	 * @return the number of messages dropped
+	 */
+	size_t evictExpiredMessages(Clock::time_point now = Clock::now());
+
+	size_t getPendingMessageCount() const {
+		return m_pendingMessages.size();
+	}
+
+	/**
+	 * Returns the number of payload bytes currently buffered for the incomplete messages
+	 */
+	size_t getBufferedBytes() const {
+		return m_bufferedBytes;
+	}
+
+	void setMaximumBufferedBytes(size_t size) {
+		m_maximumBufferedBytes = size;
+	}
+
+	void setMaximumPendingMessageCount(size_t count) {
+		assert(count != 0);
+		m_maximumPendingMessageCount = count;
+	}
+
+	/**
+	 * Makes the buffered bytes count against the given budget, in addition to the maximum of this reassembler. The budget is
+	 * shared with the reassemblers of the other peers.
+	 */
+	void setSharedBudget(std::shared_ptr<SegmentReassemblyBudget> budget) {
+		assert(m_bufferedBytes == 0);
+		m_sharedBudget = budget;
+	}
+
+	void setTimeout(int timeout) {
+		m_timeout = timeout;
+	}
+
+	int getTimeout() const {
+		return m_timeout;
+	}
+
+private:
+	static const size_t UNKNOWN_LENGTH = -1;
+
+	struct PendingMessage {
+		/// Header of the message, without the TP flag
+		SomeIP::SomeIPHeader m_header;
+		ByteArray m_buffer;
+		/// Ranges of the payload already received, sorted and merged
+		std::vector<std::pair<size_t, size_t> > m_receivedRanges;
+		/// Length of the payload, known once the last segment has been received
+		size_t m_payloadLength = UNKNOWN_LENGTH;
+		Clock::time_point m_lastSegmentTime;
+	};
+
+	PendingMessage& getOrCreatePendingMessage(const SomeIP::SomeIPHeader& header, Clock::time_point now);
+
+	/**
+	 * Makes room for the given number of additional bytes, by dropping the oldest messages other than the given one, and
+	 * reserves them
+	 * @return false if the bytes do not fit even without the other messages
+	 */
+	bool reserveBufferedBytes(size_t size, const PendingMessage& message);
+
+	void releaseBufferedBytes(size_t size);
+
+	void dropMessage(const PendingMessage& message, const char* reason);
+
+	void removeMessage(const PendingMessage& message);
+
+	static void addReceivedRange(PendingMessage& message, size_t begin, size_t end);
+
+	size_t m_headroom;
+
+	size_t m_maximumBufferedBytes = DEFAULT_MAXIMUM_BUFFERED_BYTES;
+	size_t m_maximumPendingMessageCount = DEFAULT_MAXIMUM_PENDING_MESSAGE_COUNT;
+	int m_timeout = DEFAULT_TIMEOUT;
+
+	std::vector<std::unique_ptr<PendingMessage> > m_pendingMessages;
+	size_t m_bufferedBytes = 0;
+
+	std::shared_ptr<SegmentReassemblyBudget> m_sharedBudget;
+
+};
+
+}
@@ -6,6 +6,7 @@
 
 #include "ServiceAnnouncer.h"
 #include "TCPManager.h"
+#include "UDPManager.h"
 
 namespace SomeIP_Dispatcher {
 
@@ -25,46 +26,65 @@ void ServiceAnnouncer::sendMessage(const SomeIPServiceDiscoveryMessage& serviceD
 
 }
 
-void ServiceAnnouncer::onServiceRegistered(const Service& service) {
+std::vector<ServiceAnnouncer::OfferedEndPoint> ServiceAnnouncer::getOfferedEndPoints(const Service& service) {
 
-	const TCPServer* server = m_tcpServer.getEndPoint(service);
+	std::vector<OfferedEndPoint> endPoints;
 
+	// the UDP endpoint comes first, so that the receivers supporting UDP use it rather than the TCP one
+	if (m_udpManager != nullptr) {
+		const UDPEndPoint* udpEndPoint = m_udpManager->getEndPoint(service);
+		if (udpEndPoint != nullptr)
+			for ( auto ipAddress : udpEndPoint->getIPAddresses() )
+				endPoints.push_back( OfferedEndPoint(TransportProtocol::UDP, ipAddress) );
+	}
+
+	const TCPServer* server = m_tcpServer.getEndPoint(service);
 	if (server != nullptr)
-		for (auto channel : m_channels)
-			for (auto ipAddress : server->getIPAddresses())
-				if (channel.address == ipAddress.getAddress()) {
-					SomeIPServiceDiscoveryMessage serviceDiscoveryMessage(true);
+		for ( auto ipAddress : server->getIPAddresses() )
+			endPoints.push_back( OfferedEndPoint(TransportProtocol::TCP, ipAddress) );
 
-					SomeIPServiceDiscoveryServiceOfferedEntry serviceEntry(serviceDiscoveryMessage,
-							service.getServiceIDs(), TransportProtocol::TCP, ipAddress.m_address, ipAddress.m_port);
+	return endPoints;
+}
+
+void ServiceAnnouncer::onServiceRegistered(const Service& service) {
 
-					serviceDiscoveryMessage.addEntry(serviceEntry);
+	auto endPoints = getOfferedEndPoints(service);
+
+	for (auto& channel : m_channels) {
+		SomeIPServiceDiscoveryMessage serviceDiscoveryMessage(true);
 
-					sendMessage(serviceDiscoveryMessage, channel);
-				}
+		for (auto& endPoint : endPoints)
+			if ( channel.address == endPoint.second.getAddress() ) {
+				SomeIPServiceDiscoveryServiceOfferedEntry serviceEntry(serviceDiscoveryMessage,
+						service.getServiceIDs(), endPoint.first, endPoint.second.m_address, endPoint.second.m_port);
+
+				serviceDiscoveryMessage.addEntry(serviceEntry);
+			}
+
+		if ( !serviceDiscoveryMessage.getEntries().empty() )
+			sendMessage(serviceDiscoveryMessage, channel);
+	}
 
 }
 
 void ServiceAnnouncer::onServiceUnregistered(const Service& service) {
 
-	const TCPServer* server = m_tcpServer.getEndPoint(service);
+	auto endPoints = getOfferedEndPoints(service);
 
-	if (server != nullptr)
-		for (auto& channel : m_channels) {
-			for (auto ipAddress : server->getIPAddresses())
-				if (channel.address == ipAddress.getAddress()) {
-
-					SomeIPServiceDiscoveryMessage serviceDiscoveryMessage(true);
+	for (auto& channel : m_channels) {
+		SomeIPServiceDiscoveryMessage serviceDiscoveryMessage(true);
 
-					SomeIPServiceDiscoveryServiceUnregisteredEntry serviceEntry(serviceDiscoveryMessage,
-							service.getServiceIDs(), SomeIP::TransportProtocol::TCP, ipAddress.m_address,
-							ipAddress.m_port);
+		for (auto& endPoint : endPoints)
+			if ( channel.address == endPoint.second.getAddress() ) {
+				SomeIPServiceDiscoveryServiceUnregisteredEntry serviceEntry(serviceDiscoveryMessage,
+						service.getServiceIDs(), endPoint.first, endPoint.second.m_address, endPoint.second.m_port);
 
-					serviceDiscoveryMessage.addEntry(serviceEntry);
+				serviceDiscoveryMessage.addEntry(serviceEntry);
+			}
 
-					sendMessage(serviceDiscoveryMessage, channel);
-				}
-		}
+		if ( !serviceDiscoveryMessage.getEntries().empty() )
+			sendMessage(serviceDiscoveryMessage, channel);
+	}
 
 }
 
@@ -17,6 +17,8 @@
 
 namespace SomeIP_Dispatcher {
 
+class UDPManager;
+
 /**
  * Announces the available services via UDP
  */
@@ -30,6 +32,8 @@ class ServiceAnnouncer : public ServiceRegistrationListener  {
 		IPV4Address address;
 	};
 
+	typedef std::pair<TransportProtocol, IPv4TCPEndPoint> OfferedEndPoint;
+
 public:
 	ServiceAnnouncer(Dispatcher& dispatcher, TCPManager& tcpServer, MainLoopContext& mainLoopContext) :
 		m_dispatcher(dispatcher), m_timer(
@@ -59,7 +63,19 @@ public:
 
 	SomeIPReturnCode init();
 
+	/**
+	 * Sets the manager whose endpoints are announced in addition to the TCP ones
+	 */
+	void setUDPManager(UDPManager& udpManager) {
+		m_udpManager = &udpManager;
+	}
+
 private:
+	/**
+	 * Returns the endpoints through which the given service is offered
+	 */
+	std::vector<OfferedEndPoint> getOfferedEndPoints(const Service& service);
+
 	Dispatcher& m_dispatcher;
 
 	std::unique_ptr<TimeOutMainLoopHook> m_timer;
@@ -68,6 +84,8 @@ private:
 
 	TCPManager& m_tcpServer;
 
+	UDPManager* m_udpManager = nullptr;
+
 };
 
 }
@@ -26,7 +26,7 @@ class SomeIPServiceDiscoveryConfigurationOption : public Serializable {
 public:
 	enum class Type
 		: uint8_t {
-		IPv4Option = 0x04
+		IPv4Option = 0x04, IPv4MulticastOption = 0x14
 	};
 
 	virtual ~SomeIPServiceDiscoveryConfigurationOption() {
@@ -40,15 +40,15 @@ public:
 class IPv4ConfigurationOption : public SomeIPServiceDiscoveryConfigurationOption {
 
 public:
-	IPv4ConfigurationOption(TransportProtocol protocol, IPV4Address address, TCPPort port) {
-		m_type = Type::IPv4Option;
+	IPv4ConfigurationOption(TransportProtocol protocol, IPV4Address address, TCPPort port, Type type = Type::IPv4Option) {
+		m_type = type;
 		m_protocol = protocol;
 		m_port = port;
 		m_address = address;
 	}
 
-	IPv4ConfigurationOption(NetworkDeserializer& deserializer) {
-		m_type = Type::IPv4Option;
+	IPv4ConfigurationOption(NetworkDeserializer& deserializer, Type type = Type::IPv4Option) {
+		m_type = type;
 		std::array<uint8_t,4> address;
 		deserializer >> address[0] >> address[1] >> address[2] >> address[3];
 		deserializer >> reserved;
@@ -65,6 +65,13 @@ public:
 		serializer << m_port;
 	}
 
+	/**
+	 * Returns true if the option contains the address of a multicast group instead of the address of an endpoint
+	 */
+	bool isMulticast() const {
+		return (m_type == Type::IPv4MulticastOption);
+	}
+
 	IPV4Address m_address;
 	uint16_t m_port = -1;
 	TransportProtocol m_protocol;
@@ -234,7 +241,8 @@ public:
 
 		uint8_t flagsAsUint8;
 		serializer >> flagsAsUint8 >> m_reserved1 >> m_reserved2 >> m_reserved3;
-		m_flags = *reinterpret_cast<Flags*>(&flagsAsUint8);
+		// the flags are stored in the first byte of the structure, which is larger than the byte read
+		memcpy( &m_flags, &flagsAsUint8, sizeof(flagsAsUint8) );
 
 		// read entries
 		{
@@ -285,8 +293,9 @@ public:
 
 				switch (type) {
 
-				case SomeIPServiceDiscoveryConfigurationOption::Type::IPv4Option : {
-					addOption( IPv4ConfigurationOption(serializer) );
+				case SomeIPServiceDiscoveryConfigurationOption::Type::IPv4Option :
+				case SomeIPServiceDiscoveryConfigurationOption::Type::IPv4MulticastOption : {
+					addOption( IPv4ConfigurationOption(serializer, type) );
 				}
 				break;
 
@@ -405,6 +414,33 @@ public:
 	}
 };
 
+/**
+ * Acknowledges a subscription. If the notifications of the eventgroup are sent to a multicast group, its address is attached
+ * to the entry, so that the subscriber can join the group.
+ */
+class SomeIPServiceDiscoverySubscribeAckEntry : public SomeIPServiceDiscoveryEventGroupEntry {
+public:
+	SomeIPServiceDiscoverySubscribeAckEntry(SomeIPServiceDiscoveryMessage& serviceDiscoveryMessage,
+						const SomeIPServiceDiscoveryEventGroupEntry& subscription,
+						const IPv4TCPEndPoint* multicastGroup) {
+		m_type = SomeIP::SomeIPServiceDiscoveryEntryHeader::Type::SubscribeAck;
+		m_ttl = subscription.m_ttl;
+		m_serviceID = subscription.m_serviceID;
+		m_majorVersion = subscription.m_majorVersion;
+		m_instanceID = subscription.m_instanceID;
+		m_eventGroupID = subscription.m_eventGroupID;
+		m_1 = 0;
+		m_2 = 0;
+		m_indexFirstOptionRun = m_indexSecondOptionRun = 0;
+		if (multicastGroup != nullptr) {
+			IPv4ConfigurationOption multicastOption(TransportProtocol::UDP, multicastGroup->m_address, multicastGroup->m_port,
+								SomeIPServiceDiscoveryConfigurationOption::Type::IPv4MulticastOption);
+			m_indexFirstOptionRun = serviceDiscoveryMessage.addOption(multicastOption);
+			m_1 = 1;
+		}
+	}
+};
+
 class ServiceDiscoveryListener {
 public:
 	virtual ~ServiceDiscoveryListener() {
@@ -416,6 +452,13 @@ public:
 	virtual void onRemoteClientSubscriptionFinished(const SomeIPServiceDiscoveryEventGroupEntry& serviceEntry,
 							const IPv4ConfigurationOption* address) = 0;
 
+	/**
+	 * Called when a subscription of ours has been acknowledged by the provider of the service
+	 * @param multicastAddress the group to which the notifications are sent, or nullptr if they are sent to us directly
+	 */
+	virtual void onRemoteSubscriptionAcknowledged(const SomeIPServiceDiscoveryEventGroupEntry& serviceEntry,
+						      const IPv4ConfigurationOption* multicastAddress) = 0;
+
 	virtual void onRemoteServiceAvailable(const SomeIPServiceDiscoveryServiceEntry& serviceEntry,
 					      const IPv4ConfigurationOption* address,
 					      const SomeIPServiceDiscoveryMessage& message) = 0;
@@ -508,6 +551,24 @@ public:
 			}
 			break;
 
+			case SomeIP::SomeIPServiceDiscoveryEntryHeader::Type::SubscribeAck : {
+				IPv4AddressExtractor ext;
+
+				const IPv4ConfigurationOption* multicastOption = nullptr;
+				if ( (entry.m_1 != 0) && ( entry.m_indexFirstOptionRun < m_message.getOptions().size() ) ) {
+					multicastOption = boost::apply_visitor(ext, m_message.getOptions()[entry.m_indexFirstOptionRun]);
+					if ( (multicastOption != nullptr) && !multicastOption->isMulticast() )
+						multicastOption = nullptr;
+				}
+
+				if (entry.m_ttl != 0)
+					m_serviceListener.m_listener.onRemoteSubscriptionAcknowledged(entry, multicastOption);
+				else
+					log_warning() << "Subscription to eventgroup " << entry.m_eventGroupID << " of service " <<
+						ServiceIDs(entry.m_serviceID, entry.m_instanceID).toString() << " refused";
+			}
+			break;
+
 			default :
 				assert(false);
 				break;
@@ -531,14 +592,19 @@ public:
 
 	}
 
-	void decodeMessage(const void* payload, size_t payloadLength) {
-		NetworkDeserializer deserializer(payload, payloadLength);
-		SomeIPServiceDiscoveryMessage message(deserializer);
-
-		EntryVisitor visitor(*this, message);
-		for ( auto& entry : message.getEntries() ) {
-			boost::apply_visitor(visitor, entry);
+	/**
+	 * Decodes a complete message, including its SOME/IP header
+	 */
+	void decodeMessage(const void* data, size_t length) {
+		SomeIPHeader header;
+		size_t payloadLength;
+		if ( (length < SOMEIP_HEADER_LENGTH_ON_NETWORK) || !SomeIPHeaderCodec::decode(data, header, payloadLength) ) {
+			log_warning() << "Invalid service discovery message received";
+			return;
 		}
+
+		const unsigned char* payload = static_cast<const unsigned char*>(data) + SOMEIP_HEADER_LENGTH_ON_NETWORK;
+		decodeMessage( header, payload, std::min(payloadLength, length - SOMEIP_HEADER_LENGTH_ON_NETWORK) );
 	}
 
 private:
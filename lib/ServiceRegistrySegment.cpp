@@ -0,0 +1,308 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <new>
+
+#include "ServiceRegistrySegment.h"
+
+namespace SomeIP_Lib {
+
+SomeIPReturnCode ServiceRegistrySegment::create(uint32_t capacity) {
+
+	uint32_t roundedCapacity = 1;
+	while (roundedCapacity < capacity)
+		roundedCapacity <<= 1;
+
+	int fd = memfd_create("someip-registry", MFD_CLOEXEC);
+	if (fd == -1) {
+		log_warning() << "Can't create registry segment";
+		return SomeIPReturnCode::ERROR;
+	}
+
+	size_t size = getSegmentSize(roundedCapacity);
+
+	if (ftruncate(fd, size) != 0) {
+		log_warning() << "Can't resize registry segment";
+		close(fd);
+		return SomeIPReturnCode::ERROR;
+	}
+
+	void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED) {
+		log_warning() << "Can't map registry segment";
+		close(fd);
+		return SomeIPReturnCode::ERROR;
+	}
+
+	// the clients only get a read-only descriptor, which can neither be mapped in write mode nor be resized. Since a client
+	// could reopen it through /proc in write mode, the file is made read-only as well
+	char path[64];
+	snprintf(path, sizeof(path), "/proc/self/fd/%i", fd);
+	int readOnlyFd = open(path, O_RDONLY | O_CLOEXEC);
+	if ( (readOnlyFd == -1) || (fchmod(fd, S_IRUSR | S_IRGRP | S_IROTH) != 0) ) {
+		log_warning() << "Can't make registry segment read-only";
+		if (readOnlyFd != -1)
+			close(readOnlyFd);
+		munmap(p, size);
+		close(fd);
+		return SomeIPReturnCode::ERROR;
+	}
+
+	// our own mapping stays writable without the writable descriptor
+	close(fd);
+
+	m_header = new (p) Header();
+	m_header->m_capacity = roundedCapacity;
+	m_header->m_sequence.store(0);
+	m_header->m_usedSlotCount = 0;
+	m_header->m_deletedSlotCount = 0;
+	m_header->m_overflow = 0;
+	// the slots are already zeroed by ftruncate(), which means EMPTY
+	m_header->m_magic = MAGIC;
+
+	m_size = size;
+	m_fileDescriptor = readOnlyFd;
+
+	return SomeIPReturnCode::OK;
+}
+
+SomeIPReturnCode ServiceRegistrySegment::map(int fd) {
+
+	unmap();
+
+	struct stat fileStat;
+	if ( (fstat(fd, &fileStat) != 0) || (static_cast<size_t>(fileStat.st_size) < sizeof(Header)) ) {
+		close(fd);
+		return SomeIPReturnCode::ERROR;
+	}
+
+	size_t size = fileStat.st_size;
+
+	void* p = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED) {
+		log_warning() << "Can't map registry segment";
+		close(fd);
+		return SomeIPReturnCode::ERROR;
+	}
+
+	Header* header = static_cast<Header*>(p);
+	if ( (header->m_magic != MAGIC) || (getSegmentSize(header->m_capacity) > size) ) {
+		log_warning() << "Invalid registry segment";
+		munmap(p, size);
+		close(fd);
+		return SomeIPReturnCode::ERROR;
+	}
+
+	m_header = header;
+	m_size = size;
+	m_fileDescriptor = fd;
+
+	return SomeIPReturnCode::OK;
+}
+
+void ServiceRegistrySegment::unmap() {
+	if (m_header != nullptr) {
+		munmap(m_header, m_size);
+		m_header = nullptr;
+		m_size = 0;
+	}
+
+	if (m_fileDescriptor != -1) {
+		close(m_fileDescriptor);
+		m_fileDescriptor = -1;
+	}
+}
+
+const ServiceRegistrySegment::Slot* ServiceRegistrySegment::findSlot(uint32_t key) const {
+	uint32_t mask = m_header->m_capacity - 1;
+	const Slot* slots = getSlots();
+
+	// bounded, since a reader might see the table while it is being modified
+	for (uint32_t i = 0, index = getHash(key) & mask; i <= mask; i++, index = (index + 1) & mask) {
+		const Slot& slot = slots[index];
+		if (slot.m_state == SlotState::EMPTY)
+			return nullptr;
+		if ( (slot.m_state == SlotState::USED) && (slot.m_key == key) )
+			return &slot;
+	}
+
+	return nullptr;
+}
+
+void ServiceRegistrySegment::insert(uint32_t key) {
+	uint32_t mask = m_header->m_capacity - 1;
+	Slot* slots = getSlots();
+
+	for (uint32_t index = getHash(key) & mask; ; index = (index + 1) & mask) {
+		Slot& slot = slots[index];
+		if (slot.m_state != SlotState::USED) {
+			if (slot.m_state == SlotState::DELETED)
+				m_header->m_deletedSlotCount--;
+			slot.m_key = key;
+			slot.m_state = SlotState::USED;
+			m_header->m_usedSlotCount++;
+			return;
+		}
+	}
+}
+
+void ServiceRegistrySegment::clear() {
+	Slot* slots = getSlots();
+	for (uint32_t i = 0; i < m_header->m_capacity; i++)
+		slots[i].m_state = SlotState::EMPTY;
+
+	m_header->m_usedSlotCount = 0;
+	m_header->m_deletedSlotCount = 0;
+}
+
+void ServiceRegistrySegment::compact() {
+	std::vector<uint32_t> keys;
+	Slot* slots = getSlots();
+
+	for (uint32_t i = 0; i < m_header->m_capacity; i++) {
+		if (slots[i].m_state == SlotState::USED)
+			keys.push_back(slots[i].m_key);
+	}
+
+	clear();
+
+	for (auto key : keys)
+		insert(key);
+}
+
+void ServiceRegistrySegment::addService(SomeIP::ServiceIDs serviceID) {
+
+	if ( !isMapped() )
+		return;
+
+	uint32_t key = getKey(serviceID);
+
+	if (findSlot(key) != nullptr)
+		return;
+
+	uint32_t maxSlotCount = getMaximumServiceCount();
+
+	beginWrite();
+
+	if (m_header->m_usedSlotCount + 1 > maxSlotCount) {
+		if (m_header->m_overflow == 0)
+			log_error() << "Registry segment is full. Clients will need to use IPC to check the service availability";
+		m_header->m_overflow = 1;
+	} else {
+		if (m_header->m_usedSlotCount + m_header->m_deletedSlotCount + 1 > maxSlotCount)
+			compact();
+		insert(key);
+	}
+
+	endWrite();
+}
+
+void ServiceRegistrySegment::removeService(SomeIP::ServiceIDs serviceID) {
+
+	if ( !isMapped() )
+		return;
+
+	Slot* slot = const_cast<Slot*>( findSlot( getKey(serviceID) ) );
+
+	if (slot == nullptr)
+		return;
+
+	beginWrite();
+	slot->m_state = SlotState::DELETED;
+	m_header->m_usedSlotCount--;
+	m_header->m_deletedSlotCount++;
+	endWrite();
+}
+
+void ServiceRegistrySegment::rebuild(const std::vector<SomeIP::ServiceIDs>& services) {
+
+	if ( !isMapped() )
+		return;
+
+	uint32_t maxSlotCount = getMaximumServiceCount();
+	bool wasOverflowed = isOverflowed();
+
+	beginWrite();
+
+	clear();
+	m_header->m_overflow = 0;
+	for (auto serviceID : services) {
+		uint32_t key = getKey(serviceID);
+		if (findSlot(key) != nullptr)
+			continue;
+		if (m_header->m_usedSlotCount + 1 > maxSlotCount) {
+			m_header->m_overflow = 1;
+			break;
+		}
+		insert(key);
+	}
+
+	endWrite();
+
+	if ( wasOverflowed && !isOverflowed() )
+		log_info() << "Registry segment contains all the services again";
+}
+
+ServiceRegistrySegment::LookupResult ServiceRegistrySegment::lookup(SomeIP::ServiceIDs serviceID) const {
+
+	if ( !isMapped() )
+		return LookupResult::UNKNOWN;
+
+	uint32_t key = getKey(serviceID);
+
+	for (int attempt = 0; attempt < MAXIMUM_READ_ATTEMPTS; attempt++) {
+		uint32_t sequence = m_header->m_sequence.load(std::memory_order_acquire);
+		if (sequence & 1) {
+			std::this_thread::yield();             // being modified
+			continue;
+		}
+
+		bool found = (findSlot(key) != nullptr);
+		bool overflow = (m_header->m_overflow != 0);
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (m_header->m_sequence.load(std::memory_order_relaxed) == sequence) {
+			if (found)
+				return LookupResult::FOUND;
+			return overflow ? LookupResult::UNKNOWN : LookupResult::NOT_FOUND;
+		}
+	}
+
+	// the writer may have died in the middle of a modification
+	log_warning() << "Service registry segment not readable";
+	return LookupResult::UNKNOWN;
+}
+
+bool ServiceRegistrySegment::getServices(std::vector<SomeIP::ServiceIDs>& services) const {
+
+	if ( !isMapped() )
+		return false;
+
+	for (int attempt = 0; attempt < MAXIMUM_READ_ATTEMPTS; attempt++) {
+		uint32_t sequence = m_header->m_sequence.load(std::memory_order_acquire);
+		if (sequence & 1) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		services.resize(0);
+		const Slot* slots = getSlots();
+		for (uint32_t i = 0; i < m_header->m_capacity; i++) {
+			if (slots[i].m_state == SlotState::USED)
+				services.push_back( SomeIP::ServiceIDs(slots[i].m_key >> 16, slots[i].m_key & 0xFFFF) );
+		}
+		bool overflow = (m_header->m_overflow != 0);
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (m_header->m_sequence.load(std::memory_order_relaxed) == sequence)
+			return !overflow;
+	}
+
+	log_warning() << "Service registry segment not readable";
+	services.resize(0);
+	return false;
+}
+
+}
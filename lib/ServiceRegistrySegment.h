@@ -0,0 +1,175 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+#include "SomeIP-common.h"
+#include "SomeIP.h"
+
+namespace SomeIP_Lib {
+
+/**
+ * Shared memory segment in which the dispatcher publishes the list of registered services, so that the clients can check
+ * whether a service is available without any IPC.
+ * The services are stored in an open-addressing hash table, protected by a sequence lock : the writer increments the
+ * sequence number before and after each modification, and the readers retry whenever the number is odd or has changed
+ * while they were reading.
+ */
+class ServiceRegistrySegment {
+
+	LOG_DECLARE_CLASS_CONTEXT("SRSe", "ServiceRegistrySegment");
+
+public:
+	static const uint32_t DEFAULT_CAPACITY = 16384;
+
+	enum class LookupResult {
+		FOUND, NOT_FOUND,
+		UNKNOWN         /// the segment is not available or is not complete
+	};
+
+	ServiceRegistrySegment() {
+	}
+
+	~ServiceRegistrySegment() {
+		unmap();
+	}
+
+	ServiceRegistrySegment(const ServiceRegistrySegment&) = delete;
+	ServiceRegistrySegment& operator=(const ServiceRegistrySegment&) = delete;
+
+	/**
+	 * Creates a new writable segment. The capacity is rounded up to a power of two.
+	 */
+	SomeIPReturnCode create(uint32_t capacity = DEFAULT_CAPACITY);
+
+	/**
+	 * Maps a segment created by another process, in read-only mode. The segment takes the ownership of the file descriptor.
+	 */
+	SomeIPReturnCode map(int fd);
+
+	void unmap();
+
+	bool isMapped() const {
+		return (m_header != nullptr);
+	}
+
+	/**
+	 * Returns the read-only file descriptor to be transferred to the processes which need to map the segment
+	 */
+	int getFileDescriptor() const {
+		return m_fileDescriptor;
+	}
+
+	void addService(SomeIP::ServiceIDs serviceID);
+
+	void removeService(SomeIP::ServiceIDs serviceID);
+
+	/**
+	 * Replaces the content of the segment with the given services. The segment is not marked as full anymore if they all fit.
+	 */
+	void rebuild(const std::vector<SomeIP::ServiceIDs>& services);
+
+	/**
+	 * Returns true if some services could not be added because the segment was full
+	 */
+	bool isOverflowed() const {
+		return isMapped() && (m_header->m_overflow != 0);
+	}
+
+	/**
+	 * Returns the number of services which fit into the segment, keeping the load factor of the table under 75%
+	 */
+	size_t getMaximumServiceCount() const {
+		return isMapped() ? m_header->m_capacity / 4 * 3 : 0;
+	}
+
+	/**
+	 * Returns UNKNOWN if the segment could not be read consistently after a bounded number of attempts, which happens if the
+	 * writer died in the middle of a modification
+	 */
+	LookupResult lookup(SomeIP::ServiceIDs serviceID) const;
+
+	/**
+	 * Copies the list of services into the given vector
+	 * @return false if the segment is not available, is not complete or could not be read consistently
+	 */
+	bool getServices(std::vector<SomeIP::ServiceIDs>& services) const;
+
+private:
+	static const uint32_t MAGIC = 0x53524547;         // "SREG"
+
+	/// Number of times a reader retries while the segment is being modified, before giving up and reporting it as unavailable
+	static const int MAXIMUM_READ_ATTEMPTS = 100000;
+
+	enum class SlotState : uint32_t {
+		EMPTY, USED, DELETED
+	};
+
+	struct Slot {
+		uint32_t m_key;
+		SlotState m_state;
+	};
+
+	struct Header {
+		uint32_t m_magic;
+		uint32_t m_capacity;
+		std::atomic<uint32_t> m_sequence;
+		uint32_t m_usedSlotCount;
+		uint32_t m_deletedSlotCount;
+
+		/// Set when the table was too small to contain all the services
+		uint32_t m_overflow;
+	};
+
+	static uint32_t getKey(SomeIP::ServiceIDs serviceID) {
+		return (static_cast<uint32_t>(serviceID.serviceID) << 16) | serviceID.instanceID;
+	}
+
+	static uint32_t getHash(uint32_t key) {
+		// multiplicative hashing
+		return key * 2654435761u;
+	}
+
+	static size_t getSegmentSize(uint32_t capacity) {
+		return sizeof(Header) + capacity * sizeof(Slot);
+	}
+
+	Slot* getSlots() const {
+		return reinterpret_cast<Slot*>(m_header + 1);
+	}
+
+	/**
+	 * Returns the slot containing the key, or nullptr
+	 */
+	const Slot* findSlot(uint32_t key) const;
+
+	void insert(uint32_t key);
+
+	/**
+	 * Empties the table
+	 */
+	void clear();
+
+	/**
+	 * Rebuilds the table, to get rid of the deleted slots
+	 */
+	void compact();
+
+	void beginWrite() {
+		m_header->m_sequence.store(m_header->m_sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+	}
+
+	void endWrite() {
+		m_header->m_sequence.store(m_header->m_sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	Header* m_header = nullptr;
+	size_t m_size = 0;
+	int m_fileDescriptor = -1;
+
+};
+
+}
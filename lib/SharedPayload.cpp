@@ -0,0 +1,83 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "SharedPayload.h"
+
+namespace SomeIP_Lib {
+
+static const int REQUIRED_SEALS = F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE;
+
+int SharedPayload::createFile(const void* data, size_t length) {
+
+	int fd = memfd_create("someip-payload", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (fd == -1) {
+		log_warning() << "Can't create shared payload";
+		return -1;
+	}
+
+	// the file is written without any writable mapping, which would prevent F_SEAL_WRITE
+	const char* p = static_cast<const char*>(data);
+	size_t writtenBytes = 0;
+	while (writtenBytes < length) {
+		ssize_t n = write(fd, p + writtenBytes, length - writtenBytes);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			log_warning() << "Can't write shared payload";
+			close(fd);
+			return -1;
+		}
+		writtenBytes += n;
+	}
+
+	if (fcntl(fd, F_ADD_SEALS, REQUIRED_SEALS | F_SEAL_SEAL) != 0) {
+		log_warning() << "Can't seal shared payload";
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+SomeIPReturnCode SharedPayload::map(int fd) {
+
+	unmap();
+
+	int seals = fcntl(fd, F_GET_SEALS);
+	if ( (seals == -1) || ( (seals & REQUIRED_SEALS) != REQUIRED_SEALS ) ) {
+		log_error() << "Shared payload is not sealed";
+		return SomeIPReturnCode::ERROR;
+	}
+
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0)
+		return SomeIPReturnCode::ERROR;
+
+	size_t size = fileStat.st_size;
+	if (size == 0)
+		return SomeIPReturnCode::OK;
+
+	void* p = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED) {
+		log_error() << "Can't map shared payload";
+		return SomeIPReturnCode::ERROR;
+	}
+
+	m_data = static_cast<unsigned char*>(p);
+	m_size = size;
+
+	return SomeIPReturnCode::OK;
+}
+
+void SharedPayload::unmap() {
+	if (m_data != nullptr) {
+		munmap(m_data, m_size);
+		m_data = nullptr;
+		m_size = 0;
+	}
+}
+
+}
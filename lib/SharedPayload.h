@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "SomeIP-common.h"
+
+namespace SomeIP_Lib {
+
+/**
+ * Payload of a large SOME/IP message, stored in a sealed memory file. Such a message is sent over the local IPC as a
+ * SEND_MESSAGE which only contains the header, with the file descriptor of the payload attached. The dispatcher forwards the
+ * descriptor instead of the payload, and the receivers map the file in read-only mode, so that the payload is never copied.
+ */
+class SharedPayload {
+
+	LOG_DECLARE_CLASS_CONTEXT("ShPa", "SharedPayload");
+
+public:
+	/// Payload size from which a shared payload is used by default
+	static const size_t DEFAULT_THRESHOLD = 256 * 1024;
+
+	SharedPayload() {
+	}
+
+	~SharedPayload() {
+		unmap();
+	}
+
+	SharedPayload(const SharedPayload&) = delete;
+	SharedPayload& operator=(const SharedPayload&) = delete;
+
+	/**
+	 * Creates a sealed memory file containing a copy of the given data
+	 * @return the file descriptor, or -1 in case of error
+	 */
+	static int createFile(const void* data, size_t length);
+
+	/**
+	 * Maps the given file in read-only mode. The file must be sealed against any modification of its content or size, so that
+	 * its sender can not make us crash by truncating it. The file descriptor is not owned.
+	 */
+	SomeIPReturnCode map(int fd);
+
+	void unmap();
+
+	const unsigned char* getData() const {
+		return m_data;
+	}
+
+	size_t getSize() const {
+		return m_size;
+	}
+
+private:
+	unsigned char* m_data = nullptr;
+	size_t m_size = 0;
+
+};
+
+}
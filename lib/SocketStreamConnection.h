@@ -1,14 +1,19 @@
 #pragma once
 
 #include <functional>
+#include <deque>
+#include <memory>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <sys/un.h>
 #include <dirent.h>
 #include <unistd.h>
+#include <string.h>
 
 #include "ipc.h"
+#include "SpliceRelay.h"
 
 #define returnIfError(code) {IPCOperationReport c = code; if (c != IPCOperationReport::OK) return c; }
 
@@ -30,13 +35,23 @@ public:
 		m_receivedBytesCount = 0;
 	}
 
-	IPCOperationReport read(int fd, bool blocking = false) {
+	/**
+	 * Reads the available bytes. If receivedFileDescriptor is not null, the ancillary data is also read and any file
+	 * descriptor received via SCM_RIGHTS is stored there.
+	 */
+	IPCOperationReport read(int fd, bool blocking = false, int* receivedFileDescriptor = nullptr) {
 
 		if (m_size - m_receivedBytesCount == 0)
 			return IPCOperationReport::OK;  // Nothing to read
 
-		ssize_t readLength = recv(fd, m_pBuffer + m_receivedBytesCount, m_size - m_receivedBytesCount,
+		ssize_t readLength;
+
+		if (receivedFileDescriptor == nullptr)
+			readLength = recv(fd, m_pBuffer + m_receivedBytesCount, m_size - m_receivedBytesCount,
 					  blocking ? 0 : MSG_DONTWAIT);
+		else
+			readLength = receiveWithFileDescriptor(fd, m_pBuffer + m_receivedBytesCount, m_size - m_receivedBytesCount,
+							       blocking, *receivedFileDescriptor);
 
 		if (readLength < 0)
 			return IPCOperationReport::DISCONNECTED;
@@ -51,6 +66,40 @@ public:
 		return IPCOperationReport::OK;
 	}
 
+	/**
+	 * Receives some bytes together with a file descriptor which might have been attached to them.
+	 */
+	static ssize_t receiveWithFileDescriptor(int fd, void* buffer, size_t length, bool blocking,
+						 int& receivedFileDescriptor) {
+		struct iovec iov;
+		iov.iov_base = buffer;
+		iov.iov_len = length;
+
+		char controlBuffer[CMSG_SPACE( sizeof(int) )];
+
+		struct msghdr msg = {};
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = controlBuffer;
+		msg.msg_controllen = sizeof(controlBuffer);
+
+		ssize_t readLength = recvmsg(fd, &msg, (blocking ? 0 : MSG_DONTWAIT) | MSG_CMSG_CLOEXEC);
+
+		if (readLength > 0) {
+			for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg) ) {
+				if ( (cmsg->cmsg_level == SOL_SOCKET) && (cmsg->cmsg_type == SCM_RIGHTS) ) {
+					int receivedFd;
+					memcpy( &receivedFd, CMSG_DATA(cmsg), sizeof(receivedFd) );
+					if (receivedFileDescriptor != -1)
+						close(receivedFileDescriptor);
+					receivedFileDescriptor = receivedFd;
+				}
+			}
+		}
+
+		return readLength;
+	}
+
 	bool isComplete() {
 		return (m_receivedBytesCount == m_size);
 	}
@@ -79,10 +128,17 @@ class SocketStreamConnection {
 public:
 	static const int UNINITIALIZED_FILE_DESCRIPTOR = -1;
 
+	/// Maximum size of a message buffered by the dispatcher. Larger messages are refused, unless they can be forwarded without
+	/// being buffered
+	static const size_t DEFAULT_MAXIMUM_MESSAGE_SIZE = 64 * 1024 * 1024;
+
 	SocketStreamConnection() {
 	}
 
 	virtual ~SocketStreamConnection() {
+		for (auto& pendingFileDescriptor : m_pendingFileDescriptors)
+			close(pendingFileDescriptor.m_fileDescriptor);
+		notifyRelayDisconnection();
 	}
 
 	bool isConnected() const {
@@ -94,6 +150,11 @@ public:
 			//			log_debug() << "Disconnecting";
 			close( getFileDescriptor() );
 			setFileDescriptor(UNINITIALIZED_FILE_DESCRIPTOR);
+			// no completion can be received anymore. The kernel keeps its own references to the pages which are still queued.
+			m_pendingZeroCopyBuffers.clear();
+			m_nextZeroCopySequenceNumber = 0;
+			m_isZeroCopyEnabled = false;
+			notifyRelayDisconnection();
 			onDisconnected();
 		}
 	}
@@ -106,6 +167,52 @@ public:
 		m_connectionFileDescriptor = fd;
 	}
 
+	/**
+	 * Returns true if the socket keeps the boundaries of the data written with each call (SOCK_SEQPACKET). In that case,
+	 * the data queued with each call to enqueueData() is sent later with a single call.
+	 */
+	bool isPacketMode() const {
+		return m_isPacketMode;
+	}
+
+	void setPacketMode(bool packetMode) {
+		m_isPacketMode = packetMode;
+	}
+
+	/**
+	 * Enables the MSG_ZEROCOPY transmissions on the socket
+	 * @return false if the kernel does not support them
+	 */
+	bool enableZeroCopy();
+
+	bool isZeroCopyEnabled() const {
+		return m_isZeroCopyEnabled;
+	}
+
+	/**
+	 * Reads the completion notifications of the zero-copy transmissions from the error queue of the socket, and releases the
+	 * buffers which are not used by the kernel anymore. Called when POLLERR is reported on the socket.
+	 */
+	IPCOperationReport processZeroCopyCompletions();
+
+	/**
+	 * Reserves the socket for the given relay, which writes a message to it directly. The data written in the meantime is
+	 * queued, and sent once the relay is detached.
+	 * @return false if some data is pending already, or if the socket is in packet mode or used by another relay
+	 */
+	bool attachRelay(SpliceRelay& relay) {
+		if ( !isConnected() || isCongested() || m_isPacketMode )
+			return false;
+		m_relay = &relay;
+		return true;
+	}
+
+	void detachRelay() {
+		m_relay = nullptr;
+		if (m_dataToBeSent.size() != 0)
+			onCongestionDetected();
+	}
+
 	/**
 	 * Returns true if some bytes are available to read
 	 */
@@ -129,10 +236,54 @@ public:
 	/**
 	 */
 	IPCOperationReport writePendingDataNonBlocking() {
+		// the pending data is sent once the relay is finished
+		if (m_relay != nullptr)
+			return IPCOperationReport::OK;
+
 		if (m_dataToBeSent.size() != 0) {
 			ByteArray localContentCopy = m_dataToBeSent;
 			m_dataToBeSent.resize(0);
-			auto v = writeBytesNonBlocking( localContentCopy.getData(), localContentCopy.size() );
+
+			std::vector<PendingFileDescriptor> fileDescriptors;
+			fileDescriptors.swap(m_pendingFileDescriptors);
+
+			std::vector<size_t> packetEnds;
+			packetEnds.swap(m_pendingPacketEnds);
+
+			// the data is sent in chunks, so that each file descriptor is attached to the byte it was queued with, and
+			// each packet is sent with a single call
+			auto v = IPCOperationReport::OK;
+			size_t position = 0;
+			auto nextFileDescriptor = fileDescriptors.begin();
+			auto nextPacketEnd = packetEnds.begin();
+			while ( position < localContentCopy.size() ) {
+				int fd = UNINITIALIZED_FILE_DESCRIPTOR;
+				if ( (nextFileDescriptor != fileDescriptors.end()) && (nextFileDescriptor->m_position == position) ) {
+					fd = nextFileDescriptor->m_fileDescriptor;
+					nextFileDescriptor++;
+				}
+
+				size_t end =
+					(nextFileDescriptor != fileDescriptors.end()) ? nextFileDescriptor->m_position : localContentCopy.size();
+				if (nextPacketEnd != packetEnds.end() && (*nextPacketEnd <= end) )
+					end = *nextPacketEnd++;
+
+				if ( isConnected() ) {
+					if ( isCongested() )
+						enqueueData(localContentCopy.getData() + position, end - position, fd);
+					else
+						v = writeBytesNonBlocking(localContentCopy.getData() + position, end - position, fd);
+				}
+
+				if (fd != UNINITIALIZED_FILE_DESCRIPTOR)
+					close(fd);
+
+				position = end;
+			}
+
+			if ( !isConnected() )
+				return IPCOperationReport::DISCONNECTED;
+
 			if (v == IPCOperationReport::OK)
 				onCongestionFinished();
 			return v;
@@ -142,21 +293,81 @@ public:
 
 protected:
 	IPCOperationReport readBytesBlocking(void* buffer, size_t length);
-	IPCOperationReport writeBytesBlocking(const void* buffer, ssize_t length);
-	IPCOperationReport writeBytesNonBlocking(const void* data, ssize_t length);
+	IPCOperationReport writeBytesBlocking(const void* buffer, ssize_t length, int fileDescriptor =
+						      UNINITIALIZED_FILE_DESCRIPTOR);
+	IPCOperationReport writeBytesNonBlocking(const void* data, ssize_t length, int fileDescriptor =
+							 UNINITIALIZED_FILE_DESCRIPTOR);
+
+	/**
+	 * Writes the content of all the given buffers, using as few system calls as possible. The iovec array is modified.
+	 */
+	IPCOperationReport writeVectorBlocking(struct iovec* vectors, size_t vectorCount);
+
+	/**
+	 * Writes the content of all the given buffers with a single call, without blocking. The bytes which can not be written
+	 * are enqueued. If an owner is given and zero-copy is enabled, the kernel sends the buffers without copying them, and the
+	 * owner is kept until the kernel has notified that it does not use them anymore. The buffers must not be modified
+	 * until then.
+	 */
+	IPCOperationReport writeVectorNonBlocking(const struct iovec* vectors, size_t vectorCount,
+						  std::shared_ptr<const void> zeroCopyOwner = nullptr);
+
+	/**
+	 * Writes the given packets, using as few system calls as possible. Only relevant in packet mode.
+	 */
+	IPCOperationReport writePacketsBlocking(struct mmsghdr* packets, size_t packetCount);
 	IPCOperationReport readAvailableData(void* buffer, size_t bytesCount, size_t& readBytes);
 
 	virtual std::string toString() const = 0;
 
-	void enqueueData(const void* data, size_t length) {
+	/**
+	 * Appends some data to the outgoing buffer. If a file descriptor is provided, a copy of it is kept, which is sent together
+	 * with the first byte of the data.
+	 */
+	void enqueueData(const void* data, size_t length, int fileDescriptor = UNINITIALIZED_FILE_DESCRIPTOR) {
 		//		if (length == 4) log_verbose( "Appended data to outgoing buffer : %s", byteArrayToString(data, length).c_str() );
 
+		if (fileDescriptor != UNINITIALIZED_FILE_DESCRIPTOR) {
+			PendingFileDescriptor pendingFileDescriptor;
+			pendingFileDescriptor.m_position = m_dataToBeSent.size();
+			pendingFileDescriptor.m_fileDescriptor = dup(fileDescriptor);
+			m_pendingFileDescriptors.push_back(pendingFileDescriptor);
+		}
+
 		m_dataToBeSent.append(data, length);
+		if (m_isPacketMode)
+			m_pendingPacketEnds.push_back( m_dataToBeSent.size() );
 		onCongestionDetected();
 	}
 
+	/**
+	 * Sends the given bytes with the file descriptor attached as ancillary data
+	 */
+	ssize_t sendWithFileDescriptor(const void* data, size_t length, int fileDescriptor, int flags) {
+		struct iovec iov;
+		iov.iov_base = const_cast<void*>(data);
+		iov.iov_len = length;
+
+		char controlBuffer[CMSG_SPACE( sizeof(int) )];
+		memset( controlBuffer, 0, sizeof(controlBuffer) );
+
+		struct msghdr msg = {};
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = controlBuffer;
+		msg.msg_controllen = sizeof(controlBuffer);
+
+		struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN( sizeof(fileDescriptor) );
+		memcpy( CMSG_DATA(cmsg), &fileDescriptor, sizeof(fileDescriptor) );
+
+		return sendmsg(getFileDescriptor(), &msg, flags);
+	}
+
 	bool isCongested() const {
-		return (m_dataToBeSent.size() != 0);
+		return (m_dataToBeSent.size() != 0) || (m_relay != nullptr);
 	}
 
 private:
@@ -172,9 +383,44 @@ private:
 			log_verbose() << "Received " << m_receivedBytesCount << " bytes from " << toString().c_str();
 	}
 
+	void releaseZeroCopyBuffers(uint32_t firstSequenceNumber, uint32_t lastSequenceNumber);
+
+	void notifyRelayDisconnection() {
+		if (m_relay != nullptr) {
+			auto relay = m_relay;
+			m_relay = nullptr;
+			relay->onDestinationDisconnected();
+		}
+	}
+
+	struct PendingFileDescriptor {
+		/// Position of the byte in m_dataToBeSent to which the file descriptor is attached
+		size_t m_position;
+		int m_fileDescriptor;
+	};
+
 	//	const char* uds_socket_path;
 	int m_connectionFileDescriptor = UNINITIALIZED_FILE_DESCRIPTOR;
 	ByteArray m_dataToBeSent;
+	std::vector<PendingFileDescriptor> m_pendingFileDescriptors;
+
+	bool m_isPacketMode = false;
+
+	/// In packet mode, end position of each packet contained in m_dataToBeSent
+	std::vector<size_t> m_pendingPacketEnds;
+
+	struct PendingZeroCopyBuffer {
+		/// Number of the zero-copy send call, as counted by the kernel
+		uint32_t m_sequenceNumber;
+		std::shared_ptr<const void> m_owner;
+	};
+
+	/// Relay currently writing to the socket, if any
+	SpliceRelay* m_relay = nullptr;
+
+	bool m_isZeroCopyEnabled = false;
+	uint32_t m_nextZeroCopySequenceNumber = 0;
+	std::deque<PendingZeroCopyBuffer> m_pendingZeroCopyBuffers;
 
 	size_t m_writtenBytesCount = 0;
 	size_t m_receivedBytesCount = 0;
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <new>
+#include <memory>
+#include <utility>
+#include <string>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace SomeIP_Lib {
+
+/**
+ * A monotonic memory arena. The memory is allocated from blocks of increasing size, and is only released at once, when
+ * release() is called or when the arena is destroyed. This is typically used to decode a message into containers whose
+ * storage is released as soon as the message has been processed:
+ *
+ * MessageArena arena;
+ * ArenaVector<ArenaString> strings( (ArenaAllocator<ArenaString>(arena)) );
+ * inputStream >> strings;
+ */
+class MessageArena {
+
+public:
+	static const size_t DEFAULT_BLOCK_SIZE = 4096;
+
+	MessageArena(size_t initialBlockSize = DEFAULT_BLOCK_SIZE) : m_nextBlockSize(initialBlockSize) {
+	}
+
+	/**
+	 * Creates an arena which uses the given buffer first, before allocating any block from the heap. The buffer is typically
+	 * allocated on the stack.
+	 */
+	MessageArena(void* buffer, size_t size, size_t initialBlockSize = DEFAULT_BLOCK_SIZE) :
+		m_current( static_cast<unsigned char*>(buffer) ), m_end(m_current + size), m_nextBlockSize(initialBlockSize) {
+	}
+
+	~MessageArena() {
+		release();
+	}
+
+	MessageArena(const MessageArena&) = delete;
+	MessageArena& operator=(const MessageArena&) = delete;
+
+	void* allocate(size_t size, size_t alignment) {
+		unsigned char* p = align(m_current, alignment);
+
+		if ( (p == nullptr) || (p + size > m_end) ) {
+			allocateBlock(size + alignment);
+			p = align(m_current, alignment);
+		}
+
+		m_current = p + size;
+		m_allocatedBytes += size;
+		return p;
+	}
+
+	/**
+	 * Releases all the blocks allocated by the arena. The memory which has been returned by allocate() must not be used anymore.
+	 */
+	void release() {
+		while (m_blocks != nullptr) {
+			Block* next = m_blocks->m_next;
+			::operator delete(m_blocks);
+			m_blocks = next;
+		}
+		m_current = m_end = nullptr;
+		m_allocatedBytes = 0;
+	}
+
+	/**
+	 * Returns the number of bytes allocated since the arena has been created or released
+	 */
+	size_t getAllocatedBytes() const {
+		return m_allocatedBytes;
+	}
+
+private:
+	struct Block {
+		Block* m_next;
+	};
+
+	static unsigned char* align(unsigned char* p, size_t alignment) {
+		if (p == nullptr)
+			return nullptr;
+		uintptr_t value = reinterpret_cast<uintptr_t>(p);
+		return p + ( (alignment - value % alignment) % alignment );
+	}
+
+	void allocateBlock(size_t minimumSize) {
+		// the blocks grow geometrically, so that the number of allocations stays low for large messages
+		while (m_nextBlockSize < minimumSize)
+			m_nextBlockSize *= 2;
+
+		Block* block = static_cast<Block*>( ::operator new(sizeof(Block) + m_nextBlockSize) );
+		block->m_next = m_blocks;
+		m_blocks = block;
+
+		m_current = reinterpret_cast<unsigned char*>(block + 1);
+		m_end = m_current + m_nextBlockSize;
+		m_nextBlockSize *= 2;
+	}
+
+	unsigned char* m_current = nullptr;
+	unsigned char* m_end = nullptr;
+	size_t m_nextBlockSize;
+	Block* m_blocks = nullptr;
+	size_t m_allocatedBytes = 0;
+
+};
+
+/**
+ * A standard allocator which takes its memory from a MessageArena. Deallocation is a no-op.
+ */
+template<typename T>
+class ArenaAllocator {
+
+public:
+	typedef T value_type;
+	typedef T* pointer;
+	typedef const T* const_pointer;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef size_t size_type;
+	typedef ptrdiff_t difference_type;
+
+	template<typename U>
+	struct rebind {
+		typedef ArenaAllocator<U> other;
+	};
+
+	ArenaAllocator(MessageArena& arena) : m_arena(&arena) {
+	}
+
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) : m_arena( other.getArena() ) {
+	}
+
+	T* allocate(size_t n, const void* = nullptr) {
+		return static_cast<T*>( m_arena->allocate( n * sizeof(T), alignof(T) ) );
+	}
+
+	void deallocate(T*, size_t) {
+	}
+
+	template<typename U, typename ... Args>
+	void construct(U* p, Args && ... args) {
+		new (p) U(std::forward<Args>(args) ...);
+	}
+
+	template<typename U>
+	void destroy(U* p) {
+		p->~U();
+	}
+
+	size_t max_size() const {
+		return static_cast<size_t>(-1) / sizeof(T);
+	}
+
+	MessageArena* getArena() const {
+		return m_arena;
+	}
+
+private:
+	MessageArena* m_arena;
+};
+
+template<typename T, typename U>
+inline bool operator==(const ArenaAllocator<T>& left, const ArenaAllocator<U>& right) {
+	return ( left.getArena() == right.getArena() );
+}
+
+template<typename T, typename U>
+inline bool operator!=(const ArenaAllocator<T>& left, const ArenaAllocator<U>& right) {
+	return !(left == right);
+}
+
+typedef std::basic_string<char, std::char_traits<char>, ArenaAllocator<char> > ArenaString;
+
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T> >;
+
+/**
+ * Creates a container element, passing it the allocator of its container if it can use it, so that nested containers also
+ * take their memory from the same arena.
+ */
+template<typename T, typename Allocator, bool usesAllocator = std::uses_allocator<T, Allocator>::value>
+struct ElementFactory {
+	static T create(const Allocator&) {
+		return T();
+	}
+};
+
+template<typename T, typename Allocator>
+struct ElementFactory<T, Allocator, true> {
+	static T create(const Allocator& allocator) {
+		return T( typename T::allocator_type(allocator) );
+	}
+};
+
+}
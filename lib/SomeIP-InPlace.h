@@ -0,0 +1,340 @@
+#pragma once
+
+#include <assert.h>
+#include "SomeIP-Serialization.h"
+
+namespace SomeIP_Lib {
+
+/**
+ * In-place readable payload format, for large structured messages of which the receivers typically only need a few fields.
+ * The payload is made of tables, which start with an offset table, so that any field can be accessed directly in the
+ * received buffer, without decoding the rest of the message and without any allocation.
+ *
+ * Layout of a table, aligned on 4 bytes :
+ *   uint32_t fieldCount
+ *   uint32_t fieldOffsets[fieldCount]  : position of each field, relative to the table. 0 if the field is absent
+ *
+ * Layout of the fields :
+ *   scalar         : the value, aligned on its size
+ *   string         : uint32_t length, followed by the characters
+ *   scalar array   : uint32_t count, followed by the elements, aligned on their size
+ *   table          : the table itself
+ *   table array    : uint32_t count, followed by the uint32_t offsets of the tables, relative to the array
+ *
+ * All values are in network byte order, and the alignments are relative to the beginning of the root table.
+ */
+
+/**
+ * Writes a table to a SomeIPOutputStream. The fields can be written in any order.
+ */
+class InPlaceTableWriter {
+
+public:
+	/**
+	 * Starts a root table at the current position of the stream
+	 */
+	InPlaceTableWriter(SomeIPOutputStream& stream, size_t fieldCount) :
+		InPlaceTableWriter( stream, stream.getContent().size(), fieldCount ) {
+	}
+
+	template<typename T>
+	void writeScalar(size_t fieldIndex, T value) {
+		static_assert(std::is_arithmetic<T>::value, "Only arithmetic types are supported");
+		setFieldPosition( fieldIndex, align( sizeof(T) ) );
+		m_stream.writeArray(&value, 1);
+	}
+
+	void writeString(size_t fieldIndex, const char* s, size_t length) {
+		setFieldPosition( fieldIndex, align( sizeof(uint32_t) ) );
+		m_stream.writeValue( static_cast<uint32_t>(length) );
+		m_stream.writeRawData(s, length);
+	}
+
+	void writeString(size_t fieldIndex, const std::string& s) {
+		writeString( fieldIndex, s.data(), s.size() );
+	}
+
+	template<typename T>
+	void writeArray(size_t fieldIndex, const T* values, size_t count) {
+		static_assert(std::is_arithmetic<T>::value, "Only arithmetic types are supported");
+		setFieldPosition( fieldIndex, align( sizeof(uint32_t) ) );
+		m_stream.writeValue( static_cast<uint32_t>(count) );
+		align( sizeof(T) );
+		m_stream.writeArray(values, count);
+	}
+
+	template<typename T>
+	void writeArray(size_t fieldIndex, const std::vector<T>& values) {
+		writeArray( fieldIndex, values.data(), values.size() );
+	}
+
+	/**
+	 * Starts a nested table
+	 */
+	InPlaceTableWriter writeTable(size_t fieldIndex, size_t fieldCount) {
+		InPlaceTableWriter table(m_stream, m_rootPosition, fieldCount);
+		setFieldPosition(fieldIndex, table.m_tablePosition);
+		return table;
+	}
+
+	class ArrayWriter;
+
+	/**
+	 * Starts an array of nested tables. The tables are added with ArrayWriter::writeTable().
+	 */
+	ArrayWriter writeTableArray(size_t fieldIndex, size_t count);
+
+private:
+	InPlaceTableWriter(SomeIPOutputStream& stream, size_t rootPosition, size_t fieldCount) :
+		m_stream(stream), m_rootPosition(rootPosition), m_fieldCount(fieldCount) {
+		m_tablePosition = align( sizeof(uint32_t) );
+		m_stream.writeValue( static_cast<uint32_t>(fieldCount) );
+		// absent fields keep a null offset
+		m_stream.skip(fieldCount * sizeof(uint32_t) );
+	}
+
+	/**
+	 * Pads the stream so that the next value written is aligned, relative to the root table, and returns its position
+	 */
+	size_t align(size_t alignment) {
+		size_t relativePosition = m_stream.getContent().size() - m_rootPosition;
+		size_t paddingSize = (alignment - relativePosition % alignment) % alignment;
+		if (paddingSize != 0)
+			m_stream.skip(paddingSize);
+		return m_stream.getContent().size();
+	}
+
+	void setFieldPosition(size_t fieldIndex, size_t position) {
+		assert(fieldIndex < m_fieldCount);
+		m_stream.writeValueAt( static_cast<uint32_t>(position - m_tablePosition),
+				       m_tablePosition + sizeof(uint32_t) * (fieldIndex + 1) );
+	}
+
+	SomeIPOutputStream& m_stream;
+	size_t m_rootPosition;
+	size_t m_tablePosition;
+	size_t m_fieldCount;
+
+};
+
+class InPlaceTableWriter::ArrayWriter {
+
+public:
+	InPlaceTableWriter writeTable(size_t index, size_t fieldCount) {
+		assert(index < m_count);
+		InPlaceTableWriter table(m_parent.m_stream, m_parent.m_rootPosition, fieldCount);
+		m_parent.m_stream.writeValueAt( static_cast<uint32_t>(table.m_tablePosition - m_arrayPosition),
+						m_arrayPosition + sizeof(uint32_t) * (index + 1) );
+		return table;
+	}
+
+private:
+	ArrayWriter(InPlaceTableWriter& parent, size_t fieldIndex, size_t count) :
+		m_parent(parent), m_count(count) {
+		m_arrayPosition = parent.align( sizeof(uint32_t) );
+		parent.setFieldPosition(fieldIndex, m_arrayPosition);
+		parent.m_stream.writeValue( static_cast<uint32_t>(count) );
+		parent.m_stream.skip(count * sizeof(uint32_t) );
+	}
+
+	InPlaceTableWriter& m_parent;
+	size_t m_arrayPosition;
+	size_t m_count;
+
+	friend class InPlaceTableWriter;
+};
+
+inline InPlaceTableWriter::ArrayWriter InPlaceTableWriter::writeTableArray(size_t fieldIndex, size_t count) {
+	return ArrayWriter(*this, fieldIndex, count);
+}
+
+/**
+ * An array of scalars located in a received payload. The elements are converted to the native byte order when accessed.
+ */
+template<typename T>
+class InPlaceArray {
+
+public:
+	InPlaceArray() {
+	}
+
+	InPlaceArray(const uint8_t* data, size_t size) : m_data(data), m_size(size) {
+	}
+
+	size_t size() const {
+		return m_size;
+	}
+
+	bool empty() const {
+		return (m_size == 0);
+	}
+
+	T operator[](size_t index) const {
+		T value;
+		memcpy( &value, m_data + index * sizeof(T), sizeof(T) );
+		return NetworkToNativeOrder(value);
+	}
+
+	std::vector<T> toVector() const {
+		std::vector<T> values(m_size);
+		if (m_size != 0) {
+			memcpy( values.data(), m_data, m_size * sizeof(T) );
+			if ( !isNativeBigEndian() )
+				swapArrayBytes(values.data(), m_size);
+		}
+		return values;
+	}
+
+private:
+	const uint8_t* m_data = nullptr;
+	size_t m_size = 0;
+};
+
+/**
+ * Gives access to the fields of a table, directly in the received payload. The data is not trusted: any access to a field
+ * which is absent, or which does not fit in the payload, returns a default or empty value. The reader only references the
+ * payload, which must therefore outlive it.
+ */
+class InPlaceTableReader {
+
+	static const size_t INVALID_POSITION = static_cast<size_t>(-1);
+
+public:
+	InPlaceTableReader() {
+	}
+
+	/**
+	 * Creates a reader for the root table of the given payload
+	 */
+	InPlaceTableReader(const void* data, size_t length) :
+		InPlaceTableReader(static_cast<const uint8_t*>(data), length, 0) {
+	}
+
+	bool isValid() const {
+		return (m_data != nullptr);
+	}
+
+	size_t getFieldCount() const {
+		return m_fieldCount;
+	}
+
+	bool hasField(size_t fieldIndex) const {
+		return ( getFieldPosition(fieldIndex) != INVALID_POSITION );
+	}
+
+	template<typename T>
+	T getScalar(size_t fieldIndex, T defaultValue = T()) const {
+		static_assert(std::is_arithmetic<T>::value, "Only arithmetic types are supported");
+		T value;
+		if ( !load(getFieldPosition(fieldIndex), value) )
+			return defaultValue;
+		return value;
+	}
+
+	StringView getString(size_t fieldIndex) const {
+		auto position = getFieldPosition(fieldIndex);
+		uint32_t length;
+		if ( !load(position, length) || !contains(position + sizeof(length), length) )
+			return StringView();
+		return StringView(reinterpret_cast<const char*>(m_data + position + sizeof(length) ), length);
+	}
+
+	template<typename T>
+	InPlaceArray<T> getArray(size_t fieldIndex) const {
+		static_assert(std::is_arithmetic<T>::value, "Only arithmetic types are supported");
+		auto position = getFieldPosition(fieldIndex);
+		uint32_t count;
+		if ( !load(position, count) )
+			return InPlaceArray<T>();
+
+		size_t elementsPosition = align(position + sizeof(count), sizeof(T) );
+		if ( (elementsPosition > m_length) || ( count > (m_length - elementsPosition) / sizeof(T) ) )
+			return InPlaceArray<T>();
+
+		return InPlaceArray<T>(m_data + elementsPosition, count);
+	}
+
+	InPlaceTableReader getTable(size_t fieldIndex) const {
+		return InPlaceTableReader( m_data, m_length, getFieldPosition(fieldIndex) );
+	}
+
+	/**
+	 * Returns the number of tables contained in the given table array field
+	 */
+	size_t getTableCount(size_t fieldIndex) const {
+		auto position = getFieldPosition(fieldIndex);
+		uint32_t count;
+		if ( !load(position, count) || ( count > (m_length - position) / sizeof(uint32_t) - 1 ) )
+			return 0;
+		return count;
+	}
+
+	/**
+	 * Returns a table of the given table array field
+	 */
+	InPlaceTableReader getTable(size_t fieldIndex, size_t index) const {
+		if ( index >= getTableCount(fieldIndex) )
+			return InPlaceTableReader();
+
+		auto arrayPosition = getFieldPosition(fieldIndex);
+		uint32_t offset;
+		load(arrayPosition + sizeof(uint32_t) * (index + 1), offset);
+		if (offset == 0)
+			return InPlaceTableReader();
+		return InPlaceTableReader(m_data, m_length, arrayPosition + offset);
+	}
+
+private:
+	InPlaceTableReader(const uint8_t* data, size_t length, size_t tablePosition) {
+		uint32_t fieldCount;
+		if ( (tablePosition % sizeof(uint32_t) == 0) && load(tablePosition, fieldCount, data, length)
+		     && ( fieldCount <= (length - tablePosition) / sizeof(uint32_t) - 1 ) ) {
+			m_data = data;
+			m_length = length;
+			m_tablePosition = tablePosition;
+			m_fieldCount = fieldCount;
+		}
+	}
+
+	size_t getFieldPosition(size_t fieldIndex) const {
+		if (fieldIndex >= m_fieldCount)
+			return INVALID_POSITION;
+
+		uint32_t offset;
+		load(m_tablePosition + sizeof(uint32_t) * (fieldIndex + 1), offset);
+		// a field is always located after the offset table of its table
+		if ( (offset == 0) || (offset > m_length - m_tablePosition) )
+			return INVALID_POSITION;
+		return m_tablePosition + offset;
+	}
+
+	bool contains(size_t position, size_t length) const {
+		return (position <= m_length) && (length <= m_length - position);
+	}
+
+	template<typename T>
+	static bool load(size_t position, T& value, const uint8_t* data, size_t length) {
+		if ( (position > length) || (sizeof(T) > length - position) )
+			return false;
+		memcpy( &value, data + position, sizeof(T) );
+		value = NetworkToNativeOrder(value);
+		return true;
+	}
+
+	template<typename T>
+	bool load(size_t position, T& value) const {
+		return load(position, value, m_data, m_length);
+	}
+
+	static size_t align(size_t position, size_t alignment) {
+		return position + (alignment - position % alignment) % alignment;
+	}
+
+	const uint8_t* m_data = nullptr;
+	size_t m_length = 0;
+	size_t m_tablePosition = 0;
+	size_t m_fieldCount = 0;
+
+};
+
+}
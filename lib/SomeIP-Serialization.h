@@ -2,6 +2,10 @@
 
 #include "SomeIP-common.h"
 #include "utilLib/serialization.h"
+#include "SomeIP-Arena.h"
+
+#include <tuple>
+#include <algorithm>
 
 namespace SomeIP_Lib {
 
@@ -15,6 +19,98 @@ inline bool isAlignmentNeeded() {
 	return false;
 }
 
+/**
+ * A non-owning reference to a sequence of characters, which is typically located in the payload of a received message.
+ */
+class StringView {
+public:
+	StringView() {
+	}
+
+	StringView(const char* data, size_t size) : m_data(data), m_size(size) {
+	}
+
+	const char* data() const {
+		return m_data;
+	}
+
+	size_t size() const {
+		return m_size;
+	}
+
+	bool empty() const {
+		return (m_size == 0);
+	}
+
+	const char* begin() const {
+		return m_data;
+	}
+
+	const char* end() const {
+		return m_data + m_size;
+	}
+
+	char operator[](size_t index) const {
+		return m_data[index];
+	}
+
+	std::string toString() const {
+		return std::string(m_data, m_size);
+	}
+
+	bool operator==(const StringView& right) const {
+		return (m_size == right.m_size) && (memcmp(m_data, right.m_data, m_size) == 0);
+	}
+
+	bool operator==(const std::string& right) const {
+		return ( *this == StringView( right.data(), right.size() ) );
+	}
+
+private:
+	const char* m_data = nullptr;
+	size_t m_size = 0;
+};
+
+/**
+ * A non-owning reference to a block of bytes
+ */
+class ByteView {
+public:
+	ByteView() {
+	}
+
+	ByteView(const uint8_t* data, size_t size) : m_data(data), m_size(size) {
+	}
+
+	const uint8_t* data() const {
+		return m_data;
+	}
+
+	size_t size() const {
+		return m_size;
+	}
+
+	bool empty() const {
+		return (m_size == 0);
+	}
+
+	const uint8_t* begin() const {
+		return m_data;
+	}
+
+	const uint8_t* end() const {
+		return m_data + m_size;
+	}
+
+	uint8_t operator[](size_t index) const {
+		return m_data[index];
+	}
+
+private:
+	const uint8_t* m_data = nullptr;
+	size_t m_size = 0;
+};
+
 typedef SomeIP_utils::Serializer<true, false> SomeIPSerializer;
 typedef SomeIP_utils::Deserializer<true, false> SomeIPDeserializer;
 
@@ -55,8 +151,37 @@ private:
 protected:
 };
 
+/**
+ * Declares the fields of a structure, in the order in which they are serialized. The stream operators of the structure are
+ * then generated. Example:
+ * struct Position {
+ *     int32_t x;
+ *     int32_t y;
+ *     SOMEIP_FIELDS(x, y)
+ * };
+ */
+#define SOMEIP_FIELDS(...) \
+	auto someIPFields()->decltype( std::tie(__VA_ARGS__) ) { \
+		return std::tie(__VA_ARGS__); \
+	} \
+	auto someIPFields() const->decltype( std::tie(__VA_ARGS__) ) { \
+		return std::tie(__VA_ARGS__); \
+	}
+
+/**
+ * True if the fields of the type have been declared with SOMEIP_FIELDS()
+ */
+template<typename T, typename = void>
+struct HasSomeIPFields : std::false_type {
+};
+
+template<typename T>
+struct HasSomeIPFields<T, decltype(std::declval<const T &>().someIPFields(), void())> : std::true_type {
+};
+
 template<typename T>
-SomeIPOutputStream& operator<<(SomeIPOutputStream& stream, const T& v) {
+typename std::enable_if<!HasSomeIPFields<T>::value, SomeIPOutputStream&>::type
+operator<<(SomeIPOutputStream& stream, const T& v) {
 	stream.writeValue(v);
 	return stream;
 }
@@ -81,8 +206,31 @@ inline SomeIPOutputStream& operator<<(SomeIPOutputStream& stream, const std::str
 	return stream;
 }
 
+template<typename Allocator>
+SomeIPOutputStream& operator<<(SomeIPOutputStream& stream,
+			       const std::basic_string<char, std::char_traits<char>, Allocator>& stringValue) {
+	uint32_t stringLength = stringValue.size();
+	stream.writeValue(stringLength);
+	stream.writeRawData(stringValue.data(), stringLength);
+
+	return stream;
+}
+
+/**
+ * True for the types whose vectors can be serialized as a single block
+ */
 template<typename T>
-SomeIPOutputStream& operator<<(SomeIPOutputStream& stream, const std::vector<T>& v) {
+struct IsBulkSerializable {
+	static const bool value = std::is_arithmetic<T>::value && !std::is_same<T, bool>::value;
+};
+
+template<typename T>
+void reserveSerializedSize(SomeIPOutputStream& stream, const T& v);
+
+template<typename T, typename Allocator>
+typename std::enable_if<!IsBulkSerializable<T>::value, SomeIPOutputStream&>::type
+operator<<(SomeIPOutputStream& stream, const std::vector<T, Allocator>& v) {
+	reserveSerializedSize(stream, v);
 	uint32_t size = v.size();
 	stream.writeValue(size);
 	for (auto& element : v) {
@@ -92,6 +240,15 @@ SomeIPOutputStream& operator<<(SomeIPOutputStream& stream, const std::vector<T>&
 	return stream;
 }
 
+template<typename T, typename Allocator>
+typename std::enable_if<IsBulkSerializable<T>::value, SomeIPOutputStream&>::type
+operator<<(SomeIPOutputStream& stream, const std::vector<T, Allocator>& v) {
+	uint32_t size = v.size();
+	stream.writeValue(size);
+	stream.writeArray( v.data(), v.size() );
+	return stream;
+}
+
 template<typename KeyType, typename ValueType>
 SomeIPOutputStream& operator<<(SomeIPOutputStream& stream, const std::pair<KeyType, ValueType>& v) {
 	stream << v.first;
@@ -99,8 +256,9 @@ SomeIPOutputStream& operator<<(SomeIPOutputStream& stream, const std::pair<KeyTy
 	return stream;
 }
 
-template<typename KeyType, typename ValueType, typename Hasher>
-SomeIPOutputStream& operator<<(SomeIPOutputStream& stream, const std::unordered_map<KeyType, ValueType, Hasher>& v) {
+template<typename KeyType, typename ValueType, typename Hasher, typename KeyEqual, typename Allocator>
+SomeIPOutputStream& operator<<(SomeIPOutputStream& stream,
+			       const std::unordered_map<KeyType, ValueType, Hasher, KeyEqual, Allocator>& v) {
 	uint32_t size = v.size();
 	stream.writeValue(size);
 	for (auto& element : v) {
@@ -122,47 +280,158 @@ public:
 	}
 
 	bool hasError() const {
-		return false;
+		return m_error;
 	}
 
+	/**
+	 * Returns true if the given number of bytes can be read. Otherwise, the stream is put in error state, and the remaining
+	 * data is ignored.
+	 */
+	bool checkAvailableBytes(size_t length) {
+		if ( !m_error && (remainingBytesCount() < length) ) {
+			log_warning() << "Not enough data in the stream. Remaining : " << remainingBytesCount() << ", expected : " << length;
+			m_error = true;
+			currentDataPosition_ = m_length;
+		}
+		return !m_error;
+	}
+
+	/**
+	 * Reads a length-prefixed string without copying it. The view points into the content of the stream, so it is only
+	 * valid as long as the message from which the stream has been created.
+	 */
+	void readView(StringView& view) {
+		ByteView bytes;
+		readView(bytes);
+		view = StringView( reinterpret_cast<const char*>( bytes.data() ), bytes.size() );
+	}
+
+	/**
+	 * Reads a length-prefixed byte sequence without copying it. Same lifetime as readView(StringView&).
+	 */
+	void readView(ByteView& view) {
+		uint32_t length;
+		view = ByteView();
+		if ( !checkAvailableBytes( sizeof(length) ) )
+			return;
+		readValue(length);
+		view = readRawView(length);
+	}
+
+	/**
+	 * Returns a view on the next bytes of the stream, without copying them.
+	 */
+	ByteView readRawView(size_t length) {
+		if ( !checkAvailableBytes(length) )
+			return ByteView();
+		return ByteView(readRawData(length), length);
+	}
+
+private:
+	bool m_error = false;
+
 };
 
 template<typename T>
-SomeIPInputStream& operator>>(SomeIPInputStream& stream, T& v) {
+typename std::enable_if<!HasSomeIPFields<T>::value, SomeIPInputStream&>::type
+operator>>(SomeIPInputStream& stream, T& v) {
 	stream.readValue(v);
 	return stream;
 }
 
-inline SomeIPInputStream& operator>>(SomeIPInputStream& stream, std::string& stringValue) {
+inline SomeIPInputStream& operator>>(SomeIPInputStream& stream, StringView& v) {
+	stream.readView(v);
+	return stream;
+}
+
+inline SomeIPInputStream& operator>>(SomeIPInputStream& stream, ByteView& v) {
+	stream.readView(v);
+	return stream;
+}
+
+inline SomeIPOutputStream& operator<<(SomeIPOutputStream& stream, const StringView& v) {
+	uint32_t length = v.size();
+	stream.writeValue(length);
+	stream.writeRawData( v.data(), v.size() );
+	return stream;
+}
+
+inline SomeIPOutputStream& operator<<(SomeIPOutputStream& stream, const ByteView& v) {
+	uint32_t length = v.size();
+	stream.writeValue(length);
+	stream.writeRawData( v.data(), v.size() );
+	return stream;
+}
+
+/**
+ * The string readers, as well as the container readers below, support any allocator. The nested containers get their
+ * allocator from their parent, so that a whole message can be decoded into a single MessageArena.
+ */
+template<typename Allocator>
+SomeIPInputStream& operator>>(SomeIPInputStream& stream, std::basic_string<char, std::char_traits<char>, Allocator>& stringValue) {
 	uint32_t stringLength;
+	if ( !stream.checkAvailableBytes( sizeof(stringLength) ) )
+		return stream;
 	stream.readValue(stringLength);
+	if ( !stream.checkAvailableBytes(stringLength) )
+		return stream;
 	stringValue.resize(stringLength);
 	stream.readRawData(&(stringValue[0]), stringLength);
 
 	return stream;
 }
 
-template<typename T> SomeIPInputStream& operator>>(SomeIPInputStream& stream, std::vector<T>& v) {
+template<typename T, typename Allocator>
+typename std::enable_if<!IsBulkSerializable<T>::value, SomeIPInputStream&>::type
+operator>>(SomeIPInputStream& stream, std::vector<T, Allocator>& v) {
 	uint32_t size;
+	if ( !stream.checkAvailableBytes( sizeof(size) ) )
+		return stream;
 	stream.readValue(size);
-	for (size_t i = 0; i < size; i++) {
-		T element;
+
+	// each element takes at least one byte, which bounds the space we can reserve
+	v.reserve( v.size() + std::min<size_t>( size, stream.remainingBytesCount() ) );
+
+	for (size_t i = 0; (i < size) && !stream.hasError(); i++) {
+		T element = ElementFactory<T, Allocator>::create( v.get_allocator() );
 		stream >> element;
-		v.push_back(element);
+		v.push_back( std::move(element) );
 	}
 	return stream;
 }
 
-template<typename KeyType, typename ValueType, typename Hasher>
-SomeIPInputStream& operator>>(SomeIPInputStream& stream, std::unordered_map<KeyType, ValueType, Hasher>& v) {
+template<typename T, typename Allocator>
+typename std::enable_if<IsBulkSerializable<T>::value, SomeIPInputStream&>::type
+operator>>(SomeIPInputStream& stream, std::vector<T, Allocator>& v) {
 	uint32_t size;
+	if ( !stream.checkAvailableBytes( sizeof(size) ) )
+		return stream;
 	stream.readValue(size);
-	for (size_t i = 0; i < size; i++) {
-		KeyType key;
-		ValueType value;
+	if ( !stream.checkAvailableBytes( size * sizeof(T) ) )
+		return stream;
+	auto previousSize = v.size();
+	v.resize(previousSize + size);
+	stream.readArray(v.data() + previousSize, size);
+	return stream;
+}
+
+template<typename KeyType, typename ValueType, typename Hasher, typename KeyEqual, typename Allocator>
+SomeIPInputStream& operator>>(SomeIPInputStream& stream, std::unordered_map<KeyType, ValueType, Hasher, KeyEqual, Allocator>& v) {
+	uint32_t size;
+	if ( !stream.checkAvailableBytes( sizeof(size) ) )
+		return stream;
+	stream.readValue(size);
+	for (size_t i = 0; (i < size) && !stream.hasError(); i++) {
+		KeyType key = ElementFactory<KeyType, Allocator>::create( v.get_allocator() );
+		ValueType value = ElementFactory<ValueType, Allocator>::create( v.get_allocator() );
 		stream >> key;
 		stream >> value;
-		v[key] = value;
+
+		auto existingEntry = v.find(key);
+		if ( existingEntry != v.end() )
+			existingEntry->second = std::move(value);
+		else
+			v.emplace( std::move(key), std::move(value) );
 	}
 	return stream;
 }
@@ -217,4 +486,284 @@ struct SomeIPVariantDeserializer<Variant, _Type, _Types ...> {
 
 };
 
+/**
+ * Computes the number of bytes needed to serialize a value. The result is 0 for the types which are unknown.
+ */
+template<typename T, typename = void>
+struct SerializedSize {
+	/// true if all the values of that type have the same serialized size
+	static const bool isFixed = false;
+	static const size_t fixedSize = 0;
+
+	/// true if the type is an arithmetic type, whose serialized form is its memory representation after byte-swapping, and
+	/// which can be read with a memory copy (which excludes bool, for which only 0 and 1 are valid representations)
+	static const bool isScalar = false;
+
+	static size_t get(const T&) {
+		return 0;
+	}
+};
+
+template<typename T>
+struct SerializedSize<T, typename std::enable_if<std::is_arithmetic<T>::value>::type> {
+	static const bool isFixed = true;
+	static const size_t fixedSize = sizeof(T);
+	static const bool isScalar = !std::is_same<T, bool>::value;
+
+	static size_t get(const T&) {
+		return sizeof(T);
+	}
+};
+
+template<typename Allocator>
+struct SerializedSize<std::basic_string<char, std::char_traits<char>, Allocator> > {
+	static const bool isFixed = false;
+	static const size_t fixedSize = 0;
+	static const bool isScalar = false;
+
+	static size_t get(const std::basic_string<char, std::char_traits<char>, Allocator>& v) {
+		return sizeof(uint32_t) + v.size();
+	}
+};
+
+template<typename T, typename Allocator>
+struct SerializedSize<std::vector<T, Allocator> > {
+	static const bool isFixed = false;
+	static const size_t fixedSize = 0;
+	static const bool isScalar = false;
+
+	static size_t get(const std::vector<T, Allocator>& v) {
+		if (SerializedSize<T>::isFixed)
+			return sizeof(uint32_t) + v.size() * SerializedSize<T>::fixedSize;
+
+		size_t size = sizeof(uint32_t);
+		for (auto& element : v)
+			size += SerializedSize<T>::get(element);
+		return size;
+	}
+};
+
+/**
+ * Calls a function object for each element of a tuple
+ */
+template<size_t Index, size_t Count>
+struct TupleVisitor {
+	template<typename Tuple, typename Function>
+	static void visit(Tuple& tuple, Function& function) {
+		function( std::get<Index>(tuple) );
+		TupleVisitor<Index + 1, Count>::visit(tuple, function);
+	}
+};
+
+template<size_t Count>
+struct TupleVisitor<Count, Count> {
+	template<typename Tuple, typename Function>
+	static void visit(Tuple&, Function&) {
+	}
+};
+
+template<typename Tuple>
+struct TupleSerializedSize;
+
+template<>
+struct TupleSerializedSize<std::tuple<> > {
+	static const bool isFixed = true;
+	static const size_t fixedSize = 0;
+	static const bool isScalar = true;
+};
+
+template<typename Type, typename ... Types>
+struct TupleSerializedSize<std::tuple<Type, Types ...> > {
+	typedef SerializedSize<typename std::decay<Type>::type> FieldSize;
+	typedef TupleSerializedSize<std::tuple<Types ...> > OtherFieldsSize;
+
+	static const bool isFixed = FieldSize::isFixed && OtherFieldsSize::isFixed;
+	static const size_t fixedSize = FieldSize::fixedSize + OtherFieldsSize::fixedSize;
+
+	/// true if all the fields are scalars
+	static const bool isScalar = FieldSize::isScalar && OtherFieldsSize::isScalar;
+};
+
+/**
+ * Generated serialization code for the types declared with SOMEIP_FIELDS()
+ */
+template<typename T>
+class FieldSerializer {
+
+	typedef decltype( std::declval<const T &>().someIPFields() ) ConstFields;
+	typedef decltype( std::declval<T &>().someIPFields() ) Fields;
+	typedef TupleSerializedSize<ConstFields> FieldsSize;
+
+	static const size_t FIELD_COUNT = std::tuple_size<ConstFields>::value;
+
+	struct SizeComputer {
+		template<typename FieldType>
+		void operator()(const FieldType& field) {
+			m_size += SerializedSize<FieldType>::get(field);
+		}
+		size_t m_size;
+	};
+
+	struct FieldWriter {
+		template<typename FieldType>
+		void operator()(const FieldType& field) {
+			m_stream << field;
+		}
+		SomeIPOutputStream& m_stream;
+	};
+
+	struct FieldReader {
+		template<typename FieldType>
+		void operator()(FieldType& field) {
+			// the remaining fields are left untouched once the data is known to be truncated
+			if ( m_stream.hasError() )
+				return;
+
+			// the scalars have no bounds check of their own, which is done here when the whole structure was not checked
+			if ( m_checkScalars && ( std::is_arithmetic<FieldType>::value || std::is_enum<FieldType>::value ) &&
+			     !m_stream.checkAvailableBytes( sizeof(FieldType) ) )
+				return;
+
+			m_stream >> field;
+		}
+		SomeIPInputStream& m_stream;
+		bool m_checkScalars;
+	};
+
+	/**
+	 * Checks whether the fields are stored contiguously, in the declaration order
+	 */
+	struct LayoutChecker {
+		template<typename FieldType>
+		void operator()(const FieldType& field) {
+			m_matches = m_matches && (reinterpret_cast<const unsigned char*>(&field) == m_object + m_offset);
+			m_offset += sizeof(FieldType);
+		}
+		const unsigned char* m_object;
+		size_t m_offset;
+		bool m_matches;
+	};
+
+	/**
+	 * Converts the byte order of each field of a memory copy of the object
+	 */
+	struct FieldByteSwapper {
+		template<typename FieldType>
+		void operator()(const FieldType& field) {
+			auto offset = reinterpret_cast<const unsigned char*>(&field) - m_object;
+			SomeIP_utils::ByteSwapper<sizeof(FieldType)>::swap(m_copy + offset);
+		}
+		const unsigned char* m_object;
+		unsigned char* m_copy;
+	};
+
+	static bool checkMemoryLayout(const T& v) {
+		LayoutChecker checker = {reinterpret_cast<const unsigned char*>(&v), 0, true};
+		auto fields = v.someIPFields();
+		TupleVisitor<0, FIELD_COUNT>::visit(fields, checker);
+		return checker.m_matches;
+	}
+
+	static void swapFields(const T& v, unsigned char* copy) {
+		if ( !isNativeBigEndian() ) {
+			FieldByteSwapper swapper = {reinterpret_cast<const unsigned char*>(&v), copy};
+			auto fields = v.someIPFields();
+			TupleVisitor<0, FIELD_COUNT>::visit(fields, swapper);
+		}
+	}
+
+public:
+	static const bool isFixed = FieldsSize::isFixed;
+	static const size_t fixedSize = FieldsSize::fixedSize;
+
+	/**
+	 * Returns true if the serialized form of the type is its memory representation, with each field byte-swapped. This is
+	 * only the case for structures made of scalars, without padding.
+	 */
+	static bool hasWireMemoryLayout(const T& v) {
+		if ( !FieldsSize::isScalar || (sizeof(T) != FieldsSize::fixedSize) || !std::is_standard_layout<T>::value )
+			return false;
+
+		// the layout is the same for all the instances, so we only check it once
+		static const bool matches = checkMemoryLayout(v);
+		return matches;
+	}
+
+	static size_t getSerializedSize(const T& v) {
+		if (isFixed)
+			return fixedSize;
+
+		SizeComputer computer = {0};
+		auto fields = v.someIPFields();
+		TupleVisitor<0, FIELD_COUNT>::visit(fields, computer);
+		return computer.m_size;
+	}
+
+	static void write(SomeIPOutputStream& stream, const T& v) {
+		if ( hasWireMemoryLayout(v) ) {
+			// bulk copy, followed by the byte order conversion
+			auto& payload = stream.getContent();
+			size_t position = payload.size();
+			stream.writeRawData( &v, sizeof(T) );
+			swapFields( v, payload.getData() + position );
+		} else {
+			reserveSerializedSize(stream, v);
+			FieldWriter writer = {stream};
+			auto fields = v.someIPFields();
+			TupleVisitor<0, FIELD_COUNT>::visit(fields, writer);
+		}
+	}
+
+	static void read(SomeIPInputStream& stream, T& v) {
+		// a single bounds check is needed for the structures which have a fixed size. The fields of the other ones are checked
+		// one by one.
+		if ( isFixed && !stream.checkAvailableBytes(fixedSize) )
+			return;
+
+		if ( hasWireMemoryLayout(v) ) {
+			stream.readRawData( &v, sizeof(T) );
+			swapFields( v, reinterpret_cast<unsigned char*>(&v) );
+		} else {
+			FieldReader reader = {stream, !isFixed};
+			Fields fields = v.someIPFields();
+			TupleVisitor<0, FIELD_COUNT>::visit(fields, reader);
+		}
+	}
+
+};
+
+template<typename T>
+struct SerializedSize<T, typename std::enable_if<HasSomeIPFields<T>::value>::type> {
+	static const bool isFixed = FieldSerializer<T>::isFixed;
+	static const size_t fixedSize = FieldSerializer<T>::fixedSize;
+	static const bool isScalar = false;
+
+	static size_t get(const T& v) {
+		return FieldSerializer<T>::getSerializedSize(v);
+	}
+};
+
+/**
+ * Makes sure that the stream's buffer is large enough to contain the given value, so that it gets allocated only once
+ */
+template<typename T>
+void reserveSerializedSize(SomeIPOutputStream& stream, const T& v) {
+	auto& payload = stream.getContent();
+	payload.reserve( payload.size() + SerializedSize<T>::get(v) );
+}
+
+template<typename T>
+typename std::enable_if<HasSomeIPFields<T>::value, SomeIPOutputStream&>::type
+operator<<(SomeIPOutputStream& stream, const T& v) {
+	FieldSerializer<T>::write(stream, v);
+	return stream;
+}
+
+template<typename T>
+typename std::enable_if<HasSomeIPFields<T>::value, SomeIPInputStream&>::type
+operator>>(SomeIPInputStream& stream, T& v) {
+	FieldSerializer<T>::read(stream, v);
+	return stream;
+}
+
 }
@@ -83,7 +83,17 @@ static const MemberID PING_MEMBER_ID = 0xFF12;
 static const ServiceID DISPATCHER_SERVICE_ID = 0xFFFE;
 
 enum ReturnCode : uint8_t {
-	E_OK
+	E_OK = 0x00,
+	E_NOT_OK = 0x01,
+	E_UNKNOWN_SERVICE = 0x02,
+	E_UNKNOWN_METHOD = 0x03,
+	E_NOT_READY = 0x04,
+	E_NOT_REACHABLE = 0x05,
+	E_TIMEOUT = 0x06,
+	E_WRONG_PROTOCOL_VERSION = 0x07,
+	E_WRONG_INTERFACE_VERSION = 0x08,
+	E_MALFORMED_MESSAGE = 0x09,
+	E_WRONG_MESSAGE_TYPE = 0x0A
 };
 
 inline ServiceID getServiceID(MessageID messageID) {
@@ -156,6 +166,14 @@ public:
 		return getMessageType() == MessageType::ERROR;
 	}
 
+	ReturnCode getReturnCode() const {
+		return m_returnCode;
+	}
+
+	void setReturnCode(ReturnCode returnCode) {
+		m_returnCode = returnCode;
+	}
+
 	void setMessageID(MessageID messageID) {
 		m_messageID = messageID;
 	}
@@ -238,6 +256,114 @@ public:
 
 static constexpr size_t SOMEIP_HEADER_LENGTH_ON_NETWORK = sizeof(SomeIPHeader) + sizeof(uint32_t);
 
+/**
+ * Encodes and decodes the 16 bytes SOME/IP header in one pass, using a packed structure matching the wire layout, instead of
+ * going through the generic serializers field by field.
+ */
+class SomeIPHeaderCodec {
+
+public:
+	/// Number of header bytes following the length field, which are covered by the length
+	static constexpr size_t LENGTH_COVERED_HEADER_SIZE = 8;
+
+	struct WireHeader {
+		uint32_t m_messageID;
+		uint32_t m_length;
+		uint32_t m_requestID;
+		uint8_t m_protocolVersion;
+		uint8_t m_interfaceVersion;
+		uint8_t m_messageType;
+		uint8_t m_returnCode;
+	} __attribute__( (packed) );
+
+	static_assert(sizeof(WireHeader) == SOMEIP_HEADER_LENGTH_ON_NETWORK, "Invalid wire header layout");
+
+	/**
+	 * Writes the header of a message with the given payload length to the buffer, which must be at least
+	 * SOMEIP_HEADER_LENGTH_ON_NETWORK bytes long.
+	 */
+	static void encode(const SomeIPHeader& header, size_t payloadLength, void* buffer) {
+		WireHeader wireHeader;
+		wireHeader.m_messageID = SomeIP_utils::NativeToNetworkOrder(header.m_messageID);
+		wireHeader.m_length = SomeIP_utils::NativeToNetworkOrder( static_cast<uint32_t>(payloadLength + LENGTH_COVERED_HEADER_SIZE) );
+		wireHeader.m_requestID = SomeIP_utils::NativeToNetworkOrder(header.m_requestID);
+		wireHeader.m_protocolVersion = header.m_protocolVersion;
+		wireHeader.m_interfaceVersion = header.m_interfaceVersion;
+		wireHeader.m_messageType = static_cast<uint8_t>(header.m_messageType);
+		wireHeader.m_returnCode = static_cast<uint8_t>(header.m_returnCode);
+		memcpy( buffer, &wireHeader, sizeof(wireHeader) );
+	}
+
+	/**
+	 * Reads the header from the given buffer, which must contain at least SOMEIP_HEADER_LENGTH_ON_NETWORK bytes.
+	 * @return false if the length field is too small to cover the rest of the header
+	 */
+	static bool decode(const void* buffer, SomeIPHeader& header, size_t& payloadLength) {
+		WireHeader wireHeader;
+		memcpy( &wireHeader, buffer, sizeof(wireHeader) );
+		header.m_messageID = SomeIP_utils::NetworkToNativeOrder(wireHeader.m_messageID);
+		header.m_requestID = SomeIP_utils::NetworkToNativeOrder(wireHeader.m_requestID);
+		header.m_protocolVersion = wireHeader.m_protocolVersion;
+		header.m_interfaceVersion = wireHeader.m_interfaceVersion;
+		header.m_messageType = static_cast<MessageType>(wireHeader.m_messageType);
+		header.m_returnCode = static_cast<ReturnCode>(wireHeader.m_returnCode);
+
+		uint32_t length = SomeIP_utils::NetworkToNativeOrder(wireHeader.m_length);
+		if (length < LENGTH_COVERED_HEADER_SIZE)
+			return false;
+		payloadLength = length - LENGTH_COVERED_HEADER_SIZE;
+		return true;
+	}
+
+};
+
+/**
+ * Encodes and decodes the 4 bytes header which starts the payload of a segment, when a message too large for a datagram is
+ * split by SOME/IP-TP. The segments are flagged in the message type of their SOME/IP header.
+ */
+class SomeIPTPHeaderCodec {
+
+public:
+	static constexpr size_t SIZE = 4;
+
+	/// Bit of the message type set in the header of every segment
+	static constexpr uint8_t TP_FLAG = 0x20;
+
+	/// Unit of the offsets, so that the length of every segment but the last one is a multiple of it
+	static constexpr size_t OFFSET_UNIT = 16;
+
+	/// Bit of the TP header set in every segment but the last one
+	static constexpr uint32_t MORE_SEGMENTS_FLAG = 0x1;
+
+	static bool isSegment(const SomeIPHeader& header) {
+		return ( ( static_cast<uint8_t>( header.getMessageType() ) & TP_FLAG ) != 0 );
+	}
+
+	static void setSegmentFlag(SomeIPHeader& header, bool isSegment) {
+		auto messageType = static_cast<uint8_t>( header.getMessageType() );
+		messageType = isSegment ? (messageType | TP_FLAG) : ( messageType & ~TP_FLAG );
+		header.setMessageType( static_cast<MessageType>(messageType) );
+	}
+
+	/**
+	 * Writes the TP header of the segment starting at the given offset, which must be a multiple of OFFSET_UNIT
+	 */
+	static void encode(size_t offset, bool hasMoreSegments, void* buffer) {
+		uint32_t value = static_cast<uint32_t>(offset) | (hasMoreSegments ? MORE_SEGMENTS_FLAG : 0);
+		value = SomeIP_utils::NativeToNetworkOrder(value);
+		memcpy( buffer, &value, sizeof(value) );
+	}
+
+	static void decode(const void* buffer, size_t& offset, bool& hasMoreSegments) {
+		uint32_t value;
+		memcpy( &value, buffer, sizeof(value) );
+		value = SomeIP_utils::NetworkToNativeOrder(value);
+		offset = value & ~static_cast<uint32_t>(OFFSET_UNIT - 1);
+		hasMoreSegments = ( (value & MORE_SEGMENTS_FLAG) != 0 );
+	}
+
+};
+
 class SomeIPService {
 public:
 	SomeIPService(ServiceIDs serviceID) :
@@ -334,24 +460,11 @@ enum class TransportProtocol
 
 namespace std {
 
-  template <>
-  struct hash<SomeIP::ServiceIDs>
-  {
-    std::size_t operator()(const SomeIP::ServiceIDs& k) const
-    {
-    	return 0;
-//      using std::size_t;
-//      using std::hash;
-//      using std::string;
-//
-//      // Compute individual hash values for first,
-//      // second and third and combine them using XOR
-//      // and bit shifting:
-//
-//      return ((hash<string>()(k.first)
-//               ^ (hash<string>()(k.second) << 1)) >> 1)
-//               ^ (hash<int>()(k.third) << 1);
-    }
-  };
+template<>
+struct hash<SomeIP::ServiceIDs> {
+	size_t operator()(const SomeIP::ServiceIDs& serviceIDs) const {
+		return (static_cast<size_t>(serviceIDs.serviceID) << 16) | serviceIDs.instanceID;
+	}
+};
 
 }
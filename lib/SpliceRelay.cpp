@@ -0,0 +1,195 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <algorithm>
+
+#include "SpliceRelay.h"
+#include "SocketStreamConnection.h"
+
+namespace SomeIP_Lib {
+
+/**
+ * Switches a socket to non-blocking mode for the lifetime of the object. SPLICE_F_NONBLOCK only applies to the pipe, so a
+ * splice() from or to a blocking socket could block the main loop.
+ */
+class NonBlockingScope {
+public:
+	NonBlockingScope(int fd) : m_fd(fd) {
+		m_flags = fcntl(fd, F_GETFL);
+		if ( (m_flags != -1) && !(m_flags & O_NONBLOCK) )
+			fcntl(fd, F_SETFL, m_flags | O_NONBLOCK);
+	}
+
+	~NonBlockingScope() {
+		if ( (m_flags != -1) && !(m_flags & O_NONBLOCK) )
+			fcntl(m_fd, F_SETFL, m_flags);
+	}
+
+private:
+	int m_fd;
+	int m_flags;
+};
+
+SpliceRelay::~SpliceRelay() {
+	cancel();
+	if (m_pipe[0] != -1) {
+		close(m_pipe[0]);
+		close(m_pipe[1]);
+	}
+}
+
+SomeIPReturnCode SpliceRelay::init() {
+
+	if (m_pipe[0] != -1)
+		return SomeIPReturnCode::OK;
+
+	if (pipe2(m_pipe, O_CLOEXEC | O_NONBLOCK) != 0) {
+		log_error() << "Can't create relay pipe. Error : " << strerror(errno);
+		m_pipe[0] = m_pipe[1] = -1;
+		return SomeIPReturnCode::ERROR;
+	}
+
+	// a larger pipe reduces the number of calls per message. The size might be limited by /proc/sys/fs/pipe-max-size
+	int pipeSize = fcntl(m_pipe[1], F_SETPIPE_SZ, static_cast<int>(PIPE_SIZE) );
+	if (pipeSize < 0)
+		pipeSize = fcntl(m_pipe[1], F_GETPIPE_SZ);
+	m_pipeSize = pipeSize;
+
+	return SomeIPReturnCode::OK;
+}
+
+bool SpliceRelay::start(SocketStreamConnection& destination, const void* header, size_t headerLength, size_t payloadLength) {
+
+	assert(!m_isActive);
+	assert(m_pipe[0] != -1);
+
+	if ( !destination.attachRelay(*this) )
+		return false;
+
+	m_destination = &destination;
+	m_header.resize(0);
+	m_header.append(header, headerLength);
+	m_writtenHeaderBytes = 0;
+	m_remainingPayloadBytes = payloadLength;
+	m_hasWrittenBytes = false;
+	m_isActive = true;
+
+	return true;
+}
+
+int SpliceRelay::getDestinationFileDescriptor() const {
+	return (m_destination != nullptr) ? m_destination->getFileDescriptor() : -1;
+}
+
+SpliceRelay::Status SpliceRelay::transfer(int sourceFileDescriptor) {
+
+	assert(m_isActive);
+
+	NonBlockingScope sourceScope(sourceFileDescriptor);
+
+	while (true) {
+
+		if (m_destination != nullptr) {
+
+			NonBlockingScope destinationScope( m_destination->getFileDescriptor() );
+			ssize_t n = 0;
+
+			if ( m_writtenHeaderBytes < m_header.size() )
+				n = send(m_destination->getFileDescriptor(), m_header.getData() + m_writtenHeaderBytes,
+					 m_header.size() - m_writtenHeaderBytes, MSG_DONTWAIT | MSG_NOSIGNAL);
+			else if (m_bytesInPipe != 0)
+				n = splice(m_pipe[0], nullptr, m_destination->getFileDescriptor(), nullptr, m_bytesInPipe,
+					   SPLICE_F_MOVE | SPLICE_F_NONBLOCK | ( (m_remainingPayloadBytes != 0) ? SPLICE_F_MORE : 0 ) );
+
+			if (n < 0) {
+				if (errno == EAGAIN)
+					return Status::WAITING_FOR_DESTINATION;
+				log_warning() << "Can't relay message. Error : " << strerror(errno);
+				m_destination->disconnect();        // calls onDestinationDisconnected()
+				continue;
+			}
+
+			if (n > 0)
+				m_hasWrittenBytes = true;
+
+			if ( m_writtenHeaderBytes < m_header.size() ) {
+				m_writtenHeaderBytes += n;
+				continue;
+			}
+
+			m_bytesInPipe -= n;
+
+		} else if (m_bytesInPipe != 0) {
+			// the destination is gone : the bytes are dropped
+			char buffer[4096];
+			ssize_t n = read( m_pipe[0], buffer, std::min( sizeof(buffer), m_bytesInPipe ) );
+			if (n > 0)
+				m_bytesInPipe -= n;
+		}
+
+		if (m_bytesInPipe != 0)
+			continue;
+
+		if (m_remainingPayloadBytes == 0) {
+			finish();
+			return Status::COMPLETE;
+		}
+
+		// only the bytes which are already available are requested, so that the call never waits for more bytes
+		int availableBytes = 0;
+		ioctl(sourceFileDescriptor, FIONREAD, &availableBytes);
+		if (availableBytes <= 0)
+			return Status::WAITING_FOR_SOURCE;
+
+		size_t length = std::min( std::min(m_remainingPayloadBytes, m_pipeSize), static_cast<size_t>(availableBytes) );
+		ssize_t n = splice(sourceFileDescriptor, nullptr, m_pipe[1], nullptr, length, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+		if (n < 0) {
+			if (errno == EAGAIN)
+				return Status::WAITING_FOR_SOURCE;
+			return Status::SOURCE_ERROR;
+		}
+		if (n == 0)
+			return Status::SOURCE_ERROR;
+
+		m_remainingPayloadBytes -= n;
+		m_bytesInPipe += n;
+	}
+}
+
+void SpliceRelay::cancel() {
+
+	if (!m_isActive)
+		return;
+
+	if ( (m_destination != nullptr) && m_hasWrittenBytes ) {
+		log_error() << "Message relay interrupted, disconnecting the destination";
+		m_destination->disconnect();
+	}
+
+	// drop what remains in the pipe, which is non-blocking
+	char buffer[4096];
+	while (read( m_pipe[0], buffer, sizeof(buffer) ) > 0)
+		;
+	m_bytesInPipe = 0;
+
+	finish();
+}
+
+void SpliceRelay::onDestinationDisconnected() {
+	m_destination = nullptr;
+	if (m_destinationDisconnectionHandler)
+		m_destinationDisconnectionHandler();
+}
+
+void SpliceRelay::finish() {
+	if (m_destination != nullptr) {
+		auto destination = m_destination;
+		m_destination = nullptr;
+		destination->detachRelay();
+	}
+	m_isActive = false;
+}
+
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <functional>
+
+#include "SomeIP-common.h"
+
+namespace SomeIP_Lib {
+
+class SocketStreamConnection;
+
+/**
+ * Moves the payload of a message from a socket to another one through a pipe with splice(), so that the payload is never
+ * copied to user space. Used by the dispatcher to forward a large message whose header has already been read from the source
+ * socket. The destination connection is reserved during the transfer : the data written to it in the meantime is queued, and
+ * sent once the relay is finished.
+ */
+class SpliceRelay {
+
+	LOG_DECLARE_CLASS_CONTEXT("SpRe", "SpliceRelay");
+
+public:
+	enum class Status {
+		/// The whole message has been relayed
+		COMPLETE,
+		/// More bytes have to be received from the source
+		WAITING_FOR_SOURCE,
+		/// The destination does not accept more bytes for now
+		WAITING_FOR_DESTINATION,
+		/// The source has been disconnected before the end of the payload
+		SOURCE_ERROR
+	};
+
+	/// Requested capacity of the pipe, which is the maximum amount of data moved with a single call
+	static const size_t PIPE_SIZE = 256 * 1024;
+
+	SpliceRelay() {
+	}
+
+	~SpliceRelay();
+
+	SpliceRelay(const SpliceRelay&) = delete;
+	SpliceRelay& operator=(const SpliceRelay&) = delete;
+
+	/**
+	 * Creates the pipe through which the payloads are moved, if not done yet
+	 */
+	SomeIPReturnCode init();
+
+	/**
+	 * Starts relaying a message to the given destination. The given header is written first, followed by payloadLength bytes
+	 * read from the source.
+	 * @return false if the destination can not be reserved, because it is congested or already used by another relay
+	 */
+	bool start(SocketStreamConnection& destination, const void* header, size_t headerLength, size_t payloadLength);
+
+	bool isActive() const {
+		return m_isActive;
+	}
+
+	/**
+	 * Moves as many bytes as possible from the source to the destination, without blocking. Called when the source is readable,
+	 * or when the destination is writable.
+	 */
+	Status transfer(int sourceFileDescriptor);
+
+	/**
+	 * Returns the file descriptor of the destination, which has to be watched when WAITING_FOR_DESTINATION is returned, or
+	 * -1 if there is no destination anymore
+	 */
+	int getDestinationFileDescriptor() const;
+
+	/**
+	 * Stops the relay before the end of the message. The destination is disconnected if a part of the message has been written
+	 * to it already, since the rest of its stream could not be decoded.
+	 */
+	void cancel();
+
+	/**
+	 * Called by the destination when it gets disconnected. The rest of the payload is then read and dropped.
+	 */
+	void onDestinationDisconnected();
+
+	/**
+	 * Sets the function called when the destination gets disconnected during a relay
+	 */
+	void setDestinationDisconnectionHandler(std::function<void()> handler) {
+		m_destinationDisconnectionHandler = handler;
+	}
+
+private:
+	void finish();
+
+	int m_pipe[2] = {-1, -1};
+	size_t m_pipeSize = 0;
+
+	SocketStreamConnection* m_destination = nullptr;
+	std::function<void()> m_destinationDisconnectionHandler;
+
+	ByteArray m_header;
+	size_t m_writtenHeaderBytes = 0;
+
+	/// Number of payload bytes which have not been read from the source yet
+	size_t m_remainingPayloadBytes = 0;
+
+	/// Number of payload bytes which are in the pipe
+	size_t m_bytesInPipe = 0;
+
+	bool m_isActive = false;
+
+	/// True if some bytes have been written to the destination
+	bool m_hasWrittenBytes = false;
+
+};
+
+}
@@ -11,26 +11,82 @@ WatchStatus TCPClient::processIncomingData(int fileDescriptor, std::function<voi
 	if( isInputBlocked() )
 		return WatchStatus::STOP_WATCHING;
 
+	DispatchCycle dispatchCycle( getDispatcher() );
+
 	bool bKeepProcessing = true;
 
 	do {
 
-		if ( !m_headerReader.isComplete() ) {
+		if ( m_relay.isActive() ) {
+
+			// the payload of the current message is moved to its destination
+			switch ( m_relay.transfer(fileDescriptor) ) {
+			case SpliceRelay::Status::COMPLETE :
+				break;
+			case SpliceRelay::Status::WAITING_FOR_SOURCE :
+				bKeepProcessing = false;
+				break;
+			case SpliceRelay::Status::WAITING_FOR_DESTINATION :
+				waitForRelayDestination();
+				return WatchStatus::KEEP_WATCHING;
+			case SpliceRelay::Status::SOURCE_ERROR :
+				disconnect();
+				return WatchStatus::STOP_WATCHING;
+			}
+
+		} else if (m_discardedPayloadBytes != 0) {
+
+			// the payload of a message which is too large is read and dropped
+			char buffer[16 * 1024];
+			ssize_t n = recv(fileDescriptor, buffer, std::min( sizeof(buffer), m_discardedPayloadBytes ), MSG_DONTWAIT);
+			if (n < 0) {
+				if (errno != EAGAIN) {
+					disconnect();
+					return WatchStatus::STOP_WATCHING;
+				}
+				bKeepProcessing = false;
+			} else if (n == 0)
+				bKeepProcessing = false;
+			else
+				m_discardedPayloadBytes -= n;
+
+		} else if ( !m_headerReader.isComplete() ) {
 
 			m_headerReader.read(fileDescriptor, false);
 			if ( m_headerReader.isComplete() ) {
-				NetworkDeserializer deserializer( m_headerBytes, sizeof(m_headerBytes) );
-				SomeIP::SomeIPHeader& header = m_currentIncomingMessage.getHeaderPrivate();
-				uint32_t messageLength;
-				deserializer >> header.m_messageID >> messageLength >> header.m_requestID >>
-				header.m_protocolVersion
-				>> header.m_interfaceVersion;
-				deserializer.readEnum(header.m_messageType);
-				deserializer.readEnum(header.m_returnCode);
-
-				m_currentIncomingMessage.setPayloadSize(
-					messageLength - SomeIP::SOMEIP_HEADER_LENGTH_ON_NETWORK + sizeof(SomeIP::MessageID)
-					+ sizeof(messageLength) );
+				size_t payloadLength;
+				if ( !SomeIPHeaderCodec::decode(m_headerBytes, m_currentIncomingMessage.getHeaderPrivate(), payloadLength) ) {
+					log_error() << "Invalid message length received from " << toString();
+					disconnect();
+					return WatchStatus::STOP_WATCHING;
+				}
+
+				auto& header = m_currentIncomingMessage.getHeader();
+				if ( header.isReply() ) {
+					// This is the answer to a request => extract the client identifier from the requestID
+					ClientIdentifier clientIdentifier = extractClientIdentifier(header);
+					m_currentIncomingMessage.setClientIdentifier(clientIdentifier);
+					tagClientIdentifier(m_currentIncomingMessage.getHeaderPrivate(), 0); // remove the client identifier from the requestID
+				}
+
+				auto maximumMessageSize = m_tcpManager.getMaximumMessageSize();
+				bool isTooLarge = (maximumMessageSize != 0) && (payloadLength > maximumMessageSize);
+
+				// a message which is too large to be buffered can still be relayed, since its payload is never stored
+				if ( tryRelay(payloadLength, isTooLarge) ) {
+					m_headerReader.clear();
+					continue;
+				}
+
+				if (isTooLarge) {
+					log_error() << "Dropping message ID:" << header.getMessageID() << " from " << toString() << ". Payload length " <<
+						payloadLength << " exceeds the maximum of " << maximumMessageSize << " bytes";
+					m_discardedPayloadBytes = payloadLength;
+					m_headerReader.clear();
+					continue;
+				}
+
+				m_currentIncomingMessage.setPayloadSize(payloadLength);
 
 				m_payloadReader.setBuffer( m_currentIncomingMessage.getWritablePayload(),
 							   m_currentIncomingMessage.getPayloadLength() );
@@ -50,18 +106,9 @@ WatchStatus TCPClient::processIncomingData(int fileDescriptor, std::function<voi
 					m_serviceDiscoveryDecoder.decodeMessage( m_currentIncomingMessage.getHeader(),
 										 m_currentIncomingMessage.getPayload(),
 										 m_currentIncomingMessage.getPayloadLength() );
-				} else {
-
-					if ( header.isReply() ) {
-						// This is the answer to a request => extract the client identifier from the requestID
-						ClientIdentifier clientIdentifier = extractClientIdentifier(header);
-						m_currentIncomingMessage.setClientIdentifier(clientIdentifier);
-						tagClientIdentifier(m_currentIncomingMessage.getHeaderPrivate(), 0); // remove the client identifier from the requestID
-					}
-
+				} else
 					handler(m_currentIncomingMessage);
 
-				}
 				m_headerReader.clear();
 				m_payloadReader.clear();
 			} else
@@ -74,6 +121,71 @@ WatchStatus TCPClient::processIncomingData(int fileDescriptor, std::function<voi
 	return WatchStatus::KEEP_WATCHING;
 }
 
+bool TCPClient::tryRelay(size_t payloadLength, bool isRequired) {
+
+	auto relayThreshold = m_tcpManager.getRelayThreshold();
+	if ( !isRequired && ( (relayThreshold == 0) || (payloadLength < relayThreshold) ) )
+		return false;
+
+	if (m_currentIncomingMessage.getHeader().getMessageID() == SomeIPServiceDiscoveryMessage::SERVICE_DISCOVERY_MEMBER_ID)
+		return false;
+
+	auto serviceID = m_currentIncomingMessage.getServiceID();
+	if (m_instanceNamespace.count(serviceID) != 1)
+		return false;
+	m_currentIncomingMessage.setInstanceID(m_instanceNamespace.at(serviceID)->getServiceIDs().instanceID);
+
+	if ( isError( m_relay.init() ) )
+		return false;
+
+	// only the header is dispatched
+	m_currentIncomingMessage.setPayloadSize(0);
+	return relayIncomingMessage(m_currentIncomingMessage, payloadLength, m_relay);
+}
+
+void TCPClient::waitForRelayDestination() {
+	m_inputDataWatcher->disable();
+
+	pollfd fd;
+	fd.fd = m_relay.getDestinationFileDescriptor();
+	fd.events = POLLOUT;
+	m_relayOutputWatcher = m_mainLoopContext.addFileDescriptorWatch([&] () {
+										onRelayDestinationWritable();
+									}, fd);
+	m_relayOutputWatcher->enable();
+}
+
+void TCPClient::onRelayDestinationWritable() {
+
+	auto status = m_relay.transfer( getFileDescriptor() );
+	if (status == SpliceRelay::Status::WAITING_FOR_DESTINATION)
+		return;
+
+	m_relayOutputWatcher->disable();
+
+	if (status == SpliceRelay::Status::SOURCE_ERROR) {
+		disconnect();
+		return;
+	}
+
+	// the input watcher is level-triggered, so the rest of the stream is processed as soon as some bytes are available
+	m_inputDataWatcher->enable();
+}
+
+bool TCPClient::beginRelay(const DispatcherMessage& msg, size_t payloadLength, SpliceRelay& relay) {
+
+	if ( !isConnected() )
+		return false;
+
+	SomeIP::SomeIPHeader header( msg.getHeader() );
+	if ( header.isRequestWithReturn() )
+		tagClientIdentifier( header, msg.getClientIdentifier() );
+
+	unsigned char headerBytes[SomeIP::SOMEIP_HEADER_LENGTH_ON_NETWORK];
+	SomeIPHeaderCodec::encode(header, payloadLength, headerBytes);
+	return relay.start( *this, headerBytes, sizeof(headerBytes), payloadLength );
+}
+
 void TCPClient::onRemoteServiceAvailable(const SomeIPServiceDiscoveryServiceEntry& serviceEntry,
 					 const IPv4ConfigurationOption* address,
 					 const SomeIPServiceDiscoveryMessage& message) {
@@ -147,30 +259,59 @@ SomeIPReturnCode TCPClient::sendMessage(const DispatcherMessage& msg) {
 		// If this is a request, we use the requestID to identify the client which is sending the request, in order to dispatch the answer to it
 		SomeIP::SomeIPHeader requestHeader(header);
 		tagClientIdentifier( requestHeader, msg.getClientIdentifier() );
-		sendMessage( requestHeader, msg.getPayload(), msg.getPayloadLength() );
+		sendMessage( requestHeader, msg.getPayload(), msg.getPayloadLength(), msg.getSharedPayloadMapping() );
 	} else
-		sendMessage( header, msg.getPayload(), msg.getPayloadLength() );
+		sendMessage( header, msg.getPayload(), msg.getPayloadLength(), msg.getSharedPayloadMapping() );
 
 	// TODO : return correct code
 	return SomeIPReturnCode::OK;
 }
 
-IPCOperationReport TCPClient::sendMessage(const SomeIP::SomeIPHeader& header, const void* payload, size_t payloadLength) {
+/**
+ * Keeps the buffers of a message sent with MSG_ZEROCOPY, until the kernel does not use them anymore
+ */
+struct ZeroCopyMessage {
+	unsigned char m_header[SomeIP::SOMEIP_HEADER_LENGTH_ON_NETWORK];
+	std::shared_ptr<const SharedPayload> m_payload;
+};
+
+IPCOperationReport TCPClient::sendMessage(const SomeIP::SomeIPHeader& header, const void* payload, size_t payloadLength,
+					  std::shared_ptr<const SharedPayload> sharedPayload) {
+
+	struct iovec vectors[2];
+	vectors[1].iov_base = const_cast<void*>(payload);
+	vectors[1].iov_len = payloadLength;
+
+	// only a shared payload can be sent without copy, since it is read-only and its mapping can be kept alive until the
+	// completion is received
+	if ( (sharedPayload != nullptr) && isZeroCopyEnabled() && (payloadLength >= m_tcpManager.getZeroCopyThreshold()) ) {
+		auto message = std::make_shared<ZeroCopyMessage>();
+		SomeIPHeaderCodec::encode(header, payloadLength, message->m_header);
+		message->m_payload = std::move(sharedPayload);
+		vectors[0].iov_base = message->m_header;
+		vectors[0].iov_len = sizeof(message->m_header);
+		return writeVectorNonBlocking(vectors, 2, message);
+	}
 
-	ByteArray headerBytes;
-	NetworkSerializer serializer(headerBytes);
+	unsigned char headerBytes[SomeIP::SOMEIP_HEADER_LENGTH_ON_NETWORK];
+	SomeIPHeaderCodec::encode(header, payloadLength, headerBytes);
+	vectors[0].iov_base = headerBytes;
+	vectors[0].iov_len = sizeof(headerBytes);
+	return writeVectorNonBlocking(vectors, 2);
+}
 
-	{
-		serializer << header.m_messageID;
-		LengthPlaceHolder<uint32_t, NetworkSerializer> lengthPlaceHolder(serializer);
-		serializer << header.m_requestID << header.m_protocolVersion << header.m_interfaceVersion;
-		serializer.writeEnum(header.m_messageType);
-		serializer.writeEnum(header.m_returnCode);
-		serializer.writeRawData(payload, payloadLength); // TODO : for big messages, send the content directly without making a copy
-	}
+void TCPClient::initZeroCopy() {
+
+	if ( (m_tcpManager.getZeroCopyThreshold() == 0) || !enableZeroCopy() )
+		return;
 
-	auto v = writeBytesNonBlocking( headerBytes.getData(), headerBytes.size() );
-	return v;
+	pollfd fd;
+	fd.fd = getFileDescriptor();
+	fd.events = POLLERR;
+	m_zeroCopyCompletionWatcher = m_mainLoopContext.addFileDescriptorWatch([&] () {
+										       processZeroCopyCompletions();
+									       }, fd);
+	m_zeroCopyCompletionWatcher->enable();
 }
 
 void TCPClient::onNotificationSubscribed(Service& service, SomeIP::MemberID memberID) {
@@ -81,6 +81,10 @@ public:
 		// TODO : implement
 	}
 
+	void onRemoteSubscriptionAcknowledged(const SomeIPServiceDiscoveryEventGroupEntry& serviceEntry,
+					      const IPv4ConfigurationOption* multicastAddress) override {
+	}
+
 	void onRemoteServiceAvailable(const SomeIPServiceDiscoveryServiceEntry& serviceEntry,
 				      const IPv4ConfigurationOption* address,
 				      const SomeIPServiceDiscoveryMessage& message) override;
@@ -125,7 +129,8 @@ public:
 			fd.fd = getFileDescriptor();
 			fd.events = POLLOUT;
 			m_outputDataWatcher = m_mainLoopContext.addFileDescriptorWatch([&] () {
-										 return onWritingPossible();
+										 if (onWritingPossible() == WatchStatus::STOP_WATCHING)
+											 m_outputDataWatcher->disable();
 									 }, fd);
 		}
 
@@ -139,10 +144,28 @@ public:
 			m_disconnectionWatcher->enable();
 		}
 
+		m_relay.setDestinationDisconnectionHandler([&] () {
+								   // the rest of the payload is read and dropped
+								   if (m_relayOutputWatcher) {
+									   m_relayOutputWatcher->disable();
+									   m_inputDataWatcher->enable();
+								   }
+							   });
+
+		initZeroCopy();
 	}
 
+	/**
+	 * Enables the zero-copy transmissions if a threshold is configured, and watches the error queue of the socket, where the
+	 * kernel notifies the completion of those transmissions
+	 */
+	void initZeroCopy();
+
 	void onServiceAvailable(ServiceIDs serviceID) {
+		// the service is already known, from a previous announcement or through another transport
 		Service* service = registerService(serviceID, false);
+		if (service == nullptr)
+			return;
 		assert( (m_instanceNamespace.count(serviceID.serviceID) == 0) ||
 				( m_instanceNamespace.at(serviceID.serviceID)->getServiceIDs().instanceID == serviceID.instanceID));
 		m_instanceNamespace[serviceID.serviceID] = service;
@@ -161,6 +184,11 @@ public:
 		m_inputDataWatcher->disable();
 		m_outputDataWatcher->disable();
 		m_disconnectionWatcher->disable();
+		if (m_zeroCopyCompletionWatcher)
+			m_zeroCopyCompletionWatcher->disable();
+		if (m_relayOutputWatcher)
+			m_relayOutputWatcher->disable();
+		m_relay.cancel();
 	}
 
 	static void enableNoDelay(int fd) {
@@ -170,19 +198,10 @@ public:
 			log_error() << "Can't enable TCP_NODELAY on the socket. Error : " << strerror(errno);
 	}
 
-	void tagClientIdentifier(SomeIP::SomeIPHeader& header, ClientIdentifier clientIdentifier) const {
-		SomeIP::RequestID requestID = clientIdentifier;
-		requestID <<= 16;
-		requestID += (header.getRequestID() & 0xFFFF);
-		header.setRequestID(requestID);
-	}
-
-	ClientIdentifier extractClientIdentifier(const SomeIP::SomeIPHeader& header) const {
-		return header.getRequestID() >> 16;
-	}
-
 	SomeIPReturnCode sendMessage(const DispatcherMessage& msg) override;
 
+	bool beginRelay(const DispatcherMessage& msg, size_t payloadLength, SpliceRelay& relay) override;
+
 	InputMessage sendMessageBlocking(const OutputMessage& msg) override {
 
 		InputMessage answer;
@@ -221,7 +240,12 @@ public:
 		return !isError(sendMessage( msg.getHeader(), msg.getPayload(), msg.getPayloadLength() )) ? SomeIPReturnCode::OK : SomeIPReturnCode::ERROR;
 	}
 
-	IPCOperationReport sendMessage(const SomeIP::SomeIPHeader& header, const void* payload, size_t payloadLength);
+	/**
+	 * Sends a message. The header and the payload are written with a single call, without being copied into an intermediate
+	 * buffer. If the payload is a shared payload mapping, it can be sent with MSG_ZEROCOPY.
+	 */
+	IPCOperationReport sendMessage(const SomeIP::SomeIPHeader& header, const void* payload, size_t payloadLength,
+				       std::shared_ptr<const SharedPayload> sharedPayload = nullptr);
 
 	void onNotificationSubscribed(Service& serviceID, SomeIP::MemberID memberID) override;
 
@@ -230,40 +254,24 @@ public:
 		log_info() << "Congestion " << toString();
 	}
 
-	class MyInputMessage : public DispatcherMessage {
-
-public:
-		MyInputMessage() :
-			InputMessage(m_ipcMessage) {
-			m_ipcMessage.getHeader().m_messageType = IPCMessageType::SEND_MESSAGE;
-		}
-
-		SomeIP::SomeIPHeader& getHeaderPrivate() {
-			return InputMessage::getHeaderPrivate();
-		}
-
-		void setPayloadSize(size_t size) {
-			auto s = size + m_ipcMessage.getHeaderSize() + getHeaderSize();
-			m_ipcMessage.getPayload().resize(s);
-		}
-
-		void clear() {
-		}
-
-		void* getWritablePayload() {
-			return const_cast<void*>( getPayload() );
-		}
-
-private:
-		IPCInputMessage m_ipcMessage;
-
-	};
-
 	/**
 	 * Called whenever some data is received from a client
 	 */
 	WatchStatus processIncomingData(int fileDescriptor, std::function<void(InputMessage&)> handler);
 
+	/**
+	 * Relays the message whose header has just been received, if it is large enough and has a single destination
+	 * @param isRequired true if the message can not be buffered, in which case the relay threshold is ignored
+	 */
+	bool tryRelay(size_t payloadLength, bool isRequired);
+
+	/**
+	 * Stops reading from the socket until the destination of the relayed message accepts more data
+	 */
+	void waitForRelayDestination();
+
+	void onRelayDestinationWritable();
+
 	WatchStatus onWritingPossible() {
 		return (writePendingDataNonBlocking() ==
 			IPCOperationReport::OK) ? WatchStatus::STOP_WATCHING : WatchStatus::KEEP_WATCHING;
@@ -280,7 +288,7 @@ private:
 
 private:
 
-	MyInputMessage m_currentIncomingMessage;
+	NetworkInputMessage m_currentIncomingMessage;
 
 	unsigned char m_headerBytes[SomeIP::SOMEIP_HEADER_LENGTH_ON_NETWORK];
 	IPCBufferReader m_headerReader;
@@ -294,6 +302,14 @@ private:
 	std::unique_ptr<WatchMainLoopHook> m_inputDataWatcher;
 	std::unique_ptr<WatchMainLoopHook> m_outputDataWatcher;
 	std::unique_ptr<WatchMainLoopHook> m_disconnectionWatcher;
+	std::unique_ptr<WatchMainLoopHook> m_zeroCopyCompletionWatcher;
+	std::unique_ptr<WatchMainLoopHook> m_relayOutputWatcher;
+
+	/// Moves the payload of the large messages to their destination. Declared after the watchers used by its handler.
+	SpliceRelay m_relay;
+
+	/// Number of payload bytes of a message exceeding the maximum size, which still have to be read and dropped
+	size_t m_discardedPayloadBytes = 0;
 
 	RebootInformation m_rebootInformationMulticast;
 	RebootInformation m_rebootInformationUnicast;
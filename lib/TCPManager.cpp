@@ -28,6 +28,10 @@ void TCPManager::onRemoteServiceAvailable(const SomeIPServiceDiscoveryServiceEnt
 					  const IPv4ConfigurationOption* address,
 					  const SomeIPServiceDiscoveryMessage& message) {
 
+	// the services offered over UDP are handled by the UDPManager
+	if (address->m_protocol != TransportProtocol::TCP)
+		return;
+
 	IPv4TCPEndPoint serverID(address->m_address, address->m_port);
 	ServiceIDs serviceIDs(serviceEntry.m_serviceID, serviceEntry.m_instanceID);
 
@@ -59,6 +63,10 @@ void TCPManager::onRemoteServiceUnavailable(const SomeIPServiceDiscoveryServiceE
 					    const IPv4ConfigurationOption* address,
 					    const SomeIPServiceDiscoveryMessage& message) {
 
+	// the services offered over UDP are handled by the UDPManager
+	if (address->m_protocol != TransportProtocol::TCP)
+		return;
+
 	IPv4TCPEndPoint serverID(address->m_address, address->m_port);
 	ServiceIDs serviceIDs(serviceEntry.m_serviceID, serviceEntry.m_instanceID);
 
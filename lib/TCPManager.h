@@ -86,6 +86,7 @@ public:
 
 		if (availableServer == nullptr) {
 			availableServer = new TCPServer(m_dispatcher, *this, m_basePort, m_mainLoopContext);
+			availableServer->setAcceptorCount(m_acceptorCount);
 			auto code = availableServer->init(m_portCount);
 			if (!isError(code))
 				m_servers.push_back(availableServer);
@@ -103,6 +104,54 @@ public:
 		return TCPServer::getAllIPAddresses();
 	}
 
+	/**
+	 * Sets the payload size from which the messages whose payload is in a shared memory file are sent to the remote clients
+	 * with MSG_ZEROCOPY. 0 disables the zero-copy transmissions.
+	 */
+	void setZeroCopyThreshold(size_t threshold) {
+		m_zeroCopyThreshold = threshold;
+	}
+
+	size_t getZeroCopyThreshold() const {
+		return m_zeroCopyThreshold;
+	}
+
+	/**
+	 * Sets the payload size from which the messages received from a remote client are relayed to their destination with
+	 * splice(), without reading their payload. 0 disables the relay.
+	 */
+	void setRelayThreshold(size_t threshold) {
+		m_relayThreshold = threshold;
+	}
+
+	size_t getRelayThreshold() const {
+		return m_relayThreshold;
+	}
+
+	/**
+	 * Sets the maximum payload length of the messages received from the remote clients. The payload of a larger message is
+	 * relayed to its destination if possible, or dropped otherwise, so that it never gets buffered. 0 means no limit.
+	 */
+	void setMaximumMessageSize(size_t maximumSize) {
+		m_maximumMessageSize = maximumSize;
+	}
+
+	size_t getMaximumMessageSize() const {
+		return m_maximumMessageSize;
+	}
+
+	/**
+	 * Sets the number of threads accepting the connections of each server, through sockets sharing its port with SO_REUSEPORT.
+	 * 1 means that the connections are accepted by the main loop.
+	 */
+	void setAcceptorCount(size_t count) {
+		m_acceptorCount = (count == 0) ? 1 : count;
+	}
+
+	size_t getAcceptorCount() const {
+		return m_acceptorCount;
+	}
+
 private:
 	std::vector<RemoteTCPClient*> m_clients;
 	Dispatcher& m_dispatcher;
@@ -110,6 +159,10 @@ private:
 	std::vector<TCPServer*> m_servers;
 	TCPPort m_basePort = -1;
 	int m_portCount = 10;
+	size_t m_zeroCopyThreshold = 0;
+	size_t m_relayThreshold = 0;
+	size_t m_maximumMessageSize = SocketStreamConnection::DEFAULT_MAXIMUM_MESSAGE_SIZE;
+	size_t m_acceptorCount = 1;
 
 };
 
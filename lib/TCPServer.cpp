@@ -49,64 +49,112 @@ std::vector<IPV4Address> TCPServer::getAllIPAddresses() {
 	return ipAddresses;
 }
 
-SomeIPReturnCode TCPServer::init(int portCount) {
-
-	m_dispatcher.addBlackListFilter(*this);
+int TCPServer::createBoundSocket(TCPPort port, bool reusePort) {
 
 	int tcpServerSocketHandle = 0;
 
 	if ( ( tcpServerSocketHandle = ::socket(AF_INET, SOCK_STREAM, 0) ) < 0 ) {
 		log_error() << "Failed to create socket";
-		return SomeIPReturnCode::ERROR;
+		return -1;
+	}
+
+	int opt = 1;
+	if ( reusePort && ( setsockopt(tcpServerSocketHandle, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(int)) == -1 ) ) {
+		log_error() << "Failed to setsockopt SO_REUSEPORT. Error : " << strerror(errno);
+		close(tcpServerSocketHandle);
+		return -1;
 	}
 
 	struct sockaddr_in sin;
 
 	sin.sin_family = AF_INET;
-	sin.sin_port = htons(m_port);
+	sin.sin_port = htons(port);
 	sin.sin_addr.s_addr = INADDR_ANY;
 
-	bool bindSuccessful = false;
+	if (::bind( tcpServerSocketHandle, (struct sockaddr*) &sin, sizeof(sin) ) != 0) {
+		log_warn() << "Failed to bind TCP server socket " << port << ". Error : " << strerror(errno);
+		close(tcpServerSocketHandle);
+		return -1;
+	}
+
+	if ( setsockopt(tcpServerSocketHandle, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(int)) == -1 )
+	{
+		log_error() << "Failed to setsockopt SO_REUSEADDR. Error : " << strerror(errno);
+	}
+
+	return tcpServerSocketHandle;
+}
 
-	// we try to find an available TCP port to listen to
+SomeIPReturnCode TCPServer::init(int portCount) {
+
+	m_dispatcher.addBlackListFilter(*this);
+
+	std::vector<int> listeningSockets;
+
+	auto closeListeningSockets = [&] () {
+		for (auto socketHandle : listeningSockets)
+			close(socketHandle);
+	};
+
+	// we try to find an available TCP port to listen to. With several acceptors, the first socket found is kept as the one
+	// of the first acceptor, so that the port is not released before the other acceptors share it. SO_REUSEPORT only keeps
+	// the processes of other users out : a process of the same user setting it as well can share the port with us
+	bool reusePort = (m_acceptorCount > 1);
 	for (int i = 0; i < portCount; i++) {
-		sin.sin_port = htons(m_port);
-		if (::bind( tcpServerSocketHandle, (struct sockaddr*) &sin, sizeof(sin) ) != 0) {
-			log_warn() << "Failed to bind TCP server socket " << m_port << ". Error : " << strerror(errno);
-			m_port++;
-		} else {
-			int opt = 1;
-			if ( setsockopt(tcpServerSocketHandle, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(int)) == -1 )
-			{
-				log_error() << "Failed to setsockopt SO_REUSEADDR. Error : " << strerror(errno);
-			}
-			bindSuccessful = true;
+		auto tcpServerSocketHandle = createBoundSocket(m_port, reusePort);
+		if (tcpServerSocketHandle != -1) {
+			listeningSockets.push_back(tcpServerSocketHandle);
 			break;
 		}
+		m_port++;
 	}
 
-	if (bindSuccessful) {
+	if ( listeningSockets.empty() ) {
+		log_error() << "Failed to find a free port in the range " << m_port - portCount << "-" << m_port - 1;
+		return SomeIPReturnCode::ERROR;
+	}
+
+	if (reusePort) {
+		for (size_t i = 1; i < m_acceptorCount; i++) {
+			auto tcpServerSocketHandle = createBoundSocket(m_port, true);
+			if (tcpServerSocketHandle == -1) {
+				closeListeningSockets();
+				return SomeIPReturnCode::ERROR;
+			}
+			listeningSockets.push_back(tcpServerSocketHandle);
+		}
+	}
+
+	for (auto tcpServerSocketHandle : listeningSockets) {
 		if (::listen(tcpServerSocketHandle, SOMAXCONN) != 0) {
 			log_error() << "Failed to listen to TCP port " << m_port << ". Error : " << strerror(errno);
+			closeListeningSockets();
 			return SomeIPReturnCode::ERROR;
 		}
+	}
 
-		setFileDescriptor(tcpServerSocketHandle);
-
-		log_info() << "TCP Server socket listening on port " << m_port;
-
-		for ( auto address : getAllIPAddresses() ) {
-			m_activePorts.push_back( IPv4TCPEndPoint(address, m_port) );
+	if (m_acceptorCount > 1) {
+		m_acceptorGroup.reset( new AcceptorGroup(m_mainContext, [this] (int fileDescriptor) {
+								 if (acceptConnections)
+									 createNewClientConnection(fileDescriptor);
+								 else
+									 close(fileDescriptor);
+							 }) );
+		if ( isError( m_acceptorGroup->start(listeningSockets) ) ) {
+			m_acceptorGroup.reset();
+			return SomeIPReturnCode::ERROR;
 		}
-
-		return SomeIPReturnCode::OK;
-	}
-	else {
-		log_error() << "Failed to find a free port in the range " << m_port << "-" << m_port + portCount - 1;
-		return SomeIPReturnCode::ERROR;
+		log_info() << "TCP Server sockets listening on port " << m_port << " with " << m_acceptorCount << " acceptors";
+	} else {
+		setFileDescriptor(listeningSockets[0]);
+		log_info() << "TCP Server socket listening on port " << m_port;
 	}
 
+	for ( auto address : getAllIPAddresses() ) {
+		m_activePorts.push_back( IPv4TCPEndPoint(address, m_port) );
+	}
 
+	return SomeIPReturnCode::OK;
 }
 
 
@@ -11,6 +11,7 @@
 #include "ipc.h"
 #include "Dispatcher.h"
 #include "SocketStreamConnection.h"
+#include "AcceptorGroup.h"
 #include "TCPClient.h"
 
 namespace SomeIP_Dispatcher {
@@ -66,6 +67,20 @@ public:
 
 	SomeIPReturnCode init(int portCount = 1);
 
+	/**
+	 * Sets the number of sockets listening to the port of the server, which must be called before init(). With more than one
+	 * acceptor, the sockets share the port with SO_REUSEPORT and each of them accepts its connections in its own thread. Any
+	 * other process of the same user setting SO_REUSEPORT can then bind the port as well, and receive part of the connections.
+	 */
+	void setAcceptorCount(size_t count) {
+		assert(count != 0);
+		m_acceptorCount = count;
+	}
+
+	size_t getAcceptorCount() const {
+		return m_acceptorCount;
+	}
+
 	const ServiceInstanceNamespace& getServiceInstanceNamespace() const {
 		return m_instanceNamespace;
 	}
@@ -87,12 +102,22 @@ public:
 	}
 
 private:
+	/**
+	 * Creates a TCP socket bound to the given port, which other sockets of the same user can also bind to if reusePort is true
+	 * @return the file descriptor of the socket, or -1
+	 */
+	int createBoundSocket(TCPPort port, bool reusePort);
+
 	std::vector<IPv4TCPEndPoint> m_activePorts;
 	Dispatcher& m_dispatcher;
 	TCPManager& m_tcpManager;
 	TCPPort m_port = -1;
 	MainLoopContext& m_mainContext;
 	ServiceInstanceNamespace m_instanceNamespace;
+	size_t m_acceptorCount = 1;
+
+	/// Acceptors of the connections when there are several of them, destroyed first since it calls createNewClientConnection()
+	std::unique_ptr<AcceptorGroup> m_acceptorGroup;
 
 };
 
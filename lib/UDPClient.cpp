@@ -0,0 +1,222 @@
+#include "UDPClient.h"
+#include "UDPEndPoint.h"
+#include "UDPManager.h"
+
+namespace SomeIP_Dispatcher {
+
+UDPClient::UDPClient(Dispatcher& dispatcher, UDPManager& udpManager, UDPEndPoint& endPoint,
+		     ServiceInstanceNamespace& instanceNamespace, const IPv4TCPEndPoint& peerAddress) :
+	Client(dispatcher), m_udpManager(udpManager), m_endPoint(endPoint), m_serviceDiscoveryDecoder(*this),
+	m_instanceNamespace(instanceNamespace), m_peerAddress(peerAddress),
+	m_segmentReassembler( NetworkInputMessage::getPayloadOffset() ) {
+	// the memory used to reassemble the messages of all the peers is bounded, whatever their number
+	m_segmentReassembler.setSharedBudget( udpManager.getReassemblyBudget() );
+}
+
+SomeIPReturnCode UDPClient::sendMessage(const DispatcherMessage& msg) {
+
+	log_traffic() << "Sending message to client " << toString() << ". Message: " << msg.toString();
+
+	const SomeIP::SomeIPHeader& header = msg.getHeader();
+
+	if ( header.isRequestWithReturn() ) {
+		// the requestID identifies the client which is sending the request, in order to dispatch the answer to it
+		SomeIP::SomeIPHeader requestHeader(header);
+		tagClientIdentifier( requestHeader, msg.getClientIdentifier() );
+		return m_endPoint.queueMessage( *this, requestHeader, msg.getPayload(), msg.getPayloadLength() );
+	}
+
+	return m_endPoint.queueMessage( *this, header, msg.getPayload(), msg.getPayloadLength() );
+}
+
+SomeIPReturnCode UDPClient::sendMessage(const OutputMessage& msg) {
+	log_traffic() << "Sending message to client " << toString() << " Message: " << msg.toString();
+	return m_endPoint.queueMessage( *this, msg.getHeader(), msg.getPayload(), msg.getPayloadLength() );
+}
+
+void UDPClient::flushDeferredMessages() {
+	m_endPoint.flush();
+}
+
+void UDPClient::onMessageReceived(const SomeIP::SomeIPHeader& header, const void* payload, size_t payloadLength) {
+
+	m_lastReceptionTime = SegmentReassembler::Clock::now();
+
+	if (header.getMessageID() == SomeIPServiceDiscoveryMessage::SERVICE_DISCOVERY_MEMBER_ID) {
+		m_serviceDiscoveryDecoder.decodeMessage(header, payload, payloadLength);
+		return;
+	}
+
+	if ( SomeIPTPHeaderCodec::isSegment(header) ) {
+		SomeIP::SomeIPHeader messageHeader;
+		ByteArray messageBuffer;
+		if ( m_segmentReassembler.addSegment(header, payload, payloadLength, messageHeader, messageBuffer) ) {
+			// the segments have been written at their place in the buffer, which becomes the one of the message
+			m_currentIncomingMessage.setBuffer( std::move(messageBuffer) );
+			dispatchIncomingMessage(messageHeader);
+		}
+		return;
+	}
+
+	m_currentIncomingMessage.setPayloadSize(payloadLength);
+	memcpy(m_currentIncomingMessage.getWritablePayload(), payload, payloadLength);
+	dispatchIncomingMessage(header);
+}
+
+void UDPClient::dispatchIncomingMessage(const SomeIP::SomeIPHeader& header) {
+
+	auto& message = m_currentIncomingMessage;
+	message.getHeaderPrivate() = header;
+
+	if ( header.isReply() ) {
+		// This is the answer to a request => extract the client identifier from the requestID
+		message.setClientIdentifier( extractClientIdentifier(header) );
+		tagClientIdentifier(message.getHeaderPrivate(), 0);
+	}
+
+	// a datagram can be sent by anyone, so that a message for an unknown service is not an error on our side
+	auto serviceID = message.getServiceID();
+	if (m_instanceNamespace.count(serviceID) != 1) {
+		log_warning() << "Message ID:" << header.getMessageID() << " from " << toString() << " ignored : unknown service";
+		return;
+	}
+
+	message.setInstanceID(m_instanceNamespace.at(serviceID)->getServiceIDs().instanceID);
+
+	processIncomingMessage(message);
+}
+
+void UDPClient::onServiceAvailable(ServiceIDs serviceID) {
+
+	// the service is already known, from a previous announcement or through another transport
+	Service* service = registerService(serviceID, false);
+	if (service == nullptr)
+		return;
+
+	m_instanceNamespace[serviceID.serviceID] = service;
+	log_debug() << m_instanceNamespace;
+}
+
+void UDPClient::onServiceUnavailable(ServiceIDs serviceID) {
+
+	if ( (m_instanceNamespace.count(serviceID.serviceID) == 0) ||
+	     (m_instanceNamespace.at(serviceID.serviceID)->getServiceIDs().instanceID != serviceID.instanceID) )
+		return;
+
+	unregisterService(serviceID);
+	m_instanceNamespace.erase(serviceID.serviceID);
+	log_debug() << m_instanceNamespace;
+}
+
+void UDPClient::onNotificationSubscribed(Service& service, SomeIP::MemberID memberID) {
+
+	const auto serviceID = service.getServiceIDs();
+
+	// the subscription is sent to the endpoint of the service, like the requests
+	SomeIPServiceDiscoveryMessage serviceDiscoveryMessage(true);
+	SomeIPServiceDiscoverySubscribeNotificationEntry subscribeEntry(serviceID, memberID);
+	serviceDiscoveryMessage.addEntry(subscribeEntry);
+	sendServiceDiscoveryMessage(serviceDiscoveryMessage);
+}
+
+void UDPClient::sendServiceDiscoveryMessage(const SomeIPServiceDiscoveryMessage& serviceDiscoveryMessage) {
+
+	ByteArray byteArray;
+	NetworkSerializer s(byteArray);
+	serviceDiscoveryMessage.serialize(s);
+
+	SomeIP::SomeIPHeader header;
+	size_t payloadLength;
+	if ( SomeIPHeaderCodec::decode(byteArray.getData(), header, payloadLength) )
+		m_endPoint.queueMessage(*this, header, byteArray.getData() + SomeIP::SOMEIP_HEADER_LENGTH_ON_NETWORK, payloadLength);
+}
+
+void UDPClient::onRemoteClientSubscription(const SomeIPServiceDiscoveryEventGroupEntry& serviceEntry,
+					   const IPv4ConfigurationOption* address) {
+
+	MemberIDs eventGroup(serviceEntry.m_serviceID, serviceEntry.m_instanceID, serviceEntry.m_eventGroupID);
+
+	// the notifications of a multicast eventgroup are received by the client through the group it is told to join
+	auto multicastGroup = m_udpManager.getMulticastGroup(eventGroup, m_endPoint);
+	if (multicastGroup != nullptr)
+		multicastGroup->addSubscriber(m_peerAddress);
+	else
+		subscribeToNotification(eventGroup);
+
+	SomeIPServiceDiscoveryMessage serviceDiscoveryMessage(true);
+	SomeIPServiceDiscoverySubscribeAckEntry ackEntry( serviceDiscoveryMessage, serviceEntry,
+							  (multicastGroup != nullptr) ? &multicastGroup->getGroupAddress() : nullptr );
+	serviceDiscoveryMessage.addEntry(ackEntry);
+	sendServiceDiscoveryMessage(serviceDiscoveryMessage);
+}
+
+void UDPClient::onRemoteClientSubscriptionFinished(const SomeIPServiceDiscoveryEventGroupEntry& serviceEntry,
+						   const IPv4ConfigurationOption* address) {
+
+	MemberIDs eventGroup(serviceEntry.m_serviceID, serviceEntry.m_instanceID, serviceEntry.m_eventGroupID);
+
+	auto multicastGroup = m_udpManager.getMulticastGroup(eventGroup, m_endPoint);
+	if (multicastGroup != nullptr)
+		multicastGroup->removeSubscriber(m_peerAddress);
+	else
+		unsubscribeFromNotification(eventGroup);
+}
+
+void UDPClient::onRemoteSubscriptionAcknowledged(const SomeIPServiceDiscoveryEventGroupEntry& serviceEntry,
+						 const IPv4ConfigurationOption* multicastAddress) {
+	if (multicastAddress != nullptr)
+		m_udpManager.onMulticastSubscriptionAcknowledged( *this, IPv4TCPEndPoint(multicastAddress->m_address,
+											 multicastAddress->m_port) );
+}
+
+void UDPClient::onRemoteServiceAvailable(const SomeIPServiceDiscoveryServiceEntry& serviceEntry,
+					 const IPv4ConfigurationOption* address,
+					 const SomeIPServiceDiscoveryMessage& message) {
+	m_udpManager.onRemoteServiceAvailable(serviceEntry, address, message);
+}
+
+void UDPClient::onRemoteServiceUnavailable(const SomeIPServiceDiscoveryServiceEntry& serviceEntry,
+					   const IPv4ConfigurationOption* address,
+					   const SomeIPServiceDiscoveryMessage& message) {
+	m_udpManager.onRemoteServiceUnavailable(serviceEntry, address, message);
+}
+
+SomeIPReturnCode UDPMulticastGroup::sendMessage(const DispatcherMessage& msg) {
+
+	if ( !msg.getHeader().isNotification() )
+		return SomeIPReturnCode::OK;
+
+	log_traffic() << "Sending message to " << toString() << ". Message: " << msg.toString();
+	return m_endPoint.queueMessage( *this, m_groupAddress, msg.getHeader(), msg.getPayload(), msg.getPayloadLength() );
+}
+
+void UDPMulticastGroup::flushDeferredMessages() {
+	m_endPoint.flush();
+}
+
+void UDPMulticastGroup::addSubscriber(const IPv4TCPEndPoint& subscriber) {
+
+	if ( std::find(m_subscribers.begin(), m_subscribers.end(), subscriber) != m_subscribers.end() )
+		return;
+
+	m_subscribers.push_back(subscriber);
+	log_debug() << subscriber.toString() << " subscribed to " << toString();
+
+	if (m_subscribers.size() == 1)
+		subscribeToNotification(m_eventGroup);
+}
+
+void UDPMulticastGroup::removeSubscriber(const IPv4TCPEndPoint& subscriber) {
+
+	auto i = std::find(m_subscribers.begin(), m_subscribers.end(), subscriber);
+	if ( i == m_subscribers.end() )
+		return;
+
+	m_subscribers.erase(i);
+	log_debug() << subscriber.toString() << " unsubscribed from " << toString();
+
+	if ( m_subscribers.empty() )
+		unsubscribeFromNotification(m_eventGroup);
+}
+
+}
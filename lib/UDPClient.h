@@ -0,0 +1,216 @@
+#pragma once
+
+#include "SomeIP-common.h"
+
+#include "Client.h"
+#include "ServiceDiscovery.h"
+#include "SegmentReassembler.h"
+
+namespace SomeIP_Dispatcher {
+
+class UDPManager;
+class UDPEndPoint;
+
+/**
+ * Handles a remote client exchanging messages with us via UDP. Since there is no connection, the client is identified by
+ * the address from which its datagrams are sent, and its messages are sent and received by the endpoint it is attached to.
+ */
+class UDPClient : public Client,
+	private ServiceDiscoveryListener {
+
+	LOG_DECLARE_CLASS_CONTEXT("UDPC", "UDPClient");
+
+public:
+	UDPClient(Dispatcher& dispatcher, UDPManager& udpManager, UDPEndPoint& endPoint, ServiceInstanceNamespace& instanceNamespace,
+		  const IPv4TCPEndPoint& peerAddress);
+
+	~UDPClient() {
+	}
+
+	void init() override {
+	}
+
+	/**
+	 * A UDP client is always reachable, since no connection is involved
+	 */
+	bool isConnected() const override {
+		return true;
+	}
+
+	const IPv4TCPEndPoint& getPeerAddress() const {
+		return m_peerAddress;
+	}
+
+	std::string toString() const override {
+		return StringBuilder() << "UDP Client " << m_peerAddress.toString();
+	}
+
+	SomeIPReturnCode sendMessage(const DispatcherMessage& msg) override;
+
+	SomeIPReturnCode sendMessage(const OutputMessage& msg) override;
+
+	/**
+	 * Blocking calls are not supported, since the answer or the request itself could be lost
+	 */
+	InputMessage sendMessageBlocking(const OutputMessage& msg) override {
+		sendMessage(msg);
+		log_error() << "Blocking calls are not supported over UDP";
+		return InputMessage();
+	}
+
+	void flushDeferredMessages() override;
+
+	void onNotificationSubscribed(Service& service, SomeIP::MemberID memberID) override;
+
+	/**
+	 * Called by the endpoint for each message received from the client. The segments of a large message are reassembled
+	 * before the message is dispatched.
+	 */
+	void onMessageReceived(const SomeIP::SomeIPHeader& header, const void* payload, size_t payloadLength);
+
+	/**
+	 * Drops the large messages whose segments have stopped arriving
+	 */
+	void evictIncompleteMessages() {
+		m_segmentReassembler.evictExpiredMessages();
+	}
+
+	/**
+	 * Returns true if nothing has been received from the client since the given time, and if the client has neither
+	 * subscribed to a notification nor registered a service, which would be lost if it was removed
+	 */
+	bool isIdleSince(SegmentReassembler::Clock::time_point time) const {
+		return (m_lastReceptionTime < time) && !hasSubscriptions() && m_registeredServices.empty();
+	}
+
+	void onServiceAvailable(ServiceIDs serviceID);
+
+	void onServiceUnavailable(ServiceIDs serviceID);
+
+private:
+	/**
+	 * Dispatches the current incoming message, whose payload has been written
+	 */
+	void dispatchIncomingMessage(const SomeIP::SomeIPHeader& header);
+
+	void sendServiceDiscoveryMessage(const SomeIPServiceDiscoveryMessage& serviceDiscoveryMessage);
+
+	void onRemoteClientSubscription(const SomeIPServiceDiscoveryEventGroupEntry& serviceEntry,
+					const IPv4ConfigurationOption* address) override;
+
+	void onRemoteClientSubscriptionFinished(const SomeIPServiceDiscoveryEventGroupEntry& serviceEntry,
+						const IPv4ConfigurationOption* address) override;
+
+	void onRemoteSubscriptionAcknowledged(const SomeIPServiceDiscoveryEventGroupEntry& serviceEntry,
+					      const IPv4ConfigurationOption* multicastAddress) override;
+
+	void onRemoteServiceAvailable(const SomeIPServiceDiscoveryServiceEntry& serviceEntry,
+				      const IPv4ConfigurationOption* address,
+				      const SomeIPServiceDiscoveryMessage& message) override;
+
+	void onRemoteServiceUnavailable(const SomeIPServiceDiscoveryServiceEntry& serviceEntry,
+					const IPv4ConfigurationOption* address,
+					const SomeIPServiceDiscoveryMessage& message) override;
+
+	void onFindServiceRequested(const SomeIPServiceDiscoveryServiceEntry& serviceEntry,
+				    const SomeIPServiceDiscoveryMessage& message) override {
+	}
+
+	UDPManager& m_udpManager;
+	UDPEndPoint& m_endPoint;
+	ServiceDiscoveryMessageDecoder m_serviceDiscoveryDecoder;
+
+	ServiceInstanceNamespace& m_instanceNamespace;
+	IPv4TCPEndPoint m_peerAddress;
+
+	NetworkInputMessage m_currentIncomingMessage;
+
+	SegmentReassembler m_segmentReassembler;
+
+	SegmentReassembler::Clock::time_point m_lastReceptionTime = SegmentReassembler::Clock::now();
+
+};
+
+/**
+ * A remote host offering one or several services via UDP
+ */
+class RemoteUDPClient : public UDPClient {
+
+public:
+	RemoteUDPClient(Dispatcher& dispatcher, UDPManager& udpManager, UDPEndPoint& endPoint, const IPv4TCPEndPoint& server) :
+		UDPClient(dispatcher, udpManager, endPoint, m_ownInstanceNamespace, server) {
+	}
+
+private:
+	ServiceInstanceNamespace m_ownInstanceNamespace;
+
+};
+
+/**
+ * Multicast group through which the notifications of an eventgroup of a local service are delivered to all its remote UDP
+ * subscribers, with a single datagram per notification. The group subscribes to the notifications on behalf of the remote
+ * subscribers, as long as there is any.
+ */
+class UDPMulticastGroup : public Client {
+
+	LOG_DECLARE_CLASS_CONTEXT("UDPG", "UDPMulticastGroup");
+
+public:
+	UDPMulticastGroup(Dispatcher& dispatcher, UDPEndPoint& endPoint, SomeIP::MemberIDs eventGroup,
+			  const IPv4TCPEndPoint& groupAddress) :
+		Client(dispatcher), m_endPoint(endPoint), m_eventGroup(eventGroup), m_groupAddress(groupAddress) {
+	}
+
+	void init() override {
+	}
+
+	bool isConnected() const override {
+		return true;
+	}
+
+	const IPv4TCPEndPoint& getGroupAddress() const {
+		return m_groupAddress;
+	}
+
+	std::string toString() const override {
+		return StringBuilder() << "UDP multicast group " << m_groupAddress.toString() << " eventgroup:" << m_eventGroup.toString();
+	}
+
+	/**
+	 * Sends a notification to the group. The other messages, like the pings, are not sent, since nobody would answer them.
+	 */
+	SomeIPReturnCode sendMessage(const DispatcherMessage& msg) override;
+
+	SomeIPReturnCode sendMessage(const OutputMessage& msg) override {
+		return SomeIPReturnCode::OK;
+	}
+
+	InputMessage sendMessageBlocking(const OutputMessage& msg) override {
+		log_error() << "Blocking calls are not supported over UDP";
+		return InputMessage();
+	}
+
+	void flushDeferredMessages() override;
+
+	void onNotificationSubscribed(Service& service, SomeIP::MemberID memberID) override {
+	}
+
+	void addSubscriber(const IPv4TCPEndPoint& subscriber);
+
+	void removeSubscriber(const IPv4TCPEndPoint& subscriber);
+
+	size_t getSubscriberCount() const {
+		return m_subscribers.size();
+	}
+
+private:
+	UDPEndPoint& m_endPoint;
+	SomeIP::MemberIDs m_eventGroup;
+	IPv4TCPEndPoint m_groupAddress;
+
+	/// Remote clients which have subscribed to the eventgroup
+	std::vector<IPv4TCPEndPoint> m_subscribers;
+
+};
+
+}
@@ -0,0 +1,195 @@
+#include "UDPEndPoint.h"
+#include "UDPManager.h"
+#include "TCPServer.h"
+
+namespace SomeIP_Dispatcher {
+
+UDPEndPoint::~UDPEndPoint() {
+	for (auto client : m_createdClients)
+		client->unregisterClient();
+	log_info() << toString() << " destroyed";
+}
+
+SomeIPReturnCode UDPEndPoint::init(TCPPort port, int portCount) {
+
+	bool bindSuccessful = false;
+
+	// we try to find an available UDP port
+	for (int i = 0; i < portCount; i++) {
+		if ( !isError( m_socket.bind(port) ) ) {
+			bindSuccessful = true;
+			break;
+		}
+		port++;
+	}
+
+	if (!bindSuccessful) {
+		log_error() << "Failed to find a free UDP port in the range " << port - portCount << "-" << port - 1;
+		return SomeIPReturnCode::ERROR;
+	}
+
+	m_port = m_socket.getLocalPort();
+	startWatching();
+
+	// an endpoint bound to a port chosen by the kernel is only used to reach the remote services
+	if (port != 0) {
+		m_dispatcher.addBlackListFilter(*this);
+		for ( auto address : TCPServer::getAllIPAddresses() ) {
+			m_activePorts.push_back( IPv4TCPEndPoint(address, m_port) );
+		}
+	}
+
+	log_info() << "UDP socket bound to port " << m_port;
+
+	return SomeIPReturnCode::OK;
+}
+
+SomeIPReturnCode UDPEndPoint::initMulticastReception(const IPv4TCPEndPoint& group) {
+
+	if ( isError( m_socket.bindMulticast(group) ) )
+		return SomeIPReturnCode::ERROR;
+
+	m_port = group.m_port;
+	m_multicastGroup = group;
+	m_isMulticastReception = true;
+	startWatching();
+
+	log_info() << "UDP socket joined multicast group " << group.toString();
+
+	return SomeIPReturnCode::OK;
+}
+
+void UDPEndPoint::startWatching() {
+
+	pollfd fd;
+	fd.fd = m_socket.getFileDescriptor();
+	fd.events = POLLIN;
+	m_inputDataWatcher = m_mainContext.addFileDescriptorWatch([&] () {
+									  onDataAvailable();
+								  }, fd);
+	m_inputDataWatcher->enable();
+
+	fd.events = POLLOUT;
+	m_outputDataWatcher = m_mainContext.addFileDescriptorWatch([&] () {
+									   flush();
+								   }, fd);
+
+	// the clients receiving a multicast group are also attached to the endpoint they send through, which evicts them
+	if (!m_isMulticastReception)
+		m_evictionTimer = m_mainContext.addTimeout([&] () {
+								   for (auto& client : m_clients)
+									   client.second->evictIncompleteMessages();
+								   evictIdleClients();
+							   }, SegmentReassembler::DEFAULT_TIMEOUT);
+}
+
+bool UDPEndPoint::isBlackListed(const IPv4TCPEndPoint& server, ServiceIDs serviceID) const {
+	// ignore our own services
+	for ( auto localAddress : m_activePorts )
+		if ( localAddress == server )
+			return true;
+
+	return false;
+}
+
+UDPClient* UDPEndPoint::getOrCreateClient(const IPv4TCPEndPoint& address) {
+
+	auto i = m_clients.find(address);
+	if ( i != m_clients.end() )
+		return i->second;
+
+	// anyone can send to a multicast group, so that only the providers we have subscribed to are accepted
+	if (m_isMulticastReception) {
+		log_debug() << "Datagram sent to " << m_multicastGroup.toString() << " by unknown sender " << address.toString() << " ignored";
+		return nullptr;
+	}
+
+	// anyone can send datagrams, possibly from spoofed addresses, so that the number of clients is bounded
+	if (m_createdClients.size() >= m_maximumClientCount) {
+		if (!m_isClientCountExceeded)
+			log_warning() << toString() << " : maximum client count reached. Datagrams from new senders are ignored";
+		m_isClientCountExceeded = true;
+		return nullptr;
+	}
+
+	UDPClient* newClient = new UDPClient(m_dispatcher, m_udpManager, *this, m_instanceNamespace, address);
+	m_createdClients.push_back(newClient);
+	log_debug() << "New client : " << newClient->toString();
+	addClient(*newClient);
+	newClient->registerClient();
+	return newClient;
+}
+
+void UDPEndPoint::evictIdleClients(SegmentReassembler::Clock::time_point now) {
+
+	auto idleLimit = now - std::chrono::milliseconds(m_clientIdleTimeout);
+
+	for (auto i = m_createdClients.begin(); i != m_createdClients.end();) {
+		auto& client = **i;
+		if ( !client.isIdleSince(idleLimit) ) {
+			++i;
+			continue;
+		}
+
+		log_debug() << "Idle client removed : " << client.toString();
+		removeClient(client);
+		m_udpManager.onClientRemoved(client);
+		client.unregisterClient();
+		i = m_createdClients.erase(i);
+		m_isClientCountExceeded = false;
+	}
+}
+
+void UDPEndPoint::onDataAvailable() {
+
+	// the messages sent while processing the received datagrams are packed together
+	DispatchCycle dispatchCycle(m_dispatcher);
+
+	m_socket.receive([&] (const IPv4TCPEndPoint& source, const SomeIP::SomeIPHeader& header, const void* payload,
+			      size_t payloadLength) {
+				 auto client = getOrCreateClient(source);
+				 if (client != nullptr)
+					 client->onMessageReceived(header, payload, payloadLength);
+			 });
+}
+
+SomeIPReturnCode UDPEndPoint::queueMessage(UDPClient& client, const SomeIP::SomeIPHeader& header, const void* payload,
+					   size_t payloadLength) {
+	return queueMessage(client, client.getPeerAddress(), header, payload, payloadLength);
+}
+
+SomeIPReturnCode UDPEndPoint::queueMessage(Client& client, const IPv4TCPEndPoint& destination, const SomeIP::SomeIPHeader& header,
+					   const void* payload, size_t payloadLength) {
+
+	auto code = m_socket.queueMessage(destination, header, payload, payloadLength);
+	if ( isError(code) )
+		return code;
+
+	if ( !m_dispatcher.isInDispatchCycle() )
+		flush();
+	else if (!m_isFlushScheduled) {
+		// any client of the endpoint can flush it, since all the datagrams are sent through the same socket
+		m_isFlushScheduled = true;
+		m_dispatcher.addClientToFlush(client);
+	}
+
+	return SomeIPReturnCode::OK;
+}
+
+void UDPEndPoint::flush() {
+
+	m_isFlushScheduled = false;
+
+	if (m_socket.getPendingDatagramCount() == 0)
+		return;
+
+	log_verbose() << "Sending " << m_socket.getPendingDatagramCount() << " datagrams from " << toString();
+
+	// the rest of the datagrams is sent as soon as the socket is writable again
+	if (m_socket.flush() == IPCOperationReport::BUFFER_FULL)
+		m_outputDataWatcher->enable();
+	else
+		m_outputDataWatcher->disable();
+}
+
+}
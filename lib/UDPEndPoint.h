@@ -0,0 +1,190 @@
+#pragma once
+
+#include <unordered_map>
+
+#include "SomeIP-common.h"
+
+#include "Dispatcher.h"
+#include "DatagramSocket.h"
+#include "UDPClient.h"
+
+namespace SomeIP_Dispatcher {
+
+/**
+ * UDP socket through which the local services are offered, or through which the remote services are used. The messages
+ * received are dispatched to the client matching the address of their sender, which is created on its first datagram and
+ * removed once idle. The messages sent during a dispatch cycle are packed into datagrams which are all sent at the end of
+ * the cycle.
+ */
+class UDPEndPoint : private BlackListHostFilter {
+
+	LOG_DECLARE_CLASS_CONTEXT("UDPE", "UDPEndPoint");
+
+public:
+	static const TCPPort DEFAULT_UDP_SERVER_PORT = 10052;
+
+	/// Delay after which a client from which nothing has been received is removed
+	static const int DEFAULT_CLIENT_IDLE_TIMEOUT = 60000;  // ms
+
+	/// Maximum number of clients created by an endpoint, beyond which the datagrams of new senders are ignored
+	static const size_t DEFAULT_MAXIMUM_CLIENT_COUNT = 1024;
+
+	UDPEndPoint(Dispatcher& dispatcher, UDPManager& udpManager, MainLoopContext& mainContext) :
+		m_dispatcher(dispatcher), m_udpManager(udpManager), m_mainContext(mainContext) {
+	}
+
+	virtual ~UDPEndPoint();
+
+	/**
+	 * Binds the socket to the first available port of the given range. If the port is 0, a port is chosen by the kernel and
+	 * the endpoint is not published.
+	 */
+	SomeIPReturnCode init(TCPPort port, int portCount = 1);
+
+	/**
+	 * Joins the given multicast group, to receive the notifications sent to it. Only the datagrams sent by the clients added
+	 * with addClient() are accepted.
+	 */
+	SomeIPReturnCode initMulticastReception(const IPv4TCPEndPoint& group);
+
+	/**
+	 * Returns the multicast group received by the endpoint, if initialized with initMulticastReception()
+	 */
+	const IPv4TCPEndPoint& getMulticastGroup() const {
+		return m_multicastGroup;
+	}
+
+	bool isBlackListed(const IPv4TCPEndPoint& server, ServiceIDs serviceID) const override;
+
+	bool isServiceRegistered(const Service& service) {
+		return (m_instanceNamespace.count(service.getServiceIDs().serviceID) != 0) &&
+		       (m_instanceNamespace.at(service.getServiceIDs().serviceID)->getServiceIDs().instanceID ==
+			service.getServiceIDs().instanceID);
+	}
+
+	bool isServiceRegistered(ServiceID serviceID) {
+		return (m_instanceNamespace.count(serviceID) != 0);
+	}
+
+	void addService(const Service& service) {
+		assert(m_instanceNamespace.count(service.getServiceIDs().serviceID) == 0);
+		m_instanceNamespace[service.getServiceIDs().serviceID] = &service;
+		log_debug() << toString() << m_instanceNamespace;
+	}
+
+	void removeService(const Service& service) {
+		assert(m_instanceNamespace.count(service.getServiceIDs().serviceID) == 1);
+		m_instanceNamespace.erase(service.getServiceIDs().serviceID);
+		log_debug() << toString() << m_instanceNamespace;
+	}
+
+	const std::vector<IPv4TCPEndPoint> getIPAddresses() const {
+		return m_activePorts;
+	}
+
+	TCPPort getLocalPort() const {
+		return m_port;
+	}
+
+	std::string toString() const {
+		return StringBuilder() << "UDPEndPoint port:" << m_port;
+	}
+
+	/**
+	 * Adds a client to which the datagrams received from its address are dispatched. The client is not owned by the endpoint.
+	 */
+	void addClient(UDPClient& client) {
+		m_clients.emplace(client.getPeerAddress(), &client);
+	}
+
+	void removeClient(UDPClient& client) {
+		auto i = m_clients.find( client.getPeerAddress() );
+		if ( (i != m_clients.end()) && (i->second == &client) )
+			m_clients.erase(i);
+	}
+
+	/**
+	 * Returns the number of clients created by the endpoint for the senders of the datagrams it has received
+	 */
+	size_t getCreatedClientCount() const {
+		return m_createdClients.size();
+	}
+
+	void setMaximumClientCount(size_t count) {
+		m_maximumClientCount = count;
+	}
+
+	void setClientIdleTimeout(int timeout) {
+		m_clientIdleTimeout = timeout;
+	}
+
+	/**
+	 * Unregisters the clients created by the endpoint which have been idle for longer than the idle timeout
+	 */
+	void evictIdleClients(SegmentReassembler::Clock::time_point now = SegmentReassembler::Clock::now());
+
+	/**
+	 * Queues a message to the given client. The message is sent immediately if no dispatch cycle is running, or at the end of
+	 * the current cycle otherwise.
+	 */
+	SomeIPReturnCode queueMessage(UDPClient& client, const SomeIP::SomeIPHeader& header, const void* payload,
+				      size_t payloadLength);
+
+	/**
+	 * Queues a message to the given destination, on behalf of the given client, which flushes the endpoint at the end of the
+	 * current dispatch cycle
+	 */
+	SomeIPReturnCode queueMessage(Client& client, const IPv4TCPEndPoint& destination, const SomeIP::SomeIPHeader& header,
+				      const void* payload, size_t payloadLength);
+
+	/**
+	 * Sends the queued datagrams
+	 */
+	void flush();
+
+	void setMaximumDatagramSize(size_t size) {
+		m_socket.setMaximumDatagramSize(size);
+	}
+
+private:
+	void startWatching();
+
+	void onDataAvailable();
+
+	UDPClient* getOrCreateClient(const IPv4TCPEndPoint& address);
+
+	Dispatcher& m_dispatcher;
+	UDPManager& m_udpManager;
+	MainLoopContext& m_mainContext;
+
+	SomeIPDatagramSocket m_socket;
+	TCPPort m_port = 0;
+	std::vector<IPv4TCPEndPoint> m_activePorts;
+
+	/// Multicast group joined by the endpoint, whose datagrams do not create new clients
+	IPv4TCPEndPoint m_multicastGroup;
+	bool m_isMulticastReception = false;
+
+	/// Local services offered by this endpoint
+	ServiceInstanceNamespace m_instanceNamespace;
+
+	std::unordered_map<IPv4TCPEndPoint, UDPClient*, IPv4TCPEndPointHash> m_clients;
+
+	/// Clients created on the first datagram of their sender, which are deleted by the dispatcher once unregistered
+	std::vector<UDPClient*> m_createdClients;
+	size_t m_maximumClientCount = DEFAULT_MAXIMUM_CLIENT_COUNT;
+	int m_clientIdleTimeout = DEFAULT_CLIENT_IDLE_TIMEOUT;
+	bool m_isClientCountExceeded = false;
+
+	/// True if a client has been registered to flush the endpoint at the end of the current dispatch cycle
+	bool m_isFlushScheduled = false;
+
+	std::unique_ptr<WatchMainLoopHook> m_inputDataWatcher;
+	std::unique_ptr<WatchMainLoopHook> m_outputDataWatcher;
+
+	/// Drops the incomplete segmented messages and the idle clients
+	std::unique_ptr<TimeOutMainLoopHook> m_evictionTimer;
+
+};
+
+}
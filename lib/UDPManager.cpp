@@ -0,0 +1,173 @@
+#include <sstream>
+
+#include <arpa/inet.h>
+
+#include "UDPManager.h"
+
+namespace SomeIP_Dispatcher {
+
+SomeIPReturnCode UDPManager::bindService(const Service& service) {
+
+	// Search for an endpoint which has no service currently registered with the serviceID
+	UDPEndPoint* availableEndPoint = nullptr;
+	for (auto& endPoint : m_endPoints) {
+		if ( !endPoint->isServiceRegistered(service.getServiceIDs().serviceID) )
+			availableEndPoint = endPoint;
+	}
+
+	if (availableEndPoint == nullptr) {
+		// each endpoint gets its own port, after the ports of the existing ones
+		TCPPort port = m_endPoints.empty() ? m_basePort : m_endPoints.back()->getLocalPort() + 1;
+		availableEndPoint = new UDPEndPoint(m_dispatcher, *this, m_mainLoopContext);
+		availableEndPoint->setMaximumDatagramSize(m_maximumDatagramSize);
+		if ( isError( availableEndPoint->init(port, m_portCount) ) ) {
+			delete availableEndPoint;
+			return SomeIPReturnCode::ERROR;
+		}
+		m_endPoints.push_back(availableEndPoint);
+	}
+
+	availableEndPoint->addService(service);
+	return SomeIPReturnCode::OK;
+}
+
+RemoteUDPClient* UDPManager::getOrCreateClient(const IPv4TCPEndPoint& serverID) {
+
+	for (auto existingClient : m_clients) {
+		if ( serverID == existingClient->getPeerAddress() )
+			return existingClient;
+	}
+
+	if (m_clientEndPoint == nullptr) {
+		std::unique_ptr<UDPEndPoint> endPoint( new UDPEndPoint(m_dispatcher, *this, m_mainLoopContext) );
+		endPoint->setMaximumDatagramSize(m_maximumDatagramSize);
+		if ( isError( endPoint->init(0) ) )
+			return nullptr;
+		m_clientEndPoint = std::move(endPoint);
+	}
+
+	auto client = new RemoteUDPClient(m_dispatcher, *this, *m_clientEndPoint, serverID);
+	m_clientEndPoint->addClient(*client);
+	m_clients.push_back(client);
+	client->registerClient();
+
+	return client;
+}
+
+void UDPManager::onRemoteServiceAvailable(const SomeIPServiceDiscoveryServiceEntry& serviceEntry,
+					  const IPv4ConfigurationOption* address,
+					  const SomeIPServiceDiscoveryMessage& message) {
+
+	if (address->m_protocol != TransportProtocol::UDP)
+		return;
+
+	IPv4TCPEndPoint serverID(address->m_address, address->m_port);
+	ServiceIDs serviceIDs(serviceEntry.m_serviceID, serviceEntry.m_instanceID);
+
+	// ignore our own notifications
+	for ( auto filter : m_dispatcher.getBlackList() ) {
+		if ( filter->isBlackListed(serverID, serviceIDs) ) {
+			log_debug() << "Ignoring service " << serverID.toString();
+			return;
+		}
+	}
+
+	RemoteUDPClient* client = getOrCreateClient(serverID);
+	if (client == nullptr)
+		return;
+
+	client->onServiceAvailable(serviceIDs);
+
+	log_info() << "Remote service " << serviceIDs.toString() << " is available on UDP " << serverID.toString();
+}
+
+void UDPManager::onRemoteServiceUnavailable(const SomeIPServiceDiscoveryServiceEntry& serviceEntry,
+					    const IPv4ConfigurationOption* address,
+					    const SomeIPServiceDiscoveryMessage& message) {
+
+	if (address->m_protocol != TransportProtocol::UDP)
+		return;
+
+	IPv4TCPEndPoint serverID(address->m_address, address->m_port);
+	ServiceIDs serviceIDs(serviceEntry.m_serviceID, serviceEntry.m_instanceID);
+
+	for (auto client : m_clients) {
+		if ( serverID == client->getPeerAddress() ) {
+			client->onServiceUnavailable(serviceIDs);
+			log_info() << "Remote service " << serviceIDs.toString() << " is NOT available on UDP " << serverID.toString();
+		}
+	}
+}
+
+SomeIPReturnCode UDPManager::addMulticastEventGroups(const std::string& configuration) {
+
+	std::istringstream stream(configuration);
+	std::string item;
+	while ( std::getline(stream, item, ',') ) {
+		if ( item.empty() )
+			continue;
+
+		unsigned int serviceID, instanceID, eventGroupID, port;
+		char address[16];
+		struct in_addr groupAddress;
+		if ( (sscanf(item.c_str(), "%i:%i:%i=%15[0-9.]:%u", &serviceID, &instanceID, &eventGroupID, address, &port) != 5) ||
+		     (inet_pton(AF_INET, address, &groupAddress) != 1) || !IN_MULTICAST( ntohl(groupAddress.s_addr) ) ||
+		     (port == 0) || (port > 0xFFFF) ) {
+			log_error() << "Invalid multicast eventgroup : " << item;
+			return SomeIPReturnCode::ERROR;
+		}
+
+		addMulticastEventGroup( SomeIP::MemberIDs(serviceID, instanceID, eventGroupID),
+					IPv4TCPEndPoint(IPV4Address(groupAddress), port) );
+	}
+
+	return SomeIPReturnCode::OK;
+}
+
+UDPMulticastGroup* UDPManager::getMulticastGroup(const SomeIP::MemberIDs& eventGroup, UDPEndPoint& endPoint) {
+
+	for (auto& multicastEventGroup : m_multicastEventGroups) {
+		if ( !(multicastEventGroup.m_eventGroup == eventGroup) )
+			continue;
+
+		if (multicastEventGroup.m_group == nullptr) {
+			// the notifications are sent through the endpoint of the service, so that the subscribers know their origin
+			auto group = new UDPMulticastGroup(m_dispatcher, endPoint, eventGroup, multicastEventGroup.m_groupAddress);
+			group->registerClient();
+			multicastEventGroup.m_group = group;
+			log_info() << "Notifications of eventgroup " << eventGroup.toString() << " sent to multicast group " <<
+				multicastEventGroup.m_groupAddress.toString();
+		}
+
+		return multicastEventGroup.m_group;
+	}
+
+	return nullptr;
+}
+
+void UDPManager::onMulticastSubscriptionAcknowledged(UDPClient& client, const IPv4TCPEndPoint& groupAddress) {
+
+	UDPEndPoint* multicastEndPoint = nullptr;
+	for (auto& endPoint : m_multicastEndPoints) {
+		if (endPoint->getMulticastGroup() == groupAddress)
+			multicastEndPoint = endPoint.get();
+	}
+
+	if (multicastEndPoint == nullptr) {
+		std::unique_ptr<UDPEndPoint> endPoint( new UDPEndPoint(m_dispatcher, *this, m_mainLoopContext) );
+		if ( isError( endPoint->initMulticastReception(groupAddress) ) )
+			return;
+		multicastEndPoint = endPoint.get();
+		m_multicastEndPoints.push_back( std::move(endPoint) );
+	}
+
+	// the notifications sent to the group by the provider are dispatched to the client representing it
+	multicastEndPoint->addClient(client);
+}
+
+void UDPManager::onClientRemoved(UDPClient& client) {
+	for (auto& endPoint : m_multicastEndPoints)
+		endPoint->removeClient(client);
+}
+
+}
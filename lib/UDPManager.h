@@ -0,0 +1,155 @@
+#pragma once
+
+#include "ServiceDiscovery.h"
+
+#include "Dispatcher.h"
+#include "UDPClient.h"
+#include "UDPEndPoint.h"
+
+namespace SomeIP_Dispatcher {
+
+/**
+ * Offers the local services over UDP, and registers the remote services offered over UDP
+ */
+class UDPManager : public ServiceRegistrationListener {
+
+	LOG_DECLARE_CLASS_CONTEXT("UDPM", "UDPManager");
+
+public:
+	/**
+	 * @param port First port of the endpoints through which the local services are offered. If 0, the local services are not
+	 * offered over UDP, but the remote services offered over UDP can still be used.
+	 */
+	UDPManager(Dispatcher& dispatcher, MainLoopContext& mainLoopContext, TCPPort port) :
+		m_dispatcher(dispatcher), m_mainLoopContext(mainLoopContext), m_basePort(port) {
+		m_dispatcher.addServiceRegistrationListener(*this);
+	}
+
+	~UDPManager() {
+	}
+
+	SomeIPReturnCode init(int portCount = 1) {
+		m_portCount = portCount;
+		return SomeIPReturnCode::OK;
+	}
+
+	void onServiceRegistered(const Service& service) override {
+		if ( service.isLocal() && (m_basePort != 0) ) {         // we don't publish remote services
+			bindService(service);
+		}
+	}
+
+	void onServiceUnregistered(const Service& service) override {
+		if ( service.isLocal() ) {
+			UDPEndPoint* endPoint = getEndPoint(service);
+			if (endPoint != nullptr) {
+				endPoint->removeService(service);
+			}
+		}
+	}
+
+	/**
+	 * Returns the endpoint which is offering the given service
+	 */
+	UDPEndPoint* getEndPoint(const Service& service) {
+		for (auto& endPoint : m_endPoints) {
+			if ( endPoint->isServiceRegistered(service) )
+				return endPoint;
+		}
+
+		return nullptr;
+	}
+
+	/**
+	 * Offers the given service through an endpoint which does not offer any service with the same serviceID yet
+	 */
+	SomeIPReturnCode bindService(const Service& service);
+
+	void onRemoteServiceAvailable(const SomeIPServiceDiscoveryServiceEntry& serviceEntry,
+				      const IPv4ConfigurationOption* address,
+				      const SomeIPServiceDiscoveryMessage& message);
+
+	void onRemoteServiceUnavailable(const SomeIPServiceDiscoveryServiceEntry& serviceEntry,
+					const IPv4ConfigurationOption* address,
+					const SomeIPServiceDiscoveryMessage& message);
+
+	/**
+	 * Delivers the notifications of the given eventgroup of a local service through a multicast group, with a single datagram
+	 * per notification instead of a copy per remote subscriber. The group is advertised to the subscribers in the
+	 * acknowledgement of their subscription.
+	 */
+	void addMulticastEventGroup(SomeIP::MemberIDs eventGroup, const IPv4TCPEndPoint& groupAddress) {
+		MulticastEventGroup multicastEventGroup;
+		multicastEventGroup.m_eventGroup = eventGroup;
+		multicastEventGroup.m_groupAddress = groupAddress;
+		m_multicastEventGroups.push_back(multicastEventGroup);
+	}
+
+	/**
+	 * Adds the multicast eventgroups described by a comma separated list of "serviceID:instanceID:eventGroupID=address:port"
+	 */
+	SomeIPReturnCode addMulticastEventGroups(const std::string& configuration);
+
+	/**
+	 * Returns the multicast group of the given eventgroup, created on the given endpoint if needed, or nullptr if the
+	 * notifications of the eventgroup are sent to each subscriber
+	 */
+	UDPMulticastGroup* getMulticastGroup(const SomeIP::MemberIDs& eventGroup, UDPEndPoint& endPoint);
+
+	/**
+	 * Called when a remote service has acknowledged a subscription, whose notifications are sent to the given multicast group
+	 */
+	void onMulticastSubscriptionAcknowledged(UDPClient& client, const IPv4TCPEndPoint& groupAddress);
+
+	/**
+	 * Called when an endpoint removes one of its clients, which must not receive the datagrams of any group anymore
+	 */
+	void onClientRemoved(UDPClient& client);
+
+	/**
+	 * Sets the size up to which several messages are packed into a single datagram
+	 */
+	void setMaximumDatagramSize(size_t size) {
+		m_maximumDatagramSize = size;
+	}
+
+	/**
+	 * Returns the budget of the bytes buffered to reassemble the segmented messages, which all the UDP clients share
+	 */
+	const std::shared_ptr<SegmentReassemblyBudget>& getReassemblyBudget() const {
+		return m_reassemblyBudget;
+	}
+
+private:
+	struct MulticastEventGroup {
+		SomeIP::MemberIDs m_eventGroup;
+		IPv4TCPEndPoint m_groupAddress;
+		/// Created when the first remote client subscribes
+		UDPMulticastGroup* m_group = nullptr;
+	};
+
+	RemoteUDPClient* getOrCreateClient(const IPv4TCPEndPoint& serverID);
+
+	Dispatcher& m_dispatcher;
+	MainLoopContext& m_mainLoopContext;
+	TCPPort m_basePort;
+	int m_portCount = 10;
+	size_t m_maximumDatagramSize = SomeIPDatagramSocket::DEFAULT_MAXIMUM_DATAGRAM_SIZE;
+
+	std::shared_ptr<SegmentReassemblyBudget> m_reassemblyBudget = std::make_shared<SegmentReassemblyBudget>();
+
+	std::vector<UDPEndPoint*> m_endPoints;
+
+	/// Endpoint through which the remote services are used, created when the first one is available
+	std::unique_ptr<UDPEndPoint> m_clientEndPoint;
+
+	std::vector<RemoteUDPClient*> m_clients;
+
+	std::vector<MulticastEventGroup> m_multicastEventGroups;
+
+	/// Endpoints receiving the multicast groups joined to receive the notifications of remote services
+	std::vector<std::unique_ptr<UDPEndPoint> > m_multicastEndPoints;
+
+};
+
+}
@@ -1,9 +1,11 @@
 #pragma once
 
 #include <vector>
+#include <algorithm>
 #include <stddef.h>
 #include <assert.h>
 #include <memory.h>
+#include <unistd.h>
 #include "utilLib/serialization.h"
 #include "SomeIP-common.h"
 
@@ -26,7 +28,7 @@ enum class IPCMessageType
 	INVALID,
 	PING,
 	PONG,
-	SEND_MESSAGE,
+	SEND_MESSAGE,           /// if a file descriptor is attached, it contains the payload (see SharedPayload)
 	REGISTER_SERVICE,
 	UNREGISTER_SERVICE,
 	GET_SERVICE_LIST,
@@ -34,7 +36,16 @@ enum class IPCMessageType
 	DUMP_STATE,
 	ANSWER,
 	SERVICES_REGISTERED,
-	SERVICES_UNREGISTERED
+	SERVICES_UNREGISTERED,
+	PEER_CHANNEL,
+	REGISTER_SERVICES,
+	UNREGISTER_SERVICES,
+	SUBSCRIBE_NOTIFICATIONS,
+	REGISTRY_SEGMENT,
+	SET_FRAMING,
+	BATCH,
+	LARGE_MESSAGE,
+	REGISTRY_SEGMENT_UNAVAILABLE    /// sent by a client which can not read the registry segment, to get the registry via IPC
 };
 
 inline std::string toString(IPCMessageType messageType) {
@@ -50,9 +61,35 @@ inline std::string toString(IPCMessageType messageType) {
 	RETURN_ENUM_NAME_IF_EQUAL(messageType, IPCMessageType, ANSWER);
 	RETURN_ENUM_NAME_IF_EQUAL(messageType, IPCMessageType, SERVICES_REGISTERED);
 	RETURN_ENUM_NAME_IF_EQUAL(messageType, IPCMessageType, SERVICES_UNREGISTERED);
+	RETURN_ENUM_NAME_IF_EQUAL(messageType, IPCMessageType, PEER_CHANNEL);
+	RETURN_ENUM_NAME_IF_EQUAL(messageType, IPCMessageType, REGISTER_SERVICES);
+	RETURN_ENUM_NAME_IF_EQUAL(messageType, IPCMessageType, UNREGISTER_SERVICES);
+	RETURN_ENUM_NAME_IF_EQUAL(messageType, IPCMessageType, SUBSCRIBE_NOTIFICATIONS);
+	RETURN_ENUM_NAME_IF_EQUAL(messageType, IPCMessageType, REGISTRY_SEGMENT);
+	RETURN_ENUM_NAME_IF_EQUAL(messageType, IPCMessageType, SET_FRAMING);
+	RETURN_ENUM_NAME_IF_EQUAL(messageType, IPCMessageType, BATCH);
+	RETURN_ENUM_NAME_IF_EQUAL(messageType, IPCMessageType, LARGE_MESSAGE);
+	RETURN_ENUM_NAME_IF_EQUAL(messageType, IPCMessageType, REGISTRY_SEGMENT_UNAVAILABLE);
 	return "Unknown value of IPCMessageType";
 }
 
+/**
+ * Encoding of the frames on a local connection. The native framing is used until both ends agree on the compact one,
+ * via a SET_FRAMING request. Both ends of a connection on which a SET_FRAMING request has been accepted also support
+ * BATCH messages.
+ */
+enum class IPCFraming
+	: uint8_t {
+	NATIVE, COMPACT
+};
+
+/**
+ * Type of the local sockets. With SEQPACKET, each message is sent as a single packet, without any length prefix.
+ */
+enum class IPCSocketType {
+	STREAM, SEQPACKET
+};
+
 enum class IPCReturnCode
 	: uint8_t {
 	UNDEFINED, OK, ERROR
@@ -128,9 +165,27 @@ public:
 		return m_payload.size() - sizeof(IPCMessageHeader);
 	}
 
+	/**
+	 * Returns the file descriptor to be transferred together with the message, or -1 if there is none.
+	 */
+	int getFileDescriptor() const {
+		return m_fileDescriptor;
+	}
+
+	/**
+	 * Attaches a file descriptor to the message. The descriptor is transferred to the receiver via SCM_RIGHTS.
+	 * The message does not take the ownership of the descriptor.
+	 */
+	void setFileDescriptor(int fileDescriptor) {
+		m_fileDescriptor = fileDescriptor;
+	}
+
 private:
 	ByteArray m_payload;
 
+protected:
+	int m_fileDescriptor = -1;
+
 };
 
 /**
@@ -146,12 +201,55 @@ public:
 	}
 
 	~IPCInputMessage() {
+		closeFileDescriptor();
 	}
 
-	IPCInputMessage(const IPCInputMessage& msg) {
+	IPCInputMessage(const IPCInputMessage& msg) : IPCMessage() {
 		*this = msg;
 	}
 
+	IPCInputMessage(IPCInputMessage&& msg) noexcept : IPCMessage( std::move(msg) ),
+		m_totalMessageSize(msg.m_totalMessageSize), m_receivedSize(msg.m_receivedSize), m_isError(msg.m_isError) {
+		msg.m_fileDescriptor = -1;
+	}
+
+	IPCInputMessage& operator=(const IPCInputMessage& msg) {
+		if (this != &msg) {
+			closeFileDescriptor();
+			IPCMessage::operator=(msg);
+			// each copy owns its own descriptor
+			if (msg.m_fileDescriptor != -1)
+				m_fileDescriptor = dup(msg.m_fileDescriptor);
+			m_totalMessageSize = msg.m_totalMessageSize;
+			m_receivedSize = msg.m_receivedSize;
+			m_isError = msg.m_isError;
+		}
+		return *this;
+	}
+
+	IPCInputMessage& operator=(IPCInputMessage&& msg) noexcept {
+		if (this != &msg) {
+			closeFileDescriptor();
+			IPCMessage::operator=( std::move(msg) );
+			// the descriptor ownership is transferred
+			msg.m_fileDescriptor = -1;
+			m_totalMessageSize = msg.m_totalMessageSize;
+			m_receivedSize = msg.m_receivedSize;
+			m_isError = msg.m_isError;
+		}
+		return *this;
+	}
+
+	/**
+	 * Returns the file descriptor received with the message and releases its ownership. The caller is responsible for
+	 * closing it.
+	 */
+	int takeFileDescriptor() {
+		int fd = m_fileDescriptor;
+		m_fileDescriptor = -1;
+		return fd;
+	}
+
 	bool isComplete() const {
 		return (m_totalMessageSize == m_receivedSize);
 	}
@@ -161,6 +259,10 @@ public:
 	}
 
 	void clear() {
+		closeFileDescriptor();
+		// the payload of a moved-from message is empty
+		if ( getPayload().size() < getHeaderSize() )
+			getPayload().resize( getHeaderSize() );
 		getHeader().m_messageType = IPCMessageType::INVALID;
 		getHeader().m_requestID = 0;
 		m_receivedSize = 0;
@@ -191,7 +293,24 @@ public:
 		return m_receivedSize;
 	}
 
+	/**
+	 * Replaces the content of the message with the given complete payload, made of an IPC header and the user data
+	 */
+	void setContent(const void* payload, size_t length) {
+		closeFileDescriptor();
+		setLength(length);
+		memcpy(getPayload().getData(), payload, length);
+		m_receivedSize = length;
+	}
+
 private:
+	void closeFileDescriptor() {
+		if (m_fileDescriptor != -1) {
+			close(m_fileDescriptor);
+			m_fileDescriptor = -1;
+		}
+	}
+
 	size_t m_totalMessageSize;
 	size_t m_receivedSize;
 
@@ -229,6 +348,23 @@ public:
 		getHeader().m_returnCode = returnCode;
 	}
 
+	// the serializer must always write into the payload of its own message, not into the one of the message it was copied from
+	IPCOutputMessage(const IPCOutputMessage& msg) : IPCMessage(msg), m_serializer( getPayload() ) {
+	}
+
+	IPCOutputMessage(IPCOutputMessage&& msg) noexcept : IPCMessage( std::move(msg) ), m_serializer( getPayload() ) {
+	}
+
+	IPCOutputMessage& operator=(const IPCOutputMessage& msg) {
+		IPCMessage::operator=(msg);
+		return *this;
+	}
+
+	IPCOutputMessage& operator=(IPCOutputMessage&& msg) noexcept {
+		IPCMessage::operator=( std::move(msg) );
+		return *this;
+	}
+
 	template<typename T> IPCOutputMessage& operator<<(const T& v) {
 		m_serializer.writeValue(v);
 		return *this;
@@ -247,6 +383,118 @@ private:
 	Serializer<false, false> m_serializer;
 };
 
+/**
+ * Packs several messages into the user data of a single BATCH message, so that they are sent with a single frame.
+ * Each message is stored as a uint32_t length, followed by its payload (IPC header and user data), padded to 4 bytes so
+ * that the headers stay aligned. File descriptors can't be attached to the packed messages.
+ */
+class IPCBatchWriter {
+
+public:
+	static const size_t ALIGNMENT = 4;
+
+	IPCBatchWriter() : m_batch(IPCMessageType::BATCH) {
+	}
+
+	void append(const IPCMessage& msg) {
+		assert(msg.getFileDescriptor() == -1);
+		auto& payload = m_batch.getWritablePayload();
+		uint32_t length = msg.getPayload().size();
+		size_t position = payload.size();
+		payload.resize( position + sizeof(length) + getPaddedSize(length) );
+		memcpy( payload.getData() + position, &length, sizeof(length) );
+		memcpy(payload.getData() + position + sizeof(length), msg.getPayload().getData(), length);
+		m_messageCount++;
+	}
+
+	size_t getMessageCount() const {
+		return m_messageCount;
+	}
+
+	const IPCOutputMessage& getMessage() const {
+		return m_batch;
+	}
+
+	void clear() {
+		m_batch.getWritablePayload().resize( IPCMessage::getHeaderSize() );
+		m_messageCount = 0;
+	}
+
+	static size_t getPaddedSize(size_t length) {
+		return (length + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+	}
+
+private:
+	IPCOutputMessage m_batch;
+	size_t m_messageCount = 0;
+};
+
+/**
+ * Iterates over the messages packed into a BATCH message, without copying them. The reader references the batch, which
+ * must therefore outlive it.
+ */
+class IPCBatchReader {
+
+public:
+	IPCBatchReader(const IPCMessage& batch) :
+		m_position( batch.getUserData() ), m_end( batch.getUserData() + batch.getUserDataLength() ) {
+	}
+
+	/**
+	 * Moves to the next message
+	 * @return false if there is no more message, or if the rest of the batch is invalid
+	 */
+	bool next() {
+		m_position += m_nextOffset;
+		uint32_t length;
+		if (static_cast<size_t>(m_end - m_position) < sizeof(length) )
+			return false;
+		memcpy( &length, m_position, sizeof(length) );
+		if ( (length < IPCMessage::getHeaderSize() ) || (length > static_cast<size_t>(m_end - m_position) - sizeof(length) ) )
+			return false;
+		m_length = length;
+		m_nextOffset = std::min( sizeof(length) + IPCBatchWriter::getPaddedSize(length),
+					 static_cast<size_t>(m_end - m_position) );
+		return true;
+	}
+
+	/**
+	 * Returns the payload of the current message, which starts with its IPC header
+	 */
+	const unsigned char* getPayload() const {
+		return m_position + sizeof(uint32_t);
+	}
+
+	size_t getPayloadSize() const {
+		return m_length;
+	}
+
+	IPCMessageType getMessageType() const {
+		return reinterpret_cast<const IPCMessageHeader*>( getPayload() )->m_messageType;
+	}
+
+	const unsigned char* getUserData() const {
+		return getPayload() + IPCMessage::getHeaderSize();
+	}
+
+	size_t getUserDataLength() const {
+		return m_length - IPCMessage::getHeaderSize();
+	}
+
+	/**
+	 * Copies the current message, for the cases where it needs to outlive the batch
+	 */
+	void copyTo(IPCInputMessage& msg) const {
+		msg.setContent( getPayload(), getPayloadSize() );
+	}
+
+private:
+	const unsigned char* m_position;
+	const unsigned char* m_end;
+	size_t m_nextOffset = 0;
+	size_t m_length = 0;
+};
+
 inline bool IPCInputMessage::isResponseOf(const IPCOutputMessage& outputMessage) const {
 	return ( getRequestID() == outputMessage.getRequestID() );
 }
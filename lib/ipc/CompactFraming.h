@@ -0,0 +1,282 @@
+#pragma once
+
+#include "Message.h"
+
+namespace SomeIP_Lib {
+
+/**
+ * Compact encoding of the IPC frames, used on a local connection once both ends have agreed on it with a SET_FRAMING request.
+ * The length of a frame is encoded as a varint instead of a native size_t, and the header of a SOME/IP message only
+ * contains the fields which do not have their default value. This divides the size of a frame carrying a small payload by
+ * about two.
+ *
+ * Frame layout :
+ *   varint    length of the rest of the frame
+ *   uint8_t   IPC message type, combined with FILE_DESCRIPTOR_FLAG if a file descriptor is attached to the frame
+ *   SEND_MESSAGE frames :
+ *     uint8_t   flags telling which of the optional fields are present
+ *     uint32_t  message ID
+ *     uint32_t  request ID
+ *     uint8_t   message type
+ *     uint16_t  instance ID                                                 (INSTANCE_ID_FLAG)
+ *     uint16_t  client identifier                                           (CLIENT_IDENTIFIER_FLAG)
+ *     uint8_t   protocol version, uint8_t interface version, uint8_t return code  (VERSIONS_FLAG)
+ *     uint16_t  IPC request ID, uint8_t IPC return code                     (IPC_HEADER_FLAG)
+ *     payload
+ *   other frames :
+ *     uint16_t  IPC request ID
+ *     uint8_t   IPC return code
+ *     user data
+ *
+ * As with the native framing, the values are in native byte order, since both ends run on the same host.
+ */
+class CompactFraming {
+
+public:
+	static const size_t MAX_LENGTH_SIZE = 10;
+
+	static const uint8_t FILE_DESCRIPTOR_FLAG = 0x80;
+
+	enum class LengthStatus {
+		COMPLETE, INCOMPLETE, INVALID
+	};
+
+	/**
+	 * Appends the encoded frame of the given message to the given array
+	 * @param followingPayloadLength number of bytes which are not contained in the message, but written after the frame as the
+	 * end of its payload
+	 */
+	static void encode(const IPCMessage& msg, ByteArray& frame, size_t followingPayloadLength = 0) {
+
+		const IPCMessageHeader& ipcHeader = msg.getHeader();
+		const uint8_t* userData = msg.getUserData();
+		size_t userDataLength = msg.getUserDataLength();
+
+		uint8_t flags = 0;
+		size_t bodyLength;
+
+		if (ipcHeader.m_messageType == IPCMessageType::SEND_MESSAGE) {
+			assert( userDataLength >= sizeof(InputMessageHeader) );
+			const InputMessageHeader& header = *reinterpret_cast<const InputMessageHeader*>(userData);
+			flags = getFlags(ipcHeader, header);
+			bodyLength = SEND_MESSAGE_FIXED_SIZE + getOptionalFieldsSize(flags) + userDataLength - sizeof(InputMessageHeader);
+		} else
+			bodyLength = OTHER_FIXED_SIZE + userDataLength;
+
+		uint8_t lengthBuffer[MAX_LENGTH_SIZE];
+		size_t lengthSize = encodeLength(bodyLength + followingPayloadLength, lengthBuffer);
+
+		size_t framePosition = frame.size();
+		frame.resize(framePosition + lengthSize + bodyLength);
+		uint8_t* p = frame.getData() + framePosition;
+
+		p = write(p, lengthBuffer, lengthSize);
+		uint8_t messageType = static_cast<uint8_t>(ipcHeader.m_messageType);
+		if (msg.getFileDescriptor() != -1)
+			messageType |= FILE_DESCRIPTOR_FLAG;
+		p = write(p, messageType);
+
+		if (ipcHeader.m_messageType == IPCMessageType::SEND_MESSAGE) {
+			const InputMessageHeader& header = *reinterpret_cast<const InputMessageHeader*>(userData);
+			p = write(p, flags);
+			p = write(p, header.m_messageID);
+			p = write(p, header.m_requestID);
+			p = write(p, header.m_messageType);
+			if (flags & INSTANCE_ID_FLAG)
+				p = write(p, header.m_instanceID);
+			if (flags & CLIENT_IDENTIFIER_FLAG)
+				p = write(p, header.m_clientIdentifier);
+			if (flags & VERSIONS_FLAG) {
+				p = write(p, header.m_protocolVersion);
+				p = write(p, header.m_interfaceVersion);
+				p = write(p, header.m_returnCode);
+			}
+			if (flags & IPC_HEADER_FLAG) {
+				p = write(p, ipcHeader.m_requestID);
+				p = write(p, ipcHeader.m_returnCode);
+			}
+			write( p, userData + sizeof(InputMessageHeader), userDataLength - sizeof(InputMessageHeader) );
+		} else {
+			p = write(p, ipcHeader.m_requestID);
+			p = write(p, ipcHeader.m_returnCode);
+			write(p, userData, userDataLength);
+		}
+	}
+
+	/**
+	 * Decodes the varint at the beginning of a frame. lengthSize is set to the number of bytes used by the varint.
+	 */
+	static LengthStatus decodeLength(const uint8_t* data, size_t availableBytes, size_t& length, size_t& lengthSize) {
+		length = 0;
+		for (size_t i = 0; i < MAX_LENGTH_SIZE; i++) {
+			if (i == availableBytes)
+				return LengthStatus::INCOMPLETE;
+			length |= static_cast<size_t>(data[i] & 0x7F) << (7 * i);
+			if ( (data[i] & 0x80) == 0 ) {
+				lengthSize = i + 1;
+				return LengthStatus::COMPLETE;
+			}
+		}
+		return LengthStatus::INVALID;
+	}
+
+	/**
+	 * Returns true if a file descriptor has been sent together with the given frame, which starts after its length
+	 */
+	static bool hasFileDescriptor(const uint8_t* frame) {
+		return (frame[0] & FILE_DESCRIPTOR_FLAG);
+	}
+
+	/**
+	 * Decodes the given frame, which starts after its length, into the native layout of the given message
+	 * @return false if the frame is invalid
+	 */
+	static bool decode(const uint8_t* frame, size_t frameLength, IPCInputMessage& msg) {
+
+		if (frameLength < 1)
+			return false;
+
+		IPCMessageHeader ipcHeader;
+		ipcHeader.m_messageType = static_cast<IPCMessageType>(frame[0] & ~FILE_DESCRIPTOR_FLAG);
+		ipcHeader.m_requestID = 0;
+		ipcHeader.m_returnCode = IPCReturnCode::UNDEFINED;
+
+		const uint8_t* p = frame + 1;
+		const uint8_t* end = frame + frameLength;
+
+		if (ipcHeader.m_messageType == IPCMessageType::SEND_MESSAGE) {
+
+			if (frameLength < SEND_MESSAGE_FIXED_SIZE)
+				return false;
+
+			uint8_t flags;
+			p = read(p, flags);
+			if ( getOptionalFieldsSize(flags) > static_cast<size_t>(end - p) - (SEND_MESSAGE_FIXED_SIZE - 2) )
+				return false;
+
+			InputMessageHeader header;
+			header.m_clientIdentifier = 0;
+			p = read(p, header.m_messageID);
+			p = read(p, header.m_requestID);
+			p = read(p, header.m_messageType);
+			if (flags & INSTANCE_ID_FLAG)
+				p = read(p, header.m_instanceID);
+			if (flags & CLIENT_IDENTIFIER_FLAG)
+				p = read(p, header.m_clientIdentifier);
+			if (flags & VERSIONS_FLAG) {
+				p = read(p, header.m_protocolVersion);
+				p = read(p, header.m_interfaceVersion);
+				p = read(p, header.m_returnCode);
+			}
+			if (flags & IPC_HEADER_FLAG) {
+				p = read(p, ipcHeader.m_requestID);
+				p = read(p, ipcHeader.m_returnCode);
+			}
+
+			size_t payloadLength = end - p;
+			msg.setLength(sizeof(IPCMessageHeader) + sizeof(InputMessageHeader) + payloadLength);
+			uint8_t* data = msg.getPayload().getData();
+			data = write(data, ipcHeader);
+			new (data) InputMessageHeader(header);
+			write(data + sizeof(InputMessageHeader), p, payloadLength);
+
+		} else {
+
+			if (frameLength < OTHER_FIXED_SIZE)
+				return false;
+
+			p = read(p, ipcHeader.m_requestID);
+			p = read(p, ipcHeader.m_returnCode);
+
+			size_t userDataLength = end - p;
+			msg.setLength(sizeof(IPCMessageHeader) + userDataLength);
+			uint8_t* data = msg.getPayload().getData();
+			data = write(data, ipcHeader);
+			write(data, p, userDataLength);
+		}
+
+		return true;
+	}
+
+	/**
+	 * Decodes the header of a SEND_MESSAGE frame whose first availableBytes bytes have been received. The given message gets
+	 * the header without any payload, and headerLength is set to the number of bytes which precede the payload in the frame.
+	 */
+	static LengthStatus decodeHeader(const uint8_t* frame, size_t availableBytes, size_t frameLength, IPCInputMessage& msg,
+					 size_t& headerLength) {
+		if (availableBytes < 2)
+			return LengthStatus::INCOMPLETE;
+
+		headerLength = SEND_MESSAGE_FIXED_SIZE + getOptionalFieldsSize(frame[1]);
+		if (headerLength > frameLength)
+			return LengthStatus::INVALID;
+		if (availableBytes < headerLength)
+			return LengthStatus::INCOMPLETE;
+
+		return decode(frame, headerLength, msg) ? LengthStatus::COMPLETE : LengthStatus::INVALID;
+	}
+
+	static bool isSendMessage(const uint8_t* frame) {
+		return ( static_cast<IPCMessageType>(frame[0] & ~FILE_DESCRIPTOR_FLAG) == IPCMessageType::SEND_MESSAGE );
+	}
+
+	static size_t encodeLength(size_t length, uint8_t* buffer) {
+		size_t i = 0;
+		while (length >= 0x80) {
+			buffer[i++] = static_cast<uint8_t>(length) | 0x80;
+			length >>= 7;
+		}
+		buffer[i++] = static_cast<uint8_t>(length);
+		return i;
+	}
+
+private:
+	static const uint8_t INSTANCE_ID_FLAG = 0x01;
+	static const uint8_t CLIENT_IDENTIFIER_FLAG = 0x02;
+	static const uint8_t VERSIONS_FLAG = 0x04;
+	static const uint8_t IPC_HEADER_FLAG = 0x08;
+
+	/// Type, flags, message ID, request ID and message type
+	static const size_t SEND_MESSAGE_FIXED_SIZE = 1 + 1 + 4 + 4 + 1;
+
+	/// Type, IPC request ID and IPC return code
+	static const size_t OTHER_FIXED_SIZE = 1 + 2 + 1;
+
+	static uint8_t getFlags(const IPCMessageHeader& ipcHeader, const InputMessageHeader& header) {
+		uint8_t flags = 0;
+		if (header.m_instanceID != 0)
+			flags |= INSTANCE_ID_FLAG;
+		if (header.m_clientIdentifier != 0)
+			flags |= CLIENT_IDENTIFIER_FLAG;
+		if ( (header.m_protocolVersion != 1) || (header.m_interfaceVersion != 0) || (header.m_returnCode != SomeIP::E_OK) )
+			flags |= VERSIONS_FLAG;
+		if ( (ipcHeader.m_requestID != 0) || (ipcHeader.m_returnCode != IPCReturnCode::UNDEFINED) )
+			flags |= IPC_HEADER_FLAG;
+		return flags;
+	}
+
+	static size_t getOptionalFieldsSize(uint8_t flags) {
+		return ( (flags & INSTANCE_ID_FLAG) ? 2 : 0 ) + ( (flags & CLIENT_IDENTIFIER_FLAG) ? 2 : 0 ) +
+		       ( (flags & VERSIONS_FLAG) ? 3 : 0 ) + ( (flags & IPC_HEADER_FLAG) ? 3 : 0 );
+	}
+
+	template<typename T>
+	static uint8_t* write(uint8_t* p, const T& value) {
+		memcpy( p, &value, sizeof(value) );
+		return p + sizeof(value);
+	}
+
+	static uint8_t* write(uint8_t* p, const void* data, size_t length) {
+		memcpy(p, data, length);
+		return p + length;
+	}
+
+	template<typename T>
+	static const uint8_t* read(const uint8_t* p, T& value) {
+		memcpy( &value, p, sizeof(value) );
+		return p + sizeof(value);
+	}
+
+};
+
+}
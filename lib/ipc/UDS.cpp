@@ -2,14 +2,30 @@
 #include <assert.h>
 #include <sys/ioctl.h>
 #include <errno.h>
+#include <limits.h>
+#include <algorithm>
+
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+#define SOMEIP_ZEROCOPY_SUPPORTED
+#endif
 
 #include "SomeIP-common.h"
 #include "UDSConnection.h"
+#include "CompactFraming.h"
 
 namespace SomeIP_Lib {
 
 LOG_DECLARE_DEFAULT_CONTEXT(udsLogContext, "UDS", "UDS");
 
+const size_t UDSConnection::MAX_PACKET_SIZE;
+const size_t UDSConnection::RECEIVED_PACKETS_COUNT;
+const size_t UDSConnection::RECEPTION_CHUNK_SIZE;
+
+/// Size of the beginning of a SEND_MESSAGE in the native layout, which precedes its payload
+static const size_t STREAMED_MESSAGE_HEADER_SIZE = sizeof(IPCMessageHeader) + sizeof(InputMessageHeader);
+
 IPCOperationReport SocketStreamConnection::readBytesBlocking(void* buffer, size_t length) {
 
 	size_t receivedBytes = 0;
@@ -67,12 +83,64 @@ IPCOperationReport SocketStreamConnection::readAvailableData(void* buffer, size_
 
 IPCOperationReport UDSConnection::read(IPCInputMessage& msg, bool blocking) {
 
+	if ( isPacketMode() )
+		return readPacket(msg, blocking);
+
+	if (m_remainingStreamedBytes != 0) {
+		returnIfError( readStreamedPayload(blocking) );
+		if (m_remainingStreamedBytes != 0)
+			return IPCOperationReport::OK;
+	}
+
+	if (m_framing == IPCFraming::COMPACT)
+		return readCompact(msg, blocking);
+
 	if ( !m_messageLengthReader.isComplete() ) {
-		returnIfError( m_messageLengthReader.read(getFileDescriptor(), blocking) );
+		// file descriptors are always attached to the length field
+		returnIfError( m_messageLengthReader.read(getFileDescriptor(), blocking, &msg.m_fileDescriptor) );
+
+		if ( m_messageLengthReader.isComplete() ) {
+			m_isReadingStreamedHeader = (msg.getFileDescriptor() == UNINITIALIZED_FILE_DESCRIPTOR) &&
+						    (msg.getLength() > STREAMED_MESSAGE_HEADER_SIZE) &&
+						    isStreamingCandidate(msg.getLength() - STREAMED_MESSAGE_HEADER_SIZE, blocking);
+			if (m_isReadingStreamedHeader)
+				msg.getPayload().resize(STREAMED_MESSAGE_HEADER_SIZE);
+			else {
+				returnIfError( checkMessageLength( msg.getLength() ) );
+				msg.setLength( msg.getLength() );  // to make sure the buffer is allocated
+			}
+		}
+
+	}
+
+	if ( m_messageLengthReader.isComplete() && m_isReadingStreamedHeader ) {
+
+		uint8_t* header = msg.getPayload().getData();
+		if (blocking) {
+			returnIfError( readBytesBlocking(header + msg.getReceivedSize(), STREAMED_MESSAGE_HEADER_SIZE - msg.getReceivedSize()) );
+			msg.m_receivedSize = STREAMED_MESSAGE_HEADER_SIZE;
+		} else {
+			size_t readBytes;
+			returnIfError( readAvailableData(header + msg.getReceivedSize(), STREAMED_MESSAGE_HEADER_SIZE - msg.getReceivedSize(),
+							 readBytes) );
+			msg.m_receivedSize += readBytes;
+			if (msg.getReceivedSize() < STREAMED_MESSAGE_HEADER_SIZE)
+				return IPCOperationReport::OK;
+		}
+
+		m_isReadingStreamedHeader = false;
 
-		if ( m_messageLengthReader.isComplete() )
-			msg.setLength( msg.getLength() );  // to make sure the buffer is allocated
+		if (msg.getMessageType() == IPCMessageType::SEND_MESSAGE) {
+			m_streamedMessage.setContent(header, STREAMED_MESSAGE_HEADER_SIZE);
+			if ( startStream(msg.getLength() - STREAMED_MESSAGE_HEADER_SIZE, nullptr, 0) ) {
+				resetInputMessage(msg);
+				return read(msg, blocking);
+			}
+		}
 
+		// the message is buffered as usual. The header which has been read is kept
+		returnIfError( checkMessageLength( msg.getLength() ) );
+		msg.getPayload().resize( msg.getLength() );
 	}
 
 	if ( m_messageLengthReader.isComplete() ) {
@@ -94,11 +162,356 @@ IPCOperationReport UDSConnection::read(IPCInputMessage& msg, bool blocking) {
 	return IPCOperationReport::OK;
 }
 
+IPCOperationReport UDSConnection::readCompact(IPCInputMessage& msg, bool blocking) {
+
+	while (true) {
+
+		// decode the next frame if it has been entirely received
+		const uint8_t* data = m_receptionBuffer.data() + m_receptionBufferBegin;
+		size_t availableBytes = m_receptionBufferEnd - m_receptionBufferBegin;
+		size_t frameLength = 0;
+		size_t lengthSize = 0;
+
+		auto lengthStatus = CompactFraming::decodeLength(data, availableBytes, frameLength, lengthSize);
+
+		if (lengthStatus == CompactFraming::LengthStatus::INVALID) {
+			log_error() << "Invalid frame length received from " << toString();
+			disconnect();
+			return IPCOperationReport::DISCONNECTED;
+		}
+
+		if ( (lengthStatus == CompactFraming::LengthStatus::COMPLETE) && (availableBytes - lengthSize >= frameLength) ) {
+			const uint8_t* frame = data + lengthSize;
+
+			returnIfError( checkMessageLength(frameLength) );
+
+			if ( !CompactFraming::decode(frame, frameLength, msg) ) {
+				log_error() << "Invalid frame received from " << toString();
+				disconnect();
+				return IPCOperationReport::DISCONNECTED;
+			}
+
+			// the file descriptors are received in the order of their frames
+			if ( CompactFraming::hasFileDescriptor(frame) && !m_receivedFileDescriptors.empty() ) {
+				msg.m_fileDescriptor = m_receivedFileDescriptors.front();
+				m_receivedFileDescriptors.pop_front();
+			}
+
+			msg.m_receivedSize = msg.getLength();
+			m_receptionBufferBegin += lengthSize + frameLength;
+			m_isStreamRefused = false;
+			return IPCOperationReport::OK;
+		}
+
+		// the header of a large frame is decoded as soon as it is available, to find out whether its payload can be streamed
+		bool isWaitingForStreamedHeader = false;
+
+		if (lengthStatus == CompactFraming::LengthStatus::COMPLETE) {
+
+			if ( !m_isStreamRefused && isStreamingCandidate(frameLength, blocking) ) {
+				const uint8_t* frame = data + lengthSize;
+				size_t receivedFrameBytes = availableBytes - lengthSize;
+				size_t headerLength = 0;
+				auto headerStatus = CompactFraming::LengthStatus::INVALID;
+
+				if (receivedFrameBytes == 0)
+					headerStatus = CompactFraming::LengthStatus::INCOMPLETE;
+				else if ( CompactFraming::isSendMessage(frame) && !CompactFraming::hasFileDescriptor(frame) )
+					headerStatus = CompactFraming::decodeHeader(frame, receivedFrameBytes, frameLength, m_streamedMessage,
+										    headerLength);
+
+				if ( (headerStatus == CompactFraming::LengthStatus::COMPLETE) &&
+				     startStream(frameLength - headerLength, frame + headerLength, receivedFrameBytes - headerLength) ) {
+					// the frame is incomplete, so all the buffered bytes belong to it
+					m_receptionBufferBegin = m_receptionBufferEnd = 0;
+					return read(msg, blocking);
+				}
+
+				if (headerStatus == CompactFraming::LengthStatus::INCOMPLETE)
+					isWaitingForStreamedHeader = true;
+				else
+					m_isStreamRefused = true;
+			}
+
+			if (!isWaitingForStreamedHeader)
+				returnIfError( checkMessageLength(frameLength) );
+		}
+
+		// move the incomplete frame to the beginning of the buffer, and make room for the rest of it
+		if (m_receptionBufferBegin != 0) {
+			memmove(m_receptionBuffer.data(), data, availableBytes);
+			m_receptionBufferBegin = 0;
+			m_receptionBufferEnd = availableBytes;
+		}
+
+		size_t requiredSize = RECEPTION_CHUNK_SIZE;
+		if ( (lengthStatus == CompactFraming::LengthStatus::COMPLETE) && !isWaitingForStreamedHeader )
+			requiredSize = std::max(requiredSize, lengthSize + frameLength);
+		if (m_receptionBuffer.size() < requiredSize)
+			m_receptionBuffer.resize(requiredSize);
+
+		int fileDescriptor = UNINITIALIZED_FILE_DESCRIPTOR;
+		ssize_t readLength = IPCBufferReader::receiveWithFileDescriptor(getFileDescriptor(),
+										m_receptionBuffer.data() + m_receptionBufferEnd,
+										m_receptionBuffer.size() - m_receptionBufferEnd,
+										blocking, fileDescriptor);
+
+		if (fileDescriptor != UNINITIALIZED_FILE_DESCRIPTOR)
+			m_receivedFileDescriptors.push_back(fileDescriptor);
+
+		if (readLength < 0) {
+			if ( !blocking && ( (errno == EAGAIN) || (errno == EWOULDBLOCK) ) )
+				return IPCOperationReport::OK;
+			disconnect();
+			return IPCOperationReport::DISCONNECTED;
+		}
+
+		if (readLength == 0) {
+			if (blocking) {
+				disconnect();
+				return IPCOperationReport::DISCONNECTED;
+			}
+			return IPCOperationReport::OK;
+		}
+
+		m_receptionBufferEnd += readLength;
+	}
+
+}
+
+bool UDSConnection::startStream(size_t payloadLength, const void* receivedPayload, size_t receivedLength) {
+
+	if ( !beginStreamedMessage(m_streamedMessage, payloadLength) )
+		return false;
+
+	m_remainingStreamedBytes = payloadLength - receivedLength;
+	deliverStreamedChunk(receivedPayload, receivedLength);
+	return true;
+}
+
+IPCOperationReport UDSConnection::readStreamedPayload(bool blocking) {
+
+	// in compact mode, the reception buffer is empty during a stream, since the bytes of the next frame are never read
+	if (m_receptionBuffer.size() < RECEPTION_CHUNK_SIZE)
+		m_receptionBuffer.resize(RECEPTION_CHUNK_SIZE);
+
+	while (m_remainingStreamedBytes != 0) {
+
+		size_t length = std::min(m_remainingStreamedBytes, RECEPTION_CHUNK_SIZE);
+
+		if (blocking) {
+			returnIfError( readBytesBlocking(m_receptionBuffer.data(), length) );
+		} else {
+			size_t readBytes;
+			returnIfError( readAvailableData(m_receptionBuffer.data(), length, readBytes) );
+			if (readBytes == 0)
+				return IPCOperationReport::OK;
+			length = readBytes;
+		}
+
+		m_remainingStreamedBytes -= length;
+		deliverStreamedChunk(m_receptionBuffer.data(), length);
+	}
+
+	return IPCOperationReport::OK;
+}
+
+void UDSConnection::deliverStreamedChunk(const void* data, size_t length) {
+	if ( (length != 0) || (m_remainingStreamedBytes == 0) )
+		onStreamedChunk(m_streamedMessage, data, length, m_remainingStreamedBytes == 0);
+}
+
+IPCOperationReport UDSConnection::checkMessageLength(size_t length) {
+	if ( (m_maximumMessageSize != 0) && (length > m_maximumMessageSize) ) {
+		log_error() << "Message of " << length << " bytes received from " << toString() << ", which exceeds the maximum of " <<
+			m_maximumMessageSize << " bytes";
+		disconnect();
+		return IPCOperationReport::DISCONNECTED;
+	}
+	return IPCOperationReport::OK;
+}
+
+/**
+ * Returns the file descriptor received as ancillary data of the given message, or -1
+ */
+static int takeReceivedFileDescriptor(struct msghdr& msg) {
+	int receivedFileDescriptor = SocketStreamConnection::UNINITIALIZED_FILE_DESCRIPTOR;
+	for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg) ) {
+		if ( (cmsg->cmsg_level == SOL_SOCKET) && (cmsg->cmsg_type == SCM_RIGHTS) ) {
+			if (receivedFileDescriptor != SocketStreamConnection::UNINITIALIZED_FILE_DESCRIPTOR)
+				close(receivedFileDescriptor);
+			memcpy( &receivedFileDescriptor, CMSG_DATA(cmsg), sizeof(receivedFileDescriptor) );
+		}
+	}
+	return receivedFileDescriptor;
+}
+
+IPCOperationReport UDSConnection::receivePackets(bool blocking) {
+
+	assert( m_nextPacket == m_receivedPackets.size() );
+	m_receivedPackets.resize(0);
+	m_nextPacket = 0;
+
+	// the slots are never read beyond the received length, so there is no need to initialize them
+	if (!m_packetBuffer)
+		m_packetBuffer.reset(new uint8_t[MAX_PACKET_SIZE * RECEIVED_PACKETS_COUNT]);
+
+	struct mmsghdr packets[RECEIVED_PACKETS_COUNT];
+	struct iovec vectors[RECEIVED_PACKETS_COUNT];
+	char controlBuffers[RECEIVED_PACKETS_COUNT][CMSG_SPACE( sizeof(int) )];
+	memset( packets, 0, sizeof(packets) );
+
+	for (size_t i = 0; i < RECEIVED_PACKETS_COUNT; i++) {
+		vectors[i].iov_base = m_packetBuffer.get() + i * MAX_PACKET_SIZE;
+		vectors[i].iov_len = MAX_PACKET_SIZE;
+		packets[i].msg_hdr.msg_iov = &vectors[i];
+		packets[i].msg_hdr.msg_iovlen = 1;
+		packets[i].msg_hdr.msg_control = controlBuffers[i];
+		packets[i].msg_hdr.msg_controllen = sizeof(controlBuffers[i]);
+	}
+
+	// in blocking mode, only the first packet is waited for
+	int flags = MSG_CMSG_CLOEXEC | (blocking ? MSG_WAITFORONE : MSG_DONTWAIT);
+
+	int packetCount;
+	do {
+		packetCount = recvmmsg(getFileDescriptor(), packets, RECEIVED_PACKETS_COUNT, flags, nullptr);
+	} while ( (packetCount < 0) && (errno == EINTR) );
+
+	if (packetCount < 0) {
+		if ( !blocking && ( (errno == EAGAIN) || (errno == EWOULDBLOCK) ) )
+			return IPCOperationReport::OK;
+		disconnect();
+		return IPCOperationReport::DISCONNECTED;
+	}
+
+	bool isValid = (packetCount != 0);
+
+	for (int i = 0; i < packetCount; i++) {
+		ReceivedPacket packet;
+		packet.m_size = packets[i].msg_len;
+		packet.m_fileDescriptor = takeReceivedFileDescriptor(packets[i].msg_hdr);
+		m_receivedPackets.push_back(packet);
+
+		// an empty packet means that the peer has closed the connection, since we never send any
+		if ( (packet.m_size == 0) || (packets[i].msg_hdr.msg_flags & (MSG_TRUNC | MSG_CTRUNC) ) )
+			isValid = false;
+	}
+
+	if (!isValid) {
+		if (packetCount != 0)
+			log_error() << "Invalid packet received from " << toString();
+		for (auto& packet : m_receivedPackets)
+			if (packet.m_fileDescriptor != UNINITIALIZED_FILE_DESCRIPTOR)
+				close(packet.m_fileDescriptor);
+		m_receivedPackets.resize(0);
+		disconnect();
+		return IPCOperationReport::DISCONNECTED;
+	}
+
+	return IPCOperationReport::OK;
+}
+
+IPCOperationReport UDSConnection::readPacket(IPCInputMessage& msg, bool blocking) {
+
+	while (true) {
+
+		if ( m_nextPacket == m_receivedPackets.size() ) {
+			returnIfError( receivePackets(blocking) );
+			if ( m_receivedPackets.empty() )
+				return IPCOperationReport::OK;  // nothing available yet
+		}
+
+		const uint8_t* data = m_packetBuffer.get() + m_nextPacket * MAX_PACKET_SIZE;
+		ReceivedPacket packet = m_receivedPackets[m_nextPacket++];
+		bool isValid = true;
+
+		if (m_remainingStreamedBytes != 0) {
+
+			// continuation of a streamed message
+			if ( (packet.m_size > m_remainingStreamedBytes) || (packet.m_fileDescriptor != UNINITIALIZED_FILE_DESCRIPTOR) )
+				isValid = false;
+			else {
+				m_remainingStreamedBytes -= packet.m_size;
+				deliverStreamedChunk(data, packet.m_size);
+				continue;
+			}
+
+		} else if ( !msg.isLengthReceived() ) {
+
+			// first packet of a message
+			const IPCMessageHeader* header = reinterpret_cast<const IPCMessageHeader*>(data);
+
+			if ( packet.m_size < sizeof(IPCMessageHeader) )
+				isValid = false;
+			else if (header->m_messageType == IPCMessageType::LARGE_MESSAGE) {
+				uint64_t totalLength = 0;
+				if (packet.m_size >= LARGE_MESSAGE_HEADER_SIZE)
+					memcpy( &totalLength, data + sizeof(IPCMessageHeader), sizeof(totalLength) );
+				size_t chunkSize = packet.m_size - LARGE_MESSAGE_HEADER_SIZE;
+				const uint8_t* chunk = data + LARGE_MESSAGE_HEADER_SIZE;
+				if ( (packet.m_size < LARGE_MESSAGE_HEADER_SIZE) || (totalLength <= chunkSize) ) {
+					isValid = false;
+				} else {
+					if ( (chunkSize >= STREAMED_MESSAGE_HEADER_SIZE) &&
+					     (reinterpret_cast<const IPCMessageHeader*>(chunk)->m_messageType == IPCMessageType::SEND_MESSAGE) &&
+					     (packet.m_fileDescriptor == UNINITIALIZED_FILE_DESCRIPTOR) &&
+					     isStreamingCandidate(totalLength - STREAMED_MESSAGE_HEADER_SIZE, blocking) ) {
+						m_streamedMessage.setContent(chunk, STREAMED_MESSAGE_HEADER_SIZE);
+						if ( startStream(totalLength - STREAMED_MESSAGE_HEADER_SIZE, chunk + STREAMED_MESSAGE_HEADER_SIZE,
+								 chunkSize - STREAMED_MESSAGE_HEADER_SIZE) )
+							continue;
+					}
+
+					if ( isError( checkMessageLength(totalLength) ) ) {
+						if (packet.m_fileDescriptor != UNINITIALIZED_FILE_DESCRIPTOR)
+							close(packet.m_fileDescriptor);
+						return IPCOperationReport::DISCONNECTED;
+					}
+
+					msg.setLength(totalLength);
+					memcpy(msg.getPayload().getData(), chunk, chunkSize);
+					msg.m_receivedSize = chunkSize;
+				}
+			} else {
+				msg.setContent(data, packet.m_size);
+			}
+
+			if (isValid)
+				msg.m_fileDescriptor = packet.m_fileDescriptor;
+
+		} else {
+
+			// continuation of a large message
+			if ( (packet.m_size > msg.getLength() - msg.getReceivedSize() ) ||
+			     (packet.m_fileDescriptor != UNINITIALIZED_FILE_DESCRIPTOR) )
+				isValid = false;
+			else {
+				memcpy(msg.getPayload().getData() + msg.getReceivedSize(), data, packet.m_size);
+				msg.m_receivedSize += packet.m_size;
+			}
+
+		}
+
+		if (!isValid) {
+			if (packet.m_fileDescriptor != UNINITIALIZED_FILE_DESCRIPTOR)
+				close(packet.m_fileDescriptor);
+			log_error() << "Invalid packet received from " << toString();
+			disconnect();
+			return IPCOperationReport::DISCONNECTED;
+		}
+
+		if ( msg.isComplete() )
+			return IPCOperationReport::OK;
+	}
+
+}
+
 IPCOperationReport UDSConnection::readNonBlocking(IPCInputMessage& msg) {
 	return read(msg, false);
 }
 
-IPCOperationReport SocketStreamConnection::writeBytesBlocking(const void* buffer, ssize_t length) {
+IPCOperationReport SocketStreamConnection::writeBytesBlocking(const void* buffer, ssize_t length, int fileDescriptor) {
 
 	assert(getFileDescriptor() != UNINITIALIZED_FILE_DESCRIPTOR);
 
@@ -107,7 +520,14 @@ IPCOperationReport SocketStreamConnection::writeBytesBlocking(const void* buffer
 	ssize_t sentBytes = 0;
 
 	while (sentBytes < length) {
-		auto n = send(getFileDescriptor(), static_cast<const char*>(buffer) + sentBytes, length - sentBytes, MSG_DONTWAIT);
+		ssize_t n;
+		if (fileDescriptor != UNINITIALIZED_FILE_DESCRIPTOR) {
+			n = sendWithFileDescriptor(static_cast<const char*>(buffer) + sentBytes, length - sentBytes, fileDescriptor,
+						   MSG_DONTWAIT);
+			if (n > 0)
+				fileDescriptor = UNINITIALIZED_FILE_DESCRIPTOR;  // the descriptor has been transferred with the first bytes
+		} else
+			n = send(getFileDescriptor(), static_cast<const char*>(buffer) + sentBytes, length - sentBytes, MSG_DONTWAIT);
 
 		if (n < 0)
 			if (errno != EAGAIN) {
@@ -131,6 +551,223 @@ IPCOperationReport SocketStreamConnection::writeBytesBlocking(const void* buffer
 	return IPCOperationReport::OK;
 }
 
+IPCOperationReport SocketStreamConnection::writeVectorBlocking(struct iovec* vectors, size_t vectorCount) {
+
+	assert(getFileDescriptor() != UNINITIALIZED_FILE_DESCRIPTOR);
+
+	while (vectorCount != 0) {
+
+		struct msghdr msg = {};
+		msg.msg_iov = vectors;
+		msg.msg_iovlen = std::min(vectorCount, static_cast<size_t>(IOV_MAX) );
+
+		ssize_t n = sendmsg(getFileDescriptor(), &msg, MSG_DONTWAIT);
+
+		if (n < 0) {
+			if (errno != EAGAIN) {
+				disconnect();
+				return IPCOperationReport::DISCONNECTED;
+			}
+			log_verbose() << "Reception buffer is full";
+			onCongestionDetected();
+			continue;
+		}
+
+		increaseWrittenBytesCounter(n);
+
+		// skip the buffers which have been entirely sent
+		size_t sentBytes = n;
+		while ( (vectorCount != 0) && (sentBytes >= vectors->iov_len) ) {
+			sentBytes -= vectors->iov_len;
+			vectors++;
+			vectorCount--;
+		}
+
+		if (sentBytes != 0) {
+			vectors->iov_base = static_cast<char*>(vectors->iov_base) + sentBytes;
+			vectors->iov_len -= sentBytes;
+		}
+	}
+
+	return IPCOperationReport::OK;
+}
+
+IPCOperationReport SocketStreamConnection::writePacketsBlocking(struct mmsghdr* packets, size_t packetCount) {
+
+	assert(getFileDescriptor() != UNINITIALIZED_FILE_DESCRIPTOR);
+
+	while (packetCount != 0) {
+
+		int n = sendmmsg(getFileDescriptor(), packets, std::min( packetCount, static_cast<size_t>(UIO_MAXIOV) ), MSG_DONTWAIT);
+
+		if (n < 0) {
+			if (errno != EAGAIN) {
+				disconnect();
+				return IPCOperationReport::DISCONNECTED;
+			}
+			log_verbose() << "Reception buffer is full";
+			onCongestionDetected();
+			continue;
+		}
+
+		// each packet is either entirely sent or not sent at all
+		for (int i = 0; i < n; i++)
+			increaseWrittenBytesCounter(packets[i].msg_len);
+
+		packets += n;
+		packetCount -= n;
+	}
+
+	return IPCOperationReport::OK;
+}
+
+IPCOperationReport SocketStreamConnection::writeVectorNonBlocking(const struct iovec* vectors, size_t vectorCount,
+								   std::shared_ptr<const void> zeroCopyOwner) {
+
+	assert(getFileDescriptor() != UNINITIALIZED_FILE_DESCRIPTOR);
+	assert(!m_isPacketMode);
+
+	size_t length = 0;
+	for (size_t i = 0; i < vectorCount; i++)
+		length += vectors[i].iov_len;
+
+	ssize_t writtenBytesCount = 0;
+
+	// the pending data must be sent first, to keep the order
+	if ( !isCongested() ) {
+
+		struct msghdr msg = {};
+		msg.msg_iov = const_cast<struct iovec*>(vectors);
+		msg.msg_iovlen = std::min( vectorCount, static_cast<size_t>(IOV_MAX) );
+
+		int flags = MSG_DONTWAIT;
+#ifdef SOMEIP_ZEROCOPY_SUPPORTED
+		bool isZeroCopy = m_isZeroCopyEnabled && (zeroCopyOwner != nullptr);
+		if (isZeroCopy)
+			flags |= MSG_ZEROCOPY;
+#endif
+
+		writtenBytesCount = sendmsg(getFileDescriptor(), &msg, flags);
+
+#ifdef SOMEIP_ZEROCOPY_SUPPORTED
+		if ( (writtenBytesCount < 0) && isZeroCopy && (errno == ENOBUFS) ) {
+			// the pages could not be pinned (locked memory limit reached), so we let the kernel copy them
+			isZeroCopy = false;
+			writtenBytesCount = sendmsg(getFileDescriptor(), &msg, MSG_DONTWAIT);
+		}
+#endif
+
+		if (writtenBytesCount < 0) {
+			if (errno != EAGAIN) {
+				log_error() << "Unknown error : " << errno << " . " << toString();
+				disconnect();
+				return IPCOperationReport::DISCONNECTED;
+			}
+			log_info() << "Congestion detected fileDescriptor: " << getFileDescriptor();
+			writtenBytesCount = 0;
+		}
+
+#ifdef SOMEIP_ZEROCOPY_SUPPORTED
+		// each zero-copy call which has sent some bytes is numbered by the kernel, starting from 0
+		if (isZeroCopy && (writtenBytesCount > 0) ) {
+			PendingZeroCopyBuffer buffer;
+			buffer.m_sequenceNumber = m_nextZeroCopySequenceNumber++;
+			buffer.m_owner = std::move(zeroCopyOwner);
+			m_pendingZeroCopyBuffers.push_back( std::move(buffer) );
+		}
+#endif
+
+		increaseWrittenBytesCounter(writtenBytesCount);
+
+		if (static_cast<size_t>(writtenBytesCount) == length)
+			return IPCOperationReport::OK;
+	}
+
+	// enqueue the bytes which have not been written
+	size_t skippedBytes = writtenBytesCount;
+	for (size_t i = 0; i < vectorCount; i++) {
+		if (skippedBytes >= vectors[i].iov_len) {
+			skippedBytes -= vectors[i].iov_len;
+			continue;
+		}
+		m_dataToBeSent.append(static_cast<const char*>(vectors[i].iov_base) + skippedBytes, vectors[i].iov_len - skippedBytes);
+		skippedBytes = 0;
+	}
+	onCongestionDetected();
+
+	return IPCOperationReport::BUFFER_FULL;
+}
+
+bool SocketStreamConnection::enableZeroCopy() {
+#ifdef SOMEIP_ZEROCOPY_SUPPORTED
+	int on = 1;
+	if ( setsockopt( getFileDescriptor(), SOL_SOCKET, SO_ZEROCOPY, &on, sizeof(on) ) == 0 ) {
+		m_isZeroCopyEnabled = true;
+		return true;
+	}
+	log_info() << "Zero-copy transmissions not supported by " << toString() << ". Error : " << strerror(errno);
+#endif
+	return false;
+}
+
+IPCOperationReport SocketStreamConnection::processZeroCopyCompletions() {
+
+#ifdef SOMEIP_ZEROCOPY_SUPPORTED
+	while (true) {
+
+		char controlBuffer[CMSG_SPACE( sizeof(struct sock_extended_err) + sizeof(struct sockaddr_in6) )];
+
+		struct msghdr msg = {};
+		msg.msg_control = controlBuffer;
+		msg.msg_controllen = sizeof(controlBuffer);
+
+		if (recvmsg(getFileDescriptor(), &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+			// once the error queue is empty, POLLERR might still be caused by an error on the connection itself
+			int error = 0;
+			socklen_t errorSize = sizeof(error);
+			if ( (errno == EAGAIN) && (getsockopt(getFileDescriptor(), SOL_SOCKET, SO_ERROR, &error, &errorSize) == 0) &&
+			     (error == 0) )
+				return IPCOperationReport::OK;
+			disconnect();
+			return IPCOperationReport::DISCONNECTED;
+		}
+
+		for ( struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg) ) {
+
+			if ( !( ( (cmsg->cmsg_level == SOL_IP) && (cmsg->cmsg_type == IP_RECVERR) ) ||
+				( (cmsg->cmsg_level == SOL_IPV6) && (cmsg->cmsg_type == IPV6_RECVERR) ) ) )
+				continue;
+
+			struct sock_extended_err error;
+			memcpy( &error, CMSG_DATA(cmsg), sizeof(error) );
+			if ( (error.ee_origin != SO_EE_ORIGIN_ZEROCOPY) || (error.ee_errno != 0) )
+				continue;
+
+			releaseZeroCopyBuffers(error.ee_info, error.ee_data);
+
+			// the kernel had to copy the data anyway (loopback, or no scatter-gather support on the device), in which case
+			// pinning the pages only costs some CPU
+			if ( (error.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) && m_isZeroCopyEnabled ) {
+				log_info() << "Zero-copy transmissions disabled, since the kernel copies the data sent to " << toString();
+				m_isZeroCopyEnabled = false;
+			}
+		}
+	}
+#else
+	return IPCOperationReport::OK;
+#endif
+}
+
+void SocketStreamConnection::releaseZeroCopyBuffers(uint32_t firstSequenceNumber, uint32_t lastSequenceNumber) {
+	// the range is inclusive, and the sequence numbers wrap around
+	uint32_t rangeLength = lastSequenceNumber - firstSequenceNumber;
+	auto end = std::remove_if( m_pendingZeroCopyBuffers.begin(), m_pendingZeroCopyBuffers.end(),
+				   [&] (const PendingZeroCopyBuffer& buffer) {
+					   return (static_cast<uint32_t>(buffer.m_sequenceNumber - firstSequenceNumber) <= rangeLength);
+				   });
+	m_pendingZeroCopyBuffers.erase( end, m_pendingZeroCopyBuffers.end() );
+}
+
 void setSocketBufferSize(int fd, int size) {
 	int buffsize = size;
 	int actualBufferSize;
@@ -153,9 +790,17 @@ void setSocketBufferSize(int fd, int size) {
 
 IPCOperationReport UDSConnection::writeBlocking(const IPCMessage& msg) {
 
+	if ( isPacketMode() )
+		return writePacketBlocking(msg);
+
+	if (m_framing == IPCFraming::COMPACT) {
+		const IPCMessage* messages[] = {&msg};
+		return writeCompactBlocking(messages, 1);
+	}
+
 	// write length
 	auto size = msg.getPayload().size();
-	returnIfError( writeBytesBlocking( &size, sizeof(size) ) );
+	returnIfError( writeBytesBlocking( &size, sizeof(size), msg.getFileDescriptor() ) );
 
 	// write payload
 	returnIfError( writeBytesBlocking( msg.getPayload().getData(), msg.getPayload().size() ) );
@@ -165,17 +810,218 @@ IPCOperationReport UDSConnection::writeBlocking(const IPCMessage& msg) {
 	return IPCOperationReport::OK;
 }
 
+IPCOperationReport UDSConnection::writeCompactBlocking(const IPCMessage* const* messages, size_t messageCount) {
+
+	// the frames are encoded into a single buffer, which is written with a single system call
+	ByteArray frames;
+
+	for (size_t i = 0; i < messageCount; i++) {
+		const IPCMessage& msg = *messages[i];
+
+		if (msg.getFileDescriptor() != UNINITIALIZED_FILE_DESCRIPTOR) {
+			// the descriptor needs to be attached to the first byte of its own frame
+			if (frames.size() != 0)
+				returnIfError( writeBytesBlocking( frames.getData(), frames.size() ) );
+			frames.resize(0);
+			CompactFraming::encode(msg, frames);
+			returnIfError( writeBytesBlocking( frames.getData(), frames.size(), msg.getFileDescriptor() ) );
+			frames.resize(0);
+		} else
+			CompactFraming::encode(msg, frames);
+
+		log_traffic() << "Written IPCMessage : " << msg.toString();
+	}
+
+	if (frames.size() != 0)
+		returnIfError( writeBytesBlocking( frames.getData(), frames.size() ) );
+
+	return IPCOperationReport::OK;
+}
+
+void UDSConnection::encodeLargeMessageHeader(const IPCMessage& msg, ByteArray& packet) {
+	IPCMessageHeader header = msg.getHeader();
+	header.m_messageType = IPCMessageType::LARGE_MESSAGE;
+	uint64_t totalLength = msg.getPayload().size();
+
+	packet.resize(0);
+	packet.append( &header, sizeof(header) );
+	packet.append( &totalLength, sizeof(totalLength) );
+	packet.append(msg.getPayload().getData(), MAX_PACKET_SIZE - LARGE_MESSAGE_HEADER_SIZE);
+}
+
+IPCOperationReport UDSConnection::writePacketBlocking(const IPCMessage& msg) {
+
+	const uint8_t* payload = msg.getPayload().getData();
+	size_t length = msg.getPayload().size();
+
+	if (length <= MAX_PACKET_SIZE) {
+		returnIfError( writeBytesBlocking( payload, length, msg.getFileDescriptor() ) );
+	} else {
+		ByteArray packet;
+		encodeLargeMessageHeader(msg, packet);
+		returnIfError( writeBytesBlocking( packet.getData(), packet.size(), msg.getFileDescriptor() ) );
+		for (size_t position = MAX_PACKET_SIZE - LARGE_MESSAGE_HEADER_SIZE; position < length; position += MAX_PACKET_SIZE)
+			returnIfError( writeBytesBlocking( payload + position, std::min(MAX_PACKET_SIZE, length - position) ) );
+	}
+
+	log_traffic() << "Written IPCMessage : " << msg.toString();
+
+	return IPCOperationReport::OK;
+}
+
+IPCOperationReport UDSConnection::writeMessagePacketsBlocking(const IPCMessage* const* messages, size_t messageCount) {
+
+	// the messages which fit in a single packet are sent together
+	std::vector<struct mmsghdr> packets;
+	std::vector<struct iovec> vectors(messageCount);
+	packets.reserve(messageCount);
+
+	for (size_t i = 0; i < messageCount; i++) {
+		const IPCMessage& msg = *messages[i];
+
+		if ( (msg.getFileDescriptor() != UNINITIALIZED_FILE_DESCRIPTOR) || (msg.getPayload().size() > MAX_PACKET_SIZE) ) {
+			returnIfError( writePacketsBlocking( packets.data(), packets.size() ) );
+			packets.resize(0);
+			returnIfError( writePacketBlocking(msg) );
+			continue;
+		}
+
+		vectors[i].iov_base = const_cast<unsigned char*>( msg.getPayload().getData() );
+		vectors[i].iov_len = msg.getPayload().size();
+
+		struct mmsghdr packet = {};
+		packet.msg_hdr.msg_iov = &vectors[i];
+		packet.msg_hdr.msg_iovlen = 1;
+		packets.push_back(packet);
+
+		log_traffic() << "Written IPCMessage : " << msg.toString();
+	}
+
+	return writePacketsBlocking( packets.data(), packets.size() );
+}
+
+IPCOperationReport UDSConnection::writeBlocking(const IPCMessage* const* messages, size_t messageCount) {
+
+	if ( isPacketMode() )
+		return writeMessagePacketsBlocking(messages, messageCount);
+
+	if (m_framing == IPCFraming::COMPACT)
+		return writeCompactBlocking(messages, messageCount);
+
+	// two buffers per message : the length and the payload
+	std::vector<size_t> sizes(messageCount);
+	std::vector<struct iovec> vectors;
+	vectors.reserve(messageCount * 2);
+
+	for (size_t i = 0; i < messageCount; i++) {
+		const IPCMessage& msg = *messages[i];
+
+		if (msg.getFileDescriptor() != UNINITIALIZED_FILE_DESCRIPTOR) {
+			// the descriptor needs to be attached to the length of its own message
+			returnIfError( writeVectorBlocking( vectors.data(), vectors.size() ) );
+			vectors.resize(0);
+			returnIfError( writeBlocking(msg) );
+			continue;
+		}
+
+		sizes[i] = msg.getPayload().size();
+
+		struct iovec vector;
+		vector.iov_base = &sizes[i];
+		vector.iov_len = sizeof(sizes[i]);
+		vectors.push_back(vector);
+
+		vector.iov_base = const_cast<unsigned char*>( msg.getPayload().getData() );
+		vector.iov_len = msg.getPayload().size();
+		vectors.push_back(vector);
+
+		log_traffic() << "Written IPCMessage : " << msg.toString();
+	}
+
+	return writeVectorBlocking( vectors.data(), vectors.size() );
+}
+
+IPCOperationReport UDSConnection::writePacketNonBlocking(const IPCMessage& msg) {
+
+	const uint8_t* payload = msg.getPayload().getData();
+	size_t length = msg.getPayload().size();
+
+	ByteArray largeMessageHeader;
+	const uint8_t* packet = payload;
+	size_t packetLength = length;
+	if (length > MAX_PACKET_SIZE) {
+		encodeLargeMessageHeader(msg, largeMessageHeader);
+		packet = largeMessageHeader.getData();
+		packetLength = largeMessageHeader.size();
+	}
+
+	// once the socket is congested, the remaining packets are queued
+	auto report = IPCOperationReport::OK;
+	int fileDescriptor = msg.getFileDescriptor();
+	size_t position = (length > MAX_PACKET_SIZE) ? MAX_PACKET_SIZE - LARGE_MESSAGE_HEADER_SIZE : length;
+
+	while (true) {
+		if ( isCongested() ) {
+			enqueueData(packet, packetLength, fileDescriptor);
+			report = IPCOperationReport::BUFFER_FULL;
+		} else {
+			auto writeReport = writeBytesNonBlocking(packet, packetLength, fileDescriptor);
+			if (writeReport == IPCOperationReport::DISCONNECTED)
+				return writeReport;
+			if (writeReport == IPCOperationReport::BUFFER_FULL)
+				report = writeReport;
+		}
+
+		if (position == length)
+			break;
+
+		fileDescriptor = UNINITIALIZED_FILE_DESCRIPTOR;
+		packet = payload + position;
+		packetLength = std::min(MAX_PACKET_SIZE, length - position);
+		position += packetLength;
+	}
+
+	return report;
+}
+
+void UDSConnection::encodeFrameHeader(const IPCMessage& msg, size_t payloadLength, ByteArray& frame) const {
+
+	assert( !isPacketMode() );
+
+	if (m_framing == IPCFraming::COMPACT) {
+		CompactFraming::encode(msg, frame, payloadLength);
+		return;
+	}
+
+	size_t size = msg.getPayload().size() + payloadLength;
+	frame.append( &size, sizeof(size) );
+	frame.append( msg.getPayload().getData(), msg.getPayload().size() );
+}
+
 IPCOperationReport UDSConnection::writeNonBlocking(const IPCMessage& msg) {
 
+	if ( isPacketMode() )
+		return writePacketNonBlocking(msg);
+
+	if (m_framing == IPCFraming::COMPACT) {
+		ByteArray frame;
+		CompactFraming::encode(msg, frame);
+		if ( isCongested() ) {
+			enqueueData( frame.getData(), frame.size(), msg.getFileDescriptor() );
+			return IPCOperationReport::BUFFER_FULL;
+		}
+		return writeBytesNonBlocking( frame.getData(), frame.size(), msg.getFileDescriptor() );
+	}
+
 	auto size = msg.getPayload().size();
 
 	if ( isCongested() ) {
-		enqueueData( &size, sizeof(size) );
+		enqueueData( &size, sizeof(size), msg.getFileDescriptor() );
 		enqueueData(msg.getPayload().getData(), size);
 		return IPCOperationReport::BUFFER_FULL;
 	} else {
 
-		switch ( writeBytesNonBlocking( &size, sizeof(size) ) ) {
+		switch ( writeBytesNonBlocking( &size, sizeof(size), msg.getFileDescriptor() ) ) {
 		case IPCOperationReport::OK : {
 			return writeBytesNonBlocking(msg.getPayload().getData(), size);
 		}
@@ -205,14 +1051,16 @@ IPCOperationReport UDSConnection::writeNonBlocking(const IPCMessage& msg) {
 	return IPCOperationReport::DISCONNECTED;
 }
 
-IPCOperationReport SocketStreamConnection::writeBytesNonBlocking(const void* data, ssize_t length) {
+IPCOperationReport SocketStreamConnection::writeBytesNonBlocking(const void* data, ssize_t length, int fileDescriptor) {
 
 	assert(getFileDescriptor() != UNINITIALIZED_FILE_DESCRIPTOR);
 
 	increaseWrittenBytesCounter(length);
 
 	const char* dataAsChar = reinterpret_cast<const char*>(data);
-	auto writtenBytesCount = send(getFileDescriptor(), dataAsChar, length, MSG_DONTWAIT);
+	auto writtenBytesCount =
+		(fileDescriptor == UNINITIALIZED_FILE_DESCRIPTOR) ? send(getFileDescriptor(), dataAsChar, length, MSG_DONTWAIT) :
+		sendWithFileDescriptor(dataAsChar, length, fileDescriptor, MSG_DONTWAIT);
 	bool bCongestionDetected = false;
 	if (writtenBytesCount == length)
 		return IPCOperationReport::OK;
@@ -244,7 +1092,9 @@ IPCOperationReport SocketStreamConnection::writeBytesNonBlocking(const void* dat
 		bCongestionDetected = true;
 
 	if (bCongestionDetected) {
-		enqueueData(dataAsChar + writtenBytesCount, length - writtenBytesCount);
+		// if some bytes have been written, the file descriptor has been transferred with them
+		enqueueData(dataAsChar + writtenBytesCount, length - writtenBytesCount,
+			    (writtenBytesCount == 0) ? fileDescriptor : UNINITIALIZED_FILE_DESCRIPTOR);
 		return IPCOperationReport::BUFFER_FULL;
 	}
 
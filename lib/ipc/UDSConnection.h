@@ -7,6 +7,9 @@
 #include <sys/un.h>
 #include <dirent.h>
 #include <unistd.h>
+#include <deque>
+#include <memory>
+#include <errno.h>
 
 #include "ipc.h"
 
@@ -15,7 +18,7 @@
 namespace SomeIP_Lib {
 
 /**
- * Handles a stream connection via Unix domain socket
+ * Handles a stream connection via Unix domain socket. With a SOCK_SEQPACKET socket, each message is sent as one packet.
  */
 class UDSConnection : public SocketStreamConnection {
 
@@ -24,12 +27,59 @@ class UDSConnection : public SocketStreamConnection {
 public:
 	IPCOperationReport writeBlocking(const IPCMessage& msg);
 
+	/**
+	 * Writes several messages with a single system call where possible
+	 */
+	IPCOperationReport writeBlocking(const IPCMessage* const* messages, size_t messageCount);
+
 	IPCOperationReport writeNonBlocking(const IPCMessage& msg);
 
 	IPCOperationReport readBlocking(IPCInputMessage& msg);
 
 	IPCOperationReport readNonBlocking(IPCInputMessage& msg);
 
+	IPCFraming getFraming() const {
+		return m_framing;
+	}
+
+	/**
+	 * Sets the encoding of the frames which are written and read after this call. Both ends of the connection need to switch
+	 * at the same position of the stream.
+	 */
+	void setFraming(IPCFraming framing) {
+		m_framing = framing;
+	}
+
+	/**
+	 * Returns true if some data has already been read from the socket, but not returned as a message yet
+	 */
+	bool hasBufferedData() const {
+		return (m_receptionBufferBegin != m_receptionBufferEnd) || ( m_nextPacket != m_receivedPackets.size() );
+	}
+
+	/**
+	 * Appends the beginning of the frame of the given message, which does not contain its payload, to the given array. The
+	 * payload, of the given length, is written to the socket separately, such as by a SpliceRelay. Not available in packet
+	 * mode.
+	 */
+	void encodeFrameHeader(const IPCMessage& msg, size_t payloadLength, ByteArray& frame) const;
+
+	/**
+	 * Sets the maximum length of the messages which are received. A peer announcing a larger message is disconnected before
+	 * any buffer is allocated for it. 0 means no limit, which is the default.
+	 */
+	void setMaximumMessageSize(size_t maximumSize) {
+		m_maximumMessageSize = maximumSize;
+	}
+
+	/**
+	 * Sets the payload size from which a message is offered to beginStreamedMessage() once its header has been received, so
+	 * that its payload does not need to be buffered. 0 disables the streaming, which is the default.
+	 */
+	void setStreamingThreshold(size_t threshold) {
+		m_streamingThreshold = threshold;
+	}
+
 protected:
 	typedef std::function<bool (IPCInputMessage&)> IPCMessageReceivedCallbackFunction;
 
@@ -38,58 +88,218 @@ protected:
 	}
 
 	virtual ~UDSConnection() {
+		for (auto fileDescriptor : m_receivedFileDescriptors)
+			close(fileDescriptor);
+		for (size_t i = m_nextPacket; i < m_receivedPackets.size(); i++)
+			if (m_receivedPackets[i].m_fileDescriptor != UNINITIALIZED_FILE_DESCRIPTOR)
+				close(m_receivedPackets[i].m_fileDescriptor);
 	}
 
-	SomeIPReturnCode connectToServer(const char* uds_socket_path) {
+	/**
+	 * Connects to the server socket. If the server socket does not have the requested type, the other type is used.
+	 */
+	SomeIPReturnCode connectToServer(const char* uds_socket_path, IPCSocketType socketType = IPCSocketType::STREAM) {
 
-		int fileDescriptor = socket(AF_UNIX, SOCK_STREAM, 0);
+		int fileDescriptor = connectSocket(uds_socket_path, socketType);
 
-		if ( fileDescriptor == -1 ) {
-			log_warning() << "Failed to create socket";
-			return SomeIPReturnCode::ERROR;
+		if ( (fileDescriptor == -1) && (errno == EPROTOTYPE) ) {
+			socketType = (socketType == IPCSocketType::STREAM) ? IPCSocketType::SEQPACKET : IPCSocketType::STREAM;
+			log_info() << "The socket " << uds_socket_path << " has another type. Trying " <<
+				( (socketType == IPCSocketType::STREAM) ? "SOCK_STREAM" : "SOCK_SEQPACKET" );
+			fileDescriptor = connectSocket(uds_socket_path, socketType);
 		}
 
-		struct sockaddr_un remote;
-
-		remote.sun_family = AF_UNIX;
-		strcpy(remote.sun_path, uds_socket_path);
-
-		if (::connect( fileDescriptor, (struct sockaddr*) &remote, strlen(remote.sun_path) +
-			       sizeof(remote.sun_family) )
-		    == -1) {
+		if (fileDescriptor == -1) {
 			log_warning() << "Failed to connect to the daemon via socket " << uds_socket_path <<
 			". Trying alternative socket";
-			if (alternative_uds_socket_path != nullptr) {
-				uds_socket_path = alternative_uds_socket_path;
-				strcpy(remote.sun_path, uds_socket_path);
-				if (::connect( fileDescriptor, (struct sockaddr*) &remote,
-					       strlen(remote.sun_path) + sizeof(remote.sun_family) ) == -1) {
-					log_error() << "Failed to connect to daemon via socket " << uds_socket_path;
-					return SomeIPReturnCode::ERROR;
-				}
-			} else
+			if (alternative_uds_socket_path == nullptr)
 				return SomeIPReturnCode::ERROR;
+
+			uds_socket_path = alternative_uds_socket_path;
+			fileDescriptor = connectSocket(uds_socket_path, socketType);
+			if (fileDescriptor == -1) {
+				log_error() << "Failed to connect to daemon via socket " << uds_socket_path;
+				return SomeIPReturnCode::ERROR;
+			}
 		}
 
 		setFileDescriptor(fileDescriptor);
+		setPacketMode(socketType == IPCSocketType::SEQPACKET);
+
+		// a stream interrupted by a previous disconnection is not continued
+		m_remainingStreamedBytes = 0;
+		m_isReadingStreamedHeader = false;
+		m_isStreamRefused = false;
+
 		return SomeIPReturnCode::OK;
 	}
 
+	/**
+	 * Enables the packet mode if the socket of the connection has the SOCK_SEQPACKET type
+	 */
+	void detectSocketType() {
+		int type = SOCK_STREAM;
+		socklen_t length = sizeof(type);
+		if (getsockopt(getFileDescriptor(), SOL_SOCKET, SO_TYPE, &type, &length) == 0)
+			setPacketMode(type == SOCK_SEQPACKET);
+	}
+
 	virtual void handleIncomingIPCMessage(IPCInputMessage& inputMessage) = 0;
 
+	/**
+	 * Called by a non-blocking read when the header of a SEND_MESSAGE whose payload reaches the streaming threshold has been
+	 * received. The given message only contains the IPC header and the message header. If true is returned, the payload is
+	 * passed to onStreamedChunk() as it arrives, and the message itself is never returned by a read.
+	 */
+	virtual bool beginStreamedMessage(const IPCInputMessage& header, size_t payloadLength) {
+		return false;
+	}
+
+	/**
+	 * Receives the next part of the payload of a streamed message. isLast is true for the last part. A stream which has been
+	 * started is continued by the next reads, including the blocking ones.
+	 */
+	virtual void onStreamedChunk(const IPCInputMessage& header, const void* data, size_t length, bool isLast) {
+	}
+
 	void setInputMessage(IPCInputMessage& msg) {
 		m_currentInputMessage = &msg;
-		msg.clear();
-		m_messageLengthReader.setBuffer( &msg.m_totalMessageSize, sizeof(msg.m_totalMessageSize) );
+		resetInputMessage(msg);
 	}
 
 private:
+	/// Number of bytes read at once from the socket when the compact framing is used
+	static const size_t RECEPTION_CHUNK_SIZE = 64 * 1024;
+
 	IPCOperationReport read(IPCInputMessage& msg, bool blocking);
 
+	IPCOperationReport readCompact(IPCInputMessage& msg, bool blocking);
+
+	/**
+	 * Returns true if a message of the given length might be streamed, in which case its header is read first
+	 */
+	bool isStreamingCandidate(size_t messageLength, bool blocking) const {
+		return !blocking && (m_streamingThreshold != 0) && (messageLength >= m_streamingThreshold);
+	}
+
+	/**
+	 * Offers the message whose header is in m_streamedMessage to beginStreamedMessage(), and passes the part of its payload
+	 * which has already been received if it is accepted
+	 */
+	bool startStream(size_t payloadLength, const void* receivedPayload, size_t receivedLength);
+
+	/**
+	 * Reads the rest of the payload of the streamed message, by chunks of RECEPTION_CHUNK_SIZE bytes
+	 */
+	IPCOperationReport readStreamedPayload(bool blocking);
+
+	void deliverStreamedChunk(const void* data, size_t length);
+
+	/**
+	 * Disconnects if the given length exceeds the maximum message size
+	 */
+	IPCOperationReport checkMessageLength(size_t length);
+
+	void resetInputMessage(IPCInputMessage& msg) {
+		msg.clear();
+		m_messageLengthReader.setBuffer( &msg.m_totalMessageSize, sizeof(msg.m_totalMessageSize) );
+	}
+
+	IPCOperationReport writeCompactBlocking(const IPCMessage* const* messages, size_t messageCount);
+
+	/**
+	 * Returns a socket connected to the given path, or -1
+	 */
+	int connectSocket(const char* uds_socket_path, IPCSocketType socketType) {
+
+		int fileDescriptor = socket(AF_UNIX, (socketType == IPCSocketType::SEQPACKET) ? SOCK_SEQPACKET : SOCK_STREAM, 0);
+
+		if ( fileDescriptor == -1 ) {
+			log_warning() << "Failed to create socket";
+			return -1;
+		}
+
+		struct sockaddr_un remote;
+
+		remote.sun_family = AF_UNIX;
+		strcpy(remote.sun_path, uds_socket_path);
+
+		if (::connect( fileDescriptor, (struct sockaddr*) &remote, strlen(remote.sun_path) +
+			       sizeof(remote.sun_family) )
+		    == -1) {
+			int error = errno;
+			close(fileDescriptor);
+			errno = error;
+			return -1;
+		}
+
+		return fileDescriptor;
+	}
+
+	/// In packet mode, maximum size of a packet. Larger messages are sent as a LARGE_MESSAGE packet, followed by the rest of
+	/// their payload
+	static const size_t MAX_PACKET_SIZE = 64 * 1024;
+
+	/// In packet mode, maximum number of packets received with a single system call
+	static const size_t RECEIVED_PACKETS_COUNT = 8;
+
+	/// Size of the IPC header and of the total length of a LARGE_MESSAGE packet
+	static const size_t LARGE_MESSAGE_HEADER_SIZE = sizeof(IPCMessageHeader) + sizeof(uint64_t);
+
+	IPCOperationReport readPacket(IPCInputMessage& msg, bool blocking);
+
+	IPCOperationReport receivePackets(bool blocking);
+
+	IPCOperationReport writePacketBlocking(const IPCMessage& msg);
+
+	IPCOperationReport writeMessagePacketsBlocking(const IPCMessage* const* messages, size_t messageCount);
+
+	IPCOperationReport writePacketNonBlocking(const IPCMessage& msg);
+
+	/**
+	 * Fills the first packet of a message which is too large for a single packet
+	 */
+	static void encodeLargeMessageHeader(const IPCMessage& msg, ByteArray& packet);
+
 	//	const char* uds_socket_path = nullptr;
 	const char* alternative_uds_socket_path = nullptr;
 	IPCBufferReader m_messageLengthReader;
 
+	IPCFraming m_framing = IPCFraming::NATIVE;
+
+	/// With the compact framing, the data is read by chunks, which can contain several frames
+	std::vector<uint8_t> m_receptionBuffer;
+	size_t m_receptionBufferBegin = 0;
+	size_t m_receptionBufferEnd = 0;
+
+	/// File descriptors which have been received, but whose frame has not been decoded yet
+	std::deque<int> m_receivedFileDescriptors;
+
+	struct ReceivedPacket {
+		size_t m_size;
+		int m_fileDescriptor;
+	};
+
+	/// In packet mode, the packets are received together into slots of MAX_PACKET_SIZE bytes
+	std::unique_ptr<uint8_t[]> m_packetBuffer;
+	std::vector<ReceivedPacket> m_receivedPackets;
+	size_t m_nextPacket = 0;
+
+	size_t m_maximumMessageSize = 0;
+	size_t m_streamingThreshold = 0;
+
+	/// Header of the message whose payload is being streamed
+	IPCInputMessage m_streamedMessage;
+
+	/// Number of payload bytes of the streamed message which have not been received yet
+	size_t m_remainingStreamedBytes = 0;
+
+	/// True while the header of a native frame is read on its own, before deciding whether the message is streamed
+	bool m_isReadingStreamedHeader = false;
+
+	/// True once beginStreamedMessage() has refused the compact frame being received
+	bool m_isStreamRefused = false;
+
 protected:
 	IPCInputMessage* m_currentInputMessage = nullptr;
 
@@ -104,11 +314,11 @@ public:
 	UDSServer(MainLoopInterface& mainContext) : SocketStreamServer(mainContext) {
 	}
 
-	IPCReturnCode initServerSocket(const char* uds_socket_path, int fd = 0) {
+	IPCReturnCode initServerSocket(const char* uds_socket_path, int fd = 0, IPCSocketType socketType = IPCSocketType::STREAM) {
 
 		if (fd == 0) {
 
-			if ( ( fd = socket(AF_UNIX, SOCK_STREAM, 0) ) < 0 ) {
+			if ( ( fd = socket(AF_UNIX, (socketType == IPCSocketType::SEQPACKET) ? SOCK_SEQPACKET : SOCK_STREAM, 0) ) < 0 ) {
 				log_error() << "Failed to open socket " << uds_socket_path;
 				return IPCReturnCode::ERROR;
 			}
@@ -0,0 +1,1049 @@
+#include <chrono>
+#include <thread>
+#include <sys/resource.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+
+#include "gtest/gtest.h"
+
+#include "ivi-logging.h"
+#include "SomeIP-Serialization.h"
+#include "Message.h"
+#include "ipc/UDSConnection.h"
+#include "SomeIP-clientLib.h"
+#include "DatagramSocket.h"
+#include "BenchmarkService.h"
+
+using namespace SomeIP_Lib;
+
+LOG_DECLARE_DEFAULT_CONTEXT(benchmarkContext, "BENC", "Benchmarks");
+
+namespace {
+
+static const size_t ITERATION_COUNT = 10000;
+static const size_t ARRAY_SIZE = 256;
+
+/**
+ * Reference implementation of the byte-order conversion, with a runtime endianness check and a byte loop
+ */
+inline bool legacyIsNativeBigEndian() {
+	short int number = 1;
+	char* numPtr = (char*) &number;
+	return (numPtr[0] != 1);
+}
+
+template<typename T>
+inline T legacyNativeToNetworkOrder(const T& v) {
+	if ( legacyIsNativeBigEndian() )
+		return v;
+	T networkValue = v;
+	char* chars = reinterpret_cast<char*>(&networkValue);
+	for (size_t i = 0; i < sizeof(T) / 2; i++)
+		std::swap(chars[i], chars[sizeof(T) - i - 1]);
+	return networkValue;
+}
+
+template<typename Function>
+double measure(Function function, size_t iterationCount = ITERATION_COUNT) {
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < iterationCount; i++)
+		function();
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / iterationCount;
+}
+
+void report(const char* name, double legacyDuration, double duration) {
+	log_info() << name << " : " << legacyDuration << " us -> " << duration << " us";
+}
+
+}
+
+class SerializationBenchmark : public::testing::Test {
+};
+
+TEST_F(SerializationBenchmark, ScalarByteSwap) {
+
+	std::vector<uint32_t> values(ARRAY_SIZE);
+	for (size_t i = 0; i < values.size(); i++)
+		values[i] = i * 0x01020304;
+
+	std::vector<uint32_t> legacyResult(ARRAY_SIZE);
+	std::vector<uint32_t> result(ARRAY_SIZE);
+
+	auto legacyDuration = measure([&]() {
+					      for (size_t i = 0; i < values.size(); i++)
+						      legacyResult[i] = legacyNativeToNetworkOrder(values[i]);
+				      });
+
+	auto duration = measure([&]() {
+					for (size_t i = 0; i < values.size(); i++)
+						result[i] = NativeToNetworkOrder(values[i]);
+				});
+
+	EXPECT_EQ(legacyResult, result);
+	report("uint32_t byte swap", legacyDuration, duration);
+}
+
+TEST_F(SerializationBenchmark, VectorSerialization) {
+
+	std::vector<uint16_t> values(ARRAY_SIZE);
+	for (size_t i = 0; i < values.size(); i++)
+		values[i] = i;
+
+	ByteArray legacyPayload;
+	ByteArray payload;
+
+	auto legacyDuration = measure([&]() {
+					      legacyPayload.resize(0);
+					      SomeIPOutputStream stream(legacyPayload);
+					      stream.writeValue( static_cast<uint32_t>( values.size() ) );
+					      for (auto value : values)
+						      stream.writeValue(value);
+				      });
+
+	auto duration = measure([&]() {
+					payload.resize(0);
+					SomeIPOutputStream stream(payload);
+					stream << values;
+				});
+
+	ASSERT_EQ( legacyPayload.size(), payload.size() );
+	EXPECT_EQ( memcmp( legacyPayload.getData(), payload.getData(), payload.size() ), 0 );
+	report("std::vector<uint16_t> serialization", legacyDuration, duration);
+
+	std::vector<uint16_t> legacyReadValues;
+	legacyDuration = measure([&]() {
+					 legacyReadValues.resize(0);
+					 SomeIPInputStream stream( payload.getData(), payload.size() );
+					 uint32_t size;
+					 stream.readValue(size);
+					 for (size_t i = 0; i < size; i++) {
+						 uint16_t value;
+						 stream.readValue(value);
+						 legacyReadValues.push_back(value);
+					 }
+				 });
+
+	std::vector<uint16_t> readValues;
+	duration = measure([&]() {
+				   readValues.resize(0);
+				   SomeIPInputStream stream( payload.getData(), payload.size() );
+				   stream >> readValues;
+			   });
+
+	EXPECT_EQ(values, legacyReadValues);
+	EXPECT_EQ(values, readValues);
+	report("std::vector<uint16_t> deserialization", legacyDuration, duration);
+}
+
+class MessageBenchmark : public::testing::Test {
+};
+
+TEST_F(MessageBenchmark, MessageQueueing) {
+
+	static const size_t MESSAGE_COUNT = 16;
+
+	for (size_t payloadSize : {16, 4096}) {
+
+		std::vector<uint8_t> payload(payloadSize, 0x5A);
+
+		auto createMessage = [&]() {
+			OutputMessage msg( MemberIDs(0x1234, 1, 0x10) );
+			msg.getPayloadOutputStream().writeRawData( payload.data(), payload.size() );
+			return msg;
+		};
+
+		// the messages are copied into the queue, as it was done before the move operations were available
+		std::vector<OutputMessage> copiedMessages;
+		auto copyDuration = measure([&]() {
+						    copiedMessages.clear();
+						    for (size_t i = 0; i < MESSAGE_COUNT; i++) {
+							    OutputMessage msg = createMessage();
+							    copiedMessages.push_back(msg);
+						    }
+					    });
+
+		std::vector<OutputMessage> movedMessages;
+		auto moveDuration = measure([&]() {
+						    movedMessages.clear();
+						    for (size_t i = 0; i < MESSAGE_COUNT; i++) {
+							    OutputMessage msg = createMessage();
+							    movedMessages.push_back( std::move(msg) );
+						    }
+					    });
+
+		ASSERT_EQ( movedMessages.size(), MESSAGE_COUNT );
+		EXPECT_EQ( movedMessages[MESSAGE_COUNT - 1].getPayloadLength(), payloadSize );
+
+		// a moved message must still be writable through its own payload
+		uint8_t extraByte = 0x42;
+		movedMessages[0].getPayloadOutputStream().writeRawData( &extraByte, sizeof(extraByte) );
+		EXPECT_EQ( movedMessages[0].getPayloadLength(), payloadSize + 1 );
+		EXPECT_EQ( copiedMessages[0].getPayloadLength(), payloadSize );
+
+		log_info() << "Queueing " << MESSAGE_COUNT << " messages of " << payloadSize << " bytes";
+		report("copy -> move", copyDuration, moveDuration);
+	}
+}
+
+TEST_F(MessageBenchmark, HeaderCodec) {
+
+	static const size_t MESSAGE_COUNT = 256;
+	static const size_t PAYLOAD_LENGTH = 32;
+
+	SomeIP::SomeIPHeader header(0x12345678, 0x00010002, 3, SomeIP::MessageType::REQUEST, SomeIP::ReturnCode::E_OK);
+
+	ByteArray legacyBytes;
+	ByteArray bytes;
+	bytes.resize(SOMEIP_HEADER_LENGTH_ON_NETWORK * MESSAGE_COUNT);
+
+	auto legacyEncodingDuration = measure([&]() {
+						      legacyBytes.resize(0);
+						      NetworkSerializer serializer(legacyBytes);
+						      for (size_t i = 0; i < MESSAGE_COUNT; i++) {
+							      serializer << header.m_messageID;
+							      PlaceHolder<uint32_t, NetworkSerializer> lengthPlaceHolder(serializer);
+							      lengthPlaceHolder.writeValue(PAYLOAD_LENGTH + SomeIPHeaderCodec::LENGTH_COVERED_HEADER_SIZE);
+							      serializer << header.m_requestID << header.m_protocolVersion << header.m_interfaceVersion;
+							      serializer.writeEnum(header.m_messageType);
+							      serializer.writeEnum(header.m_returnCode);
+						      }
+					      });
+
+	auto encodingDuration = measure([&]() {
+						for (size_t i = 0; i < MESSAGE_COUNT; i++)
+							SomeIPHeaderCodec::encode(header, PAYLOAD_LENGTH, bytes.getData() + i * SOMEIP_HEADER_LENGTH_ON_NETWORK);
+					});
+
+	ASSERT_EQ( legacyBytes.size(), bytes.size() );
+	EXPECT_EQ( memcmp( legacyBytes.getData(), bytes.getData(), bytes.size() ), 0 );
+	report("SOME/IP header encoding", legacyEncodingDuration, encodingDuration);
+
+	SomeIP::SomeIPHeader legacyReadHeader;
+	uint32_t legacyLength = 0;
+	auto legacyDecodingDuration = measure([&]() {
+						      NetworkDeserializer deserializer( bytes.getData(), bytes.size() );
+						      for (size_t i = 0; i < MESSAGE_COUNT; i++)
+							      legacyLength = legacyReadHeader.deserialize(deserializer);
+					      });
+
+	SomeIP::SomeIPHeader readHeader;
+	size_t payloadLength = 0;
+	auto decodingDuration = measure([&]() {
+						for (size_t i = 0; i < MESSAGE_COUNT; i++)
+							SomeIPHeaderCodec::decode(bytes.getData() + i * SOMEIP_HEADER_LENGTH_ON_NETWORK, readHeader,
+										  payloadLength);
+					});
+
+	EXPECT_EQ(legacyReadHeader, header);
+	EXPECT_EQ(readHeader, header);
+	EXPECT_EQ(legacyLength, PAYLOAD_LENGTH + SomeIPHeaderCodec::LENGTH_COVERED_HEADER_SIZE);
+	EXPECT_EQ(payloadLength, PAYLOAD_LENGTH);
+	report("SOME/IP header decoding", legacyDecodingDuration, decodingDuration);
+
+	log_info() << "Header codec : " << MESSAGE_COUNT / (encodingDuration + decodingDuration) << " million messages per second";
+}
+
+namespace {
+
+/**
+ * Connection which only keeps the last message sent, so that the benchmark only measures the message processing
+ */
+class LoopbackConnection {
+
+public:
+	SomeIPReturnCode sendMessage(const OutputMessage& msg) {
+		m_lastMessage = msg;
+		return SomeIPReturnCode::OK;
+	}
+
+	OutputMessage m_lastMessage;
+};
+
+/**
+ * Hand-written message processing, as done in the tests
+ */
+class HandWrittenService {
+
+public:
+	HandWrittenService(LoopbackConnection& connection) : m_connection(connection) {
+	}
+
+	MessageProcessingResult processMessage(const InputMessage& msg) {
+		if ( msg.getServiceID() != BenchmarkService::SERVICE_ID )
+			return MessageProcessingResult::NotProcessed_OK;
+
+		auto inputStream = msg.getPayloadInputStream();
+		OutputMessage returnMessage = createMethodReturn(msg);
+		auto outputStream = returnMessage.getPayloadOutputStream();
+
+		if (msg.getHeader().getMemberID() == BenchmarkService::add_MEMBER_ID) {
+			int32_t a, b;
+			inputStream >> a >> b;
+			outputStream << a + b;
+		} else if (msg.getHeader().getMemberID() == BenchmarkService::concatenate_MEMBER_ID) {
+			std::string first, second;
+			inputStream >> first >> second;
+			outputStream << first + second;
+		} else if (msg.getHeader().getMemberID() == BenchmarkService::sum_MEMBER_ID) {
+			std::vector<uint32_t> values;
+			inputStream >> values;
+			uint64_t result = 0;
+			for (auto value : values)
+				result += value;
+			outputStream << result;
+		} else
+			return MessageProcessingResult::NotProcessed_OK;
+
+		m_connection.sendMessage(returnMessage);
+		return MessageProcessingResult::Processed_OK;
+	}
+
+private:
+	LoopbackConnection& m_connection;
+};
+
+class GeneratedService : public BenchmarkService::Stub<GeneratedService, LoopbackConnection> {
+
+public:
+	GeneratedService(LoopbackConnection& connection) : Stub(connection) {
+	}
+
+	void add(int32_t a, int32_t b, int32_t& result) {
+		result = a + b;
+	}
+
+	void concatenate(const std::string& first, const std::string& second, std::string& result) {
+		result = first + second;
+	}
+
+	void sum(const std::vector<uint32_t>& values, uint64_t& result) {
+		result = 0;
+		for (auto value : values)
+			result += value;
+	}
+
+	void reset() {
+	}
+};
+
+}
+
+TEST_F(MessageBenchmark, GeneratedStub) {
+
+	std::vector<uint32_t> values(ARRAY_SIZE);
+	for (size_t i = 0; i < values.size(); i++)
+		values[i] = i;
+
+	std::vector<OutputMessage> requests;
+	for (auto memberID : {BenchmarkService::add_MEMBER_ID, BenchmarkService::concatenate_MEMBER_ID,
+			      BenchmarkService::sum_MEMBER_ID}) {
+		OutputMessage request( SomeIP::MemberIDs(BenchmarkService::SERVICE_ID, 0, memberID) );
+		request.getHeader().setMessageType(SomeIP::MessageType::REQUEST);
+		requests.push_back( std::move(request) );
+	}
+
+	SomeIPOutputStream addStream = requests[0].getPayloadOutputStream();
+	addStream << int32_t(1) << int32_t(2);
+	SomeIPOutputStream concatenateStream = requests[1].getPayloadOutputStream();
+	concatenateStream << std::string("first") << std::string("second");
+	SomeIPOutputStream sumStream = requests[2].getPayloadOutputStream();
+	sumStream << values;
+
+	std::vector<InputMessage> inputMessages;
+	for (auto& request : requests)
+		inputMessages.push_back( InputMessage(request) );
+
+	LoopbackConnection handWrittenConnection;
+	HandWrittenService handWrittenService(handWrittenConnection);
+	LoopbackConnection generatedConnection;
+	GeneratedService generatedService(generatedConnection);
+
+	for (auto& msg : inputMessages) {
+		EXPECT_EQ( handWrittenService.processMessage(msg), MessageProcessingResult::Processed_OK );
+		EXPECT_EQ( generatedService.processMessage(msg), MessageProcessingResult::Processed_OK );
+		EXPECT_EQ( handWrittenConnection.m_lastMessage.getPayloadLength(), generatedConnection.m_lastMessage.getPayloadLength() );
+		EXPECT_EQ( memcmp( handWrittenConnection.m_lastMessage.getPayload(), generatedConnection.m_lastMessage.getPayload(),
+				   generatedConnection.m_lastMessage.getPayloadLength() ), 0 );
+	}
+
+	auto handWrittenDuration = measure([&]() {
+						   for (auto& msg : inputMessages)
+							   handWrittenService.processMessage(msg);
+					   });
+
+	auto generatedDuration = measure([&]() {
+						 for (auto& msg : inputMessages)
+							 generatedService.processMessage(msg);
+					 });
+
+	report("hand-written -> generated stub", handWrittenDuration, generatedDuration);
+}
+
+namespace {
+
+class SocketPairConnection : public UDSConnection {
+public:
+	void handleIncomingIPCMessage(IPCInputMessage&) override {
+	}
+	void onDisconnected() override {
+	}
+	void onCongestionDetected() override {
+	}
+	std::string toString() const override {
+		return "SocketPairConnection";
+	}
+	using UDSConnection::setFileDescriptor;
+	using UDSConnection::setInputMessage;
+};
+
+}
+
+TEST_F(MessageBenchmark, CompactFraming) {
+
+	static const size_t MESSAGE_COUNT = 16;
+
+	OutputMessage msg( SomeIP::MemberIDs(0x1234, 0, 0x10) );
+	SomeIPOutputStream stream = msg.getPayloadOutputStream();
+	stream << uint32_t(0x11223344);
+
+	// one round : MESSAGE_COUNT messages are written, one by one, and then read on the other end of the socket
+	auto measureFraming = [&](IPCFraming framing, size_t& bytesPerMessage) {
+		int fileDescriptors[2];
+		EXPECT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fileDescriptors), 0);
+		SocketPairConnection sender;
+		SocketPairConnection receiver;
+		sender.setFileDescriptor(fileDescriptors[0]);
+		receiver.setFileDescriptor(fileDescriptors[1]);
+		sender.setFraming(framing);
+		receiver.setFraming(framing);
+
+		IPCInputMessage inputMessage;
+		receiver.setInputMessage(inputMessage);
+
+		auto duration = measure([&]() {
+						for (size_t i = 0; i < MESSAGE_COUNT; i++)
+							sender.writeBlocking( msg.getIPCMessage() );
+						for (size_t i = 0; i < MESSAGE_COUNT; i++) {
+							receiver.readBlocking(inputMessage);
+							receiver.setInputMessage(inputMessage);
+						}
+					});
+
+		sender.writeBlocking( msg.getIPCMessage() );
+		int availableBytes = 0;
+		ioctl(fileDescriptors[1], FIONREAD, &availableBytes);
+		bytesPerMessage = availableBytes;
+
+		close(fileDescriptors[0]);
+		close(fileDescriptors[1]);
+		return duration / MESSAGE_COUNT;
+	};
+
+	size_t nativeBytesPerMessage;
+	auto nativeDuration = measureFraming(IPCFraming::NATIVE, nativeBytesPerMessage);
+	size_t compactBytesPerMessage;
+	auto compactDuration = measureFraming(IPCFraming::COMPACT, compactBytesPerMessage);
+
+	EXPECT_LT(compactBytesPerMessage, nativeBytesPerMessage);
+
+	log_info() << "Bytes per message with a " << msg.getPayloadLength() << " bytes payload : " << nativeBytesPerMessage << " -> " <<
+		compactBytesPerMessage;
+	log_info() << "Messages per second : " << static_cast<size_t>(1000000 / nativeDuration) << " -> " <<
+		static_cast<size_t>(1000000 / compactDuration);
+	report("native -> compact framing, per message", nativeDuration, compactDuration);
+}
+
+TEST_F(MessageBenchmark, BatchedSendMessages) {
+
+	static const size_t MESSAGE_COUNT = 16;
+
+	OutputMessage msg( SomeIP::MemberIDs(0x1234, 0, 0x10) );
+	SomeIPOutputStream stream = msg.getPayloadOutputStream();
+	stream << uint32_t(0x11223344);
+
+	std::vector<const IPCMessage*> messages( MESSAGE_COUNT, &msg.getIPCMessage() );
+
+	int fileDescriptors[2];
+	ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fileDescriptors), 0);
+	SocketPairConnection sender;
+	SocketPairConnection receiver;
+	sender.setFileDescriptor(fileDescriptors[0]);
+	receiver.setFileDescriptor(fileDescriptors[1]);
+
+	IPCInputMessage inputMessage;
+	receiver.setInputMessage(inputMessage);
+
+	size_t receivedCount = 0;
+	auto receive = [&]() {
+		for (size_t i = 0; i < MESSAGE_COUNT; i++) {
+			receiver.readBlocking(inputMessage);
+			receivedCount++;
+			receiver.setInputMessage(inputMessage);
+		}
+	};
+
+	// what MESSAGE_COUNT calls to sendMessage() write to the dispatcher : one write per message
+	auto singleDuration = measure([&]() {
+					      for (size_t i = 0; i < MESSAGE_COUNT; i++)
+						      sender.writeBlocking( msg.getIPCMessage() );
+					      receive();
+				      });
+
+	// what sendMessages() writes : all the frames with a single sendmsg() call
+	auto batchDuration = measure([&]() {
+					     sender.writeBlocking( messages.data(), messages.size() );
+					     receive();
+				     });
+
+	EXPECT_EQ(receivedCount, 2 * ITERATION_COUNT * MESSAGE_COUNT);
+
+	close(fileDescriptors[0]);
+	close(fileDescriptors[1]);
+
+	log_info() << "Messages per second : " << static_cast<size_t>(1000000 * MESSAGE_COUNT / singleDuration) << " -> " <<
+		static_cast<size_t>(1000000 * MESSAGE_COUNT / batchDuration);
+	report("sendMessage() x 16 -> sendMessages(), per batch", singleDuration, batchDuration);
+}
+
+TEST_F(MessageBenchmark, SeqPacketSocket) {
+
+	static const size_t MESSAGE_COUNT = 16;
+
+	OutputMessage msg( SomeIP::MemberIDs(0x1234, 0, 0x10) );
+	SomeIPOutputStream stream = msg.getPayloadOutputStream();
+	stream << uint32_t(0x11223344);
+
+	// one round : MESSAGE_COUNT messages are written, one by one, and then read on the other end of the socket
+	auto measureSocketType = [&](int socketType) {
+		int fileDescriptors[2];
+		EXPECT_EQ(socketpair(AF_UNIX, socketType, 0, fileDescriptors), 0);
+		SocketPairConnection sender;
+		SocketPairConnection receiver;
+		sender.setFileDescriptor(fileDescriptors[0]);
+		receiver.setFileDescriptor(fileDescriptors[1]);
+		sender.setPacketMode(socketType == SOCK_SEQPACKET);
+		receiver.setPacketMode(socketType == SOCK_SEQPACKET);
+
+		IPCInputMessage inputMessage;
+		receiver.setInputMessage(inputMessage);
+
+		auto duration = measure([&]() {
+						for (size_t i = 0; i < MESSAGE_COUNT; i++)
+							sender.writeBlocking( msg.getIPCMessage() );
+						for (size_t i = 0; i < MESSAGE_COUNT; i++) {
+							receiver.readBlocking(inputMessage);
+							receiver.setInputMessage(inputMessage);
+						}
+					});
+
+		close(fileDescriptors[0]);
+		close(fileDescriptors[1]);
+		return duration / MESSAGE_COUNT;
+	};
+
+	auto streamDuration = measureSocketType(SOCK_STREAM);
+	auto packetDuration = measureSocketType(SOCK_SEQPACKET);
+
+	log_info() << "Messages per second : " << static_cast<size_t>(1000000 / streamDuration) << " -> " <<
+		static_cast<size_t>(1000000 / packetDuration);
+	report("SOCK_STREAM -> SOCK_SEQPACKET, per message", streamDuration, packetDuration);
+}
+
+TEST_F(MessageBenchmark, SharedPayload) {
+
+	static const size_t PAYLOAD_SIZE = 4 * 1024 * 1024;
+	static const size_t MESSAGE_COUNT = 100;
+	static const size_t PAGE_SIZE = 4096;
+
+	OutputMessage msg( SomeIP::MemberIDs(0x1234, 0, 0x10) );
+	std::vector<uint8_t> payload(PAYLOAD_SIZE, 0x55);
+	msg.getWritablePayload().append( payload.data(), payload.size() );
+
+	// one round : a message is sent by a client, forwarded by the dispatcher, which runs in its own thread, and read by
+	// another client, which reads one byte of each page of the payload
+	auto measureTransfer = [&](size_t sharedPayloadThreshold) {
+		int clientFileDescriptors[2];
+		int dispatcherFileDescriptors[2];
+		EXPECT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, clientFileDescriptors), 0);
+		EXPECT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, dispatcherFileDescriptors), 0);
+		SocketPairConnection sender;
+		SocketPairConnection dispatcherInput;
+		SocketPairConnection dispatcherOutput;
+		SocketPairConnection receiver;
+		sender.setFileDescriptor(clientFileDescriptors[0]);
+		dispatcherInput.setFileDescriptor(clientFileDescriptors[1]);
+		dispatcherOutput.setFileDescriptor(dispatcherFileDescriptors[0]);
+		receiver.setFileDescriptor(dispatcherFileDescriptors[1]);
+
+		std::thread dispatcherThread([&]() {
+						     for (size_t i = 0; i < MESSAGE_COUNT; i++) {
+							     IPCInputMessage forwardedMessage;
+							     dispatcherInput.setInputMessage(forwardedMessage);
+							     dispatcherInput.readBlocking(forwardedMessage);
+							     dispatcherOutput.writeBlocking(forwardedMessage);
+						     }
+					     });
+
+		size_t checksum = 0;
+		auto duration = measure([&]() {
+						auto sharedPayloadMessage = SomeIPClient::SharedPayloadIPCMessage::create(msg,
+															    sharedPayloadThreshold);
+						if (sharedPayloadMessage)
+							sender.writeBlocking(*sharedPayloadMessage);
+						else
+							sender.writeBlocking( msg.getIPCMessage() );
+
+						IPCInputMessage inputMessage;
+						receiver.setInputMessage(inputMessage);
+						receiver.readBlocking(inputMessage);
+						InputMessage receivedMessage(inputMessage);
+						auto receivedPayload = static_cast<const uint8_t*>( receivedMessage.getPayload() );
+						for (size_t i = 0; i < receivedMessage.getPayloadLength(); i += PAGE_SIZE)
+							checksum += receivedPayload[i];
+					}, MESSAGE_COUNT);
+
+		dispatcherThread.join();
+		EXPECT_EQ(checksum, MESSAGE_COUNT * PAYLOAD_SIZE / PAGE_SIZE * 0x55);
+
+		close(clientFileDescriptors[0]);
+		close(clientFileDescriptors[1]);
+		close(dispatcherFileDescriptors[0]);
+		close(dispatcherFileDescriptors[1]);
+		return duration;
+	};
+
+	auto copyDuration = measureTransfer(0);
+	auto sharedDuration = measureTransfer(PAYLOAD_SIZE);
+
+	report("copied -> shared 4 MB payload, per message", copyDuration, sharedDuration);
+}
+
+TEST_F(MessageBenchmark, BatchedNotifications) {
+
+	static const size_t MESSAGE_COUNT = 16;
+
+	OutputMessage msg( SomeIP::MemberIDs(0x1234, 0, 0x8001) );
+	msg.getHeader().setMessageType(SomeIP::MessageType::NOTIFICATION);
+	SomeIPOutputStream stream = msg.getPayloadOutputStream();
+	stream << uint32_t(0x11223344);
+
+	int fileDescriptors[2];
+	ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fileDescriptors), 0);
+	SocketPairConnection sender;
+	SocketPairConnection receiver;
+	sender.setFileDescriptor(fileDescriptors[0]);
+	receiver.setFileDescriptor(fileDescriptors[1]);
+
+	IPCInputMessage inputMessage;
+	receiver.setInputMessage(inputMessage);
+
+	size_t receivedCount = 0;
+	auto receive = [&]() {
+		receiver.readBlocking(inputMessage);
+		if (inputMessage.getMessageType() == IPCMessageType::BATCH) {
+			IPCBatchReader reader(inputMessage);
+			while ( reader.next() ) {
+				InputMessage msg( reader.getUserData(), reader.getUserDataLength() );
+				receivedCount += msg.getPayloadLength();
+			}
+		} else
+			receivedCount += InputMessage(inputMessage).getPayloadLength();
+		receiver.setInputMessage(inputMessage);
+	};
+
+	// a burst of notifications, each one sent with its own frame
+	auto frameDuration = measure([&]() {
+					     for (size_t i = 0; i < MESSAGE_COUNT; i++)
+						     sender.writeNonBlocking( msg.getIPCMessage() );
+					     for (size_t i = 0; i < MESSAGE_COUNT; i++)
+						     receive();
+				     });
+
+	// the same burst, as the dispatcher sends it : the first message immediately, and the other ones with a batch
+	IPCBatchWriter batch;
+	auto batchDuration = measure([&]() {
+					     sender.writeNonBlocking( msg.getIPCMessage() );
+					     for (size_t i = 1; i < MESSAGE_COUNT; i++)
+						     batch.append( msg.getIPCMessage() );
+					     sender.writeNonBlocking( batch.getMessage() );
+					     batch.clear();
+					     receive();
+					     receive();
+				     });
+
+	EXPECT_EQ( receivedCount, 2 * ITERATION_COUNT * MESSAGE_COUNT * msg.getPayloadLength() );
+
+	close(fileDescriptors[0]);
+	close(fileDescriptors[1]);
+
+	log_info() << "Burst of " << MESSAGE_COUNT << " notifications";
+	report("one frame per message -> batch", frameDuration, batchDuration);
+}
+
+namespace {
+
+class TCPSender : public SocketStreamConnection {
+public:
+	void onDisconnected() override {
+	}
+	void onCongestionDetected() override {
+	}
+	std::string toString() const override {
+		return "TCPSender";
+	}
+
+	/**
+	 * Waits until the data queued by the non-blocking writes has been sent
+	 */
+	void flush() {
+		while ( isCongested() ) {
+			pollfd fd = { getFileDescriptor(), POLLOUT, 0 };
+			poll(&fd, 1, -1);
+			writePendingDataNonBlocking();
+		}
+	}
+
+	using SocketStreamConnection::writeBytesNonBlocking;
+	using SocketStreamConnection::writeVectorNonBlocking;
+};
+
+/**
+ * Returns the CPU time consumed by the calling thread, in microseconds
+ */
+double getThreadCPUTime() {
+	rusage usage;
+	getrusage(RUSAGE_THREAD, &usage);
+	return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1e6 + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+}
+
+TEST_F(MessageBenchmark, ZeroCopyTCP) {
+
+	static const size_t PAYLOAD_SIZE = 4 * 1024 * 1024;
+	static const size_t MESSAGE_COUNT = 256;
+
+	std::vector<uint8_t> payload(PAYLOAD_SIZE, 0x55);
+	int payloadFileDescriptor = SharedPayload::createFile( payload.data(), payload.size() );
+	ASSERT_NE(payloadFileDescriptor, -1);
+	auto sharedPayload = std::make_shared<SharedPayload>();
+	ASSERT_EQ(sharedPayload->map(payloadFileDescriptor), SomeIPReturnCode::OK);
+
+	SomeIP::SomeIPHeader header(0x12340010, 0x00010002, 3, SomeIP::MessageType::NOTIFICATION, SomeIP::ReturnCode::E_OK);
+
+	// one round : MESSAGE_COUNT messages are sent over a loopback TCP connection, and drained by a receiver thread.
+	// The CPU time of the sending thread is measured.
+	auto measureSend = [&](std::function<void(TCPSender&)> send, double& cpuTimePerGigabyte) {
+		int serverFileDescriptor = socket(AF_INET, SOCK_STREAM, 0);
+		sockaddr_in address = {};
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		socklen_t addressLength = sizeof(address);
+		EXPECT_EQ(bind( serverFileDescriptor, (sockaddr*) &address, sizeof(address) ), 0);
+		EXPECT_EQ(listen(serverFileDescriptor, 1), 0);
+		getsockname(serverFileDescriptor, (sockaddr*) &address, &addressLength);
+
+		int senderFileDescriptor = socket(AF_INET, SOCK_STREAM, 0);
+		EXPECT_EQ(connect( senderFileDescriptor, (sockaddr*) &address, sizeof(address) ), 0);
+		int receiverFileDescriptor = accept(serverFileDescriptor, nullptr, nullptr);
+
+		TCPSender sender;
+		sender.setFileDescriptor(senderFileDescriptor);
+
+		size_t expectedBytes = MESSAGE_COUNT * (SomeIP::SOMEIP_HEADER_LENGTH_ON_NETWORK + PAYLOAD_SIZE);
+		std::thread receiverThread([&]() {
+						   std::vector<uint8_t> buffer(1024 * 1024);
+						   size_t receivedBytes = 0;
+						   while (receivedBytes < expectedBytes) {
+							   auto n = recv(receiverFileDescriptor, buffer.data(), buffer.size(), 0);
+							   if (n <= 0)
+								   break;
+							   receivedBytes += n;
+						   }
+						   EXPECT_EQ(receivedBytes, expectedBytes);
+					   });
+
+		auto startCPUTime = getThreadCPUTime();
+		auto duration = measure([&]() {
+						send(sender);
+						sender.flush();
+					}, MESSAGE_COUNT);
+		cpuTimePerGigabyte = (getThreadCPUTime() - startCPUTime) / ( expectedBytes / (1024. * 1024 * 1024) );
+
+		receiverThread.join();
+		sender.disconnect();
+		close(receiverFileDescriptor);
+		close(serverFileDescriptor);
+		return duration;
+	};
+
+	// the message is copied into a single buffer before being sent
+	double copyCPUTime;
+	auto copyDuration = measureSend([&](TCPSender& sender) {
+						ByteArray messageBytes;
+						messageBytes.resize(SomeIP::SOMEIP_HEADER_LENGTH_ON_NETWORK + PAYLOAD_SIZE);
+						SomeIPHeaderCodec::encode( header, PAYLOAD_SIZE, messageBytes.getData() );
+						memcpy(messageBytes.getData() + SomeIP::SOMEIP_HEADER_LENGTH_ON_NETWORK, sharedPayload->getData(),
+						       PAYLOAD_SIZE);
+						sender.writeBytesNonBlocking( messageBytes.getData(), messageBytes.size() );
+					}, copyCPUTime);
+
+	auto sendVector = [&](TCPSender& sender, std::shared_ptr<const void> owner) {
+		unsigned char headerBytes[SomeIP::SOMEIP_HEADER_LENGTH_ON_NETWORK];
+		SomeIPHeaderCodec::encode(header, PAYLOAD_SIZE, headerBytes);
+		struct iovec vectors[2] = { { headerBytes, sizeof(headerBytes) },
+					    { const_cast<unsigned char*>( sharedPayload->getData() ), PAYLOAD_SIZE } };
+		sender.writeVectorNonBlocking(vectors, 2, owner);
+	};
+
+	// the header and the payload are sent with a single call, without intermediate copy
+	double vectorCPUTime;
+	auto vectorDuration = measureSend([&](TCPSender& sender) {
+						  sendVector(sender, nullptr);
+					  }, vectorCPUTime);
+
+	// MSG_ZEROCOPY is kept enabled, even if the kernel reports that it copies the data, which it always does on loopback.
+	// The header is on the stack, which is fine here since the bytes are all identical.
+	double zeroCopyCPUTime;
+	size_t zeroCopyEnabledCount = 0;
+	auto zeroCopyDuration = measureSend([&](TCPSender& sender) {
+						    if ( sender.enableZeroCopy() )
+							    zeroCopyEnabledCount++;
+						    sendVector(sender, sharedPayload);
+						    sender.processZeroCopyCompletions();
+					    }, zeroCopyCPUTime);
+
+	close(payloadFileDescriptor);
+
+	log_info() << "Sender CPU time per GB, copy : " << copyCPUTime / 1000 << " ms, vector : " << vectorCPUTime / 1000 <<
+		" ms, MSG_ZEROCOPY" << (zeroCopyEnabledCount == 0 ? " (not supported)" : "") << " : " << zeroCopyCPUTime / 1000 << " ms";
+	report("copy -> vector, 4 MB TCP message", copyDuration, vectorDuration);
+	report("copy -> MSG_ZEROCOPY, 4 MB TCP message", copyDuration, zeroCopyDuration);
+}
+
+TEST_F(MessageBenchmark, SpliceRelay) {
+
+	static const size_t PAYLOAD_SIZE = 4 * 1024 * 1024;
+	static const size_t MESSAGE_COUNT = 100;
+
+	std::vector<uint8_t> payload(PAYLOAD_SIZE, 0x55);
+	OutputMessage header( SomeIP::MemberIDs(0x1234, 0, 0x10) );
+
+	// one round : the payload of a message is written to the source socket by a thread, forwarded by the dispatcher
+	// thread to the destination socket, and drained by another thread. The CPU time of the dispatcher thread is measured.
+	auto measureForwarding = [&](std::function<void(int, SocketPairConnection&)> forward, double& cpuTimePerGigabyte) {
+		int sourceFileDescriptors[2];
+		int destinationFileDescriptors[2];
+		EXPECT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sourceFileDescriptors), 0);
+		EXPECT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, destinationFileDescriptors), 0);
+		SocketPairConnection destination;
+		destination.setFileDescriptor(destinationFileDescriptors[0]);
+
+		std::thread senderThread([&]() {
+						 for (size_t i = 0; i < MESSAGE_COUNT; i++) {
+							 size_t writtenBytes = 0;
+							 while (writtenBytes < PAYLOAD_SIZE) {
+								 auto n = write(sourceFileDescriptors[0], payload.data() + writtenBytes,
+										PAYLOAD_SIZE - writtenBytes);
+								 if (n <= 0)
+									 return;
+								 writtenBytes += n;
+							 }
+						 }
+					 });
+
+		size_t expectedBytes = 0;
+		std::thread receiverThread([&]() {
+						   std::vector<uint8_t> buffer(1024 * 1024);
+						   size_t receivedBytes = 0;
+						   while (true) {
+							   auto n = recv(destinationFileDescriptors[1], buffer.data(), buffer.size(), 0);
+							   if (n <= 0)
+								   break;
+							   receivedBytes += n;
+						   }
+						   expectedBytes = receivedBytes;
+					   });
+
+		auto startCPUTime = getThreadCPUTime();
+		auto duration = measure([&]() {
+						forward(sourceFileDescriptors[1], destination);
+					}, MESSAGE_COUNT);
+		cpuTimePerGigabyte = (getThreadCPUTime() - startCPUTime) / (MESSAGE_COUNT * PAYLOAD_SIZE / (1024. * 1024 * 1024) );
+
+		senderThread.join();
+		shutdown(destinationFileDescriptors[0], SHUT_WR);
+		receiverThread.join();
+		EXPECT_GT(expectedBytes, MESSAGE_COUNT * PAYLOAD_SIZE);
+
+		close(sourceFileDescriptors[0]);
+		close(sourceFileDescriptors[1]);
+		close(destinationFileDescriptors[0]);
+		close(destinationFileDescriptors[1]);
+		return duration;
+	};
+
+	// the payload is read into the message, which is then written to the destination
+	double copyCPUTime;
+	IPCInputMessage forwardedMessage;
+	forwardedMessage.getPayload().append( header.getIPCMessage().getPayload().getData(), header.getIPCMessage().getPayload().size() );
+	size_t headerSize = forwardedMessage.getPayload().size();
+	auto copyDuration = measureForwarding([&](int source, SocketPairConnection& destination) {
+						      forwardedMessage.getPayload().resize(headerSize + PAYLOAD_SIZE);
+						      IPCBufferReader reader(forwardedMessage.getPayload().getData() + headerSize, PAYLOAD_SIZE);
+						      while ( !reader.isComplete() )
+							      reader.read(source, true);
+						      destination.writeBlocking(forwardedMessage);
+					      }, copyCPUTime);
+
+	// the payload is moved from socket to socket through a pipe
+	double relayCPUTime;
+	SpliceRelay relay;
+	ASSERT_EQ(relay.init(), SomeIPReturnCode::OK);
+	auto relayDuration = measureForwarding([&](int source, SocketPairConnection& destination) {
+						       ByteArray frameHeader;
+						       destination.encodeFrameHeader(header.getIPCMessage(), PAYLOAD_SIZE, frameHeader);
+						       relay.start( destination, frameHeader.getData(), frameHeader.size(), PAYLOAD_SIZE );
+						       while (true) {
+							       auto status = relay.transfer(source);
+							       if (status == SpliceRelay::Status::COMPLETE)
+								       break;
+							       pollfd fd = { source, POLLIN, 0 };
+							       if (status == SpliceRelay::Status::WAITING_FOR_DESTINATION)
+								       fd = { relay.getDestinationFileDescriptor(), POLLOUT, 0 };
+							       poll(&fd, 1, -1);
+						       }
+					       }, relayCPUTime);
+
+	log_info() << "Dispatcher CPU time per GB, copy : " << copyCPUTime / 1000 << " ms, splice : " << relayCPUTime / 1000 << " ms";
+	report("read and write -> splice relay, 4 MB payload", copyDuration, relayDuration);
+}
+
+TEST_F(MessageBenchmark, UDPTransport) {
+
+	static const size_t PAYLOAD_SIZE = 32;
+	static const size_t BURST_SIZE = 64;
+	static const size_t ROUND_COUNT = 2000;
+
+	std::vector<uint8_t> payload(PAYLOAD_SIZE, 0x55);
+	SomeIP::SomeIPHeader header(0x12340010, 0x00010002, 3, SomeIP::MessageType::NOTIFICATION, SomeIP::ReturnCode::E_OK);
+
+	in_addr loopback;
+	loopback.s_addr = htonl(INADDR_LOOPBACK);
+
+	// one round : burstSize messages are sent to a peer thread, which answers with a single message once it has received
+	// all of them. Each message is written with its own call, as done by the TCPClient.
+	auto measureTCP = [&](size_t burstSize) {
+		int serverFileDescriptor = socket(AF_INET, SOCK_STREAM, 0);
+		sockaddr_in address = {};
+		address.sin_family = AF_INET;
+		address.sin_addr = loopback;
+		socklen_t addressLength = sizeof(address);
+		EXPECT_EQ(bind( serverFileDescriptor, (sockaddr*) &address, sizeof(address) ), 0);
+		EXPECT_EQ(listen(serverFileDescriptor, 1), 0);
+		getsockname(serverFileDescriptor, (sockaddr*) &address, &addressLength);
+
+		int senderFileDescriptor = socket(AF_INET, SOCK_STREAM, 0);
+		EXPECT_EQ(connect( senderFileDescriptor, (sockaddr*) &address, sizeof(address) ), 0);
+		int peerFileDescriptor = accept(serverFileDescriptor, nullptr, nullptr);
+
+		int on = 1;
+		setsockopt( senderFileDescriptor, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on) );
+		setsockopt( peerFileDescriptor, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on) );
+
+		std::thread peerThread([&]() {
+					       unsigned char message[SomeIP::SOMEIP_HEADER_LENGTH_ON_NETWORK + PAYLOAD_SIZE];
+					       for (size_t round = 0; round < ROUND_COUNT; round++) {
+						       for (size_t i = 0; i < burstSize; i++)
+							       if (recv(peerFileDescriptor, message, sizeof(message), MSG_WAITALL) != sizeof(message) )
+								       return;
+						       send(peerFileDescriptor, message, sizeof(message), MSG_NOSIGNAL);
+					       }
+				       });
+
+		TCPSender sender;
+		sender.setFileDescriptor(senderFileDescriptor);
+
+		unsigned char headerBytes[SomeIP::SOMEIP_HEADER_LENGTH_ON_NETWORK];
+		SomeIPHeaderCodec::encode(header, PAYLOAD_SIZE, headerBytes);
+		unsigned char answer[SomeIP::SOMEIP_HEADER_LENGTH_ON_NETWORK + PAYLOAD_SIZE];
+
+		auto duration = measure([&]() {
+						for (size_t i = 0; i < burstSize; i++) {
+							struct iovec vectors[2] = { { headerBytes, sizeof(headerBytes) }, { payload.data(), PAYLOAD_SIZE } };
+							sender.writeVectorNonBlocking(vectors, 2);
+						}
+						sender.flush();
+						recv(senderFileDescriptor, answer, sizeof(answer), MSG_WAITALL);
+					}, ROUND_COUNT);
+
+		peerThread.join();
+		sender.disconnect();
+		close(peerFileDescriptor);
+		close(serverFileDescriptor);
+		return duration;
+	};
+
+	auto waitForMessages = [](SomeIPDatagramSocket& socket, size_t messageCount, IPv4TCPEndPoint& source) {
+		size_t receivedCount = 0;
+		while (receivedCount < messageCount) {
+			pollfd fd = { socket.getFileDescriptor(), POLLIN, 0 };
+			if (poll(&fd, 1, 1000) != 1)
+				return false;
+			socket.receive([&] (const IPv4TCPEndPoint& messageSource, const SomeIP::SomeIPHeader&, const void*, size_t) {
+					       source = messageSource;
+					       receivedCount++;
+				       });
+		}
+		return true;
+	};
+
+	// same rounds, the messages of a burst being packed into datagrams sent with a single call, as done by the UDPEndPoint
+	size_t lostRoundCount = 0;
+	auto measureUDP = [&](size_t burstSize) {
+		SomeIPDatagramSocket sender;
+		SomeIPDatagramSocket peer;
+		EXPECT_EQ(sender.bind(0), SomeIPReturnCode::OK);
+		EXPECT_EQ(peer.bind(0), SomeIPReturnCode::OK);
+		IPv4TCPEndPoint peerAddress( IPV4Address(loopback), peer.getLocalPort() );
+
+		std::thread peerThread([&]() {
+					       IPv4TCPEndPoint senderAddress;
+					       for (size_t round = 0; round < ROUND_COUNT; round++) {
+						       if ( !waitForMessages(peer, burstSize, senderAddress) )
+							       return;
+						       peer.queueMessage( senderAddress, header, payload.data(), PAYLOAD_SIZE );
+						       peer.flush();
+					       }
+				       });
+
+		IPv4TCPEndPoint answerSource;
+		auto duration = measure([&]() {
+						for (size_t i = 0; i < burstSize; i++)
+							sender.queueMessage( peerAddress, header, payload.data(), PAYLOAD_SIZE );
+						sender.flush();
+						if ( !waitForMessages(sender, 1, answerSource) )
+							lostRoundCount++;
+					}, ROUND_COUNT);
+
+		peerThread.join();
+		return duration;
+	};
+
+	auto tcpRoundTrip = measureTCP(1);
+	auto udpRoundTrip = measureUDP(1);
+	auto tcpBurst = measureTCP(BURST_SIZE);
+	auto udpBurst = measureUDP(BURST_SIZE);
+
+	EXPECT_EQ(lostRoundCount, 0u);
+
+	log_info() << "Notifications per second with bursts of " << BURST_SIZE << ", TCP : " << BURST_SIZE * 1e6 / tcpBurst <<
+		", UDP : " << BURST_SIZE * 1e6 / udpBurst;
+	report("TCP -> UDP, round trip of a small message", tcpRoundTrip, udpRoundTrip);
+	report("TCP -> UDP, burst of 64 small notifications", tcpBurst, udpBurst);
+}
+
+int main(int argc, char** argv) {
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
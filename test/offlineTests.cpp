@@ -1,6 +1,12 @@
 //#include "CommonAPI-SomeIP.h"
+#include <sys/mman.h>
+#include <arpa/inet.h>
+#include <thread>
+
 #include "SomeIP-Serialization.h"
+#include "SomeIP-InPlace.h"
 #include "SomeIP-clientLib.h"
+#include "SomeIP-HandlerTable.h"
 
 #include "GlibMainLoopInterfaceImplementation.h"
 
@@ -8,6 +14,13 @@
 
 #include "MainLoopApplication.h"
 #include "Message.h"
+#include "DatagramSocket.h"
+#include "SegmentReassembler.h"
+#include "ServiceDiscovery.h"
+#include "AcceptorGroup.h"
+#include "ServiceRegistrySegment.h"
+#include "Dispatcher.h"
+#include "UDPManager.h"
 
 class MyClass {
 
@@ -245,7 +258,1368 @@ TEST_F(SomeIPTest, SerializationLSB) {
 	EXPECT_EQ(readInt, referenceInt & 0xFFFFFF);
 }
 
+struct FieldsPoint {
+	int32_t x;
+	int16_t y;
+	int16_t z;
+	SOMEIP_FIELDS(x, y, z)
+};
+
+struct FieldsShape {
+	std::string name;
+	std::vector<FieldsPoint> points;
+	uint8_t flags;
+	SOMEIP_FIELDS(name, points, flags)
+};
+
+struct FieldsSwitch {
+	uint8_t id;
+	bool isOn;
+	SOMEIP_FIELDS(id, isOn)
+};
+
+TEST_F(SomeIPTest, SerializationFields) {
+
+	ByteArray byteArray;
+	SomeIPOutputStream stream(byteArray);
+
+	FieldsShape referenceValue;
+	referenceValue.name = "shape";
+	referenceValue.points = { {1, 2, 3}, {-4, 5, -6} };
+	referenceValue.flags = 0x42;
+	stream << referenceValue;
+
+	// the points are copied as a block, but their fields still need to be in network byte order
+	EXPECT_TRUE( FieldSerializer<FieldsPoint>::hasWireMemoryLayout(referenceValue.points[0]) );
+	EXPECT_EQ( byteArray.size(), sizeof(uint32_t) + 5 + sizeof(uint32_t) + 2 * 8 + 1 );
+	EXPECT_EQ(byteArray.getData()[4 + 5 + 4 + 3], 1);
+
+	SomeIPInputStream inputStream( byteArray.getData(), byteArray.size() );
+	FieldsShape readValue;
+	inputStream >> readValue;
+	EXPECT_FALSE( inputStream.hasError() );
+	EXPECT_EQ(readValue.name, referenceValue.name);
+	ASSERT_EQ( readValue.points.size(), referenceValue.points.size() );
+	EXPECT_EQ(readValue.points[1].x, -4);
+	EXPECT_EQ(readValue.points[1].z, -6);
+	EXPECT_EQ(readValue.flags, referenceValue.flags);
+
+	// truncated data
+	SomeIPInputStream truncatedStream(byteArray.getData(), 12);
+	truncatedStream >> readValue;
+	EXPECT_TRUE( truncatedStream.hasError() );
+
+	// the scalars following a variable-size field are bounds checked too
+	std::vector<uint8_t> truncatedCopy( byteArray.getData(), byteArray.getData() + byteArray.size() - 1 );
+	SomeIPInputStream truncatedFlagsStream( truncatedCopy.data(), truncatedCopy.size() );
+	FieldsShape truncatedValue;
+	truncatedValue.flags = 0;
+	truncatedFlagsStream >> truncatedValue;
+	EXPECT_TRUE( truncatedFlagsStream.hasError() );
+	EXPECT_EQ(truncatedValue.flags, 0);
+	EXPECT_EQ( truncatedFlagsStream.remainingBytesCount(), 0u );
+
+	// a bool can't be read with a memory copy
+	FieldsSwitch switchValue = {1, true};
+	EXPECT_FALSE( FieldSerializer<FieldsSwitch>::hasWireMemoryLayout(switchValue) );
+}
+
+TEST_F(SomeIPTest, SerializationViews) {
+
+	ByteArray byteArray;
+	SomeIPOutputStream stream(byteArray);
+
+	const std::string referenceString = "diagnostic";
+	const std::vector<uint8_t> referenceBlob = {1, 2, 3, 4, 5};
+	stream << referenceString << referenceBlob;
+
+	SomeIPInputStream inputStream( byteArray.getData(), byteArray.size() );
+
+	StringView stringView;
+	ByteView blobView;
+	inputStream >> stringView >> blobView;
+
+	EXPECT_FALSE( inputStream.hasError() );
+	EXPECT_TRUE(stringView == referenceString);
+
+	// the views point into the serialized data
+	EXPECT_EQ( reinterpret_cast<const unsigned char*>( stringView.data() ), byteArray.getData() + sizeof(uint32_t) );
+	ASSERT_EQ( blobView.size(), referenceBlob.size() );
+	EXPECT_TRUE( std::equal( blobView.begin(), blobView.end(), referenceBlob.begin() ) );
+}
+
+TEST_F(SomeIPTest, SerializationArena) {
+
+	ByteArray byteArray;
+	SomeIPOutputStream stream(byteArray);
+
+	const std::vector<std::string> referenceValue = {"first", "second", "a longer string, which does not fit in the SSO buffer"};
+	std::unordered_map<uint32_t, std::vector<std::string> > referenceMap;
+	referenceMap[5] = referenceValue;
+	stream << referenceValue << referenceMap;
+
+	SomeIPInputStream inputStream( byteArray.getData(), byteArray.size() );
+
+	MessageArena arena;
+	ArenaVector<ArenaString> readValue( (ArenaAllocator<ArenaString>(arena)) );
+	typedef std::pair<const uint32_t, ArenaVector<ArenaString> > MapEntry;
+	std::unordered_map<uint32_t, ArenaVector<ArenaString>, std::hash<uint32_t>, std::equal_to<uint32_t>,
+			   ArenaAllocator<MapEntry> > readMap( 0, std::hash<uint32_t>(), std::equal_to<uint32_t>(),
+							       ArenaAllocator<MapEntry>(arena) );
+	inputStream >> readValue >> readMap;
+
+	EXPECT_FALSE( inputStream.hasError() );
+	ASSERT_EQ( readValue.size(), referenceValue.size() );
+	EXPECT_EQ(readValue[2].c_str(), referenceValue[2]);
+	auto it = readMap.find(5);
+	ASSERT_TRUE( it != readMap.end() );
+	ASSERT_EQ( it->second.size(), referenceValue.size() );
+	EXPECT_EQ(it->second[1].c_str(), referenceValue[1]);
+
+	// the nested strings also come from the arena
+	EXPECT_EQ(it->second[2].get_allocator().getArena(), &arena);
+	EXPECT_GT(arena.getAllocatedBytes(), referenceValue[2].size() * 2);
+}
+
+TEST_F(SomeIPTest, SerializationInPlace) {
+
+	enum TileField {
+		ID, NAME, HEIGHTS, ORIGIN, OBJECTS, UNUSED, TILE_FIELD_COUNT
+	};
+
+	enum PointField {
+		X, Y, POINT_FIELD_COUNT
+	};
+
+	ByteArray byteArray;
+	SomeIPOutputStream stream(byteArray);
+	// make sure the alignment does not depend on the position of the payload in the message
+	stream << static_cast<uint8_t>(0);
+
+	std::vector<float> heights(256 * 1024);
+	for (size_t i = 0; i < heights.size(); i++)
+		heights[i] = i * 0.5f;
+
+	{
+		InPlaceTableWriter tile(stream, TILE_FIELD_COUNT);
+		tile.writeArray(HEIGHTS, heights);
+		tile.writeString(NAME, "tile");
+		tile.writeScalar<uint16_t>(ID, 0x1234);
+
+		auto origin = tile.writeTable(ORIGIN, POINT_FIELD_COUNT);
+		origin.writeScalar<double>(X, 1.5);
+		origin.writeScalar<int64_t>(Y, -3);
+
+		auto objects = tile.writeTableArray(OBJECTS, 2);
+		for (size_t i = 0; i < 2; i++)
+			objects.writeTable(i, POINT_FIELD_COUNT).writeScalar<int32_t>(X, i + 10);
+	}
+
+	InPlaceTableReader tile( byteArray.getData() + 1, byteArray.size() - 1 );
+	ASSERT_TRUE( tile.isValid() );
+	EXPECT_EQ(tile.getScalar<uint16_t>(ID), 0x1234);
+	EXPECT_EQ(tile.getString(NAME), std::string("tile") );
+	EXPECT_FALSE( tile.hasField(UNUSED) );
+	EXPECT_EQ(tile.getScalar<uint32_t>(UNUSED, 7), 7u);
+
+	auto readHeights = tile.getArray<float>(HEIGHTS);
+	ASSERT_EQ( readHeights.size(), heights.size() );
+	EXPECT_EQ(readHeights[1000], heights[1000]);
+
+	auto origin = tile.getTable(ORIGIN);
+	EXPECT_EQ(origin.getScalar<double>(X), 1.5);
+	EXPECT_EQ(origin.getScalar<int64_t>(Y), -3);
+
+	ASSERT_EQ(tile.getTableCount(OBJECTS), 2u);
+	EXPECT_EQ(tile.getTable(OBJECTS, 1).getScalar<int32_t>(X), 11);
+	EXPECT_FALSE( tile.getTable(OBJECTS, 2).isValid() );
+
+	// truncated payload : the fields which are not completely available are reported as absent
+	InPlaceTableReader truncatedTile( byteArray.getData() + 1, byteArray.size() / 2 );
+	ASSERT_TRUE( truncatedTile.isValid() );
+	EXPECT_TRUE( truncatedTile.getArray<float>(HEIGHTS).empty() );
+	EXPECT_FALSE( truncatedTile.getTable(ORIGIN).isValid() );
+}
+
+
+TEST_F(SomeIPTest, MessageHandlerTable) {
+
+	class TestConnection : public MessageSource {
+	public:
+		SomeIPReturnCode sendMessage(const OutputMessage& msg) override {
+			m_sentMessages.push_back(msg);
+			return SomeIPReturnCode::OK;
+		}
+		std::vector<OutputMessage> m_sentMessages;
+	};
+
+	TestConnection connection;
+	SomeIPClient::MessageHandlerTable table(connection);
+
+	SomeIP::ServiceIDs service(0x1234, 1);
+	std::vector<SomeIP::MemberID> calledMethods;
+	for (SomeIP::MemberID memberID : {0x12, 0x10, 0x15})
+		table.onMethod(service, memberID, [&, memberID](const InputMessage&) {
+				       calledMethods.push_back(memberID);
+			       });
+
+	size_t eventCount = 0;
+	table.onEvent(service, 0x8001, [&](const InputMessage&) {
+			      eventCount++;
+		      });
+
+	auto process = [&](SomeIP::ServiceIDs serviceIDs, SomeIP::MemberID memberID, SomeIP::MessageType type) {
+		OutputMessage msg( SomeIP::MemberIDs(serviceIDs.serviceID, serviceIDs.instanceID, memberID) );
+		msg.getHeader().setMessageType(type);
+		return table.processMessage( InputMessage(msg) );
+	};
+
+	EXPECT_EQ(process(service, 0x15, SomeIP::MessageType::REQUEST), MessageProcessingResult::Processed_OK);
+	EXPECT_EQ(process(service, 0x10, SomeIP::MessageType::REQUEST_NO_RETURN), MessageProcessingResult::Processed_OK);
+	EXPECT_EQ(process(service, 0x8001, SomeIP::MessageType::NOTIFICATION), MessageProcessingResult::Processed_OK);
+	EXPECT_EQ( calledMethods, std::vector<SomeIP::MemberID>( {0x15, 0x10} ) );
+	EXPECT_EQ(eventCount, 1u);
+	EXPECT_TRUE( connection.m_sentMessages.empty() );
+
+	// a notification is not a request : no handler is called
+	EXPECT_EQ(process(service, 0x12, SomeIP::MessageType::NOTIFICATION), MessageProcessingResult::NotProcessed_OK);
+
+	// unknown method and unknown instance are answered with an error
+	EXPECT_EQ(process(service, 0x11, SomeIP::MessageType::REQUEST), MessageProcessingResult::Processed_Error);
+	EXPECT_EQ(process(SomeIP::ServiceIDs(0x1234, 2), 0x10, SomeIP::MessageType::REQUEST), MessageProcessingResult::Processed_Error);
+	EXPECT_EQ(process(service, 0x11, SomeIP::MessageType::REQUEST_NO_RETURN), MessageProcessingResult::NotProcessed_OK);
+
+	ASSERT_EQ(connection.m_sentMessages.size(), 2u);
+	EXPECT_EQ(connection.m_sentMessages[0].getHeader().getMessageType(), SomeIP::MessageType::ERROR);
+	EXPECT_EQ(connection.m_sentMessages[0].getHeader().getReturnCode(), SomeIP::E_UNKNOWN_METHOD);
+	EXPECT_EQ(connection.m_sentMessages[1].getHeader().getReturnCode(), SomeIP::E_UNKNOWN_SERVICE);
+	EXPECT_EQ(calledMethods.size(), 2u);
+
+	// the payload is only streamed to a chunk handler if no handler is registered with onMethod()
+	auto chunkHandler = [](const InputMessage&, const void*, size_t, bool) {
+	};
+	table.onStreamingMethod(service, 0x10, chunkHandler);
+	table.onStreamingMethod(service, 0x20, chunkHandler);
+	auto isStreamed = [&](SomeIP::MemberID memberID) {
+		OutputMessage msg( SomeIP::MemberIDs(service.serviceID, service.instanceID, memberID) );
+		msg.getHeader().setMessageType(SomeIP::MessageType::REQUEST);
+		return table.isStreamedMessage(InputMessage(msg), 1024 * 1024);
+	};
+	EXPECT_FALSE( isStreamed(0x10) );
+	EXPECT_TRUE( isStreamed(0x20) );
+}
+
+TEST_F(SomeIPTest, CompactFraming) {
+
+	class TestConnection : public UDSConnection {
+	public:
+		void handleIncomingIPCMessage(IPCInputMessage&) override {
+		}
+		void onDisconnected() override {
+		}
+		void onCongestionDetected() override {
+		}
+		std::string toString() const override {
+			return "TestConnection";
+		}
+		using UDSConnection::setFileDescriptor;
+	};
+
+	int fileDescriptors[2];
+	ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fileDescriptors), 0);
+
+	TestConnection sender;
+	TestConnection receiver;
+	sender.setFileDescriptor(fileDescriptors[0]);
+	receiver.setFileDescriptor(fileDescriptors[1]);
+	sender.setFraming(IPCFraming::COMPACT);
+	receiver.setFraming(IPCFraming::COMPACT);
+
+	// a message with default header fields, and one which needs the optional ones
+	OutputMessage smallMessage( SomeIP::MemberIDs(0x1234, 0, 0x10) );
+	SomeIPOutputStream smallStream = smallMessage.getPayloadOutputStream();
+	smallStream << uint32_t(0x11223344);
+
+	OutputMessage fullMessage( SomeIP::MemberIDs(0x1234, 3, 0x8001) );
+	fullMessage.getHeader().setMessageType(SomeIP::MessageType::ERROR);
+	fullMessage.getHeader().setReturnCode(SomeIP::E_UNKNOWN_METHOD);
+	fullMessage.setClientIdentifier(0x42);
+	SomeIPOutputStream fullStream = fullMessage.getPayloadOutputStream();
+	fullStream << std::string("payload");
+
+	// a non SOME/IP message with a file descriptor attached
+	int pipeFileDescriptors[2];
+	ASSERT_EQ(pipe(pipeFileDescriptors), 0);
+	IPCOutputMessage segmentMessage(IPCMessageType::REGISTRY_SEGMENT);
+	segmentMessage << uint32_t(0x55);
+	segmentMessage.setFileDescriptor(pipeFileDescriptors[0]);
+
+	const IPCMessage* messages[] = {&smallMessage.getIPCMessage(), &fullMessage.getIPCMessage(), &segmentMessage};
+	ASSERT_EQ(sender.writeBlocking(messages, 3), IPCOperationReport::OK);
+	close(pipeFileDescriptors[0]);
+
+	// the size of the length field and of the headers is reduced from 8 + 4 + 16 bytes to 1 + 11 bytes
+	int availableBytes = 0;
+	ioctl(fileDescriptors[1], FIONREAD, &availableBytes);
+	EXPECT_LT( static_cast<size_t>(availableBytes),
+		   smallMessage.getIPCMessage().getPayload().size() + fullMessage.getIPCMessage().getPayload().size() +
+		   segmentMessage.getPayload().size() );
+
+	IPCInputMessage smallInput;
+	ASSERT_EQ(receiver.readBlocking(smallInput), IPCOperationReport::OK);
+	ASSERT_TRUE( smallInput.isComplete() );
+	EXPECT_EQ( smallInput.getPayload().size(), smallMessage.getIPCMessage().getPayload().size() );
+	EXPECT_EQ( memcmp( smallInput.getPayload().getData(), smallMessage.getIPCMessage().getPayload().getData(),
+			   smallInput.getPayload().size() ), 0 );
+
+	IPCInputMessage fullInput;
+	ASSERT_EQ(receiver.readNonBlocking(fullInput), IPCOperationReport::OK);
+	ASSERT_TRUE( fullInput.isComplete() );
+	InputMessage decodedMessage(fullInput);
+	EXPECT_EQ(decodedMessage.getHeader().getMessageID(), fullMessage.getHeader().getMessageID() );
+	EXPECT_EQ(decodedMessage.getInstanceID(), 3);
+	EXPECT_EQ(decodedMessage.getClientIdentifier(), 0x42);
+	EXPECT_EQ(decodedMessage.getHeader().getMessageType(), SomeIP::MessageType::ERROR);
+	EXPECT_EQ(decodedMessage.getHeader().getReturnCode(), SomeIP::E_UNKNOWN_METHOD);
+	EXPECT_EQ( decodedMessage.getPayloadLength(), fullMessage.getPayloadLength() );
+
+	IPCInputMessage segmentInput;
+	ASSERT_EQ(receiver.readBlocking(segmentInput), IPCOperationReport::OK);
+	EXPECT_EQ(segmentInput.getMessageType(), IPCMessageType::REGISTRY_SEGMENT);
+	EXPECT_NE(segmentInput.getFileDescriptor(), -1);
+	IPCInputMessageReader reader(segmentInput);
+	uint32_t value = 0;
+	reader >> value;
+	EXPECT_EQ(value, 0x55u);
+
+	// the received descriptor refers to the pipe
+	ASSERT_EQ(write(pipeFileDescriptors[1], "x", 1), 1);
+	char c = 0;
+	EXPECT_EQ(::read(segmentInput.getFileDescriptor(), &c, 1), 1);
+	EXPECT_EQ(c, 'x');
+	close( segmentInput.getFileDescriptor() );
+	close(pipeFileDescriptors[1]);
+
+	// no frame is left
+	IPCInputMessage emptyInput;
+	EXPECT_EQ(receiver.readNonBlocking(emptyInput), IPCOperationReport::OK);
+	EXPECT_FALSE( emptyInput.isComplete() );
+	EXPECT_FALSE( receiver.hasBufferedData() );
+}
+
+TEST_F(SomeIPTest, BatchMessages) {
+
+	std::vector<OutputMessage> messages;
+	for (size_t i = 0; i < 3; i++) {
+		OutputMessage msg( SomeIP::MemberIDs(0x1234, 1, 0x8001 + i) );
+		msg.getHeader().setMessageType(SomeIP::MessageType::NOTIFICATION);
+		SomeIPOutputStream stream = msg.getPayloadOutputStream();
+		// payloads of various sizes, to check the alignment of the following messages
+		for (size_t j = 0; j <= i; j++)
+			stream << uint8_t(j);
+		messages.push_back( std::move(msg) );
+	}
+
+	IPCOutputMessage registrationMessage(IPCMessageType::SERVICES_REGISTERED);
+	registrationMessage << SomeIP::ServiceID(0x4321) << SomeIP::InstanceID(2);
+
+	IPCBatchWriter writer;
+	for (auto& msg : messages)
+		writer.append( msg.getIPCMessage() );
+	writer.append(registrationMessage);
+	EXPECT_EQ(writer.getMessageCount(), 4u);
+	EXPECT_EQ(writer.getMessage().getMessageType(), IPCMessageType::BATCH);
+
+	IPCInputMessage batch;
+	batch.setContent( writer.getMessage().getPayload().getData(), writer.getMessage().getPayload().size() );
+
+	IPCBatchReader reader(batch);
+	for (size_t i = 0; i < messages.size(); i++) {
+		ASSERT_TRUE( reader.next() );
+		ASSERT_EQ(reader.getMessageType(), IPCMessageType::SEND_MESSAGE);
+		EXPECT_EQ(reinterpret_cast<uintptr_t>( reader.getUserData() ) % IPCBatchWriter::ALIGNMENT, 0u);
+
+		// the message is read in place
+		InputMessage msg( reader.getUserData(), reader.getUserDataLength() );
+		EXPECT_EQ( msg.getMessageID(), messages[i].getHeader().getMessageID() );
+		EXPECT_EQ( msg.getInstanceID(), 1 );
+		ASSERT_EQ( msg.getPayloadLength(), i + 1 );
+		EXPECT_EQ(static_cast<const uint8_t*>( msg.getPayload() )[i], i);
+
+		// a copy references the same data
+		InputMessage copy(msg);
+		EXPECT_EQ( copy.getPayload(), msg.getPayload() );
+	}
+
+	ASSERT_TRUE( reader.next() );
+	EXPECT_EQ(reader.getMessageType(), IPCMessageType::SERVICES_REGISTERED);
+	IPCInputMessage registrationCopy;
+	reader.copyTo(registrationCopy);
+	IPCInputMessageReader registrationReader(registrationCopy);
+	SomeIP::ServiceID serviceID;
+	SomeIP::InstanceID instanceID;
+	registrationReader >> serviceID >> instanceID;
+	EXPECT_EQ(serviceID, 0x4321);
+	EXPECT_EQ(instanceID, 2);
+
+	EXPECT_FALSE( reader.next() );
+
+	// a truncated batch stops at the last complete message
+	IPCInputMessage truncatedBatch;
+	truncatedBatch.setContent(batch.getPayload().getData(), batch.getPayload().size() - 2);
+	IPCBatchReader truncatedReader(truncatedBatch);
+	size_t count = 0;
+	while ( truncatedReader.next() )
+		count++;
+	EXPECT_EQ(count, 3u);
+}
+
+TEST_F(SomeIPTest, SeqPacketConnection) {
+
+	class TestConnection : public UDSConnection {
+	public:
+		void handleIncomingIPCMessage(IPCInputMessage&) override {
+		}
+		void onDisconnected() override {
+		}
+		void onCongestionDetected() override {
+		}
+		std::string toString() const override {
+			return "TestConnection";
+		}
+		using UDSConnection::setFileDescriptor;
+		using UDSConnection::detectSocketType;
+	};
+
+	int fileDescriptors[2];
+	ASSERT_EQ(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fileDescriptors), 0);
+
+	TestConnection sender;
+	TestConnection receiver;
+	sender.setFileDescriptor(fileDescriptors[0]);
+	receiver.setFileDescriptor(fileDescriptors[1]);
+	sender.detectSocketType();
+	receiver.detectSocketType();
+	ASSERT_TRUE( sender.isPacketMode() );
+
+	OutputMessage smallMessage( SomeIP::MemberIDs(0x1234, 0, 0x10) );
+	SomeIPOutputStream smallStream = smallMessage.getPayloadOutputStream();
+	smallStream << uint32_t(0x11223344);
+
+	int pipeFileDescriptors[2];
+	ASSERT_EQ(pipe(pipeFileDescriptors), 0);
+	IPCOutputMessage segmentMessage(IPCMessageType::REGISTRY_SEGMENT);
+	segmentMessage << uint32_t(0x55);
+	segmentMessage.setFileDescriptor(pipeFileDescriptors[0]);
+
+	// a message which does not fit in a single packet
+	OutputMessage largeMessage( SomeIP::MemberIDs(0x1234, 0, 0x11) );
+	std::vector<uint8_t> largePayload(100 * 1024);
+	for (size_t i = 0; i < largePayload.size(); i++)
+		largePayload[i] = static_cast<uint8_t>(i * 7);
+	largeMessage.getWritablePayload().append( largePayload.data(), largePayload.size() );
+
+	const IPCMessage* messages[] = {&smallMessage.getIPCMessage(), &segmentMessage, &largeMessage.getIPCMessage()};
+	ASSERT_EQ(sender.writeBlocking(messages, 3), IPCOperationReport::OK);
+	ASSERT_EQ(sender.writeNonBlocking( smallMessage.getIPCMessage() ), IPCOperationReport::OK);
+	close(pipeFileDescriptors[0]);
+
+	IPCInputMessage smallInput;
+	ASSERT_EQ(receiver.readBlocking(smallInput), IPCOperationReport::OK);
+	ASSERT_TRUE( smallInput.isComplete() );
+	EXPECT_EQ( smallInput.getPayload().size(), smallMessage.getIPCMessage().getPayload().size() );
+	EXPECT_EQ( memcmp( smallInput.getPayload().getData(), smallMessage.getIPCMessage().getPayload().getData(),
+			   smallInput.getPayload().size() ), 0 );
+
+	// all the packets have been received with a single call
+	EXPECT_TRUE( receiver.hasBufferedData() );
+
+	IPCInputMessage segmentInput;
+	ASSERT_EQ(receiver.readNonBlocking(segmentInput), IPCOperationReport::OK);
+	ASSERT_TRUE( segmentInput.isComplete() );
+	EXPECT_EQ(segmentInput.getMessageType(), IPCMessageType::REGISTRY_SEGMENT);
+	EXPECT_NE(segmentInput.getFileDescriptor(), -1);
+
+	ASSERT_EQ(write(pipeFileDescriptors[1], "x", 1), 1);
+	char c = 0;
+	EXPECT_EQ(::read(segmentInput.getFileDescriptor(), &c, 1), 1);
+	EXPECT_EQ(c, 'x');
+	close(pipeFileDescriptors[1]);
+
+	IPCInputMessage largeInput;
+	ASSERT_EQ(receiver.readBlocking(largeInput), IPCOperationReport::OK);
+	ASSERT_TRUE( largeInput.isComplete() );
+	ASSERT_EQ( largeInput.getPayload().size(), largeMessage.getIPCMessage().getPayload().size() );
+	EXPECT_EQ( memcmp( largeInput.getPayload().getData(), largeMessage.getIPCMessage().getPayload().getData(),
+			   largeInput.getPayload().size() ), 0 );
+
+	IPCInputMessage lastInput;
+	ASSERT_EQ(receiver.readNonBlocking(lastInput), IPCOperationReport::OK);
+	EXPECT_TRUE( lastInput.isComplete() );
+
+	IPCInputMessage emptyInput;
+	EXPECT_EQ(receiver.readNonBlocking(emptyInput), IPCOperationReport::OK);
+	EXPECT_FALSE( emptyInput.isComplete() );
+	EXPECT_FALSE( receiver.hasBufferedData() );
+}
+
+TEST_F(SomeIPTest, SharedPayload) {
+
+	class TestConnection : public UDSConnection {
+	public:
+		void handleIncomingIPCMessage(IPCInputMessage&) override {
+		}
+		void onDisconnected() override {
+		}
+		void onCongestionDetected() override {
+		}
+		std::string toString() const override {
+			return "TestConnection";
+		}
+		using UDSConnection::setFileDescriptor;
+		using UDSConnection::setInputMessage;
+	};
+
+	// client -> dispatcher -> client
+	int clientFileDescriptors[2];
+	int dispatcherFileDescriptors[2];
+	ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, clientFileDescriptors), 0);
+	ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, dispatcherFileDescriptors), 0);
+
+	TestConnection sender;
+	TestConnection dispatcherInput;
+	TestConnection dispatcherOutput;
+	TestConnection receiver;
+	sender.setFileDescriptor(clientFileDescriptors[0]);
+	dispatcherInput.setFileDescriptor(clientFileDescriptors[1]);
+	dispatcherOutput.setFileDescriptor(dispatcherFileDescriptors[0]);
+	receiver.setFileDescriptor(dispatcherFileDescriptors[1]);
+
+	OutputMessage msg( SomeIP::MemberIDs(0x1234, 0, 0x10) );
+	std::vector<uint8_t> payload(64 * 1024);
+	for (size_t i = 0; i < payload.size(); i++)
+		payload[i] = static_cast<uint8_t>(i * 7);
+	msg.getWritablePayload().append( payload.data(), payload.size() );
+
+	EXPECT_FALSE( SomeIPClient::SharedPayloadIPCMessage::create(msg, 0) );
+	EXPECT_FALSE( SomeIPClient::SharedPayloadIPCMessage::create(msg, payload.size() + 1) );
+
+	auto sharedPayloadMessage = SomeIPClient::SharedPayloadIPCMessage::create( msg, payload.size() );
+	ASSERT_TRUE( sharedPayloadMessage.get() != nullptr );
+	EXPECT_EQ( sharedPayloadMessage->getUserDataLength(), sizeof( msg.getHeader() ) );
+
+	// the payload can not be modified once it has been sent
+	EXPECT_EQ(write(sharedPayloadMessage->getFileDescriptor(), "x", 1), -1);
+
+	ASSERT_EQ(sender.writeBlocking(*sharedPayloadMessage), IPCOperationReport::OK);
+
+	// the dispatcher only forwards the header and the file descriptor
+	IPCInputMessage forwardedMessage;
+	dispatcherInput.setInputMessage(forwardedMessage);
+	ASSERT_EQ(dispatcherInput.readBlocking(forwardedMessage), IPCOperationReport::OK);
+	InputMessage dispatcherMessage(forwardedMessage);
+	EXPECT_TRUE( dispatcherMessage.hasSharedPayload() );
+	EXPECT_EQ(dispatcherMessage.getMessageID(), msg.getHeader().getMessageID() );
+	ASSERT_EQ(dispatcherOutput.writeBlocking(forwardedMessage), IPCOperationReport::OK);
+
+	IPCInputMessage receivedMessage;
+	receiver.setInputMessage(receivedMessage);
+	ASSERT_EQ(receiver.readBlocking(receivedMessage), IPCOperationReport::OK);
+	InputMessage inputMessage(receivedMessage);
+	EXPECT_EQ( inputMessage.getHeader().getRequestID(), msg.getHeader().getRequestID() );
+	ASSERT_EQ( inputMessage.getPayloadLength(), payload.size() );
+	EXPECT_EQ(memcmp( inputMessage.getPayload(), payload.data(), payload.size() ), 0);
+
+	// the mapping is shared by the copies
+	InputMessage copy(inputMessage);
+	EXPECT_EQ( copy.getPayload(), inputMessage.getPayload() );
+
+	// a file which is not sealed is rejected
+	int unsealedFileDescriptor = memfd_create("test", MFD_CLOEXEC);
+	ASSERT_NE(unsealedFileDescriptor, -1);
+	ASSERT_EQ(write(unsealedFileDescriptor, "x", 1), 1);
+	SharedPayload unsealedPayload;
+	EXPECT_TRUE( isError( unsealedPayload.map(unsealedFileDescriptor) ) );
+	close(unsealedFileDescriptor);
+}
+
+TEST_F(SomeIPTest, ZeroCopyTransmission) {
+
+	class TestConnection : public SocketStreamConnection {
+	public:
+		void onDisconnected() override {
+		}
+		void onCongestionDetected() override {
+		}
+		std::string toString() const override {
+			return "TestConnection";
+		}
+		using SocketStreamConnection::writeVectorNonBlocking;
+	};
+
+	int serverFileDescriptor = socket(AF_INET, SOCK_STREAM, 0);
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t addressLength = sizeof(address);
+	ASSERT_EQ(bind( serverFileDescriptor, (sockaddr*) &address, sizeof(address) ), 0);
+	ASSERT_EQ(listen(serverFileDescriptor, 1), 0);
+	getsockname(serverFileDescriptor, (sockaddr*) &address, &addressLength);
+
+	int senderFileDescriptor = socket(AF_INET, SOCK_STREAM, 0);
+	ASSERT_EQ(connect( senderFileDescriptor, (sockaddr*) &address, sizeof(address) ), 0);
+	int receiverFileDescriptor = accept(serverFileDescriptor, nullptr, nullptr);
+	close(serverFileDescriptor);
+
+	TestConnection sender;
+	sender.setFileDescriptor(senderFileDescriptor);
+
+	if ( !sender.enableZeroCopy() ) {
+		log_warning() << "MSG_ZEROCOPY not supported, test skipped";
+		sender.disconnect();
+		close(receiverFileDescriptor);
+		return;
+	}
+
+	const char header[] = "header";
+	std::vector<uint8_t> payload(64 * 1024, 0x55);
+	auto owner = std::make_shared<int>(0);
+	struct iovec vectors[2] = { { const_cast<char*>(header), sizeof(header) }, { payload.data(), payload.size() } };
+	ASSERT_EQ(sender.writeVectorNonBlocking(vectors, 2, owner), IPCOperationReport::OK);
+
+	// the buffers are kept until the kernel notifies the completion
+	EXPECT_GT(owner.use_count(), 1);
+
+	std::vector<uint8_t> received( sizeof(header) + payload.size() );
+	size_t receivedBytes = 0;
+	while ( receivedBytes < received.size() ) {
+		auto n = recv(receiverFileDescriptor, received.data() + receivedBytes, received.size() - receivedBytes, 0);
+		ASSERT_GT(n, 0);
+		receivedBytes += n;
+	}
+	EXPECT_EQ(memcmp( received.data(), header, sizeof(header) ), 0);
+	EXPECT_EQ(memcmp( received.data() + sizeof(header), payload.data(), payload.size() ), 0);
+
+	pollfd fd = { senderFileDescriptor, POLLERR, 0 };
+	while (owner.use_count() > 1) {
+		ASSERT_EQ(poll(&fd, 1, 1000), 1);
+		ASSERT_EQ(sender.processZeroCopyCompletions(), IPCOperationReport::OK);
+	}
+
+	// the kernel always copies the data sent over the loopback interface, so zero-copy is not worth it there
+	EXPECT_FALSE( sender.isZeroCopyEnabled() );
+
+	sender.disconnect();
+	close(receiverFileDescriptor);
+}
+
+TEST_F(SomeIPTest, SpliceRelay) {
+
+	class TestConnection : public UDSConnection {
+	public:
+		void handleIncomingIPCMessage(IPCInputMessage&) override {
+		}
+		void onDisconnected() override {
+		}
+		void onCongestionDetected() override {
+		}
+		std::string toString() const override {
+			return "TestConnection";
+		}
+		using UDSConnection::setFileDescriptor;
+		using UDSConnection::setInputMessage;
+	};
+
+	int sourceFileDescriptors[2];
+	int destinationFileDescriptors[2];
+	ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sourceFileDescriptors), 0);
+	ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, destinationFileDescriptors), 0);
+
+	TestConnection destination;
+	TestConnection receiver;
+	destination.setFileDescriptor(destinationFileDescriptors[0]);
+	receiver.setFileDescriptor(destinationFileDescriptors[1]);
+	destination.setFraming(IPCFraming::COMPACT);
+	receiver.setFraming(IPCFraming::COMPACT);
+
+	// larger than the socket buffers, so that the relay has to wait for both ends
+	std::vector<uint8_t> payload(4 * 1024 * 1024);
+	for (size_t i = 0; i < payload.size(); i++)
+		payload[i] = static_cast<uint8_t>(i * 7);
+
+	OutputMessage header( SomeIP::MemberIDs(0x1234, 0, 0x10) );
+	ByteArray frameHeader;
+	destination.encodeFrameHeader(header.getIPCMessage(), payload.size(), frameHeader);
+
+	SpliceRelay relay;
+	ASSERT_EQ(relay.init(), SomeIPReturnCode::OK);
+	ASSERT_TRUE( relay.start( destination, frameHeader.getData(), frameHeader.size(), payload.size() ) );
+	EXPECT_TRUE( relay.isActive() );
+
+	// the destination is reserved : a message sent in the meantime is queued, and sent after the relayed one
+	OutputMessage smallMessage( SomeIP::MemberIDs(0x1234, 0, 0x11) );
+	SomeIPOutputStream smallStream = smallMessage.getPayloadOutputStream();
+	smallStream << uint32_t(0x11223344);
+	EXPECT_EQ(destination.writeNonBlocking( smallMessage.getIPCMessage() ), IPCOperationReport::BUFFER_FULL);
+
+	SpliceRelay otherRelay;
+	ASSERT_EQ(otherRelay.init(), SomeIPReturnCode::OK);
+	EXPECT_FALSE( otherRelay.start( destination, frameHeader.getData(), frameHeader.size(), payload.size() ) );
+
+	std::thread senderThread([&]() {
+					 size_t writtenBytes = 0;
+					 while ( writtenBytes < payload.size() ) {
+						 auto n = write( sourceFileDescriptors[0], payload.data() + writtenBytes, payload.size() - writtenBytes );
+						 if (n <= 0)
+							 break;
+						 writtenBytes += n;
+					 }
+				 });
+
+	IPCInputMessage largeInput;
+	IPCInputMessage smallInput;
+	std::thread receiverThread([&]() {
+					   receiver.setInputMessage(largeInput);
+					   receiver.readBlocking(largeInput);
+					   receiver.setInputMessage(smallInput);
+					   receiver.readBlocking(smallInput);
+				   });
+
+	auto status = SpliceRelay::Status::WAITING_FOR_SOURCE;
+	bool hasWaitedForDestination = false;
+	while (status != SpliceRelay::Status::COMPLETE) {
+		status = relay.transfer(sourceFileDescriptors[1]);
+		ASSERT_NE(status, SpliceRelay::Status::SOURCE_ERROR);
+		if (status == SpliceRelay::Status::WAITING_FOR_DESTINATION) {
+			hasWaitedForDestination = true;
+			pollfd fd = { relay.getDestinationFileDescriptor(), POLLOUT, 0 };
+			poll(&fd, 1, 1000);
+		} else if (status == SpliceRelay::Status::WAITING_FOR_SOURCE) {
+			pollfd fd = { sourceFileDescriptors[1], POLLIN, 0 };
+			poll(&fd, 1, 1000);
+		}
+	}
+
+	EXPECT_TRUE(hasWaitedForDestination);
+	EXPECT_FALSE( relay.isActive() );
+	EXPECT_EQ(destination.writePendingDataNonBlocking(), IPCOperationReport::OK);
 
+	senderThread.join();
+	receiverThread.join();
+
+	ASSERT_TRUE( largeInput.isComplete() );
+	InputMessage largeMessage(largeInput);
+	EXPECT_EQ( largeMessage.getHeader().getMessageID(), header.getHeader().getMessageID() );
+	ASSERT_EQ( largeMessage.getPayloadLength(), payload.size() );
+	EXPECT_EQ(memcmp( largeMessage.getPayload(), payload.data(), payload.size() ), 0);
+
+	ASSERT_TRUE( smallInput.isComplete() );
+	EXPECT_EQ( InputMessage(smallInput).getHeader().getMessageID(), smallMessage.getHeader().getMessageID() );
+
+	for (auto fd : sourceFileDescriptors)
+		close(fd);
+}
+
+TEST_F(SomeIPTest, StreamedReception) {
+
+	class TestConnection : public UDSConnection {
+	public:
+		void handleIncomingIPCMessage(IPCInputMessage&) override {
+		}
+		void onDisconnected() override {
+		}
+		void onCongestionDetected() override {
+		}
+		std::string toString() const override {
+			return "TestConnection";
+		}
+		bool beginStreamedMessage(const IPCInputMessage& header, size_t payloadLength) override {
+			m_streamedPayloadLength = payloadLength;
+			return ( InputMessage(header).getHeader().getMemberID() == 0x10 );
+		}
+		void onStreamedChunk(const IPCInputMessage& header, const void* data, size_t length, bool isLast) override {
+			auto p = static_cast<const uint8_t*>(data);
+			m_streamedPayload.insert(m_streamedPayload.end(), p, p + length);
+			m_largestChunk = std::max(m_largestChunk, length);
+			m_isStreamComplete = isLast;
+		}
+		using UDSConnection::setFileDescriptor;
+		using UDSConnection::setInputMessage;
+		using UDSConnection::setPacketMode;
+
+		std::vector<uint8_t> m_streamedPayload;
+		size_t m_streamedPayloadLength = 0;
+		size_t m_largestChunk = 0;
+		bool m_isStreamComplete = false;
+	};
+
+	std::vector<uint8_t> payload(1024 * 1024);
+	for (size_t i = 0; i < payload.size(); i++)
+		payload[i] = static_cast<uint8_t>(i * 7);
+
+	OutputMessage largeMessage( SomeIP::MemberIDs(0x1234, 0, 0x10) );
+	largeMessage.getPayloadOutputStream().writeRawData( payload.data(), payload.size() );
+
+	// refused by the receiver, so it is buffered as usual
+	OutputMessage bufferedMessage( SomeIP::MemberIDs(0x1234, 0, 0x11) );
+	bufferedMessage.getPayloadOutputStream().writeRawData( payload.data(), payload.size() );
+
+	OutputMessage smallMessage( SomeIP::MemberIDs(0x1234, 0, 0x12) );
+	SomeIPOutputStream smallStream = smallMessage.getPayloadOutputStream();
+	smallStream << uint32_t(0x11223344);
+
+	for (int mode = 0; mode < 3; mode++) {
+
+		int fileDescriptors[2];
+		ASSERT_EQ(socketpair(AF_UNIX, (mode == 2) ? SOCK_SEQPACKET : SOCK_STREAM, 0, fileDescriptors), 0);
+
+		TestConnection sender;
+		TestConnection receiver;
+		sender.setFileDescriptor(fileDescriptors[0]);
+		receiver.setFileDescriptor(fileDescriptors[1]);
+		sender.setPacketMode(mode == 2);
+		receiver.setPacketMode(mode == 2);
+		if (mode == 1) {
+			sender.setFraming(IPCFraming::COMPACT);
+			receiver.setFraming(IPCFraming::COMPACT);
+		}
+		receiver.setStreamingThreshold(64 * 1024);
+		// the streamed message is never buffered, so it is not subject to the limit
+		receiver.setMaximumMessageSize(payload.size() + 1024);
+
+		std::thread senderThread([&]() {
+						 const IPCMessage* messages[] = {&largeMessage.getIPCMessage(), &bufferedMessage.getIPCMessage(),
+										 &smallMessage.getIPCMessage()};
+						 sender.writeBlocking(messages, 3);
+					 });
+
+		IPCInputMessage bufferedInput;
+		receiver.setInputMessage(bufferedInput);
+		while ( !bufferedInput.isComplete() && receiver.isConnected() ) {
+			pollfd fd = { fileDescriptors[1], POLLIN, 0 };
+			poll(&fd, 1, 1000);
+			receiver.readNonBlocking(bufferedInput);
+		}
+
+		IPCInputMessage smallInput;
+		receiver.setInputMessage(smallInput);
+		ASSERT_EQ(receiver.readBlocking(smallInput), IPCOperationReport::OK);
+		senderThread.join();
+
+		EXPECT_TRUE(receiver.m_isStreamComplete);
+		EXPECT_EQ(receiver.m_streamedPayloadLength, payload.size() );
+		EXPECT_LE(receiver.m_largestChunk, 64u * 1024);
+		EXPECT_TRUE(receiver.m_streamedPayload == payload);
+
+		ASSERT_TRUE( bufferedInput.isComplete() );
+		InputMessage buffered(bufferedInput);
+		EXPECT_EQ( buffered.getHeader().getMemberID(), 0x11 );
+		ASSERT_EQ( buffered.getPayloadLength(), payload.size() );
+		EXPECT_EQ(memcmp( buffered.getPayload(), payload.data(), payload.size() ), 0);
+
+		ASSERT_TRUE( smallInput.isComplete() );
+		EXPECT_EQ( InputMessage(smallInput).getHeader().getMemberID(), 0x12 );
+
+		// a frame exceeding the limit makes the receiver disconnect before allocating its buffer. A single packet is
+		// received at once anyway, so the limit only applies to the messages split into several packets.
+		if (mode != 2) {
+			receiver.setMaximumMessageSize(8);
+			ASSERT_EQ(sender.writeBlocking( smallMessage.getIPCMessage() ), IPCOperationReport::OK);
+			IPCInputMessage refusedInput;
+			receiver.setInputMessage(refusedInput);
+			EXPECT_EQ(receiver.readBlocking(refusedInput), IPCOperationReport::DISCONNECTED);
+			EXPECT_FALSE( receiver.isConnected() );
+		}
+	}
+}
+
+TEST_F(SomeIPTest, DatagramSocket) {
+
+	SomeIPDatagramSocket sender;
+	SomeIPDatagramSocket receiver;
+	ASSERT_EQ(sender.bind(0), SomeIPReturnCode::OK);
+	ASSERT_EQ(receiver.bind(0), SomeIPReturnCode::OK);
+
+	in_addr loopback;
+	loopback.s_addr = htonl(INADDR_LOOPBACK);
+	IPv4TCPEndPoint destination(IPV4Address(loopback), receiver.getLocalPort());
+
+	// the small messages are packed into a datagram, until the maximum size is reached
+	static const size_t SMALL_MESSAGE_COUNT = 100;
+	uint32_t value = 0x11223344;
+	for (size_t i = 0; i < SMALL_MESSAGE_COUNT; i++) {
+		SomeIP::SomeIPHeader header(0x12340010 + i, i, 1, SomeIP::MessageType::NOTIFICATION, SomeIP::ReturnCode::E_OK);
+		ASSERT_EQ(sender.queueMessage( destination, header, &value, sizeof(value) ), SomeIPReturnCode::OK);
+	}
+
+	size_t messageLength = SomeIP::SOMEIP_HEADER_LENGTH_ON_NETWORK + sizeof(value);
+	size_t messagesPerDatagram = SomeIPDatagramSocket::DEFAULT_MAXIMUM_DATAGRAM_SIZE / messageLength;
+	size_t expectedDatagramCount = (SMALL_MESSAGE_COUNT + messagesPerDatagram - 1) / messagesPerDatagram;
+	EXPECT_EQ(sender.getPendingDatagramCount(), expectedDatagramCount);
+
+	// a message larger than the maximum datagram size is split into segments, sent after the small messages
+	std::vector<uint8_t> largePayload(8000);
+	for (size_t i = 0; i < largePayload.size(); i++)
+		largePayload[i] = i * 7;
+	SomeIP::SomeIPHeader largeHeader(0x12340100, 0, 1, SomeIP::MessageType::NOTIFICATION, SomeIP::ReturnCode::E_OK);
+	ASSERT_EQ(sender.queueMessage( destination, largeHeader, largePayload.data(), largePayload.size() ), SomeIPReturnCode::OK);
+	size_t segmentLength = sender.getMaximumSegmentLength();
+	EXPECT_EQ(segmentLength % SomeIPTPHeaderCodec::OFFSET_UNIT, 0u);
+	size_t segmentCount = (largePayload.size() + segmentLength - 1) / segmentLength;
+	EXPECT_EQ(sender.getPendingDatagramCount(), expectedDatagramCount + segmentCount);
+
+	ASSERT_EQ(sender.flush(), IPCOperationReport::OK);
+	EXPECT_EQ(sender.getPendingDatagramCount(), 0u);
+
+	SegmentReassembler reassembler;
+	std::vector<SomeIP::SomeIPHeader> receivedHeaders;
+	size_t receivedDatagramCount = 0;
+	while (receivedDatagramCount < expectedDatagramCount + segmentCount) {
+		pollfd fd = { receiver.getFileDescriptor(), POLLIN, 0 };
+		ASSERT_EQ(poll(&fd, 1, 1000), 1);
+		receivedDatagramCount += receiver.receive([&] (const IPv4TCPEndPoint& source, const SomeIP::SomeIPHeader& header,
+							       const void* payload, size_t payloadLength) {
+								  EXPECT_EQ( source.m_port, sender.getLocalPort() );
+								  if ( SomeIPTPHeaderCodec::isSegment(header) ) {
+									  SomeIP::SomeIPHeader messageHeader;
+									  ByteArray messageBuffer;
+									  if ( !reassembler.addSegment(header, payload, payloadLength, messageHeader,
+												       messageBuffer) )
+										  return;
+									  ASSERT_EQ( messageBuffer.size(), largePayload.size() );
+									  EXPECT_EQ(memcmp( messageBuffer.getData(), largePayload.data(),
+											    largePayload.size() ), 0);
+									  EXPECT_TRUE(messageHeader == largeHeader);
+									  receivedHeaders.push_back(messageHeader);
+								  } else {
+									  ASSERT_EQ( payloadLength, sizeof(value) );
+									  EXPECT_EQ(memcmp( payload, &value, sizeof(value) ), 0);
+									  receivedHeaders.push_back(header);
+								  }
+							  });
+	}
+
+	EXPECT_EQ(receivedDatagramCount, expectedDatagramCount + segmentCount);
+	ASSERT_EQ(receivedHeaders.size(), SMALL_MESSAGE_COUNT + 1);
+	for (size_t i = 0; i < SMALL_MESSAGE_COUNT; i++)
+		EXPECT_EQ(receivedHeaders[i].getMessageID(), 0x12340010 + i);
+	EXPECT_EQ( receivedHeaders.back().getMessageID(), largeHeader.getMessageID() );
+	EXPECT_EQ(reassembler.getPendingMessageCount(), 0u);
+}
+
+TEST_F(SomeIPTest, SegmentReassembly) {
+
+	static const size_t HEADROOM = 12;
+	static const size_t SEGMENT_LENGTH = 64;
+
+	std::vector<uint8_t> payload(1000);
+	for (size_t i = 0; i < payload.size(); i++)
+		payload[i] = i * 13;
+
+	SomeIP::SomeIPHeader header(0x12340020, 0x55, 1, SomeIP::MessageType::REQUEST, SomeIP::ReturnCode::E_OK);
+	SomeIP::SomeIPHeader segmentHeader(header);
+	SomeIPTPHeaderCodec::setSegmentFlag(segmentHeader, true);
+	EXPECT_TRUE( SomeIPTPHeaderCodec::isSegment(segmentHeader) );
+	EXPECT_FALSE( SomeIPTPHeaderCodec::isSegment(header) );
+
+	auto makeSegment = [&] (size_t offset) {
+		size_t length = std::min(SEGMENT_LENGTH, payload.size() - offset);
+		std::vector<uint8_t> segment(SomeIPTPHeaderCodec::SIZE + length);
+		SomeIPTPHeaderCodec::encode(offset, offset + length < payload.size(), segment.data());
+		memcpy(segment.data() + SomeIPTPHeaderCodec::SIZE, payload.data() + offset, length);
+		return segment;
+	};
+
+	std::vector<std::vector<uint8_t> > segments;
+	for (size_t offset = 0; offset < payload.size(); offset += SEGMENT_LENGTH)
+		segments.push_back( makeSegment(offset) );
+
+	size_t offset;
+	bool hasMoreSegments;
+	SomeIPTPHeaderCodec::decode(segments.back().data(), offset, hasMoreSegments);
+	EXPECT_EQ(offset, (segments.size() - 1) * SEGMENT_LENGTH);
+	EXPECT_FALSE(hasMoreSegments);
+
+	SegmentReassembler reassembler(HEADROOM);
+	SomeIP::SomeIPHeader messageHeader;
+	ByteArray messageBuffer;
+
+	// the segments are received in reverse order, the second one twice
+	auto now = SegmentReassembler::Clock::now();
+	for (size_t i = segments.size(); i-- > 1; ) {
+		EXPECT_FALSE( reassembler.addSegment(segmentHeader, segments[i].data(), segments[i].size(), messageHeader, messageBuffer,
+						     now) );
+		if (i == 1) {
+			EXPECT_FALSE( reassembler.addSegment(segmentHeader, segments[i].data(), segments[i].size(), messageHeader,
+							     messageBuffer, now) );
+		}
+	}
+	EXPECT_EQ(reassembler.getPendingMessageCount(), 1u);
+	EXPECT_EQ( reassembler.getBufferedBytes(), payload.size() );
+
+	ASSERT_TRUE( reassembler.addSegment(segmentHeader, segments[0].data(), segments[0].size(), messageHeader, messageBuffer,
+					    now) );
+	EXPECT_TRUE(messageHeader == header);
+	ASSERT_EQ( messageBuffer.size(), HEADROOM + payload.size() );
+	EXPECT_EQ(memcmp( messageBuffer.getData() + HEADROOM, payload.data(), payload.size() ), 0);
+	EXPECT_EQ(reassembler.getPendingMessageCount(), 0u);
+	EXPECT_EQ(reassembler.getBufferedBytes(), 0u);
+
+	// an incomplete message is dropped after the timeout
+	EXPECT_FALSE( reassembler.addSegment(segmentHeader, segments[0].data(), segments[0].size(), messageHeader, messageBuffer,
+					     now) );
+	EXPECT_EQ( reassembler.evictExpiredMessages( now + std::chrono::milliseconds(reassembler.getTimeout() / 2) ), 0u );
+	EXPECT_EQ( reassembler.evictExpiredMessages( now + std::chrono::milliseconds( reassembler.getTimeout() ) ), 1u );
+	EXPECT_EQ(reassembler.getPendingMessageCount(), 0u);
+
+	// a message which does not fit into the buffer limit is dropped, and the oldest message makes room for a newer one
+	reassembler.setMaximumBufferedBytes( payload.size() );
+	SomeIP::SomeIPHeader otherSegmentHeader(segmentHeader);
+	otherSegmentHeader.setRequestID(0x56);
+	EXPECT_FALSE( reassembler.addSegment(segmentHeader, segments[1].data(), segments[1].size(), messageHeader, messageBuffer,
+					     now) );
+	EXPECT_FALSE( reassembler.addSegment( otherSegmentHeader, segments.back().data(), segments.back().size(), messageHeader,
+					      messageBuffer, now + std::chrono::milliseconds(1) ) );
+	EXPECT_EQ(reassembler.getPendingMessageCount(), 1u);
+	EXPECT_EQ( reassembler.getBufferedBytes(), payload.size() );
+
+	reassembler.setMaximumBufferedBytes(payload.size() - 1);
+	auto tooLarge = makeSegment( (segments.size() - 1) * SEGMENT_LENGTH );
+	SomeIP::SomeIPHeader tooLargeHeader(segmentHeader);
+	tooLargeHeader.setRequestID(0x57);
+	EXPECT_FALSE( reassembler.addSegment(tooLargeHeader, tooLarge.data(), tooLarge.size(), messageHeader, messageBuffer, now) );
+	EXPECT_EQ(reassembler.getPendingMessageCount(), 1u);
+
+	// the reassemblers of several peers share a budget, on top of their own maximum
+	auto budget = std::make_shared<SegmentReassemblyBudget>( payload.size() );
+	SegmentReassembler firstPeer;
+	std::unique_ptr<SegmentReassembler> secondPeer(new SegmentReassembler);
+	firstPeer.setSharedBudget(budget);
+	secondPeer->setSharedBudget(budget);
+	EXPECT_FALSE( firstPeer.addSegment(segmentHeader, segments.back().data(), segments.back().size(), messageHeader,
+					   messageBuffer, now) );
+	EXPECT_EQ( budget->getUsedBytes(), payload.size() );
+	EXPECT_FALSE( secondPeer->addSegment(segmentHeader, segments[0].data(), segments[0].size(), messageHeader, messageBuffer,
+					     now) );
+	EXPECT_EQ(secondPeer->getPendingMessageCount(), 0u);
+	EXPECT_EQ(firstPeer.getPendingMessageCount(), 1u);
+
+	EXPECT_EQ( firstPeer.evictExpiredMessages( now + std::chrono::milliseconds( firstPeer.getTimeout() ) ), 1u );
+	EXPECT_EQ(budget->getUsedBytes(), 0u);
+	EXPECT_FALSE( secondPeer->addSegment(segmentHeader, segments[0].data(), segments[0].size(), messageHeader, messageBuffer,
+					     now) );
+	EXPECT_EQ(budget->getUsedBytes(), SEGMENT_LENGTH);
+	secondPeer.reset();
+	EXPECT_EQ(budget->getUsedBytes(), 0u);
+}
+
+TEST_F(SomeIPTest, SubscribeAckMulticastOption) {
+
+	struct AckListener : public ServiceDiscoveryListener {
+		void onRemoteClientSubscription(const SomeIPServiceDiscoveryEventGroupEntry& serviceEntry,
+						const IPv4ConfigurationOption* address) override {
+		}
+		void onRemoteClientSubscriptionFinished(const SomeIPServiceDiscoveryEventGroupEntry& serviceEntry,
+							const IPv4ConfigurationOption* address) override {
+		}
+		void onRemoteSubscriptionAcknowledged(const SomeIPServiceDiscoveryEventGroupEntry& serviceEntry,
+						      const IPv4ConfigurationOption* multicastAddress) override {
+			m_eventGroups.push_back(serviceEntry.m_eventGroupID);
+			m_multicastGroups.push_back( (multicastAddress != nullptr) ?
+						     IPv4TCPEndPoint(multicastAddress->m_address, multicastAddress->m_port) :
+						     IPv4TCPEndPoint() );
+		}
+		void onRemoteServiceAvailable(const SomeIPServiceDiscoveryServiceEntry& serviceEntry,
+					      const IPv4ConfigurationOption* address,
+					      const SomeIPServiceDiscoveryMessage& message) override {
+		}
+		void onRemoteServiceUnavailable(const SomeIPServiceDiscoveryServiceEntry& serviceEntry,
+						const IPv4ConfigurationOption* address,
+						const SomeIPServiceDiscoveryMessage& message) override {
+		}
+		void onFindServiceRequested(const SomeIPServiceDiscoveryServiceEntry& serviceEntry,
+					    const SomeIPServiceDiscoveryMessage& message) override {
+		}
+
+		std::vector<EventGroupID> m_eventGroups;
+		std::vector<IPv4TCPEndPoint> m_multicastGroups;
+	};
+
+	in_addr groupAddress;
+	groupAddress.s_addr = inet_addr("239.1.2.3");
+	IPv4TCPEndPoint group(IPV4Address(groupAddress), 30490);
+
+	// the subscription to the first eventgroup is acknowledged with a multicast group, the second one without
+	SomeIPServiceDiscoveryMessage message(true);
+	SomeIPServiceDiscoverySubscribeNotificationEntry multicastSubscription(ServiceIDs(0x1234, 1), 0x10);
+	SomeIPServiceDiscoverySubscribeNotificationEntry unicastSubscription(ServiceIDs(0x1234, 1), 0x20);
+	message.addEntry( SomeIPServiceDiscoverySubscribeAckEntry(message, multicastSubscription, &group) );
+	message.addEntry( SomeIPServiceDiscoverySubscribeAckEntry(message, unicastSubscription, nullptr) );
+
+	ByteArray byteArray;
+	NetworkSerializer serializer(byteArray);
+	message.serialize(serializer);
+
+	AckListener listener;
+	ServiceDiscoveryMessageDecoder decoder(listener);
+	decoder.decodeMessage( byteArray.getData(), byteArray.size() );
+
+	ASSERT_EQ(listener.m_eventGroups.size(), 2u);
+	EXPECT_EQ(listener.m_eventGroups[0], 0x10);
+	EXPECT_TRUE(listener.m_multicastGroups[0] == group);
+	EXPECT_EQ(listener.m_eventGroups[1], 0x20);
+	EXPECT_EQ(listener.m_multicastGroups[1].m_port, 0);
+}
+
+/**
+ * Main loop which only records the last watch, which the test triggers manually
+ */
+struct TestMainLoop : public MainLoopInterface {
+	struct Watch : public WatchMainLoopHook {
+		void enable() override {
+		}
+		void disable() override {
+		}
+	};
+	struct Idle : public IdleMainLoopHook {
+		void activate() override {
+		}
+	};
+	std::unique_ptr<IdleMainLoopHook> addIdle(IdleMainLoopHook::CallBackFunction callBack) override {
+		m_idleCallBack = callBack;
+		return std::unique_ptr<IdleMainLoopHook>(new Idle);
+	}
+	std::unique_ptr<TimeOutMainLoopHook> addTimeout(TimeOutMainLoopHook::CallBackFunction, int) override {
+		return nullptr;
+	}
+	std::unique_ptr<WatchMainLoopHook> addFileDescriptorWatch(WatchMainLoopHook::CallBackFunction callBack,
+								  const pollfd& fd) override {
+		m_callBack = callBack;
+		m_callBacks.push_back(callBack);
+		m_fd = fd;
+		return std::unique_ptr<WatchMainLoopHook>(new Watch);
+	}
+	IdleMainLoopHook::CallBackFunction m_idleCallBack;
+	WatchMainLoopHook::CallBackFunction m_callBack;
+	std::vector<WatchMainLoopHook::CallBackFunction> m_callBacks;
+	pollfd m_fd;
+};
+
+TEST_F(SomeIPTest, AcceptorGroup) {
+
+	static const size_t ACCEPTOR_COUNT = 4;
+	static const size_t CONNECTION_COUNT = 64;
+
+	// the sockets of the group share an ephemeral port
+	std::vector<int> listeningSockets;
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	for (size_t i = 0; i < ACCEPTOR_COUNT; i++) {
+		int fileDescriptor = socket(AF_INET, SOCK_STREAM, 0);
+		int opt = 1;
+		ASSERT_EQ(setsockopt( fileDescriptor, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt) ), 0);
+		ASSERT_EQ(bind( fileDescriptor, reinterpret_cast<sockaddr*>(&address), sizeof(address) ), 0);
+		socklen_t addressLength = sizeof(address);
+		ASSERT_EQ(getsockname( fileDescriptor, reinterpret_cast<sockaddr*>(&address), &addressLength ), 0);
+		ASSERT_EQ(listen(fileDescriptor, SOMAXCONN), 0);
+		listeningSockets.push_back(fileDescriptor);
+	}
+
+	TestMainLoop mainLoop;
+	std::vector<int> acceptedConnections;
+	AcceptorGroup group(mainLoop, [&] (int fileDescriptor) {
+				    acceptedConnections.push_back(fileDescriptor);
+			    });
+	ASSERT_EQ(group.start(listeningSockets), SomeIPReturnCode::OK);
+	EXPECT_EQ(group.getAcceptorCount(), ACCEPTOR_COUNT);
+
+	std::vector<int> clientSockets;
+	for (size_t i = 0; i < CONNECTION_COUNT; i++) {
+		int fileDescriptor = socket(AF_INET, SOCK_STREAM, 0);
+		ASSERT_EQ(connect( fileDescriptor, reinterpret_cast<sockaddr*>(&address), sizeof(address) ), 0);
+		clientSockets.push_back(fileDescriptor);
+	}
+
+	// the connections are handed over to the main loop, in batches
+	while (acceptedConnections.size() < CONNECTION_COUNT) {
+		ASSERT_EQ(poll(&mainLoop.m_fd, 1, 1000), 1);
+		mainLoop.m_callBack();
+	}
+
+	EXPECT_EQ(acceptedConnections.size(), CONNECTION_COUNT);
+	EXPECT_EQ(group.getAcceptedConnectionCount(), CONNECTION_COUNT);
+
+	group.stop();
+	EXPECT_EQ(group.getAcceptorCount(), 0u);
+
+	for (auto fileDescriptor : acceptedConnections)
+		close(fileDescriptor);
+	for (auto fileDescriptor : clientSockets)
+		close(fileDescriptor);
+}
+
+TEST_F(SomeIPTest, ServiceRegistrySegment) {
+
+	ServiceRegistrySegment segment;
+	ASSERT_EQ(segment.create(16), SomeIPReturnCode::OK);
+	segment.addService( SomeIP::ServiceIDs(0x1234, 1) );
+
+	// the descriptor given to the clients can not be used to modify the segment
+	int fd = dup( segment.getFileDescriptor() );
+	size_t size = lseek(fd, 0, SEEK_END);
+	EXPECT_EQ(mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0), MAP_FAILED);
+	EXPECT_NE(ftruncate(fd, 0), 0);
+
+	ServiceRegistrySegment clientSegment;
+	ASSERT_EQ(clientSegment.map(fd), SomeIPReturnCode::OK);
+	EXPECT_EQ(clientSegment.lookup( SomeIP::ServiceIDs(0x1234, 1) ), ServiceRegistrySegment::LookupResult::FOUND);
+	EXPECT_EQ(clientSegment.lookup( SomeIP::ServiceIDs(0x1234, 2) ), ServiceRegistrySegment::LookupResult::NOT_FOUND);
+
+	// once a service has been refused because the segment was full, the missing services are unknown
+	std::vector<SomeIP::ServiceIDs> services;
+	for (size_t i = 1; i <= segment.getMaximumServiceCount() + 1; i++) {
+		services.push_back( SomeIP::ServiceIDs(0x1234, i) );
+		segment.addService( services.back() );
+	}
+	EXPECT_TRUE( segment.isOverflowed() );
+	EXPECT_EQ(clientSegment.lookup( services.back() ), ServiceRegistrySegment::LookupResult::UNKNOWN);
+	std::vector<SomeIP::ServiceIDs> clientServices;
+	EXPECT_FALSE( clientSegment.getServices(clientServices) );
+
+	// the segment is complete again when it is rebuilt with services which all fit
+	segment.removeService( services.front() );
+	services.erase( services.begin() );
+	segment.rebuild(services);
+	EXPECT_FALSE( segment.isOverflowed() );
+	EXPECT_EQ(clientSegment.lookup( services.back() ), ServiceRegistrySegment::LookupResult::FOUND);
+	EXPECT_EQ(clientSegment.lookup( SomeIP::ServiceIDs(0x1234, 1) ), ServiceRegistrySegment::LookupResult::NOT_FOUND);
+	ASSERT_TRUE( clientSegment.getServices(clientServices) );
+	EXPECT_EQ( clientServices.size(), services.size() );
+
+	// a rebuild with too many services keeps the segment marked as full
+	services.push_back( SomeIP::ServiceIDs(0x1234, 1) );
+	segment.rebuild(services);
+	EXPECT_TRUE( segment.isOverflowed() );
+}
+
+TEST_F(SomeIPTest, ServiceRegistryMirror) {
+
+	using namespace SomeIP_Dispatcher;
+
+	ServiceRegistrySegment segment;
+	ASSERT_EQ(segment.create(), SomeIPReturnCode::OK);
+
+	struct SegmentMirror : public ServiceRegistrationListener {
+		SegmentMirror(ServiceRegistrySegment& segment) : m_segment(segment) {
+		}
+		void onServiceRegistered(const Service& service) override {
+			m_segment.addService( service.getServiceIDs() );
+		}
+		void onServiceUnregistered(const Service& service) override {
+			m_segment.removeService( service.getServiceIDs() );
+		}
+		ServiceRegistrySegment& m_segment;
+	};
+
+	// stands for a client, which looks the service up in the segment as soon as it is notified
+	struct ClientListener : public ServiceRegistrationListener {
+		ClientListener(ServiceRegistrySegment& segment) : m_segment(segment) {
+		}
+		void onServiceRegistered(const Service& service) override {
+			m_registrationLookups.push_back( m_segment.lookup( service.getServiceIDs() ) );
+		}
+		void onServiceUnregistered(const Service& service) override {
+			m_unregistrationLookups.push_back( m_segment.lookup( service.getServiceIDs() ) );
+		}
+		ServiceRegistrySegment& m_segment;
+		std::vector<ServiceRegistrySegment::LookupResult> m_registrationLookups;
+		std::vector<ServiceRegistrySegment::LookupResult> m_unregistrationLookups;
+	};
+
+	TestMainLoop mainLoop;
+	Dispatcher dispatcher(mainLoop);
+	SegmentMirror mirror(segment);
+	ClientListener listener(segment);
+
+	// the listeners registered after the client listener are notified before it of the unregistrations
+	dispatcher.addServiceRegistrationListener(listener);
+	dispatcher.setServiceRegistryMirror(&mirror);
+
+	Service service(SomeIP::ServiceIDs(0x1234, 1), true);
+	Service secondService(SomeIP::ServiceIDs(0x1234, 2), true);
+	Service thirdService(SomeIP::ServiceIDs(0x1234, 3), true);
+	ASSERT_EQ(dispatcher.registerService(service), SomeIP_Dispatcher::ReturnCode::OK);
+	ASSERT_EQ(dispatcher.registerService(secondService), SomeIP_Dispatcher::ReturnCode::OK);
+	ASSERT_EQ(dispatcher.registerService(thirdService), SomeIP_Dispatcher::ReturnCode::OK);
+
+	dispatcher.unregisterService(service);
+	dispatcher.unregisterServices({&secondService, &thirdService});
+
+	ASSERT_EQ(listener.m_registrationLookups.size(), 3u);
+	for (auto result : listener.m_registrationLookups)
+		EXPECT_EQ(result, ServiceRegistrySegment::LookupResult::FOUND);
+
+	ASSERT_EQ(listener.m_unregistrationLookups.size(), 3u);
+	for (auto result : listener.m_unregistrationLookups)
+		EXPECT_EQ(result, ServiceRegistrySegment::LookupResult::NOT_FOUND);
+
+	dispatcher.setServiceRegistryMirror(nullptr);
+}
+
+TEST_F(SomeIPTest, UDPClientEviction) {
+
+	using namespace SomeIP_Dispatcher;
+
+	TestMainLoop mainLoop;
+	Dispatcher dispatcher(mainLoop);
+	UDPManager udpManager(dispatcher, mainLoop, 0);
+	UDPEndPoint endPoint(dispatcher, udpManager, mainLoop);
+	endPoint.setMaximumClientCount(2);
+	ASSERT_EQ(endPoint.init(0), SomeIPReturnCode::OK);
+
+	// the input watch is the first one added by the endpoint
+	auto onDataAvailable = mainLoop.m_callBacks.front();
+	in_addr loopback;
+	loopback.s_addr = htonl(INADDR_LOOPBACK);
+	IPv4TCPEndPoint destination( IPV4Address(loopback), endPoint.getLocalPort() );
+
+	SomeIPDatagramSocket senders[3];
+	auto sendDatagrams = [&] (size_t senderCount) {
+		for (size_t i = 0; i < senderCount; i++) {
+			SomeIP::SomeIPHeader header(0x12340010, 0, 1, SomeIP::MessageType::NOTIFICATION, SomeIP::ReturnCode::E_OK);
+			uint32_t value = 0;
+			ASSERT_EQ(senders[i].queueMessage( destination, header, &value, sizeof(value) ), SomeIPReturnCode::OK);
+			ASSERT_EQ(senders[i].flush(), IPCOperationReport::OK);
+		}
+		pollfd fd = { mainLoop.m_fd.fd, POLLIN, 0 };
+		while (poll(&fd, 1, 100) == 1)
+			onDataAvailable();
+	};
+
+	for (auto& sender : senders)
+		ASSERT_EQ(sender.bind(0), SomeIPReturnCode::OK);
+
+	// the datagrams of the senders beyond the maximum client count are ignored
+	sendDatagrams(3);
+	EXPECT_EQ(endPoint.getCreatedClientCount(), 2u);
+
+	auto now = SegmentReassembler::Clock::now();
+	endPoint.evictIdleClients(now);
+	EXPECT_EQ(endPoint.getCreatedClientCount(), 2u);
+
+	// the unregistered clients are deleted by the dispatcher
+	endPoint.evictIdleClients( now + std::chrono::milliseconds(UDPEndPoint::DEFAULT_CLIENT_IDLE_TIMEOUT + 1000) );
+	EXPECT_EQ(endPoint.getCreatedClientCount(), 0u);
+	mainLoop.m_idleCallBack();
+
+	sendDatagrams(1);
+	EXPECT_EQ(endPoint.getCreatedClientCount(), 1u);
+
+	endPoint.evictIdleClients( SegmentReassembler::Clock::now() +
+				   std::chrono::milliseconds(UDPEndPoint::DEFAULT_CLIENT_IDLE_TIMEOUT + 1000) );
+	mainLoop.m_idleCallBack();
+}
 
 int main(int argc, char** argv) {
 	::testing::InitGoogleTest(&argc, argv);
@@ -305,6 +305,44 @@ TEST_F(SomeIPTest, ConnectionCleanup) {
 }
 
 
+/**
+ * Send a batch of requests to a service registered by the same connection
+ */
+TEST_F(SomeIPTest, SendMessagesBatch) {
+
+	using namespace SomeIPClient;
+
+	static const size_t MESSAGE_COUNT = 50;
+
+	ClientDaemonConnection connection;
+
+	TestSink sink([&](const InputMessage &msg) {
+		      });
+
+	GlibMainLoopInterfaceImplementation glibIntegration;
+	connection.setMainLoopInterface(glibIntegration);
+
+	connection.connect(sink);
+	connection.registerService(TEST_SERVICE_ID);
+
+	std::vector<OutputMessage> messages;
+	for (size_t i = 0; i < MESSAGE_COUNT; i++)
+		messages.push_back( createTestOutputMessage(TEST_SERVICE_ID, SomeIP::MessageType::REQUEST, MESSAGE_SIZE) );
+
+	std::vector<const OutputMessage*> batch;
+	for (auto& msg : messages)
+		batch.push_back(&msg);
+
+	EXPECT_FALSE( isError( connection.sendMessages(batch) ) );
+
+	MainLoopApplication app;
+	app.run(TIMEOUT);
+
+	EXPECT_EQ(sink.getReceivedMessageCount(), MESSAGE_COUNT);
+
+}
+
+
 TEST_F(SomeIPTest, TestIsAvailableBlocking) {
 
 	AutoconnectConnection connection;
@@ -320,6 +358,98 @@ TEST_F(SomeIPTest, TestIsAvailableBlocking) {
 }
 
 
+TEST_F(SomeIPTest, WaitForService) {
+
+	static const SomeIP::ServiceIDs SERVICE_ID(0x543, 1);
+
+	AutoconnectConnection client;
+	AutoconnectConnection provider;
+
+	EXPECT_FALSE( client.connection.waitForService(SERVICE_ID, 100) );
+
+	provider.connection.registerService(SERVICE_ID);
+
+	// the registration notification is received by the client while it is waiting
+	std::vector<SomeIP::ServiceIDs> services = {SERVICE_ID};
+	EXPECT_TRUE( client.connection.waitForServices(services, 1000) );
+
+	bool available = false;
+	client.connection.waitForServiceAsync(SERVICE_ID, [&] (bool isAvailable) {
+						      available = isAvailable;
+					      });
+	EXPECT_TRUE(available);
+
+}
+
+
+TEST_F(SomeIPTest, RegisterServicesBatch) {
+
+	AutoconnectConnection connection;
+
+	std::vector<SomeIP::ServiceIDs> serviceIDs;
+	for (SomeIP::InstanceID instance = 1; instance <= 100; instance++)
+		serviceIDs.push_back( SomeIP::ServiceIDs(0x600, instance) );
+
+	EXPECT_FALSE( isError( connection.connection.registerServices(serviceIDs) ) );
+	EXPECT_TRUE( connection.connection.isServiceAvailableBlocking(serviceIDs.front()) );
+	EXPECT_TRUE( connection.connection.isServiceAvailableBlocking(serviceIDs.back()) );
+
+	// one of the services is already registered => nothing gets registered
+	static const SomeIP::ServiceIDs OTHER_SERVICE_ID(0x601, 1);
+	std::vector<SomeIP::ServiceIDs> otherServiceIDs = {OTHER_SERVICE_ID, serviceIDs.front()};
+	AutoconnectConnection otherConnection;
+	EXPECT_TRUE( isError( otherConnection.connection.registerServices(otherServiceIDs) ) );
+	EXPECT_FALSE( otherConnection.connection.isServiceAvailableBlocking(OTHER_SERVICE_ID) );
+
+	EXPECT_FALSE( isError( connection.connection.unregisterServices(serviceIDs) ) );
+	EXPECT_FALSE( connection.connection.isServiceAvailableBlocking(serviceIDs.front()) );
+
+}
+
+/**
+ * Exchange enough requests between two connections to get a direct channel opened by the dispatcher, and check that no
+ * answer gets lost when the traffic is moved to that channel.
+ */
+TEST_F(SomeIPTest, PeerChannel) {
+
+	using namespace SomeIPClient;
+
+	// a bit more than the default threshold of the dispatcher
+	static const size_t REQUEST_COUNT = 1100;
+
+	AutoconnectConnection provider;
+	provider.sink.setCallbackFunction([&](const InputMessage &msg) {
+						  OutputMessage returnMessage = createMethodReturn(msg);
+						  returnMessage.getPayloadOutputStream().writeRawData( msg.getPayload(), msg.getPayloadLength() );
+						  provider.connection.sendMessage(returnMessage);
+					  });
+	provider.connection.registerService(TEST_SERVICE_ID);
+
+	AutoconnectConnection requester;
+	size_t sentRequestsCount = 0;
+
+	auto sendRequest = [&]() {
+		OutputMessage outputMsg = createTestOutputMessage(TEST_SERVICE_ID, SomeIP::MessageType::REQUEST, 16);
+		requester.connection.sendMessage(outputMsg);
+		sentRequestsCount++;
+	};
+
+	requester.sink.setCallbackFunction([&](const InputMessage &msg) {
+						   EXPECT_EQ(msg.getMessageType(), SomeIP::MessageType::RESPONSE);
+						   if (sentRequestsCount < REQUEST_COUNT)
+							   sendRequest();
+					   });
+
+	sendRequest();
+
+	MainLoopApplication app;
+	app.run(TIMEOUT);
+
+	EXPECT_EQ(requester.sink.getReceivedMessageCount(), REQUEST_COUNT);
+	EXPECT_EQ(provider.sink.getReceivedMessageCount(), REQUEST_COUNT);
+
+}
+
 
 int main(int argc, char** argv) {
 	MainLoopApplication app; // to get rid of the DLT threads, by forcing the DLT main loop mode
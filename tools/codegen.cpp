@@ -0,0 +1,550 @@
+#include "CommandLineParser.h"
+#include "SomeIP-Config.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+using namespace SomeIP_utils;
+
+/**
+ * Generates typed proxy and stub classes from an interface description. Example of interface description:
+ *
+ * # Comments start with '#'
+ * interface Calculator 0x1234
+ * method add 0x0001 (int32 a, int32 b) -> (int32 result)
+ * oneway reset 0x0002 ()
+ * event valueChanged 0x8001 (uint32 value, string[] labels)
+ *
+ * Supported types : bool, int8, int16, int32, int64, uint8, uint16, uint32, uint64, float, double, string, and arrays of
+ * these types, declared with a "[]" suffix.
+ */
+
+struct Argument {
+	std::string m_type;
+	std::string m_name;
+};
+
+struct Member {
+
+	enum class Kind {
+		METHOD, ONEWAY, EVENT
+	};
+
+	Kind m_kind;
+	std::string m_name;
+	unsigned int m_memberID;
+	std::vector<Argument> m_inArguments;
+	std::vector<Argument> m_outArguments;
+};
+
+struct Interface {
+	std::string m_name;
+	unsigned int m_serviceID = 0;
+	std::vector<Member> m_members;
+};
+
+class InterfaceParser {
+
+public:
+	bool parse(std::istream& input, Interface& interface) {
+
+		std::string line;
+		while ( std::getline(input, line) ) {
+			m_lineNumber++;
+
+			auto commentPosition = line.find('#');
+			if (commentPosition != std::string::npos)
+				line.resize(commentPosition);
+
+			std::istringstream lineStream(line);
+			std::string keyword;
+			if ( !(lineStream >> keyword) )
+				continue;
+
+			if (keyword == "interface") {
+				std::string serviceID;
+				if ( !(lineStream >> interface.m_name >> serviceID) || !isIdentifier(interface.m_name)
+				     || !parseInteger(serviceID, interface.m_serviceID, 0xFFFF) )
+					return error("Invalid interface declaration");
+			} else if ( (keyword == "method") || (keyword == "oneway") || (keyword == "event") ) {
+				if ( interface.m_name.empty() )
+					return error("The interface must be declared first");
+
+				Member member;
+				member.m_kind = (keyword == "method") ? Member::Kind::METHOD :
+						( (keyword == "oneway") ? Member::Kind::ONEWAY : Member::Kind::EVENT );
+
+				std::string memberID;
+				if ( !(lineStream >> member.m_name >> memberID) || !isIdentifier(member.m_name)
+				     || !parseInteger(memberID, member.m_memberID, 0xFFFF) )
+					return error("Invalid member declaration");
+
+				std::string rest;
+				std::getline(lineStream, rest);
+
+				auto arrowPosition = rest.find("->");
+				if ( !parseArguments( rest.substr(0, arrowPosition), member.m_inArguments ) )
+					return error("Invalid argument list");
+
+				if (arrowPosition != std::string::npos) {
+					if (member.m_kind != Member::Kind::METHOD)
+						return error("Only methods can have output arguments");
+					if ( !parseArguments(rest.substr(arrowPosition + 2), member.m_outArguments) )
+						return error("Invalid output argument list");
+				}
+
+				for (auto& other : interface.m_members) {
+					if ( (other.m_memberID == member.m_memberID) || (other.m_name == member.m_name) )
+						return error("Duplicate member");
+				}
+
+				interface.m_members.push_back(member);
+			} else
+				return error("Unknown keyword : " + keyword);
+		}
+
+		if ( interface.m_name.empty() )
+			return error("No interface declared");
+
+		return true;
+	}
+
+	const std::string& getError() const {
+		return m_error;
+	}
+
+	static std::string getCppType(const std::string& type) {
+		static const std::map<std::string, std::string> types = {
+			{"bool", "bool"}, {"int8", "int8_t"}, {"int16", "int16_t"}, {"int32", "int32_t"}, {"int64", "int64_t"},
+			{"uint8", "uint8_t"}, {"uint16", "uint16_t"}, {"uint32", "uint32_t"}, {"uint64", "uint64_t"},
+			{"float", "float"}, {"double", "double"}, {"string", "std::string"}
+		};
+
+		bool isArray = ( (type.size() > 2) && (type.compare(type.size() - 2, 2, "[]") == 0) );
+		auto it = types.find( isArray ? type.substr(0, type.size() - 2) : type );
+		if ( it == types.end() )
+			return "";
+
+		return isArray ? "std::vector<" + it->second + ">" : it->second;
+	}
+
+private:
+	bool error(const std::string& message) {
+		std::ostringstream stream;
+		stream << "line " << m_lineNumber << " : " << message;
+		m_error = stream.str();
+		return false;
+	}
+
+	/**
+	 * The identifiers ending with '_' are reserved for the local variables of the generated code
+	 */
+	static bool isIdentifier(const std::string& s) {
+		if ( s.empty() || isdigit(s[0]) || (s.back() == '_') )
+			return false;
+		for (auto c : s)
+			if ( !isalnum(c) && (c != '_') )
+				return false;
+		return true;
+	}
+
+	static bool parseInteger(const std::string& s, unsigned int& value, unsigned int maxValue) {
+		char* end;
+		auto v = strtoul(s.c_str(), &end, 0);
+		if ( s.empty() || (*end != 0) || (v > maxValue) )
+			return false;
+		value = v;
+		return true;
+	}
+
+	/**
+	 * Parses a list of arguments such as "(int32 a, string b)"
+	 */
+	static bool parseArguments(const std::string& s, std::vector<Argument>& arguments) {
+		auto begin = s.find('(');
+		auto end = s.rfind(')');
+		if ( (begin == std::string::npos) || (end == std::string::npos) || (end < begin) )
+			return false;
+
+		if (s.find_first_not_of(" \t", end + 1) != std::string::npos)
+			return false;
+
+		std::istringstream list( s.substr(begin + 1, end - begin - 1) );
+		std::string declaration;
+		while ( std::getline(list, declaration, ',') ) {
+			std::istringstream declarationStream(declaration);
+			Argument argument;
+			std::string remaining;
+			if ( !(declarationStream >> argument.m_type) )
+				return arguments.empty() && list.eof();             // empty list
+			if ( !(declarationStream >> argument.m_name) || (declarationStream >> remaining) )
+				return false;
+			if ( getCppType(argument.m_type).empty() || !isIdentifier(argument.m_name) )
+				return false;
+			arguments.push_back(argument);
+		}
+
+		return true;
+	}
+
+	int m_lineNumber = 0;
+	std::string m_error;
+};
+
+class CodeGenerator {
+
+public:
+	CodeGenerator(const Interface& interface, std::ostream& out) : m_interface(interface), out(out) {
+	}
+
+	void generate(const std::string& sourceFileName) {
+		out << "// Generated by someip_codegen from " << sourceFileName << ". Do not edit.\n";
+		out << "#pragma once\n\n";
+		out << "#include \"SomeIP-clientLib.h\"\n\n";
+		out << "namespace " << m_interface.m_name << " {\n\n";
+		out << "using namespace SomeIP_Lib;\n\n";
+		out << "static const SomeIP::ServiceID SERVICE_ID = " << hex(m_interface.m_serviceID) << ";\n\n";
+
+		for (auto& member : m_interface.m_members)
+			out << "static const SomeIP::MemberID " << member.m_name << "_MEMBER_ID = " << hex(member.m_memberID) << ";\n";
+		out << "\n";
+
+		for (auto& member : m_interface.m_members) {
+			generateStructure(member.m_name + "_Arguments", member.m_inArguments);
+			generateStructure(member.m_name + "_Results", member.m_outArguments);
+		}
+
+		generateProxy();
+		generateStub();
+
+		out << "}\n";
+	}
+
+private:
+	static std::string hex(unsigned int value) {
+		char buffer[16];
+		snprintf(buffer, sizeof(buffer), "0x%.4X", value);
+		return buffer;
+	}
+
+	static std::string capitalize(const std::string& s) {
+		std::string result = s;
+		result[0] = toupper(result[0]);
+		return result;
+	}
+
+	void generateStructure(const std::string& name, const std::vector<Argument>& arguments) {
+		if ( arguments.empty() )
+			return;
+
+		out << "struct " << name << " {\n";
+		for (auto& argument : arguments)
+			out << "\t" << InterfaceParser::getCppType(argument.m_type) << " " << argument.m_name << ";\n";
+		out << "\tSOMEIP_FIELDS(" << join(arguments, "", ", ") << ")\n";
+		out << "};\n\n";
+	}
+
+	static std::string join(const std::vector<Argument>& arguments, const std::string& prefix, const std::string& separator) {
+		std::string s;
+		for (size_t i = 0; i < arguments.size(); i++) {
+			if (i != 0)
+				s += separator;
+			s += prefix + arguments[i].m_name;
+		}
+		return s;
+	}
+
+	static std::string parameterList(const std::vector<Argument>& inArguments, const std::vector<Argument>& outArguments) {
+		std::string s;
+		for (auto& argument : inArguments)
+			s += std::string(s.empty() ? "" : ", ") + "const " + InterfaceParser::getCppType(argument.m_type) + "& " +
+			     argument.m_name;
+		for (auto& argument : outArguments)
+			s += std::string(s.empty() ? "" : ", ") + InterfaceParser::getCppType(argument.m_type) + "& " + argument.m_name;
+		return s;
+	}
+
+	/**
+	 * Writes the given values to a new message, after having allocated the exact payload size
+	 */
+	void generateWrite(const std::vector<Argument>& arguments, const std::string& indent) {
+		if ( arguments.empty() )
+			return;
+
+		out << indent << "{\n";
+		out << indent << "\tSomeIPOutputStream stream_ = msg_.getPayloadOutputStream();\n";
+		out << indent << "\tstream_.getContent().reserve( stream_.getContent().size()";
+		for (auto& argument : arguments)
+			out << " + SerializedSize<" << InterfaceParser::getCppType(argument.m_type) << ">::get(" << argument.m_name << ")";
+		out << " );\n";
+		out << indent << "\tstream_ << " << join(arguments, "", " << ") << ";\n";
+		out << indent << "}\n";
+	}
+
+	/**
+	 * Reads the given structure from the message, and returns from the generated function if the payload is invalid
+	 */
+	void generateRead(const std::string& structureName, const std::string& messageName, const std::string& errorValue,
+			  const std::string& indent) {
+		out << indent << structureName << " values_;\n";
+		out << indent << "{\n";
+		out << indent << "\tSomeIPInputStream stream_ = " << messageName << ".getPayloadInputStream();\n";
+		out << indent << "\tstream_ >> values_;\n";
+		out << indent << "\tif ( stream_.hasError() )\n";
+		out << indent << "\t\treturn " << errorValue << ";\n";
+		out << indent << "}\n";
+	}
+
+	void generateCommonMembers() {
+		out << "\tSomeIP::ServiceIDs getServiceIDs() const {\n";
+		out << "\t\treturn SomeIP::ServiceIDs(SERVICE_ID, m_instanceID);\n";
+		out << "\t}\n\n";
+		out << "private:\n";
+		out << "\tOutputMessage createMessage(SomeIP::MemberID memberID, SomeIP::MessageType messageType) const {\n";
+		out << "\t\tOutputMessage msg( SomeIP::MemberIDs(SERVICE_ID, m_instanceID, memberID) );\n";
+		out << "\t\tmsg.getHeader().setMessageType(messageType);\n";
+		out << "\t\treturn msg;\n";
+		out << "\t}\n\n";
+		out << "\tbool isOwnMessage(const InputMessage& msg) const {\n";
+		out << "\t\treturn ( (msg.getServiceID() == SERVICE_ID) && (msg.getInstanceID() == m_instanceID) );\n";
+		out << "\t}\n\n";
+	}
+
+	void generateProxy() {
+		out << "/**\n";
+		out << " * Client side of the " << m_interface.m_name << " interface. The Connection type can be a concrete connection class, so that\n";
+		out << " * the calls to the connection are not virtual.\n";
+		out << " */\n";
+		out << "template<typename Connection = SomeIPClient::ClientConnection>\n";
+		out << "class Proxy {\n\n";
+		out << "public:\n";
+		out << "\tProxy(Connection& connection, SomeIP::InstanceID instanceID = 0) : m_connection(connection), m_instanceID(instanceID) {\n";
+		out << "\t}\n\n";
+
+		bool hasEvents = false;
+
+		for (auto& member : m_interface.m_members) {
+			switch (member.m_kind) {
+			case Member::Kind::METHOD : {
+				out << "\t/**\n\t * Calls " << member.m_name << "() and waits for the answer\n\t */\n";
+				out << "\tSomeIPReturnCode " << member.m_name << "(" << parameterList(member.m_inArguments,
+												 member.m_outArguments) << ") {\n";
+				out << "\t\tOutputMessage msg_ = createMessage(" << member.m_name << "_MEMBER_ID, SomeIP::MessageType::REQUEST);\n";
+				generateWrite(member.m_inArguments, "\t\t");
+				out << "\t\tInputMessage answer_ = m_connection.sendMessageBlocking(msg_);\n";
+				out << "\t\tif (answer_.getMessageType() != SomeIP::MessageType::RESPONSE)\n";
+				out << "\t\t\treturn SomeIPReturnCode::ERROR;\n";
+				if ( !member.m_outArguments.empty() ) {
+					generateRead(member.m_name + "_Results", "answer_", "SomeIPReturnCode::ERROR", "\t\t");
+					for (auto& argument : member.m_outArguments)
+						out << "\t\t" << argument.m_name << " = std::move(values_." << argument.m_name << ");\n";
+				}
+				out << "\t\treturn SomeIPReturnCode::OK;\n";
+				out << "\t}\n\n";
+			}
+			break;
+
+			case Member::Kind::ONEWAY : {
+				out << "\tSomeIPReturnCode " << member.m_name << "(" << parameterList(member.m_inArguments, {}) << ") {\n";
+				out << "\t\tOutputMessage msg_ = createMessage(" << member.m_name <<
+				"_MEMBER_ID, SomeIP::MessageType::REQUEST_NO_RETURN);\n";
+				generateWrite(member.m_inArguments, "\t\t");
+				out << "\t\treturn m_connection.sendMessage(msg_);\n";
+				out << "\t}\n\n";
+			}
+			break;
+
+			case Member::Kind::EVENT : {
+				hasEvents = true;
+				out << "\tSomeIPReturnCode subscribe" << capitalize(member.m_name) << "() {\n";
+				out << "\t\treturn m_connection.subscribeToNotifications( SomeIP::MemberIDs(SERVICE_ID, m_instanceID, " <<
+				member.m_name << "_MEMBER_ID) );\n";
+				out << "\t}\n\n";
+			}
+			break;
+			}
+		}
+
+		if (hasEvents) {
+			out << "\t/**\n";
+			out << "\t * Decodes the notifications of the service, and forwards them to the listener, which must define an\n";
+			out << "\t * \"on<EventName>()\" method per event.\n";
+			out << "\t */\n";
+			out << "\ttemplate<typename Listener>\n";
+			out << "\tMessageProcessingResult processMessage(const InputMessage& msg, Listener& listener) {\n";
+			out << "\t\tif ( !isOwnMessage(msg) || !msg.getHeader().isNotification() )\n";
+			out << "\t\t\treturn MessageProcessingResult::NotProcessed_OK;\n\n";
+			out << "\t\tswitch ( msg.getHeader().getMemberID() ) {\n";
+			for (auto& member : m_interface.m_members) {
+				if (member.m_kind != Member::Kind::EVENT)
+					continue;
+				out << "\t\tcase " << member.m_name << "_MEMBER_ID : {\n";
+				if ( !member.m_inArguments.empty() )
+					generateRead(member.m_name + "_Arguments", "msg", "MessageProcessingResult::Processed_Error", "\t\t\t");
+				out << "\t\t\tlistener.on" << capitalize(member.m_name) << "(" << join(member.m_inArguments, "values_.", ", ") <<
+				");\n";
+				out << "\t\t\treturn MessageProcessingResult::Processed_OK;\n";
+				out << "\t\t}\n";
+			}
+			out << "\t\tdefault :\n";
+			out << "\t\t\treturn MessageProcessingResult::NotProcessed_OK;\n";
+			out << "\t\t}\n";
+			out << "\t}\n\n";
+		}
+
+		generateCommonMembers();
+
+		out << "\tConnection& m_connection;\n";
+		out << "\tSomeIP::InstanceID m_instanceID;\n";
+		out << "};\n\n";
+	}
+
+	void generateStub() {
+		out << "/**\n";
+		out << " * Server side of the " << m_interface.m_name << " interface. The Implementation class derives from this class and\n";
+		out << " * defines a method per method of the interface, which is called without any virtual call.\n";
+		out << " */\n";
+		out << "template<typename Implementation, typename Connection = SomeIPClient::ClientConnection>\n";
+		out << "class Stub {\n\n";
+		out << "public:\n";
+		out << "\tStub(Connection& connection, SomeIP::InstanceID instanceID = 0) : m_connection(connection), m_instanceID(instanceID) {\n";
+		out << "\t}\n\n";
+		out << "\tSomeIPReturnCode registerService() {\n";
+		out << "\t\treturn m_connection.registerService( getServiceIDs() );\n";
+		out << "\t}\n\n";
+		out << "\tSomeIPReturnCode unregisterService() {\n";
+		out << "\t\treturn m_connection.unregisterService( getServiceIDs() );\n";
+		out << "\t}\n\n";
+
+		// sort the members, so that the dense member IDs end up in consecutive cases of the switch
+		std::vector<const Member*> requests;
+		for (auto& member : m_interface.m_members)
+			if (member.m_kind != Member::Kind::EVENT)
+				requests.push_back(&member);
+		std::sort( requests.begin(), requests.end(), [] (const Member * a, const Member * b) {
+				   return a->m_memberID < b->m_memberID;
+			   } );
+
+		out << "\t/**\n";
+		out << "\t * Decodes the requests addressed to the service, and calls the corresponding method of the implementation\n";
+		out << "\t */\n";
+		out << "\tMessageProcessingResult processMessage(const InputMessage& msg) {\n";
+		out << "\t\tif ( !isOwnMessage(msg) )\n";
+		out << "\t\t\treturn MessageProcessingResult::NotProcessed_OK;\n\n";
+		out << "\t\t// the compiler turns this switch into a jump table when the member IDs are dense\n";
+		out << "\t\tswitch ( msg.getHeader().getMemberID() ) {\n";
+		for (auto member : requests)
+			out << "\t\tcase " << member->m_name << "_MEMBER_ID : return dispatch_" << member->m_name << "(msg);\n";
+		out << "\t\tdefault : return MessageProcessingResult::NotProcessed_OK;\n";
+		out << "\t\t}\n";
+		out << "\t}\n\n";
+
+		for (auto& member : m_interface.m_members) {
+			if (member.m_kind != Member::Kind::EVENT)
+				continue;
+			out << "\tSomeIPReturnCode fire" << capitalize(member.m_name) << "(" << parameterList(member.m_inArguments, {}) <<
+			") {\n";
+			out << "\t\tOutputMessage msg_ = createMessage(" << member.m_name << "_MEMBER_ID, SomeIP::MessageType::NOTIFICATION);\n";
+			generateWrite(member.m_inArguments, "\t\t");
+			out << "\t\treturn m_connection.sendMessage(msg_);\n";
+			out << "\t}\n\n";
+		}
+
+		generateCommonMembers();
+
+		for (auto member : requests) {
+			bool usesRequest = ( !member->m_inArguments.empty() || (member->m_kind == Member::Kind::METHOD) );
+			out << "\tMessageProcessingResult dispatch_" << member->m_name << "(const InputMessage&" <<
+			(usesRequest ? " request_" : "") << ") {\n";
+			if ( !member->m_inArguments.empty() )
+				generateRead(member->m_name + "_Arguments", "request_", "MessageProcessingResult::Processed_Error", "\t\t");
+
+			std::vector<std::string> callArguments;
+			for (auto& argument : member->m_inArguments)
+				callArguments.push_back("values_." + argument.m_name);
+			for (auto& argument : member->m_outArguments) {
+				out << "\t\t" << InterfaceParser::getCppType(argument.m_type) << " " << argument.m_name << "{};\n";
+				callArguments.push_back(argument.m_name);
+			}
+
+			out << "\t\tstatic_cast<Implementation*>(this)->" << member->m_name << "(";
+			for (size_t i = 0; i < callArguments.size(); i++)
+				out << (i == 0 ? "" : ", ") << callArguments[i];
+			out << ");\n";
+
+			if (member->m_kind == Member::Kind::METHOD) {
+				out << "\t\tif ( request_.getHeader().isRequestWithReturn() ) {\n";
+				out << "\t\t\tOutputMessage msg_ = createMethodReturn(request_);\n";
+				generateWrite(member->m_outArguments, "\t\t\t");
+				out << "\t\t\tm_connection.sendMessage(msg_);\n";
+				out << "\t\t}\n";
+			}
+
+			out << "\t\treturn MessageProcessingResult::Processed_OK;\n";
+			out << "\t}\n\n";
+		}
+
+		out << "\tConnection& m_connection;\n";
+		out << "\tSomeIP::InstanceID m_instanceID;\n";
+		out << "};\n\n";
+	}
+
+	const Interface& m_interface;
+	std::ostream& out;
+};
+
+int main(int argc, const char** argv) {
+
+	const char* outputDirectory = ".";
+
+	CommandLineParser commandLineParser(
+		"Code generator", "interface.someip", SOMEIP_PACKAGE_VERSION,
+		"This tool generates typed proxy and stub classes from an interface description\n"
+		"Example:\n\n"
+		"someip_codegen -o generated Calculator.someip\n"
+		"generates generated/Calculator.h\n"
+		"The header is named after the interface description file, up to its first dot, whatever the name of the interface"
+		);
+	commandLineParser.addOption(outputDirectory, "output", 'o', "Output directory");
+
+	if ( commandLineParser.parse(argc, argv) || (argc != 2) ) {
+		commandLineParser.printHelp();
+		exit(1);
+	}
+
+	const char* inputFileName = argv[1];
+	std::ifstream input(inputFileName);
+	if ( !input.is_open() ) {
+		std::cerr << "Can't open " << inputFileName << std::endl;
+		exit(1);
+	}
+
+	Interface interface;
+	InterfaceParser parser;
+	if ( !parser.parse(input, interface) ) {
+		std::cerr << inputFileName << ", " << parser.getError() << std::endl;
+		exit(1);
+	}
+
+	std::string sourceFileName = inputFileName;
+	auto slashPosition = sourceFileName.rfind('/');
+	if (slashPosition != std::string::npos)
+		sourceFileName = sourceFileName.substr(slashPosition + 1);
+
+	// named like the output of someip_generate_interface() in CMake, which only knows the file name
+	std::string outputFileName = std::string(outputDirectory) + "/" + sourceFileName.substr( 0, sourceFileName.find('.') ) + ".h";
+	std::ofstream output(outputFileName);
+	if ( !output.is_open() ) {
+		std::cerr << "Can't write " << outputFileName << std::endl;
+		exit(1);
+	}
+
+	CodeGenerator(interface, output).generate(sourceFileName);
+
+	return 0;
+}
@@ -63,6 +63,7 @@ public:
 			if (inputSourceID != UNREGISTERED_SOURCE)
 				g_source_remove(inputSourceID);
 			inputSourceID = UNREGISTERED_SOURCE;
+			m_isInputWatched = false;
 		}
 
 		void enable() override {
@@ -71,6 +72,12 @@ public:
 				GIOCondition condition = static_cast<GIOCondition>(0);
 				if (m_fd.events & POLLIN)
 					condition |= G_IO_IN;
+				if (m_fd.events & POLLPRI)
+					condition |= G_IO_PRI;
+				if (m_fd.events & POLLOUT)
+					condition |= G_IO_OUT;
+				if (m_fd.events & POLLERR)
+					condition |= G_IO_ERR;
 				if (m_fd.events & POLLHUP)
 					condition |= G_IO_HUP;
 
@@ -7,10 +7,14 @@
 #include <memory.h>
 //#include <atomic>
 #include <errno.h>
+#include <stdint.h>
 #include <type_traits>
 
 #include <assert.h>
 
+// SOMEIP_BYTE_ARRAY_STATIC_SIZE, as configured when the libraries were built
+#include "SomeIP-Config.h"
+
 #include "ivi-logging.h"
 
 namespace SomeIP_utils {
@@ -59,16 +63,90 @@ template<typename T> void removeFromVector(std::vector<T*>& v, T* elementToRemov
 	}
 }
 
-inline bool isNativeBigEndian() {
-	short int number = 1;
-	char* numPtr = (char*) &number;
-	return (numPtr[0] != 1);
+/**
+ * Returns true if the host is big endian. This is evaluated at compile time, so that no test is performed when converting
+ * the values.
+ */
+constexpr bool isNativeBigEndian() {
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+	return true;
+#else
+	return false;
+#endif
 }
 
+/**
+ * Reverses the byte order of a value, using the compiler builtins for the common sizes.
+ */
+template<size_t Size>
+struct ByteSwapper {
+	static void swap(void* data) {
+		char* chars = reinterpret_cast<char*>(data);
+		for (size_t i = 0; i < Size / 2; i++)
+			std::swap(chars[i], chars[Size - i - 1]);
+	}
+};
+
+template<>
+struct ByteSwapper<1> {
+	static void swap(void* data) {
+	}
+};
+
+template<>
+struct ByteSwapper<2> {
+	static void swap(void* data) {
+		uint16_t v;
+		memcpy( &v, data, sizeof(v) );
+		v = __builtin_bswap16(v);
+		memcpy( data, &v, sizeof(v) );
+	}
+};
+
+template<>
+struct ByteSwapper<4> {
+	static void swap(void* data) {
+		uint32_t v;
+		memcpy( &v, data, sizeof(v) );
+		v = __builtin_bswap32(v);
+		memcpy( data, &v, sizeof(v) );
+	}
+};
+
+template<>
+struct ByteSwapper<8> {
+	static void swap(void* data) {
+		uint64_t v;
+		memcpy( &v, data, sizeof(v) );
+		v = __builtin_bswap64(v);
+		memcpy( data, &v, sizeof(v) );
+	}
+};
+
 inline void swapBytes(void* data, size_t length) {
-	char* chars = reinterpret_cast<char*>(data);
-	for (size_t i = 0; i < length / 2; i++)
-		std::swap(chars[i], chars[length - i - 1]);
+	switch (length) {
+	case 1 : break;
+	case 2 : ByteSwapper<2>::swap(data); break;
+	case 4 : ByteSwapper<4>::swap(data); break;
+	case 8 : ByteSwapper<8>::swap(data); break;
+	default : {
+		char* chars = reinterpret_cast<char*>(data);
+		for (size_t i = 0; i < length / 2; i++)
+			std::swap(chars[i], chars[length - i - 1]);
+	}
+	break;
+	}
+}
+
+/**
+ * Reverses the byte order of each element of the given array. The loop is simple enough to be vectorized by the compiler.
+ */
+template<typename T>
+inline void swapArrayBytes(T* values, size_t count) {
+	static_assert(std::is_arithmetic<T>::value, "Only arithmetic types are supported");
+	unsigned char* data = reinterpret_cast<unsigned char*>(values);
+	for (size_t i = 0; i < count; i++)
+		ByteSwapper<sizeof(T)>::swap( data + i * sizeof(T) );
 }
 
 template<typename T>
@@ -77,20 +155,14 @@ inline T NativeToNetworkOrder(const T& v) {
 		return v;
 	else {
 		T networkValue = v;
-		swapBytes( &networkValue, sizeof(networkValue) );
+		ByteSwapper<sizeof(T)>::swap(&networkValue);
 		return networkValue;
 	}
 }
 
 template<typename T>
 inline T NetworkToNativeOrder(const T& v) {
-	if ( isNativeBigEndian() )
-		return v;
-	else {
-		T networkValue = v;
-		swapBytes( &networkValue, sizeof(networkValue) );
-		return networkValue;
-	}
+	return NativeToNetworkOrder(v);
 }
 
 /**
@@ -99,6 +171,8 @@ inline T NetworkToNativeOrder(const T& v) {
 class ByteArray {
 
 public:
+	static const size_t STATIC_SIZE = SOMEIP_BYTE_ARRAY_STATIC_SIZE;
+
 	ByteArray() {
 		m_dynamicData = NULL;
 		m_length = 0;
@@ -110,12 +184,33 @@ public:
 
 	ByteArray(const ByteArray& b) {
 		// duplicate content
+		reserve( b.size() );
 		append( b.getData(), b.size() );
 	}
 
+	/**
+	 * Takes over the heap buffer of the given array, or copies the used part of its static buffer
+	 */
+	ByteArray(ByteArray&& b) noexcept {
+		moveFrom(b);
+	}
+
 	ByteArray& operator=(const ByteArray& right) {
-		resize( right.size() );
-		memcpy( getData(), right.getData(), right.size() );
+		if (this != &right) {
+			resize( right.size() );
+			memcpy( getData(), right.getData(), right.size() );
+		}
+		return *this;
+	}
+
+	ByteArray& operator=(ByteArray&& right) noexcept {
+		if (this != &right) {
+			if ( !usesStaticBuffer() ) {
+				delete (m_dynamicData);
+				m_dynamicData = nullptr;
+			}
+			moveFrom(right);
+		}
 		return *this;
 	}
 
@@ -168,6 +263,23 @@ public:
 
 	}
 
+	/**
+	 * Makes sure that the given number of bytes can be stored without further allocation
+	 */
+	void reserve(size_t capacity) {
+		if ( capacity <= sizeof(m_staticData) )
+			return;
+
+		if ( usesStaticBuffer() ) {
+			m_dynamicData = new std::vector<unsigned char>();
+			m_dynamicData->reserve(capacity);
+			m_dynamicData->resize(m_length);
+			memcpy(m_dynamicData->data(), m_staticData, m_length);
+			m_length = -1; // this field is not relevant anymore
+		} else
+			m_dynamicData->reserve(capacity);
+	}
+
 	void writeAt(size_t position, const void* rawDataPtr, size_t sizeInByte) {
 		assert(m_length >= position + sizeInByte);
 		memcpy(&(getData()[position]), rawDataPtr, sizeInByte);
@@ -201,8 +313,20 @@ public:
 	}
 
 private:
+	void moveFrom(ByteArray& b) {
+		if ( b.usesStaticBuffer() ) {
+			m_length = b.m_length;
+			memcpy(m_staticData, b.m_staticData, m_length);
+		} else {
+			m_dynamicData = b.m_dynamicData;
+			m_length = -1;
+			b.m_dynamicData = nullptr;
+		}
+		b.m_length = 0;
+	}
+
 	std::vector<unsigned char>* m_dynamicData = nullptr;
-	unsigned char m_staticData[1024];
+	unsigned char m_staticData[STATIC_SIZE];
 	size_t m_length = 0;
 };
 
@@ -8,6 +8,9 @@ namespace SomeIP_utils {
 
 LOG_IMPORT_CONTEXT(serializationContext);
 
+/// Uncomment to get a trace for every serialized value. This is very expensive, so it is disabled by default
+//#define ENABLE_SERIALIZATION_TRACES
+
 /**
  * Template serializer class which supports optional conversion to network byte order, and data alignment.
  */
@@ -92,21 +95,22 @@ public:
 
 		_BasicType networkOrderedValue = (convertToNetworkByteOrder ? NativeToNetworkOrder(basicValue) : basicValue);
 
+#ifdef ENABLE_SERIALIZATION_TRACES
 		log_verbose() << "Writing simple type at index " << payload_.size() << ", " <<
 		byteArrayToString( &networkOrderedValue, sizeof(networkOrderedValue) );
+#endif
 
 		writeRawData( reinterpret_cast<const char*>(&networkOrderedValue), sizeof(networkOrderedValue) );
 	}
 
 	template<typename _BasicType>
 	void writeBasicTypeValueAt(const _BasicType& basicValue, size_t position) {
-		if (alignmentNeeded)
-			alignToBoundary( sizeof(_BasicType) );
-
 		_BasicType networkOrderedValue = (convertToNetworkByteOrder ? NativeToNetworkOrder(basicValue) : basicValue);
 
+#ifdef ENABLE_SERIALIZATION_TRACES
 		log_verbose() << "Writing simple type at index " << position << " , " <<
 		byteArrayToString( &networkOrderedValue, sizeof(networkOrderedValue) );
+#endif
 
 		writeRawDataAt(reinterpret_cast<const char*>(&networkOrderedValue), sizeof(networkOrderedValue), position);
 	}
@@ -115,6 +119,23 @@ public:
 		payload_.append(rawDataPtr, sizeInByte);
 	}
 
+	/**
+	 * Writes an array of arithmetic values with a single copy, followed by a byte-swap of the whole block if needed.
+	 */
+	template<typename _BasicType>
+	void writeArray(const _BasicType* values, size_t count) {
+		if (alignmentNeeded)
+			alignToBoundary( sizeof(_BasicType) );
+
+		size_t position = payload_.size();
+		writeRawData(values, count * sizeof(_BasicType) );
+
+		if ( convertToNetworkByteOrder && !isNativeBigEndian() && (sizeof(_BasicType) > 1) ) {
+			// swapArrayBytes() does not require the data to be aligned
+			swapArrayBytes(reinterpret_cast<_BasicType*>(payload_.getData() + position), count);
+		}
+	}
+
 	void writeValueAt(const uint32_t& v, size_t position) {
 		writeBasicTypeValueAt(v, position);
 	}
@@ -125,9 +146,8 @@ public:
 	}
 
 	void alignToBoundary(size_t alignBoundary) {
-		size_t paddingSize = payload_.size() % alignBoundary;
+		size_t paddingSize = (alignBoundary - payload_.size() % alignBoundary) % alignBoundary;
 		payload_.skip(paddingSize);
-		log_verbose() << "Inserted " << paddingSize << " bytes padding";
 	}
 
 protected:
@@ -212,9 +232,8 @@ public:
 	}
 
 	void alignToBoundary(size_t alignBoundary) {
-		size_t paddingSize = currentDataPosition_ % alignBoundary;
+		size_t paddingSize = (alignBoundary - currentDataPosition_ % alignBoundary) % alignBoundary;
 		currentDataPosition_ += paddingSize;
-		log_verbose() << "Skipped " << paddingSize << " bytes padding";
 	}
 
 	const unsigned char* readRawData(size_t numBytesToRead) {
@@ -227,6 +246,20 @@ public:
 		memcpy(destinationBuffer, readRawData(numBytesToRead), numBytesToRead);
 	}
 
+	/**
+	 * Reads an array of arithmetic values with a single copy, followed by a byte-swap of the whole block if needed.
+	 */
+	template<typename _BasicType>
+	void readArray(_BasicType* values, size_t count) {
+		if (alignmentNeeded)
+			alignToBoundary( sizeof(_BasicType) );
+
+		readRawData( values, count * sizeof(_BasicType) );
+
+		if ( convertToNetworkByteOrder && !isNativeBigEndian() && (sizeof(_BasicType) > 1) )
+			swapArrayBytes(values, count);
+	}
+
 	bool hasMoreData() const {
 		return (remainingBytesCount() > 0);
 	}
@@ -244,13 +277,13 @@ public:
 		if (alignmentNeeded)
 			alignToBoundary( sizeof(Type) );
 
-		auto index = currentDataPosition_;
-		(void) index;
 		auto p = readRawData( sizeof(Type) );
-		val = *( reinterpret_cast<const Type*>(p) );
+		memcpy( &val, p, sizeof(val) );
 
-		log_verbose() << "Reading simple type from index " << index << " " <<
-		byteArrayToString( p, sizeof(val) ) << "currentDataPosition_";
+#ifdef ENABLE_SERIALIZATION_TRACES
+		log_verbose() << "Reading simple type from index " << (currentDataPosition_ - sizeof(Type)) << " " <<
+		byteArrayToString( p, sizeof(val) );
+#endif
 
 		if (convertToNetworkByteOrder)
 			val = NetworkToNativeOrder(val);